@@ -279,6 +279,59 @@
 //#define MBEDTLS_AES_ENCRYPT_ALT
 //#define MBEDTLS_AES_DECRYPT_ALT
 
+/**
+ * \def MBEDTLS_ECP_INTERNAL_ALT
+ *
+ * Expose a part of the internal interface of the Elliptic Curve Point module.
+ *
+ * MBEDTLS_ECP__FUNCTION_NAME__ALT: Uncomment a macro to let mbed TLS use your
+ * alternative core implementation of elliptic curve arithmetic. Keep in mind
+ * that function prototypes should remain the same.
+ *
+ * This partially replaces one function. The header file from mbed TLS is still
+ * used, in contrast to the MBEDTLS_ECP_ALT flag. The original implementation
+ * is still present and it is used for group structures not supported by the
+ * alternative.
+ *
+ * Any of these options become available by defining MBEDTLS_ECP_INTERNAL_ALT
+ * and implementing the following functions:
+ *      unsigned char mbedtls_internal_ecp_grp_capable(
+ *          const mbedtls_ecp_group *grp )
+ *      int  mbedtls_internal_ecp_init( const mbedtls_ecp_group *grp )
+ *      void mbedtls_internal_ecp_deinit( const mbedtls_ecp_group *grp )
+ * The mbedtls_internal_ecp_grp_capable function should return 1 if the
+ * replacement functions implement arithmetic for the given group and 0
+ * otherwise.
+ * The functions mbedtls_internal_ecp_init and mbedtls_internal_ecp_deinit are
+ * called before and after each point operation and provide an opportunity to
+ * implement optimized set up and tear down instructions.
+ *
+ * Example: In case you uncomment MBEDTLS_ECP_INTERNAL_ALT and
+ * MBEDTLS_ECP_DOUBLE_JAC_ALT, mbed TLS will still provide the ecp_double_jac
+ * function, but will use your mbedtls_internal_ecp_double_jac if the group is
+ * supported (your mbedtls_internal_ecp_grp_capable function returns 1 when
+ * receives it as an argument). If the group is not supported then the original
+ * implementation is used. The other functions and the definition of
+ * mbedtls_ecp_group and mbedtls_ecp_point will not change, so your
+ * implementation of mbedtls_internal_ecp_double_jac and
+ * mbedtls_internal_ecp_grp_capable must be compatible with this definition.
+ *
+ * Uncomment a macro to enable alternate implementation of the corresponding
+ * function.
+ */
+/* Required for all the functions in this section */
+//#define MBEDTLS_ECP_INTERNAL_ALT
+/* Support for Weierstrass curves with Jacobi representation */
+//#define MBEDTLS_ECP_RANDOMIZE_JAC_ALT
+//#define MBEDTLS_ECP_ADD_MIXED_ALT
+//#define MBEDTLS_ECP_DOUBLE_JAC_ALT
+//#define MBEDTLS_ECP_NORMALIZE_JAC_MANY_ALT
+//#define MBEDTLS_ECP_NORMALIZE_JAC_ALT
+/* Support for curves with Montgomery arithmetic */
+//#define MBEDTLS_ECP_DOUBLE_ADD_MXZ_ALT
+//#define MBEDTLS_ECP_RANDOMIZE_MXZ_ALT
+//#define MBEDTLS_ECP_NORMALIZE_MXZ_ALT
+
 /**
  * \def MBEDTLS_TEST_NULL_ENTROPY
  *
@@ -457,6 +510,20 @@
  */
 #define MBEDTLS_ECP_NIST_OPTIM
 
+/**
+ * \def MBEDTLS_ECP_FIXED_POINT_ROM_TABLES
+ *
+ * Keep the comb table of the secp256r1 base point in ROM (about 1 KB of
+ * constants) instead of computing it in RAM at each multiplication.
+ *
+ * Speeds up key generation, ECDSA signature and half of ECDSA verification,
+ * whatever MBEDTLS_ECP_WINDOW_SIZE and MBEDTLS_ECP_FIXED_POINT_OPTIM are set
+ * to, without any RAM cost.
+ *
+ * Comment this macro to drop the table.
+ */
+#define MBEDTLS_ECP_FIXED_POINT_ROM_TABLES
+
 /**
  * \def MBEDTLS_ECDSA_DETERMINISTIC
  *
@@ -1095,6 +1162,23 @@
  */
 #define MBEDTLS_SSL_MAX_FRAGMENT_LENGTH
 
+/**
+ * \def MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH
+ *
+ * Resize the I/O buffers of an SSL context at the end of the handshake,
+ * according to the negotiated max_fragment_length, so that a context which
+ * negotiated a small MFL does not keep two MBEDTLS_SSL_MAX_CONTENT_LEN
+ * buffers allocated for its whole life. The buffers get back to their full
+ * size on session reset.
+ *
+ * Not applied when renegotiation is enabled at run time, nor to DTLS.
+ *
+ * Requires: MBEDTLS_SSL_MAX_FRAGMENT_LENGTH
+ *
+ * Comment this macro to keep fixed-size buffers
+ */
+#define MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH
+
 /**
  * \def MBEDTLS_SSL_PROTO_SSL3
  *
@@ -1154,6 +1238,10 @@
  * Requires: MBEDTLS_SSL_PROTO_TLS1_1
  *        or MBEDTLS_SSL_PROTO_TLS1_2
  *
+ * Project option: NET_PROTO_DTLS sockets. About 9 kB of code, and each TLS
+ * socket keeps the session of its last DTLS handshake. The anti-replay and
+ * HelloVerifyRequest options below follow it.
+ *
  * Comment this macro to disable support for DTLS
  */
 //#define MBEDTLS_SSL_PROTO_DTLS
@@ -1180,7 +1268,9 @@
  *
  * Comment this to disable anti-replay in DTLS.
  */
-//#define MBEDTLS_SSL_DTLS_ANTI_REPLAY
+#if defined(MBEDTLS_SSL_PROTO_DTLS)
+#define MBEDTLS_SSL_DTLS_ANTI_REPLAY
+#endif
 
 /**
  * \def MBEDTLS_SSL_DTLS_HELLO_VERIFY
@@ -1196,9 +1286,14 @@
  *
  * Requires: MBEDTLS_SSL_PROTO_DTLS
  *
+ * A server built with MBEDTLS_SSL_SRV_C gets its cookie callbacks from
+ * net_tls_conf_dtls_cookies(). The default ones reject every client.
+ *
  * Comment this to disable support for HelloVerifyRequest.
  */
-//#define MBEDTLS_SSL_DTLS_HELLO_VERIFY
+#if defined(MBEDTLS_SSL_PROTO_DTLS)
+#define MBEDTLS_SSL_DTLS_HELLO_VERIFY
+#endif
 
 /**
  * \def MBEDTLS_SSL_DTLS_CLIENT_PORT_REUSE
@@ -1860,6 +1955,29 @@
  */
 //#define MBEDTLS_HAVEGE_C
 
+/**
+ * \def MBEDTLS_HW_CRYPTO_C
+ *
+ * Enable the hardware crypto hooks: board drivers register AES, SHA-256 and
+ * ECP point arithmetic routines with mbedtls_hw_crypto_register() and the
+ * library falls back to software for anything not registered.
+ *
+ * Module:  library/hw_crypto.c
+ * Caller:  library/aes.c
+ *          library/sha256.c
+ *          library/ecp.c
+ *
+ * Requires: at least one of MBEDTLS_AES_ENCRYPT_ALT, MBEDTLS_AES_DECRYPT_ALT,
+ *           MBEDTLS_SHA256_PROCESS_ALT or MBEDTLS_ECP_INTERNAL_ALT
+ *
+ * Off here: the STM32L475 has no AES, HASH or PKA engine, and the hooks would
+ * only add a call through an empty table. A board which registers hooks turns
+ * them on with httpclient_mbedtls_hw_crypto_config.h.
+ *
+ * Uncomment to enable the hardware crypto hooks.
+ */
+//#define MBEDTLS_HW_CRYPTO_C
+
 /**
  * \def MBEDTLS_HMAC_DRBG_C
  *
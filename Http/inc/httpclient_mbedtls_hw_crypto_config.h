@@ -0,0 +1,37 @@
+/**
+ * \file httpclient_mbedtls_hw_crypto_config.h
+ *
+ * \brief Hardware crypto hooks, for a board with AES, HASH or PKA engines
+ *
+ *  Applied on top of httpclient_mbedtls_config.h when the project is built
+ *  with
+ *
+ *      -DMBEDTLS_USER_CONFIG_FILE="\"httpclient_mbedtls_hw_crypto_config.h\""
+ *
+ *  The board code must register its drivers with mbedtls_hw_crypto_register()
+ *  before the first TLS connection, see mbedtls/hw_crypto.h. Leave out the
+ *  entry points the board has no engine for: each one costs a call through
+ *  the hook table, and falls back to software when no hook is registered.
+ *
+ *  Not for the STM32L475, which has none of these engines.
+ */
+
+#ifndef HTTPCLIENT_MBEDTLS_HW_CRYPTO_CONFIG_H
+#define HTTPCLIENT_MBEDTLS_HW_CRYPTO_CONFIG_H
+
+#define MBEDTLS_HW_CRYPTO_C
+
+/* AES engine: block encryption and decryption. The key schedule stays in software. */
+#define MBEDTLS_AES_ENCRYPT_ALT
+#define MBEDTLS_AES_DECRYPT_ALT
+
+/* HASH engine: SHA-256 block compression */
+#define MBEDTLS_SHA256_PROCESS_ALT
+
+/* PKA engine: point addition, doubling and normalization on short Weierstrass curves */
+#define MBEDTLS_ECP_INTERNAL_ALT
+#define MBEDTLS_ECP_ADD_MIXED_ALT
+#define MBEDTLS_ECP_DOUBLE_JAC_ALT
+#define MBEDTLS_ECP_NORMALIZE_JAC_ALT
+
+#endif /* HTTPCLIENT_MBEDTLS_HW_CRYPTO_CONFIG_H */
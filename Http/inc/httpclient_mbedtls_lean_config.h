@@ -0,0 +1,73 @@
+/**
+ * \file httpclient_mbedtls_lean_config.h
+ *
+ * \brief Lean ECC-only TLS client profile
+ *
+ *  Applied on top of httpclient_mbedtls_config.h when the project is built
+ *  with
+ *
+ *      -DMBEDTLS_USER_CONFIG_FILE="\"httpclient_mbedtls_lean_config.h\""
+ *
+ *  Only ECDHE-ECDSA over secp256r1 with AES-128-GCM is kept: no RSA, no DHM,
+ *  no other curve and no server side session caches. The servers must
+ *  present an ECDSA P-256 certificate chain (eg. Amazon Root CA 3).
+ *
+ *  The matching run time restriction for a default build is the
+ *  "tls_profile" socket option, see net.h.
+ */
+
+#ifndef HTTPCLIENT_MBEDTLS_LEAN_CONFIG_H
+#define HTTPCLIENT_MBEDTLS_LEAN_CONFIG_H
+
+/* Curves: secp256r1 only, its base point comb table in ROM */
+#undef MBEDTLS_ECP_DP_SECP192R1_ENABLED
+#undef MBEDTLS_ECP_DP_SECP224R1_ENABLED
+#undef MBEDTLS_ECP_DP_SECP384R1_ENABLED
+#undef MBEDTLS_ECP_DP_SECP521R1_ENABLED
+#undef MBEDTLS_ECP_DP_SECP192K1_ENABLED
+#undef MBEDTLS_ECP_DP_SECP224K1_ENABLED
+#undef MBEDTLS_ECP_DP_SECP256K1_ENABLED
+#undef MBEDTLS_ECP_DP_BP256R1_ENABLED
+#undef MBEDTLS_ECP_DP_BP384R1_ENABLED
+#undef MBEDTLS_ECP_DP_BP512R1_ENABLED
+#undef MBEDTLS_ECP_DP_CURVE25519_ENABLED
+
+#if !defined(MBEDTLS_ECP_FIXED_POINT_ROM_TABLES)
+#define MBEDTLS_ECP_FIXED_POINT_ROM_TABLES
+#endif
+
+/* Key exchanges: ECDHE-ECDSA only */
+#undef MBEDTLS_KEY_EXCHANGE_PSK_ENABLED
+#undef MBEDTLS_KEY_EXCHANGE_DHE_PSK_ENABLED
+#undef MBEDTLS_KEY_EXCHANGE_ECDHE_PSK_ENABLED
+#undef MBEDTLS_KEY_EXCHANGE_RSA_PSK_ENABLED
+#undef MBEDTLS_KEY_EXCHANGE_RSA_ENABLED
+#undef MBEDTLS_KEY_EXCHANGE_DHE_RSA_ENABLED
+#undef MBEDTLS_KEY_EXCHANGE_ECDHE_RSA_ENABLED
+#undef MBEDTLS_KEY_EXCHANGE_ECDH_ECDSA_ENABLED
+#undef MBEDTLS_KEY_EXCHANGE_ECDH_RSA_ENABLED
+
+/* No RSA or finite field DH */
+#undef MBEDTLS_X509_RSASSA_PSS_SUPPORT
+#undef MBEDTLS_PKCS1_V15
+#undef MBEDTLS_PKCS1_V21
+#undef MBEDTLS_GENPRIME
+#undef MBEDTLS_RSA_C
+#undef MBEDTLS_DHM_C
+
+/* Ciphers and hashes no remaining suite uses */
+#undef MBEDTLS_CIPHER_MODE_CFB
+#undef MBEDTLS_DES_C
+#undef MBEDTLS_CCM_C
+#undef MBEDTLS_RIPEMD160_C
+#undef MBEDTLS_PKCS12_C
+
+/* Client only: server side caches */
+#undef MBEDTLS_SSL_CACHE_C
+#undef MBEDTLS_SSL_COOKIE_C
+#undef MBEDTLS_SSL_TICKET_C
+
+#undef MBEDTLS_SSL_CIPHERSUITES
+#define MBEDTLS_SSL_CIPHERSUITES MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256
+
+#endif /* HTTPCLIENT_MBEDTLS_LEAN_CONFIG_H */
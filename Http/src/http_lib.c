@@ -49,6 +49,7 @@
 #include "http_lib.h"
 #include "msg.h"
 #include "net.h"
+#include "net_pool.h"
 
 /* Private defines -----------------------------------------------------------*/
 #define HTTP_MAX_HOST_SIZE        80      /**< Max length of the http server hostname. */
@@ -75,12 +76,26 @@ typedef struct {
   bool tls_verify_server;
   char query[HTTP_MAX_QUERY_SIZE];    /**< HTTP query parsed from the URL. */
   bool connection_is_open;            /**< connection status. */
+  bool keep_alive;                    /**< The last response was completely read, and the server keeps the connection open. */
   uint8_t buffer[HTTP_BUFFER_SIZE];   /**< work buffer  */
 } http_context_t;
 
+/**
+ * @brief Search of the empty line which ends the header of a response, in the bytes as they are received.
+ */
+typedef struct {
+  uint32_t offset;                    /**< Bytes scanned. */
+  uint32_t matched;                   /**< Bytes of CR-LF-CR-LF found at the end of the bytes scanned. */
+  int32_t body;                       /**< Offset of the body, or -1 until the header end is found. */
+} http_scan_t;
+
 /* Private variables ---------------------------------------------------------*/
 /* Private function prototypes -----------------------------------------------*/
 uint8_t * http_find_headers(uint8_t * http_message, unsigned int len);
+static const char * http_header_find(const uint8_t * header, uint32_t len, const char * name);
+static bool http_response_keeps_alive(const uint8_t * header, uint32_t len);
+static int http_recv_scan(http_context_t * pCtx, uint8_t * buffer, uint32_t length, http_scan_t * scan);
+static void http_scan_header(http_scan_t * scan, const uint8_t * data, uint32_t len);
 
 /* Functions Definition ------------------------------------------------------*/
 
@@ -104,6 +119,15 @@ int http_create_session(http_handle_t * const pHnd, const char *host, int port,
 
   bool tls = (pCtx->protocol==HTTP_PROTO_HTTPS);
   
+  /* An idle keep-alive connection to the same server skips the TCP and TLS setup. */
+  if (net_pool_get(hnet, (tls == true) ? NET_PROTO_TLS : NET_PROTO_TCP, pCtx->hostname, pCtx->port, &pCtx->sock) == NET_OK)
+  {
+    msg_debug("Reusing a connection to %s:%d\n", pCtx->hostname, pCtx->port);
+    pCtx->connection_is_open = true;
+    *pHnd = (http_handle_t) pCtx;
+    return HTTP_OK;
+  }
+
   ret = net_sock_create(hnet, &pCtx->sock, (tls == true) ? NET_PROTO_TLS : NET_PROTO_TCP);
   if (NET_OK != ret)
   {
@@ -126,6 +150,11 @@ int http_connect(http_handle_t Hnd)
     return HTTP_ERR;
   }
 
+  if (pCtx->connection_is_open)
+  {
+    return HTTP_OK;   /* Reused from the connection pool by http_create_session(). */
+  }
+
   ret = net_sock_open(pCtx->sock, (const char *) pCtx->hostname,NULL,  pCtx->port, 0);
   if (NET_OK != ret)
   {
@@ -143,6 +172,8 @@ int http_connect(http_handle_t Hnd)
 /**
  * @brief   Close an HTTP progressive download session.
  * @note    The internal session context is freed by the callee.
+ *          If the last response was completely read and the server keeps the connection alive,
+ *          the connection is handed over to the netsock connection pool instead of being closed.
  * @param   In: hnd   Session handle.
  * @retval  Error code
  *            HTTP_OK   (0)  Success
@@ -153,7 +184,13 @@ int http_close(const http_handle_t hnd)
   int rc = HTTP_ERR;
   
   http_context_t * pCtx = (http_context_t *) hnd;
-  if (pCtx != NULL)
+  if ((pCtx != NULL) && pCtx->connection_is_open && pCtx->keep_alive)
+  {
+    (void) net_pool_put(pCtx->sock, pCtx->hostname, pCtx->port);
+    http_free(pCtx);
+    rc = HTTP_OK;
+  }
+  else if (pCtx != NULL)
   {
     int ret = 0;
     ret = net_sock_close(pCtx->sock);
@@ -276,6 +313,7 @@ int http_send(http_handle_t hnd, uint8_t * buffer, uint32_t length)
   /* send request */
   msg_debug("http_send (%lu):\n%.*s\n", length, (int)length, buffer);
 
+  pCtx->keep_alive = false;
   rc = net_sock_send(pCtx->sock, buffer, length);
   msg_debug("net_sock_send() rc = %d\n", rc);
 
@@ -287,6 +325,7 @@ int http_recv(http_handle_t hnd, uint8_t * buffer, uint32_t length)
   http_context_t * pCtx = (http_context_t *) hnd;
   int rc = HTTP_OK;
 
+  pCtx->keep_alive = false;   /* The caller parses the response: the connection state is unknown. */
   rc = net_sock_recv(pCtx->sock, buffer, length);
   msg_debug("net_sock_recv() rc = %d\n", rc);
   return rc;
@@ -298,32 +337,35 @@ int http_recv_response(http_handle_t hnd, uint8_t * buffer, uint32_t buffer_leng
   int received = 0;
   uint8_t *pBody = NULL;
   uint32_t read_offset = 0;
-  uint32_t body_length = 0;
   uint32_t content_length = 0;
   uint32_t response_length = 0;
+  bool complete = false;
+  http_scan_t scan = { 0, 0, -1 };
   
   response_length = buffer_length;
+  pCtx->keep_alive = false;
 
   do
   {
-    received = net_sock_recv(pCtx->sock, buffer + read_offset, buffer_length - read_offset);
+    received = http_recv_scan(pCtx, buffer + read_offset, buffer_length - read_offset, &scan);
     msg_debug("net_sock_recv() received = %d", received);
     if (received >= 0)
     {
       read_offset += received;
       if (pBody == NULL)
       {
-        body_length = read_offset;
-        pBody = http_find_body(buffer, &body_length);
+        pBody = (scan.body >= 0) ? (buffer + scan.body) : NULL;
         if (pBody != NULL)
         {
           content_length = http_content_length(buffer, read_offset);
           response_length = pBody - buffer + content_length;
           msg_debug("buffer=%s pBody=%d content-length=%ld response_length=%ld",
                     buffer, (int)pBody, content_length, response_length);
+          complete = true;
           if (response_length > buffer_length)
           {
             response_length = buffer_length;
+            complete = false;
           }
         }
       }
@@ -331,6 +373,11 @@ int http_recv_response(http_handle_t hnd, uint8_t * buffer, uint32_t buffer_leng
       break;
     }
   } while ((received > 0) && (read_offset < response_length));
+
+  /* The connection may serve another request only if nothing of this response is left unread. */
+  pCtx->keep_alive = complete && (received >= 0) && (read_offset == response_length)
+                     && http_response_keeps_alive(buffer, pBody - buffer);
+
   if (received < 0)
   {
     return received;
@@ -390,6 +437,7 @@ int http_get(const http_handle_t hnd,
   /* send request */
   msg_debug("sending request (%d):\n%s", header_size, pCtx->buffer);
 
+  pCtx->keep_alive = false;
   rc = net_sock_send(pCtx->sock, (uint8_t *) pCtx->buffer, header_size);
   msg_debug("net_sock_send() rc = %d", rc);
   if (rc <= 0)
@@ -488,6 +536,7 @@ int http_post(const http_handle_t hnd,
   msg_debug("post buffer (%lu):\n%.*s", header_size + postbuffer_size,
             (int)(header_size + postbuffer_size), pCtx->buffer);
   /* send request */
+  pCtx->keep_alive = false;
   len = net_sock_send(pCtx->sock, pCtx->buffer, header_size + postbuffer_size);
   msg_debug("post net_sock_send: len=%d\n", len);
   if (len < 0)
@@ -549,6 +598,7 @@ int http_put(const http_handle_t hnd,
   memcpy(pCtx->buffer + header_size, putbuffer, putbuffer_size);
   /* send request */
   msg_debug("sending request (%lu):\n%.*s\n", header_size + putbuffer_size, (int)(header_size + putbuffer_size), pCtx->buffer);
+  pCtx->keep_alive = false;
   len = net_sock_send(pCtx->sock, pCtx->buffer, header_size + putbuffer_size);
   msg_debug("put net_sock_send: len=%d\n", len);
   if (len < 0)
@@ -593,6 +643,7 @@ int http_delete(const http_handle_t hnd, const char * resource, const char * add
                additional_headers
              );
   /* send request */
+  pCtx->keep_alive = false;
   len = net_sock_send(pCtx->sock, pCtx->buffer, header_size);
   msg_debug("delete net_sock_send: len=%d\n", len);
   if (len < 0)
@@ -736,6 +787,122 @@ uint32_t http_content_length(uint8_t * buffer, uint32_t len)
   return 0;
 }
 
+/**
+  * @brief  Find a header line in an HTTP message header.
+  * @arg    header: pointer to the HTTP message
+  * @arg    len: length of the header part
+  * @arg    name: header name with its colon, eg. "Connection:". Case insensitive.
+  * @retval pointer to the header value, or NULL if not found
+  */
+static const char * http_header_find(const uint8_t * header, uint32_t len, const char * name)
+{
+  size_t name_len = strlen(name);
+  uint32_t i = 0;
+
+  for (i = 0; (i + name_len) < len; i++)
+  {
+    if (((i == 0) || (header[i - 1] == '\n'))
+        && (strncasecmp((const char *) &header[i], name, name_len) == 0))
+    {
+      const char * v = (const char *) &header[i + name_len];
+      while (*v == ' ')
+      {
+        v++;
+      }
+      return v;
+    }
+  }
+  return NULL;
+}
+
+/**
+  * @brief  Receive into buffer, and scan what is received for the end of the header. On a zero-copy
+  *         socket, the bytes are scanned in the receive buffer of the network stack, then copied once.
+  * @arg    buffer: where the bytes are received
+  * @arg    length: room in buffer
+  * @arg    scan: state of the scan, kept from a call to the next
+  * @retval bytes received, or the net_sock_recv() error
+  */
+static int http_recv_scan(http_context_t * pCtx, uint8_t * buffer, uint32_t length, http_scan_t * scan)
+{
+  net_buf_t view;
+  int rc = 0;
+
+  if (!net_sock_is_zero_copy(pCtx->sock))
+  {
+    rc = net_sock_recv(pCtx->sock, buffer, length);
+    if (rc > 0)
+    {
+      http_scan_header(scan, buffer, rc);
+    }
+    return rc;
+  }
+
+  rc = net_sock_recv_buf(pCtx->sock, &view, length);
+  if (rc > 0)
+  {
+    http_scan_header(scan, view.data, rc);
+    memcpy(buffer, view.data, rc);
+  }
+  (void) net_sock_release_buf(pCtx->sock, &view);
+  return rc;
+}
+
+/**
+  * @brief  Look for the CR-LF-CR-LF which ends the header, in the next bytes of a response.
+  * @arg    scan: state of the scan. scan->body is set once the header end is found.
+  * @arg    data: next bytes of the response
+  * @arg    len: number of bytes
+  */
+static void http_scan_header(http_scan_t * scan, const uint8_t * data, uint32_t len)
+{
+  static const char end[] = "\r\n\r\n";
+  uint32_t i = 0;
+
+  for (i = 0; (i < len) && (scan->body < 0); i++)
+  {
+    if (data[i] == end[scan->matched])
+    {
+      scan->matched++;
+    }
+    else
+    {
+      scan->matched = (data[i] == '\r') ? 1 : 0;
+    }
+    if (scan->matched == 4)
+    {
+      scan->body = (int32_t) (scan->offset + i + 1);
+    }
+  }
+  scan->offset += len;
+}
+
+/**
+  * @brief  Tell whether the connection may be kept alive after a response, whose body length
+  *         is known from its header.
+  * @arg    header: pointer to the HTTP response
+  * @arg    len: length of the header part
+  * @retval true if the connection may be reused.
+  */
+static bool http_response_keeps_alive(const uint8_t * header, uint32_t len)
+{
+  const char * conn = http_header_find(header, len, "Connection:");
+  uint32_t status = http_response_status((uint8_t *) header, len);
+
+  if ((len < 8) || (memcmp(header, HTTP_HEADER HTTP_VERSION, 8) != 0))
+  {
+    return false;   /* HTTP/1.0 closes by default. */
+  }
+  if ((conn != NULL) && (strncasecmp(conn, "close", 5) == 0))
+  {
+    return false;
+  }
+  if (http_header_find(header, len, "Transfer-Encoding:") != NULL)
+  {
+    return false;   /* Chunked bodies are not parsed by http_recv_response(). */
+  }
+  return (http_header_find(header, len, "Content-Length:") != NULL) || (status == 204) || (status == 304);
+}
 
 
 /************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
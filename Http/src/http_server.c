@@ -12,11 +12,19 @@
 
 #include "http_server.h"
 #include "msg.h"
+#include "net_sup.h"
 
 
 #define HTTP_ERR_LIMIT        5
 #define HTTP_NET_DOWN_LIMIT   3
 #define HTTP_RESTART_DELAY_MS 50
+#define HTTP_RESTART_MIN_MS   1000    /* restart backoff, see net_sup.h */
+#define HTTP_RESTART_MAX_MS   60000
+#define HTTP_LINKUP_SPREAD_MS 2000
+
+/* Survives http_srv_restart(), which re-enters http_srv_run() through http_srv_init(). */
+static net_sup_t http_sup;
+static bool http_sup_inited = false;
 
 
 
@@ -386,6 +394,14 @@ void http_srv_run(http_srv_t *hs)
 {
     uint32_t err_count = 0;
     uint32_t netdown_count = 0;
+    bool restart = false;
+
+    if (!http_sup_inited) {
+        /* No breaker: the endpoint is our own listening socket, it must come back. */
+        net_sup_conf_t conf = { HTTP_RESTART_MIN_MS, HTTP_RESTART_MAX_MS, 0, 0, HTTP_LINKUP_SPREAD_MS };
+        net_sup_init(&http_sup, "http", hs->nethnd, &conf);
+        http_sup_inited = true;
+    }
 
     hs->state = HTTP_SRV_STATE_RUNNING;
 
@@ -395,11 +411,9 @@ void http_srv_run(http_srv_t *hs)
         if (!net_is_up(hs->nethnd)) {
             netdown_count++;
             if (netdown_count >= HTTP_NET_DOWN_LIMIT) {
-                msg_error("HTTP: network down, restarting server...");
-                http_srv_restart(hs);
-                netdown_count = 0;
-                err_count = 0;
+                restart = true;     /* once the link is back */
             }
+            (void) net_sup_ready(&http_sup);    /* let it see the link go down */
             // watchdog_kick();
             HAL_Delay(10);
             continue;
@@ -407,20 +421,33 @@ void http_srv_run(http_srv_t *hs)
             netdown_count = 0;
         }
 
-        /* 2) Serve one client/request (should not block forever) */
+        /* 2) Restart when due, paced by the supervisor rather than on every storm */
+        if (restart && net_sup_ready(&http_sup)) {
+            msg_error("HTTP: restarting server...");
+            net_sup_failure(&http_sup);     /* until a request is served again */
+            http_srv_restart(hs);
+            restart = false;
+            err_count = 0;
+        }
+
+        /* 3) Serve one client/request (should not block forever) */
         int rc = http_srv_handle_once(hs);
 
-        if (rc != HTTP_OK) err_count++;
-        else err_count = 0;
+        if (rc != HTTP_OK) {
+            err_count++;
+        } else {
+            err_count = 0;
+            restart = false;
+            net_sup_success(&http_sup);
+        }
 
-        /* 3) Too many errors -> restart */
+        /* 4) Too many errors -> restart */
         if (err_count >= HTTP_ERR_LIMIT) {
-            msg_error("HTTP: error storm, restarting server...");
-            http_srv_restart(hs);
-            err_count = 0;
+            if (!restart) msg_error("HTTP: error storm, restart pending...");
+            restart = true;
         }
 
-        /* 4) Watchdog safe point */
+        /* 5) Watchdog safe point */
         // watchdog_kick();
         HAL_Delay(1);
     }
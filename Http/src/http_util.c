@@ -51,6 +51,7 @@
 #include "http_lib.h"
 #include "msg.h"
 #include "net.h"
+#include "net_pool.h"
 
 /* Private defines -----------------------------------------------------------*/
 #define HTTP_MAX_HOST_SIZE        80      /**< Max length of the http server hostname. */
@@ -193,6 +194,14 @@ int http_open(http_handle_t * const pHnd, const char *url)
     bool tls = false;
     if (HTTP_OK == http_url_parse(pCtx->hostname, HTTP_MAX_HOST_SIZE, &port, &tls, pCtx->query, HTTP_MAX_QUERY_SIZE, url))
     {
+      /* Reuse an idle keep-alive connection left by http_lib.c to the same server. */
+      if (NET_OK == net_pool_get(hnet, (tls == true) ? NET_PROTO_TLS : NET_PROTO_TCP, pCtx->hostname, port, &pCtx->sock))
+      {
+        *pHnd = (http_handle_t) pCtx;
+        pCtx->connection_is_open = true;
+        return HTTP_OK;
+      }
+
       ret = net_sock_create(hnet, &pCtx->sock, (tls == true) ? NET_PROTO_TLS : NET_PROTO_TCP);
       if (NET_OK != ret)
       {
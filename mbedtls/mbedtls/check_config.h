@@ -186,6 +186,12 @@
 #error "MBEDTLS_HAVEGE_C defined, but not all prerequisites"
 #endif
 
+#if defined(MBEDTLS_HW_CRYPTO_C) && !defined(MBEDTLS_AES_ENCRYPT_ALT) &&  \
+    !defined(MBEDTLS_AES_DECRYPT_ALT) && !defined(MBEDTLS_SHA256_PROCESS_ALT) && \
+    !defined(MBEDTLS_ECP_INTERNAL_ALT)
+#error "MBEDTLS_HW_CRYPTO_C defined, but not all prerequisites"
+#endif
+
 #if defined(MBEDTLS_HMAC_DRBG_C) && !defined(MBEDTLS_MD_C)
 #error "MBEDTLS_HMAC_DRBG_C defined, but not all prerequisites"
 #endif
@@ -585,6 +591,11 @@
 #error "MBEDTLS_SSL_TICKET_C defined, but not all prerequisites"
 #endif
 
+#if defined(MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH) && \
+    !defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
+#error "MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH defined, but not all prerequisites"
+#endif
+
 #if defined(MBEDTLS_SSL_CBC_RECORD_SPLITTING) && \
     !defined(MBEDTLS_SSL_PROTO_SSL3) && !defined(MBEDTLS_SSL_PROTO_TLS1)
 #error "MBEDTLS_SSL_CBC_RECORD_SPLITTING defined, but not all prerequisites"
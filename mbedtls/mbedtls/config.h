@@ -561,6 +561,20 @@
  */
 #define MBEDTLS_ECP_NIST_OPTIM
 
+/**
+ * \def MBEDTLS_ECP_FIXED_POINT_ROM_TABLES
+ *
+ * Keep the comb table of the secp256r1 base point in ROM (about 1 KB of
+ * constants) instead of computing it in RAM at each multiplication.
+ *
+ * Speeds up key generation, ECDSA signature and half of ECDSA verification,
+ * whatever MBEDTLS_ECP_WINDOW_SIZE and MBEDTLS_ECP_FIXED_POINT_OPTIM are set
+ * to, without any RAM cost.
+ *
+ * Comment this macro to drop the table.
+ */
+//#define MBEDTLS_ECP_FIXED_POINT_ROM_TABLES
+
 /**
  * \def MBEDTLS_ECDSA_DETERMINISTIC
  *
@@ -1187,6 +1201,23 @@
  */
 #define MBEDTLS_SSL_MAX_FRAGMENT_LENGTH
 
+/**
+ * \def MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH
+ *
+ * Resize the I/O buffers of an SSL context at the end of the handshake,
+ * according to the negotiated max_fragment_length, so that a context which
+ * negotiated a small MFL does not keep two MBEDTLS_SSL_MAX_CONTENT_LEN
+ * buffers allocated for its whole life. The buffers get back to their full
+ * size on session reset.
+ *
+ * Not applied when renegotiation is enabled at run time, nor to DTLS.
+ *
+ * Requires: MBEDTLS_SSL_MAX_FRAGMENT_LENGTH
+ *
+ * Comment this macro to keep fixed-size buffers
+ */
+//#define MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH
+
 /**
  * \def MBEDTLS_SSL_PROTO_SSL3
  *
@@ -1965,6 +1996,25 @@
  */
 //#define MBEDTLS_HAVEGE_C
 
+/**
+ * \def MBEDTLS_HW_CRYPTO_C
+ *
+ * Enable the hardware crypto hooks: board drivers register AES, SHA-256 and
+ * ECP point arithmetic routines with mbedtls_hw_crypto_register() and the
+ * library falls back to software for anything not registered.
+ *
+ * Module:  library/hw_crypto.c
+ * Caller:  library/aes.c
+ *          library/sha256.c
+ *          library/ecp.c
+ *
+ * Requires: at least one of MBEDTLS_AES_ENCRYPT_ALT, MBEDTLS_AES_DECRYPT_ALT,
+ *           MBEDTLS_SHA256_PROCESS_ALT or MBEDTLS_ECP_INTERNAL_ALT
+ *
+ * Uncomment to enable the hardware crypto hooks.
+ */
+//#define MBEDTLS_HW_CRYPTO_C
+
 /**
  * \def MBEDTLS_HMAC_DRBG_C
  *
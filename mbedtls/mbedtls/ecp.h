@@ -227,6 +227,15 @@ mbedtls_ecp_keypair;
 #define MBEDTLS_ECP_FIXED_POINT_OPTIM  1   /**< Enable fixed-point speed-up */
 #endif /* MBEDTLS_ECP_FIXED_POINT_OPTIM */
 
+#if defined(MBEDTLS_ECP_FIXED_POINT_ROM_TABLES)
+/*
+ * Window of the base point comb tables kept in ROM. Not a tunable: the
+ * tables in ecp_curves.c are generated for this value. It is used instead of
+ * MBEDTLS_ECP_WINDOW_SIZE for those tables since they take no RAM.
+ */
+#define MBEDTLS_ECP_ROM_TABLE_WINDOW   5
+#endif /* MBEDTLS_ECP_FIXED_POINT_ROM_TABLES */
+
 /* \} name SECTION: Module settings */
 
 /*
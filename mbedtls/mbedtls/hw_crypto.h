@@ -0,0 +1,137 @@
+/**
+ * \file hw_crypto.h
+ *
+ * \brief Hardware crypto engine hooks for AES, SHA-256 and ECP
+ *
+ *        This module implements the MBEDTLS_AES_ENCRYPT_ALT,
+ *        MBEDTLS_AES_DECRYPT_ALT, MBEDTLS_SHA256_PROCESS_ALT and
+ *        MBEDTLS_ECP_INTERNAL_ALT entry points on top of a table of
+ *        board supplied hooks. Every entry point falls back to the portable
+ *        software implementation when no hook is registered or when the hook
+ *        declines the request, so the same library image runs on parts with
+ *        and without AES/HASH/PKA engines.
+ *
+ *        AES-GCM and AES-CCM use the block cipher through the AES hooks;
+ *        GHASH and CBC-MAC stay in software.
+ */
+#ifndef MBEDTLS_HW_CRYPTO_H
+#define MBEDTLS_HW_CRYPTO_H
+
+#if !defined(MBEDTLS_CONFIG_FILE)
+#include "config.h"
+#else
+#include MBEDTLS_CONFIG_FILE
+#endif
+
+#include <stdint.h>
+
+#include "aes.h"
+#include "sha256.h"
+#include "ecp.h"
+
+#define MBEDTLS_ERR_HW_CRYPTO_UNSUPPORTED                 -0x0070  /**< The hook does not handle this request, use software. */
+#define MBEDTLS_ERR_HW_CRYPTO_FAILED                      -0x0072  /**< The hardware engine reported an error. */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief          Hooks into the board crypto engines.
+ *
+ *                 Any member may be NULL, in which case the software
+ *                 implementation is used for that primitive.
+ *
+ *                 The AES hooks receive the context prepared by
+ *                 mbedtls_aes_setkey_enc() / mbedtls_aes_setkey_dec(): for
+ *                 encryption the first ctx->nr - 6 words of ctx->rk hold the
+ *                 raw key. A hook returns MBEDTLS_ERR_HW_CRYPTO_UNSUPPORTED to
+ *                 hand a request back to software (eg. a key size the engine
+ *                 cannot do).
+ *
+ *                 The ECP hooks are only used for the groups accepted by
+ *                 ecp_grp_capable, and only when the hook of every enabled
+ *                 MBEDTLS_ECP_xxx_ALT is set: mbed TLS does not fall back to
+ *                 software once a group is declared capable.
+ *                 Points are exchanged in plain Jacobian coordinates, as
+ *                 the remaining ecp.c routines work on them directly.
+ *
+ *                 The hooks are called from the TLS context of the caller;
+ *                 serializing access to a shared engine is up to the board.
+ */
+typedef struct
+{
+    int (*aes_encrypt)( mbedtls_aes_context *ctx,
+                        const unsigned char input[16],
+                        unsigned char output[16] );
+    int (*aes_decrypt)( mbedtls_aes_context *ctx,
+                        const unsigned char input[16],
+                        unsigned char output[16] );
+    int (*sha256_process)( mbedtls_sha256_context *ctx,
+                           const unsigned char data[64] );
+
+    unsigned char (*ecp_grp_capable)( const mbedtls_ecp_group *grp );
+    int (*ecp_init)( const mbedtls_ecp_group *grp );
+    void (*ecp_free)( const mbedtls_ecp_group *grp );
+    int (*ecp_double_jac)( const mbedtls_ecp_group *grp, mbedtls_ecp_point *R,
+                           const mbedtls_ecp_point *P );
+    int (*ecp_add_mixed)( const mbedtls_ecp_group *grp, mbedtls_ecp_point *R,
+                          const mbedtls_ecp_point *P, const mbedtls_ecp_point *Q );
+    int (*ecp_normalize_jac)( const mbedtls_ecp_group *grp,
+                              mbedtls_ecp_point *pt );
+}
+mbedtls_hw_crypto_ops;
+
+/**
+ * \brief          Register the board crypto hooks.
+ *
+ * \param ops      Hook table, which must stay valid while registered,
+ *                 or NULL to go back to software only.
+ *
+ * \note           Call it before the first TLS session is set up, not while
+ *                 a handshake is running.
+ *
+ * \return         0
+ */
+int mbedtls_hw_crypto_register( const mbedtls_hw_crypto_ops *ops );
+
+/**
+ * \brief          Return the registered hook table, or NULL.
+ */
+const mbedtls_hw_crypto_ops *mbedtls_hw_crypto_get( void );
+
+#if defined(MBEDTLS_SELF_TEST)
+/**
+ * \brief          Compare the registered hooks against the software
+ *                 implementation.
+ *
+ * \return         0 if successful, or 1 if the test failed
+ */
+int mbedtls_hw_crypto_self_test( int verbose );
+
+/**
+ * \brief          Measure AES-128-GCM, AES-128-CCM and SHA-256 throughput
+ *                 and the ECC cost of an ECDHE-ECDSA P-256 handshake
+ *                 (key generation, shared secret and signature check) with
+ *                 the hooks currently registered.
+ *
+ *                 Also times AES-128 and SHA-256 blocks through the hooked
+ *                 entry points against the software routines: with no hook
+ *                 registered, this is the overhead of the hook layer.
+ *
+ *                 Run it once with mbedtls_hw_crypto_register( NULL ) and
+ *                 once with the board hooks to get the speed-up.
+ *
+ * \param verbose  Print the results
+ * \param now_ms   Millisecond tick source (eg. HAL_GetTick)
+ *
+ * \return         0 if successful, or 1 if a primitive failed
+ */
+int mbedtls_hw_crypto_benchmark( int verbose, uint32_t (*now_ms)( void ) );
+#endif /* MBEDTLS_SELF_TEST */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* hw_crypto.h */
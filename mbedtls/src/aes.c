@@ -710,7 +710,14 @@ exit:
  * AES-ECB block encryption
  */
 #if !defined(MBEDTLS_AES_ENCRYPT_ALT)
-int mbedtls_internal_aes_encrypt( mbedtls_aes_context *ctx,
+#define AES_SOFT_ENCRYPT         mbedtls_internal_aes_encrypt
+#elif defined(MBEDTLS_HW_CRYPTO_C)
+/* Kept as the software fallback of the hw_crypto.c hooks */
+#define AES_SOFT_ENCRYPT         mbedtls_aes_soft_encrypt
+#endif
+
+#if defined(AES_SOFT_ENCRYPT)
+int AES_SOFT_ENCRYPT( mbedtls_aes_context *ctx,
                                   const unsigned char input[16],
                                   unsigned char output[16] )
 {
@@ -763,7 +770,7 @@ int mbedtls_internal_aes_encrypt( mbedtls_aes_context *ctx,
 
     return( 0 );
 }
-#endif /* !MBEDTLS_AES_ENCRYPT_ALT */
+#endif /* AES_SOFT_ENCRYPT */
 
 #if !defined(MBEDTLS_DEPRECATED_REMOVED)
 void mbedtls_aes_encrypt( mbedtls_aes_context *ctx,
@@ -778,7 +785,14 @@ void mbedtls_aes_encrypt( mbedtls_aes_context *ctx,
  * AES-ECB block decryption
  */
 #if !defined(MBEDTLS_AES_DECRYPT_ALT)
-int mbedtls_internal_aes_decrypt( mbedtls_aes_context *ctx,
+#define AES_SOFT_DECRYPT         mbedtls_internal_aes_decrypt
+#elif defined(MBEDTLS_HW_CRYPTO_C)
+/* Kept as the software fallback of the hw_crypto.c hooks */
+#define AES_SOFT_DECRYPT         mbedtls_aes_soft_decrypt
+#endif
+
+#if defined(AES_SOFT_DECRYPT)
+int AES_SOFT_DECRYPT( mbedtls_aes_context *ctx,
                                   const unsigned char input[16],
                                   unsigned char output[16] )
 {
@@ -831,7 +845,7 @@ int mbedtls_internal_aes_decrypt( mbedtls_aes_context *ctx,
 
     return( 0 );
 }
-#endif /* !MBEDTLS_AES_DECRYPT_ALT */
+#endif /* AES_SOFT_DECRYPT */
 
 #if !defined(MBEDTLS_DEPRECATED_REMOVED)
 void mbedtls_aes_decrypt( mbedtls_aes_context *ctx,
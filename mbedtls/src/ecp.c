@@ -65,8 +65,6 @@
 #define mbedtls_free       free
 #endif
 
-#include "mbedtls/ecp_internal.h"
-
 #if ( defined(__ARMCC_VERSION) || defined(_MSC_VER) ) && \
     !defined(inline) && !defined(__cplusplus)
 #define inline __inline
@@ -103,6 +101,9 @@ static unsigned long add_count, dbl_count, mul_count;
 #define ECP_MONTGOMERY
 #endif
 
+/* Needs ECP_SHORTWEIERSTRASS / ECP_MONTGOMERY for the ALT prototypes */
+#include "mbedtls/ecp_internal.h"
+
 /*
  * Curve types: internal for now, might be exposed later
  */
@@ -339,7 +340,8 @@ void mbedtls_ecp_group_free( mbedtls_ecp_group *grp )
         mbedtls_mpi_free( &grp->N );
     }
 
-    if( grp->T != NULL )
+    /* T_size == 0: table in ROM (MBEDTLS_ECP_FIXED_POINT_ROM_TABLES) */
+    if( grp->T != NULL && grp->T_size != 0 )
     {
         for( i = 0; i < grp->T_size; i++ )
             mbedtls_ecp_point_free( &grp->T[i] );
@@ -1354,7 +1356,7 @@ static int ecp_mul_comb( mbedtls_ecp_group *grp, mbedtls_ecp_point *R,
                          void *p_rng )
 {
     int ret;
-    unsigned char w, m_is_odd, p_eq_g, pre_len, i;
+    unsigned char w, m_is_odd, p_eq_g, p_in_rom = 0, pre_len, i;
     size_t d;
     unsigned char k[COMB_MAX_D + 1];
     mbedtls_ecp_point *T;
@@ -1397,6 +1399,18 @@ static int ecp_mul_comb( mbedtls_ecp_group *grp, mbedtls_ecp_point *R,
     if( w >= grp->nbits )
         w = 2;
 
+#if defined(MBEDTLS_ECP_FIXED_POINT_ROM_TABLES)
+    /*
+     * The base point table of some curves is in ROM (T_size == 0): no
+     * pre-computation and no RAM, so it uses its own, wider window.
+     */
+    p_in_rom = ( grp->T != NULL && grp->T_size == 0 &&
+                 mbedtls_mpi_cmp_mpi( &P->Y, &grp->G.Y ) == 0 &&
+                 mbedtls_mpi_cmp_mpi( &P->X, &grp->G.X ) == 0 );
+    if( p_in_rom )
+        w = MBEDTLS_ECP_ROM_TABLE_WINDOW;
+#endif
+
     /* Other sizes that depend on w */
     pre_len = 1U << ( w - 1 );
     d = ( grp->nbits + w - 1 ) / w;
@@ -1405,7 +1419,7 @@ static int ecp_mul_comb( mbedtls_ecp_group *grp, mbedtls_ecp_point *R,
      * Prepare precomputed points: if P == G we want to
      * use grp->T if already initialized, or initialize it.
      */
-    T = p_eq_g ? grp->T : NULL;
+    T = ( p_eq_g || p_in_rom ) ? grp->T : NULL;
 
     if( T == NULL )
     {
@@ -1448,7 +1462,7 @@ static int ecp_mul_comb( mbedtls_ecp_group *grp, mbedtls_ecp_point *R,
 
 cleanup:
 
-    if( T != NULL && ! p_eq_g )
+    if( T != NULL && ! p_eq_g && ! p_in_rom )
     {
         for( i = 0; i < pre_len; i++ )
             mbedtls_ecp_point_free( &T[i] );
@@ -1690,7 +1704,7 @@ int mbedtls_ecp_mul( mbedtls_ecp_group *grp, mbedtls_ecp_point *R,
         return( ret );
 
 #if defined(MBEDTLS_ECP_INTERNAL_ALT)
-    if ( is_grp_capable = mbedtls_internal_ecp_grp_capable( grp )  )
+    if( ( is_grp_capable = mbedtls_internal_ecp_grp_capable( grp ) ) )
     {
         MBEDTLS_MPI_CHK( mbedtls_internal_ecp_init( grp ) );
     }
@@ -1821,7 +1835,7 @@ int mbedtls_ecp_muladd( mbedtls_ecp_group *grp, mbedtls_ecp_point *R,
     MBEDTLS_MPI_CHK( mbedtls_ecp_mul_shortcuts( grp, R,   n, Q ) );
 
 #if defined(MBEDTLS_ECP_INTERNAL_ALT)
-    if (  is_grp_capable = mbedtls_internal_ecp_grp_capable( grp )  )
+    if( ( is_grp_capable = mbedtls_internal_ecp_grp_capable( grp ) ) )
     {
         MBEDTLS_MPI_CHK( mbedtls_internal_ecp_init( grp ) );
     }
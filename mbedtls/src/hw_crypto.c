@@ -0,0 +1,630 @@
+/*
+ *  Hardware crypto engine hooks for AES, SHA-256 and ECP
+ *
+ *  The *_ALT entry points below dispatch to the hooks registered by the
+ *  board (STM32 CRYP/AES, HASH and PKA drivers, or any other engine) and
+ *  fall back to the software implementations kept in aes.c, sha256.c and
+ *  ecp.c. See hw_crypto.h.
+ */
+
+#if !defined(MBEDTLS_CONFIG_FILE)
+#include "mbedtls/config.h"
+#else
+#include MBEDTLS_CONFIG_FILE
+#endif
+
+#if defined(MBEDTLS_HW_CRYPTO_C)
+
+#include "mbedtls/hw_crypto.h"
+
+#if defined(MBEDTLS_ECP_INTERNAL_ALT)
+#include "mbedtls/ecp_internal.h"
+#endif
+
+#include <string.h>
+
+#if defined(MBEDTLS_SELF_TEST)
+#if defined(MBEDTLS_GCM_C)
+#include "mbedtls/gcm.h"
+#endif
+#if defined(MBEDTLS_CCM_C)
+#include "mbedtls/ccm.h"
+#endif
+#if defined(MBEDTLS_ECDH_C)
+#include "mbedtls/ecdh.h"
+#endif
+#if defined(MBEDTLS_ECDSA_C)
+#include "mbedtls/ecdsa.h"
+#endif
+#if defined(MBEDTLS_PLATFORM_C)
+#include "mbedtls/platform.h"
+#else
+#include <stdio.h>
+#include <stdlib.h>
+#define mbedtls_printf     printf
+#define mbedtls_calloc     calloc
+#define mbedtls_free       free
+#endif /* MBEDTLS_PLATFORM_C */
+#endif /* MBEDTLS_SELF_TEST */
+
+/* Software implementations, renamed in aes.c / sha256.c when the ALT is on */
+#if defined(MBEDTLS_AES_ENCRYPT_ALT)
+int mbedtls_aes_soft_encrypt( mbedtls_aes_context *ctx,
+                              const unsigned char input[16],
+                              unsigned char output[16] );
+#endif
+#if defined(MBEDTLS_AES_DECRYPT_ALT)
+int mbedtls_aes_soft_decrypt( mbedtls_aes_context *ctx,
+                              const unsigned char input[16],
+                              unsigned char output[16] );
+#endif
+#if defined(MBEDTLS_SHA256_PROCESS_ALT)
+void mbedtls_sha256_soft_process( mbedtls_sha256_context *ctx,
+                                  const unsigned char data[64] );
+#endif
+
+static const mbedtls_hw_crypto_ops *hw_ops = NULL;
+
+int mbedtls_hw_crypto_register( const mbedtls_hw_crypto_ops *ops )
+{
+    hw_ops = ops;
+    return( 0 );
+}
+
+const mbedtls_hw_crypto_ops *mbedtls_hw_crypto_get( void )
+{
+    return( hw_ops );
+}
+
+/*
+ * AES-ECB block encryption / decryption
+ */
+#if defined(MBEDTLS_AES_ENCRYPT_ALT)
+int mbedtls_internal_aes_encrypt( mbedtls_aes_context *ctx,
+                                  const unsigned char input[16],
+                                  unsigned char output[16] )
+{
+    const mbedtls_hw_crypto_ops *ops = hw_ops;
+    int ret;
+
+    if( ops != NULL && ops->aes_encrypt != NULL )
+    {
+        ret = ops->aes_encrypt( ctx, input, output );
+        if( ret != MBEDTLS_ERR_HW_CRYPTO_UNSUPPORTED )
+            return( ret );
+    }
+
+    return( mbedtls_aes_soft_encrypt( ctx, input, output ) );
+}
+#endif /* MBEDTLS_AES_ENCRYPT_ALT */
+
+#if defined(MBEDTLS_AES_DECRYPT_ALT)
+int mbedtls_internal_aes_decrypt( mbedtls_aes_context *ctx,
+                                  const unsigned char input[16],
+                                  unsigned char output[16] )
+{
+    const mbedtls_hw_crypto_ops *ops = hw_ops;
+    int ret;
+
+    if( ops != NULL && ops->aes_decrypt != NULL )
+    {
+        ret = ops->aes_decrypt( ctx, input, output );
+        if( ret != MBEDTLS_ERR_HW_CRYPTO_UNSUPPORTED )
+            return( ret );
+    }
+
+    return( mbedtls_aes_soft_decrypt( ctx, input, output ) );
+}
+#endif /* MBEDTLS_AES_DECRYPT_ALT */
+
+/*
+ * SHA-256 block compression. The hook must leave ctx->state untouched when
+ * it fails.
+ */
+#if defined(MBEDTLS_SHA256_PROCESS_ALT)
+void mbedtls_sha256_process( mbedtls_sha256_context *ctx, const unsigned char data[64] )
+{
+    const mbedtls_hw_crypto_ops *ops = hw_ops;
+
+    if( ops != NULL && ops->sha256_process != NULL &&
+        ops->sha256_process( ctx, data ) == 0 )
+        return;
+
+    mbedtls_sha256_soft_process( ctx, data );
+}
+#endif /* MBEDTLS_SHA256_PROCESS_ALT */
+
+/*
+ * ECP point arithmetic
+ */
+#if defined(MBEDTLS_ECP_INTERNAL_ALT)
+/* ecp.c does not fall back per operation: every enabled ALT needs its hook */
+static int hw_ecp_complete( const mbedtls_hw_crypto_ops *ops )
+{
+    if( ops == NULL || ops->ecp_grp_capable == NULL )
+        return( 0 );
+#if defined(MBEDTLS_ECP_DOUBLE_JAC_ALT)
+    if( ops->ecp_double_jac == NULL )
+        return( 0 );
+#endif
+#if defined(MBEDTLS_ECP_ADD_MIXED_ALT)
+    if( ops->ecp_add_mixed == NULL )
+        return( 0 );
+#endif
+#if defined(MBEDTLS_ECP_NORMALIZE_JAC_ALT)
+    if( ops->ecp_normalize_jac == NULL )
+        return( 0 );
+#endif
+    return( 1 );
+}
+
+unsigned char mbedtls_internal_ecp_grp_capable( const mbedtls_ecp_group *grp )
+{
+    const mbedtls_hw_crypto_ops *ops = hw_ops;
+
+    if( !hw_ecp_complete( ops ) )
+        return( 0 );
+
+    return( ops->ecp_grp_capable( grp ) );
+}
+
+int mbedtls_internal_ecp_init( const mbedtls_ecp_group *grp )
+{
+    const mbedtls_hw_crypto_ops *ops = hw_ops;
+
+    if( ops == NULL || ops->ecp_init == NULL )
+        return( 0 );
+
+    return( ops->ecp_init( grp ) );
+}
+
+void mbedtls_internal_ecp_free( const mbedtls_ecp_group *grp )
+{
+    const mbedtls_hw_crypto_ops *ops = hw_ops;
+
+    if( ops != NULL && ops->ecp_free != NULL )
+        ops->ecp_free( grp );
+}
+
+#if defined(MBEDTLS_ECP_DOUBLE_JAC_ALT)
+int mbedtls_internal_ecp_double_jac( const mbedtls_ecp_group *grp,
+        mbedtls_ecp_point *R, const mbedtls_ecp_point *P )
+{
+    return( hw_ops->ecp_double_jac( grp, R, P ) );
+}
+#endif
+
+#if defined(MBEDTLS_ECP_ADD_MIXED_ALT)
+int mbedtls_internal_ecp_add_mixed( const mbedtls_ecp_group *grp,
+        mbedtls_ecp_point *R, const mbedtls_ecp_point *P,
+        const mbedtls_ecp_point *Q )
+{
+    return( hw_ops->ecp_add_mixed( grp, R, P, Q ) );
+}
+#endif
+
+#if defined(MBEDTLS_ECP_NORMALIZE_JAC_ALT)
+int mbedtls_internal_ecp_normalize_jac( const mbedtls_ecp_group *grp,
+        mbedtls_ecp_point *pt )
+{
+    return( hw_ops->ecp_normalize_jac( grp, pt ) );
+}
+#endif
+#endif /* MBEDTLS_ECP_INTERNAL_ALT */
+
+#if defined(MBEDTLS_SELF_TEST)
+
+/* Test and benchmark input only, not for keys used on the wire */
+static uint32_t hw_test_seed = 0x2545F491;
+
+static int hw_test_rand( void *p_rng, unsigned char *output, size_t len )
+{
+    ((void) p_rng);
+
+    while( len-- > 0 )
+    {
+        hw_test_seed ^= hw_test_seed << 13;
+        hw_test_seed ^= hw_test_seed >> 17;
+        hw_test_seed ^= hw_test_seed << 5;
+        *output++ = (unsigned char) hw_test_seed;
+    }
+
+    return( 0 );
+}
+
+#define HW_TEST_BLOCKS            16
+
+#if defined(MBEDTLS_AES_ENCRYPT_ALT) || defined(MBEDTLS_AES_DECRYPT_ALT)
+static int hw_self_test_aes( int verbose, unsigned int keybits )
+{
+    mbedtls_aes_context ctx;
+    unsigned char key[32], in[16], hw[16], sw[16];
+    int i, ret = 1;
+
+    mbedtls_aes_init( &ctx );
+    hw_test_rand( NULL, key, sizeof( key ) );
+
+    if( verbose != 0 )
+        mbedtls_printf( "  HW AES-%u: ", keybits );
+
+#if defined(MBEDTLS_AES_ENCRYPT_ALT)
+    if( mbedtls_aes_setkey_enc( &ctx, key, keybits ) != 0 )
+        goto exit;
+
+    for( i = 0; i < HW_TEST_BLOCKS; i++ )
+    {
+        hw_test_rand( NULL, in, sizeof( in ) );
+        if( mbedtls_internal_aes_encrypt( &ctx, in, hw ) != 0 ||
+            mbedtls_aes_soft_encrypt( &ctx, in, sw ) != 0 ||
+            memcmp( hw, sw, 16 ) != 0 )
+            goto exit;
+    }
+#endif
+
+#if defined(MBEDTLS_AES_DECRYPT_ALT)
+    if( mbedtls_aes_setkey_dec( &ctx, key, keybits ) != 0 )
+        goto exit;
+
+    for( i = 0; i < HW_TEST_BLOCKS; i++ )
+    {
+        hw_test_rand( NULL, in, sizeof( in ) );
+        if( mbedtls_internal_aes_decrypt( &ctx, in, hw ) != 0 ||
+            mbedtls_aes_soft_decrypt( &ctx, in, sw ) != 0 ||
+            memcmp( hw, sw, 16 ) != 0 )
+            goto exit;
+    }
+#endif
+
+    ret = 0;
+
+exit:
+    if( verbose != 0 )
+        mbedtls_printf( ret == 0 ? "passed\n" : "failed\n" );
+
+    mbedtls_aes_free( &ctx );
+    return( ret );
+}
+#endif /* MBEDTLS_AES_ENCRYPT_ALT || MBEDTLS_AES_DECRYPT_ALT */
+
+#if defined(MBEDTLS_SHA256_PROCESS_ALT)
+static int hw_self_test_sha256( int verbose )
+{
+    mbedtls_sha256_context hw, sw;
+    unsigned char data[64];
+    int i, ret = 0;
+
+    if( verbose != 0 )
+        mbedtls_printf( "  HW SHA-256: " );
+
+    mbedtls_sha256_init( &hw );
+    mbedtls_sha256_starts( &hw, 0 );
+    mbedtls_sha256_init( &sw );
+    mbedtls_sha256_starts( &sw, 0 );
+
+    for( i = 0; i < HW_TEST_BLOCKS; i++ )
+    {
+        hw_test_rand( NULL, data, sizeof( data ) );
+        mbedtls_sha256_process( &hw, data );
+        mbedtls_sha256_soft_process( &sw, data );
+    }
+
+    if( memcmp( hw.state, sw.state, sizeof( hw.state ) ) != 0 )
+        ret = 1;
+
+    if( verbose != 0 )
+        mbedtls_printf( ret == 0 ? "passed\n" : "failed\n" );
+
+    mbedtls_sha256_free( &hw );
+    mbedtls_sha256_free( &sw );
+    return( ret );
+}
+#endif /* MBEDTLS_SHA256_PROCESS_ALT */
+
+#if defined(MBEDTLS_ECP_INTERNAL_ALT) && defined(MBEDTLS_ECP_DP_SECP256R1_ENABLED)
+/* Same scalar multiplication with and without the hooks */
+static int hw_self_test_ecp( int verbose )
+{
+    const mbedtls_hw_crypto_ops *ops = hw_ops;
+    mbedtls_ecp_group grp;
+    mbedtls_ecp_point hw, sw;
+    mbedtls_mpi m;
+    int ret;
+
+    if( verbose != 0 )
+        mbedtls_printf( "  HW ECP P-256: " );
+
+    mbedtls_ecp_group_init( &grp );
+    mbedtls_ecp_point_init( &hw );
+    mbedtls_ecp_point_init( &sw );
+    mbedtls_mpi_init( &m );
+
+    MBEDTLS_MPI_CHK( mbedtls_ecp_group_load( &grp, MBEDTLS_ECP_DP_SECP256R1 ) );
+    MBEDTLS_MPI_CHK( mbedtls_ecp_gen_keypair( &grp, &m, &hw, hw_test_rand, NULL ) );
+
+    hw_ops = NULL;
+    ret = mbedtls_ecp_mul( &grp, &sw, &m, &grp.G, hw_test_rand, NULL );
+    hw_ops = ops;
+    if( ret != 0 )
+        goto cleanup;
+
+    if( mbedtls_ecp_point_cmp( &hw, &sw ) != 0 )
+        ret = 1;
+
+cleanup:
+    if( verbose != 0 )
+        mbedtls_printf( ret == 0 ? "passed\n" : "failed\n" );
+
+    mbedtls_ecp_group_free( &grp );
+    mbedtls_ecp_point_free( &hw );
+    mbedtls_ecp_point_free( &sw );
+    mbedtls_mpi_free( &m );
+    return( ret != 0 );
+}
+#endif /* MBEDTLS_ECP_INTERNAL_ALT && MBEDTLS_ECP_DP_SECP256R1_ENABLED */
+
+int mbedtls_hw_crypto_self_test( int verbose )
+{
+    int ret = 0;
+
+    if( hw_ops == NULL )
+    {
+        if( verbose != 0 )
+            mbedtls_printf( "  HW crypto: no hooks registered, skipped\n\n" );
+        return( 0 );
+    }
+
+#if defined(MBEDTLS_AES_ENCRYPT_ALT) || defined(MBEDTLS_AES_DECRYPT_ALT)
+    ret |= hw_self_test_aes( verbose, 128 );
+    ret |= hw_self_test_aes( verbose, 192 );
+    ret |= hw_self_test_aes( verbose, 256 );
+#endif
+#if defined(MBEDTLS_SHA256_PROCESS_ALT)
+    ret |= hw_self_test_sha256( verbose );
+#endif
+#if defined(MBEDTLS_ECP_INTERNAL_ALT) && defined(MBEDTLS_ECP_DP_SECP256R1_ENABLED)
+    ret |= hw_self_test_ecp( verbose );
+#endif
+
+    if( verbose != 0 )
+        mbedtls_printf( "\n" );
+
+    return( ret != 0 );
+}
+
+/*
+ * Benchmark
+ */
+#define HW_BENCH_CHUNK            1024
+#define HW_BENCH_BYTES            ( 32 * 1024 )
+#define HW_BENCH_HANDSHAKES       2
+#define HW_BENCH_DISPATCH_BLOCKS  32768
+
+static void hw_bench_print_rate( const char *name, uint32_t ms )
+{
+    if( ms == 0 )
+        ms = 1;
+
+    mbedtls_printf( "  %-19s: %6lu KiB/s\n", name,
+                    (unsigned long) ( ( HW_BENCH_BYTES / 1024 ) * 1000UL / ms ) );
+}
+
+#if defined(MBEDTLS_AES_ENCRYPT_ALT) || defined(MBEDTLS_SHA256_PROCESS_ALT)
+/*
+ * Cost of the hook layer: the same blocks through the hooked entry point and
+ * straight through the software routine. Without hooks, this is all the
+ * layer costs; with hooks, the gain of the engine on the bare primitive.
+ */
+static void hw_bench_print_dispatch( const char *name, uint32_t ms_entry, uint32_t ms_soft )
+{
+    if( ms_soft == 0 )
+        ms_soft = 1;
+
+    mbedtls_printf( "  %-19s: %6lu ms, software %6lu ms (%3lu%%)\n", name,
+                    (unsigned long) ms_entry, (unsigned long) ms_soft,
+                    (unsigned long) ( ms_entry * 100UL / ms_soft ) );
+}
+
+static int hw_bench_dispatch( int verbose, uint32_t (*now_ms)( void ),
+                              const unsigned char key[16], unsigned char *buf )
+{
+    uint32_t t0, t_entry, t_soft;
+    int i, ret = 0;
+
+#if defined(MBEDTLS_AES_ENCRYPT_ALT)
+    {
+        mbedtls_aes_context aes;
+
+        mbedtls_aes_init( &aes );
+        ret = mbedtls_aes_setkey_enc( &aes, key, 128 );
+        t0 = now_ms();
+        for( i = 0; ret == 0 && i < HW_BENCH_DISPATCH_BLOCKS; i++ )
+            ret = mbedtls_internal_aes_encrypt( &aes, buf, buf );
+        t_entry = now_ms() - t0;
+        t0 = now_ms();
+        for( i = 0; ret == 0 && i < HW_BENCH_DISPATCH_BLOCKS; i++ )
+            ret = mbedtls_aes_soft_encrypt( &aes, buf, buf );
+        t_soft = now_ms() - t0;
+        if( verbose != 0 && ret == 0 )
+            hw_bench_print_dispatch( "AES-128 block", t_entry, t_soft );
+        mbedtls_aes_free( &aes );
+    }
+#endif /* MBEDTLS_AES_ENCRYPT_ALT */
+
+#if defined(MBEDTLS_SHA256_PROCESS_ALT)
+    {
+        mbedtls_sha256_context sha;
+
+        mbedtls_sha256_init( &sha );
+        mbedtls_sha256_starts( &sha, 0 );
+        t0 = now_ms();
+        for( i = 0; i < HW_BENCH_DISPATCH_BLOCKS / 4; i++ )
+            mbedtls_sha256_process( &sha, buf );
+        t_entry = now_ms() - t0;
+        t0 = now_ms();
+        for( i = 0; i < HW_BENCH_DISPATCH_BLOCKS / 4; i++ )
+            mbedtls_sha256_soft_process( &sha, buf );
+        t_soft = now_ms() - t0;
+        if( verbose != 0 )
+            hw_bench_print_dispatch( "SHA-256 block", t_entry, t_soft );
+        mbedtls_sha256_free( &sha );
+    }
+#endif /* MBEDTLS_SHA256_PROCESS_ALT */
+
+    return( ret != 0 );
+}
+#endif /* MBEDTLS_AES_ENCRYPT_ALT || MBEDTLS_SHA256_PROCESS_ALT */
+
+#if defined(MBEDTLS_ECDH_C) && defined(MBEDTLS_ECDSA_C) && \
+    defined(MBEDTLS_ECP_DP_SECP256R1_ENABLED)
+/*
+ * ECC work of the client side of an ECDHE-ECDSA handshake: ephemeral key,
+ * shared secret and the ServerKeyExchange signature check. Certificate chain
+ * checks add one more verify per certificate.
+ */
+static int hw_bench_handshake( int verbose, uint32_t (*now_ms)( void ) )
+{
+    mbedtls_ecp_group grp;
+    mbedtls_ecp_point Qsrv, Qcli;
+    mbedtls_mpi dsrv, dcli, z, r, s;
+    unsigned char hash[32];
+    uint32_t t0, t_gen = 0, t_ecdh = 0, t_verify = 0;
+    int i, ret;
+
+    mbedtls_ecp_group_init( &grp );
+    mbedtls_ecp_point_init( &Qsrv ); mbedtls_ecp_point_init( &Qcli );
+    mbedtls_mpi_init( &dsrv ); mbedtls_mpi_init( &dcli ); mbedtls_mpi_init( &z );
+    mbedtls_mpi_init( &r ); mbedtls_mpi_init( &s );
+
+    MBEDTLS_MPI_CHK( mbedtls_ecp_group_load( &grp, MBEDTLS_ECP_DP_SECP256R1 ) );
+    MBEDTLS_MPI_CHK( mbedtls_ecp_gen_keypair( &grp, &dsrv, &Qsrv, hw_test_rand, NULL ) );
+    hw_test_rand( NULL, hash, sizeof( hash ) );
+    MBEDTLS_MPI_CHK( mbedtls_ecdsa_sign( &grp, &r, &s, &dsrv, hash, sizeof( hash ),
+                                         hw_test_rand, NULL ) );
+
+    for( i = 0; i < HW_BENCH_HANDSHAKES; i++ )
+    {
+        t0 = now_ms();
+        MBEDTLS_MPI_CHK( mbedtls_ecdh_gen_public( &grp, &dcli, &Qcli, hw_test_rand, NULL ) );
+        t_gen += now_ms() - t0;
+
+        t0 = now_ms();
+        MBEDTLS_MPI_CHK( mbedtls_ecdh_compute_shared( &grp, &z, &Qsrv, &dcli,
+                                                      hw_test_rand, NULL ) );
+        t_ecdh += now_ms() - t0;
+
+        t0 = now_ms();
+        MBEDTLS_MPI_CHK( mbedtls_ecdsa_verify( &grp, hash, sizeof( hash ), &Qsrv, &r, &s ) );
+        t_verify += now_ms() - t0;
+    }
+
+    if( verbose != 0 )
+    {
+        mbedtls_printf( "  ECDHE P-256 keygen : %6lu ms\n", (unsigned long) t_gen / HW_BENCH_HANDSHAKES );
+        mbedtls_printf( "  ECDHE P-256 shared : %6lu ms\n", (unsigned long) t_ecdh / HW_BENCH_HANDSHAKES );
+        mbedtls_printf( "  ECDSA P-256 verify : %6lu ms\n", (unsigned long) t_verify / HW_BENCH_HANDSHAKES );
+        mbedtls_printf( "  Handshake ECC      : %6lu ms\n",
+                        (unsigned long) ( t_gen + t_ecdh + t_verify ) / HW_BENCH_HANDSHAKES );
+    }
+
+cleanup:
+    mbedtls_ecp_group_free( &grp );
+    mbedtls_ecp_point_free( &Qsrv ); mbedtls_ecp_point_free( &Qcli );
+    mbedtls_mpi_free( &dsrv ); mbedtls_mpi_free( &dcli ); mbedtls_mpi_free( &z );
+    mbedtls_mpi_free( &r ); mbedtls_mpi_free( &s );
+    return( ret != 0 );
+}
+#endif /* MBEDTLS_ECDH_C && MBEDTLS_ECDSA_C && MBEDTLS_ECP_DP_SECP256R1_ENABLED */
+
+int mbedtls_hw_crypto_benchmark( int verbose, uint32_t (*now_ms)( void ) )
+{
+    unsigned char *buf;
+    unsigned char key[16], iv[12], tag[32];
+    uint32_t t0;
+    size_t n;
+    int ret = 0;
+
+    if( now_ms == NULL )
+        return( 1 );
+
+    buf = mbedtls_calloc( 1, HW_BENCH_CHUNK );
+    if( buf == NULL )
+        return( 1 );
+
+    hw_test_rand( NULL, key, sizeof( key ) );
+    hw_test_rand( NULL, iv, sizeof( iv ) );
+    hw_test_rand( NULL, buf, HW_BENCH_CHUNK );
+
+    if( verbose != 0 )
+        mbedtls_printf( "  HW crypto hooks    : %s\n",
+                        hw_ops != NULL ? "registered" : "none (software)" );
+
+#if defined(MBEDTLS_GCM_C)
+    {
+        mbedtls_gcm_context gcm;
+
+        mbedtls_gcm_init( &gcm );
+        ret |= mbedtls_gcm_setkey( &gcm, MBEDTLS_CIPHER_ID_AES, key, 128 );
+        t0 = now_ms();
+        for( n = 0; ret == 0 && n < HW_BENCH_BYTES; n += HW_BENCH_CHUNK )
+            ret = mbedtls_gcm_crypt_and_tag( &gcm, MBEDTLS_GCM_ENCRYPT, HW_BENCH_CHUNK,
+                                             iv, sizeof( iv ), NULL, 0,
+                                             buf, buf, 16, tag );
+        if( verbose != 0 && ret == 0 )
+            hw_bench_print_rate( "AES-128-GCM", now_ms() - t0 );
+        mbedtls_gcm_free( &gcm );
+    }
+#endif /* MBEDTLS_GCM_C */
+
+#if defined(MBEDTLS_CCM_C)
+    {
+        mbedtls_ccm_context ccm;
+
+        mbedtls_ccm_init( &ccm );
+        ret |= mbedtls_ccm_setkey( &ccm, MBEDTLS_CIPHER_ID_AES, key, 128 );
+        t0 = now_ms();
+        for( n = 0; ret == 0 && n < HW_BENCH_BYTES; n += HW_BENCH_CHUNK )
+            ret = mbedtls_ccm_encrypt_and_tag( &ccm, HW_BENCH_CHUNK, iv, sizeof( iv ),
+                                               NULL, 0, buf, buf, tag, 16 );
+        if( verbose != 0 && ret == 0 )
+            hw_bench_print_rate( "AES-128-CCM", now_ms() - t0 );
+        mbedtls_ccm_free( &ccm );
+    }
+#endif /* MBEDTLS_CCM_C */
+
+#if defined(MBEDTLS_SHA256_C)
+    {
+        mbedtls_sha256_context sha;
+
+        mbedtls_sha256_init( &sha );
+        mbedtls_sha256_starts( &sha, 0 );
+        t0 = now_ms();
+        for( n = 0; n < HW_BENCH_BYTES; n += HW_BENCH_CHUNK )
+            mbedtls_sha256_update( &sha, buf, HW_BENCH_CHUNK );
+        mbedtls_sha256_finish( &sha, tag );
+        if( verbose != 0 )
+            hw_bench_print_rate( "SHA-256", now_ms() - t0 );
+        mbedtls_sha256_free( &sha );
+    }
+#endif /* MBEDTLS_SHA256_C */
+
+#if defined(MBEDTLS_AES_ENCRYPT_ALT) || defined(MBEDTLS_SHA256_PROCESS_ALT)
+    if( ret == 0 )
+        ret = hw_bench_dispatch( verbose, now_ms, key, buf );
+#endif
+
+#if defined(MBEDTLS_ECDH_C) && defined(MBEDTLS_ECDSA_C) && \
+    defined(MBEDTLS_ECP_DP_SECP256R1_ENABLED)
+    if( ret == 0 )
+        ret = hw_bench_handshake( verbose, now_ms );
+#endif
+
+    if( verbose != 0 )
+        mbedtls_printf( "\n" );
+
+    mbedtls_free( buf );
+    return( ret != 0 );
+}
+
+#endif /* MBEDTLS_SELF_TEST */
+
+#endif /* MBEDTLS_HW_CRYPTO_C */
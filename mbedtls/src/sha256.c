@@ -134,6 +134,13 @@ void mbedtls_sha256_starts( mbedtls_sha256_context *ctx, int is224 )
 }
 
 #if !defined(MBEDTLS_SHA256_PROCESS_ALT)
+#define SHA256_SOFT_PROCESS     mbedtls_sha256_process
+#elif defined(MBEDTLS_HW_CRYPTO_C)
+/* Kept as the software fallback of the hw_crypto.c hooks */
+#define SHA256_SOFT_PROCESS     mbedtls_sha256_soft_process
+#endif
+
+#if defined(SHA256_SOFT_PROCESS)
 static const uint32_t K[] =
 {
     0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5,
@@ -179,7 +186,7 @@ static const uint32_t K[] =
     d += temp1; h = temp1 + temp2;              \
 }
 
-void mbedtls_sha256_process( mbedtls_sha256_context *ctx, const unsigned char data[64] )
+void SHA256_SOFT_PROCESS( mbedtls_sha256_context *ctx, const unsigned char data[64] )
 {
     uint32_t temp1, temp2, W[64];
     uint32_t A[8];
@@ -233,7 +240,7 @@ void mbedtls_sha256_process( mbedtls_sha256_context *ctx, const unsigned char da
     for( i = 0; i < 8; i++ )
         ctx->state[i] += A[i];
 }
-#endif /* !MBEDTLS_SHA256_PROCESS_ALT */
+#endif /* SHA256_SOFT_PROCESS */
 
 /*
  * SHA-256 process buffer
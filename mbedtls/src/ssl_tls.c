@@ -155,6 +155,143 @@ static unsigned int mfl_code_to_length[MBEDTLS_SSL_MAX_FRAG_LEN_INVALID] =
 };
 #endif /* MBEDTLS_SSL_MAX_FRAGMENT_LENGTH */
 
+#if defined(MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH)
+#define SSL_IN_BUFFER_LEN( ssl )    ( ( ssl )->in_buf_len )
+#define SSL_OUT_BUFFER_LEN( ssl )   ( ( ssl )->out_buf_len )
+#else
+#define SSL_IN_BUFFER_LEN( ssl )    MBEDTLS_SSL_BUFFER_LEN
+#define SSL_OUT_BUFFER_LEN( ssl )   MBEDTLS_SSL_BUFFER_LEN
+#endif
+
+#if defined(MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH)
+/*
+ * Move a record buffer to a new allocation of new_len bytes, keeping its
+ * first 'used' bytes. Returns NULL (and leaves the old buffer untouched)
+ * if the data does not fit or the allocation fails.
+ */
+static unsigned char *ssl_buffer_move( unsigned char *old, size_t old_len,
+                                       size_t new_len, size_t used )
+{
+    unsigned char *buf;
+
+    if( used > new_len )
+        return( NULL );
+
+    if( ( buf = mbedtls_calloc( 1, new_len ) ) == NULL )
+        return( NULL );
+
+    memcpy( buf, old, used );
+    mbedtls_zeroize( old, old_len );
+    mbedtls_free( old );
+
+    return( buf );
+}
+
+#define SSL_BUF_REBASE( ptr, old, buf )                         \
+    do { if( ( ptr ) != NULL ) ( ptr ) = ( buf ) + ( ( ptr ) - ( old ) ); } while( 0 )
+
+/*
+ * Resize the record buffers, keeping any pending data.
+ * A buffer that cannot be resized keeps its current size.
+ */
+static int ssl_resize_buffers( mbedtls_ssl_context *ssl,
+                               size_t in_len, size_t out_len )
+{
+    unsigned char *old, *buf;
+    size_t used;
+    int ret = 0;
+
+    if( in_len != ssl->in_buf_len )
+    {
+        old = ssl->in_buf;
+        used = (size_t)( ssl->in_hdr - old ) + ssl->in_left;
+        if( used < (size_t)( ssl->in_msg - old ) + ssl->in_msglen )
+            used = (size_t)( ssl->in_msg - old ) + ssl->in_msglen;
+
+        if( ( buf = ssl_buffer_move( old, ssl->in_buf_len, in_len, used ) ) == NULL )
+            ret = MBEDTLS_ERR_SSL_ALLOC_FAILED;
+        else
+        {
+            SSL_BUF_REBASE( ssl->in_ctr,  old, buf );
+            SSL_BUF_REBASE( ssl->in_hdr,  old, buf );
+            SSL_BUF_REBASE( ssl->in_len,  old, buf );
+            SSL_BUF_REBASE( ssl->in_iv,   old, buf );
+            SSL_BUF_REBASE( ssl->in_msg,  old, buf );
+            SSL_BUF_REBASE( ssl->in_offt, old, buf );
+            ssl->in_buf = buf;
+            ssl->in_buf_len = in_len;
+        }
+    }
+
+    if( out_len != ssl->out_buf_len )
+    {
+        old = ssl->out_buf;
+        used = (size_t)( ssl->out_hdr - old ) + ssl->out_left;
+        if( used < (size_t)( ssl->out_msg - old ) + ssl->out_msglen )
+            used = (size_t)( ssl->out_msg - old ) + ssl->out_msglen;
+
+        if( ( buf = ssl_buffer_move( old, ssl->out_buf_len, out_len, used ) ) == NULL )
+            ret = MBEDTLS_ERR_SSL_ALLOC_FAILED;
+        else
+        {
+            SSL_BUF_REBASE( ssl->out_ctr, old, buf );
+            SSL_BUF_REBASE( ssl->out_hdr, old, buf );
+            SSL_BUF_REBASE( ssl->out_len, old, buf );
+            SSL_BUF_REBASE( ssl->out_iv,  old, buf );
+            SSL_BUF_REBASE( ssl->out_msg, old, buf );
+            ssl->out_buf = buf;
+            ssl->out_buf_len = out_len;
+        }
+    }
+
+    return( ret );
+}
+
+/*
+ * Once the handshake is over, the records are bounded by the negotiated
+ * max_fragment_length: release the part of the buffers that cannot be used.
+ * The outgoing records are always bounded by our own MFL setting, the
+ * incoming ones only if the server acknowledged the extension.
+ */
+static void ssl_shrink_buffers( mbedtls_ssl_context *ssl )
+{
+    const size_t overhead = MBEDTLS_SSL_BUFFER_LEN - MBEDTLS_SSL_MAX_CONTENT_LEN;
+    size_t in_len = ssl->in_buf_len;
+    size_t out_len = ssl->out_buf_len;
+
+#if defined(MBEDTLS_SSL_RENEGOTIATION)
+    /* A renegotiation would need room for full-size handshake messages. */
+    if( ssl->conf->disable_renegotiation == MBEDTLS_SSL_RENEGOTIATION_ENABLED )
+        return;
+#endif
+
+#if defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
+    out_len = mbedtls_ssl_get_max_frag_len( ssl ) + overhead;
+    if( ssl->session != NULL &&
+        ssl->session->mfl_code != MBEDTLS_SSL_MAX_FRAG_LEN_NONE )
+    {
+        in_len = mfl_code_to_length[ssl->session->mfl_code] + overhead;
+    }
+#endif
+
+    if( in_len > ssl->in_buf_len )
+        in_len = ssl->in_buf_len;
+    if( out_len > ssl->out_buf_len )
+        out_len = ssl->out_buf_len;
+
+    if( ssl_resize_buffers( ssl, in_len, out_len ) != 0 )
+    {
+        MBEDTLS_SSL_DEBUG_MSG( 2, ( "record buffers kept at in %d, out %d bytes",
+                                    ssl->in_buf_len, ssl->out_buf_len ) );
+    }
+    else
+    {
+        MBEDTLS_SSL_DEBUG_MSG( 3, ( "record buffers resized to in %d, out %d bytes",
+                                    ssl->in_buf_len, ssl->out_buf_len ) );
+    }
+}
+#endif /* MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH */
+
 #if defined(MBEDTLS_SSL_CLI_C)
 static int ssl_session_copy( mbedtls_ssl_session *dst, const mbedtls_ssl_session *src )
 {
@@ -2214,7 +2351,7 @@ int mbedtls_ssl_fetch_input( mbedtls_ssl_context *ssl, size_t nb_want )
         return( MBEDTLS_ERR_SSL_BAD_INPUT_DATA );
     }
 
-    if( nb_want > MBEDTLS_SSL_BUFFER_LEN - (size_t)( ssl->in_hdr - ssl->in_buf ) )
+    if( nb_want > SSL_IN_BUFFER_LEN( ssl ) - (size_t)( ssl->in_hdr - ssl->in_buf ) )
     {
         MBEDTLS_SSL_DEBUG_MSG( 1, ( "requesting more data than fits" ) );
         return( MBEDTLS_ERR_SSL_BAD_INPUT_DATA );
@@ -2297,7 +2434,7 @@ int mbedtls_ssl_fetch_input( mbedtls_ssl_context *ssl, size_t nb_want )
             ret = MBEDTLS_ERR_SSL_TIMEOUT;
         else
         {
-            len = MBEDTLS_SSL_BUFFER_LEN - ( ssl->in_hdr - ssl->in_buf );
+            len = SSL_IN_BUFFER_LEN( ssl ) - ( ssl->in_hdr - ssl->in_buf );
 
             if( ssl->state != MBEDTLS_SSL_HANDSHAKE_OVER )
                 timeout = ssl->handshake->retransmit_timeout;
@@ -3048,7 +3185,7 @@ static int ssl_reassemble_dtls_handshake( mbedtls_ssl_context *ssl )
         ssl->next_record_offset = new_remain - ssl->in_hdr;
         ssl->in_left = ssl->next_record_offset + remain_len;
 
-        if( ssl->in_left > MBEDTLS_SSL_BUFFER_LEN -
+        if( ssl->in_left > SSL_IN_BUFFER_LEN( ssl ) -
                            (size_t)( ssl->in_hdr - ssl->in_buf ) )
         {
             MBEDTLS_SSL_DEBUG_MSG( 1, ( "reassembled message too large for buffer" ) );
@@ -3512,7 +3649,7 @@ static int ssl_parse_record_header( mbedtls_ssl_context *ssl )
     }
 
     /* Check length against the size of our buffer */
-    if( ssl->in_msglen > MBEDTLS_SSL_BUFFER_LEN
+    if( ssl->in_msglen > SSL_IN_BUFFER_LEN( ssl )
                          - (size_t)( ssl->in_msg - ssl->in_buf ) )
     {
         MBEDTLS_SSL_DEBUG_MSG( 1, ( "bad message length" ) );
@@ -5221,6 +5358,11 @@ void mbedtls_ssl_handshake_wrapup( mbedtls_ssl_context *ssl )
 #endif
         ssl_handshake_wrapup_free_hs_transform( ssl );
 
+#if defined(MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH)
+    if( ssl->conf->transport == MBEDTLS_SSL_TRANSPORT_STREAM )
+        ssl_shrink_buffers( ssl );
+#endif
+
     ssl->state++;
 
     MBEDTLS_SSL_DEBUG_MSG( 3, ( "<= handshake wrapup" ) );
@@ -5621,6 +5763,10 @@ int mbedtls_ssl_setup( mbedtls_ssl_context *ssl,
         ssl->in_buf = NULL;
         return( MBEDTLS_ERR_SSL_ALLOC_FAILED );
     }
+#if defined(MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH)
+    ssl->in_buf_len = len;
+    ssl->out_buf_len = len;
+#endif
 
 #if defined(MBEDTLS_SSL_PROTO_DTLS)
     if( conf->transport == MBEDTLS_SSL_TRANSPORT_DATAGRAM )
@@ -5717,9 +5863,17 @@ static int ssl_session_reset_int( mbedtls_ssl_context *ssl, int partial )
     ssl->transform_in = NULL;
     ssl->transform_out = NULL;
 
-    memset( ssl->out_buf, 0, MBEDTLS_SSL_BUFFER_LEN );
+#if defined(MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH)
+    /* A new handshake needs full-size buffers again. */
+    if( ( ret = ssl_resize_buffers( ssl, partial == 0 ? MBEDTLS_SSL_BUFFER_LEN
+                                                      : ssl->in_buf_len,
+                                    MBEDTLS_SSL_BUFFER_LEN ) ) != 0 )
+        return( ret );
+#endif
+
+    memset( ssl->out_buf, 0, SSL_OUT_BUFFER_LEN( ssl ) );
     if( partial == 0 )
-        memset( ssl->in_buf, 0, MBEDTLS_SSL_BUFFER_LEN );
+        memset( ssl->in_buf, 0, SSL_IN_BUFFER_LEN( ssl ) );
 
 #if defined(MBEDTLS_SSL_HW_RECORD_ACCEL)
     if( mbedtls_ssl_hw_record_reset != NULL )
@@ -7345,13 +7499,13 @@ void mbedtls_ssl_free( mbedtls_ssl_context *ssl )
 
     if( ssl->out_buf != NULL )
     {
-        mbedtls_zeroize( ssl->out_buf, MBEDTLS_SSL_BUFFER_LEN );
+        mbedtls_zeroize( ssl->out_buf, SSL_OUT_BUFFER_LEN( ssl ) );
         mbedtls_free( ssl->out_buf );
     }
 
     if( ssl->in_buf != NULL )
     {
-        mbedtls_zeroize( ssl->in_buf, MBEDTLS_SSL_BUFFER_LEN );
+        mbedtls_zeroize( ssl->in_buf, SSL_IN_BUFFER_LEN( ssl ) );
         mbedtls_free( ssl->in_buf );
     }
 
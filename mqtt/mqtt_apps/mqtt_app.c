@@ -7,6 +7,8 @@
 
 #include "mqtt_app.h"
 #include "MQTTClient.h"
+#include "mqtt_queue.h"
+#include "mqtt_batch.h"
 #include "cJSON.h"
 #include "aws_cert.h"
 #include "timedate.h"
@@ -14,9 +16,11 @@
 extern timestamp_t ts;
 
 
-static uint32_t backoff_ms = RECONN_MIN_MS;
+static net_sup_t mqtt_sup;	/* paces the reconnections to the broker */
 static void allpurposeMessageHandler(MessageData *data);
-static int mqtt_client_publish(MQTTClient *client, device_config_t *dev) ;
+static int mqtt_client_publish(device_config_t *dev);
+static int mqtt_batch_head(void *ctx, char *buf, size_t size);
+static int mqtt_batch_publish(void *ctx, const char *payload, size_t len);
 
 /* Detailed variables for the mqtt apps*/
 /*For use in MQTT client task*/
@@ -27,13 +31,25 @@ status_data_t status_data = { MODEL_DEFAULT_MAC,
 
 static unsigned char mqtt_send_buffer[MQTT_SEND_BUFFER_SIZE];
 static unsigned char mqtt_read_buffer[MQTT_READ_BUFFER_SIZE];
+static MQTTInboundQueue mqtt_inq;	/* incoming messages, handled after the yield rather than in its read loop */
 
-/* Warning: The subscribed topics names strings must be allocated separately,
- * because Paho does not copy them and uses references to dispatch the incoming message. */
+/* The client copies the subscribed topic filters: mqtt_subtopic may be reused after MQTTSubscribe(). */
 static char mqtt_subtopic[MQTT_TOPIC_BUFFER_SIZE];
 static char mqtt_pubtopic[MQTT_TOPIC_BUFFER_SIZE];
 static char mqtt_msg[MQTT_MSG_BUFFER_SIZE];
 
+/* Telemetry published while the broker is not reachable waits here */
+static mqtt_queue_t mqtt_q;
+static uint8_t mqtt_q_ram[MQTT_QUEUE_RAM_SIZE];
+#ifdef MQTT_QUEUE_FLASH_START
+static mqtt_queue_store_t mqtt_q_store;
+static mqtt_queue_flash_t mqtt_q_flash = { MQTT_QUEUE_FLASH_START, MQTT_QUEUE_FLASH_SIZE, FLASH_PAGE_SIZE };
+#endif
+
+/* Telemetry samples, packed into one message per batch before being queued */
+static mqtt_batch_t mqtt_batch;
+static char mqtt_batch_buf[BATCH_MAX_BYTES + 1];
+
 /* Detailed variables for the mqtt apps*/
 extern net_hnd_t hnet;
 extern RTC_t rtc;
@@ -65,6 +81,8 @@ static int mqtt_do_connect_and_subscribe(MQTTClient *mc,
                                         MQTTPacket_connectData *opt,
                                         const char *subtopic)
 {
+    /* Without socket probes (e.g. ES-WiFi), the PINGREQs are all that finds a lost connection */
+    opt->keepAliveInterval = net_sock_is_probed(mc->ipstack->sockHandle) ? MQTT_KEEPALIVE_S : MQTT_KEEPALIVE_UNPROBED_S;
     int rc = MQTTConnect(mc, opt);
     if (rc != SUCCESS) return rc;
 
@@ -77,27 +95,43 @@ void mqtt_main(void) {
 
 	while (1) {
 
+		/* 0) Sample the telemetry periodically, whether the broker is reachable or not: the
+		 *    batches are queued on count, size or age */
+		uint32_t now = HAL_GetTick();
+		if ((now - last_pub) >= SAMPLE_INTERVAL_MS) {
+			(void) mqtt_client_publish(&dev);
+			last_pub = now;
+		}
+		(void) mqtt_batch_poll(&mqtt_batch, now);
+
 		/* 1) Ensure connected */
 		if (!MQTTIsConnected(&mc)) {
 
+			/* Backoff, circuit breaker and link state are up to the supervisor */
+			if (!net_sup_ready(&mqtt_sup)) {
+				HAL_Delay(MIN(net_sup_wait_ms(&mqtt_sup), YIELD_MS));
+				continue;
+			}
+
 			msg_debug("MQTT: connecting...\n");
-			int rc = mqtt_do_connect_and_subscribe(&mc, &options,
-					mqtt_subtopic);
+			int rc = SUCCESS;
+			if (net.sockHandle == NULL) {	/* released by the last reset */
+				rc = (mqtt_network_open(&net, &dev) == NET_OK) ? SUCCESS : FAILURE;
+			}
+			if (rc == SUCCESS) {
+				rc = mqtt_do_connect_and_subscribe(&mc, &options,
+						mqtt_subtopic);
+			}
 
 			if (rc != SUCCESS) {
 				msg_error("MQTT: connect/sub failed rc=%d\n", rc);
 
 				mqtt_hard_reset(&net, &mc);
-
-				HAL_Delay(backoff_ms);
-				backoff_ms =
-						(backoff_ms < RECONN_MAX_MS) ?
-								(backoff_ms * 2) : RECONN_MAX_MS;
+				net_sup_failure(&mqtt_sup);
 				continue;
 			}
 
-			/* Success => reset backoff */
-			backoff_ms = RECONN_MIN_MS;
+			net_sup_success(&mqtt_sup);
 		}
 
 		/* 2) Service keepalive + incoming packets */
@@ -108,81 +142,76 @@ void mqtt_main(void) {
 			HAL_Delay(500);
 			continue;
 		}
+		/* A half-open connection is found by the socket probes, if any, long before the MQTT keepalive. */
+		if (!net_sock_is_alive(net.sockHandle)) {
+			msg_error("MQTT: broker connection lost -> reset\n");
+			mqtt_hard_reset(&net, &mc);
+			continue;
+		}
 
-		/* 3) Publish periodically */
-		uint32_t now = HAL_GetTick();
-		if ((now - last_pub) >= PUB_INTERVAL_MS) {
-			rc = mqtt_client_publish(&mc, &dev); /* make this return SUCCESS/FAIL */
-			if (rc != SUCCESS) {
-				msg_error("MQTT: publish failed rc=%d -> reset\n", rc);
-				mqtt_hard_reset(&net, &mc);
-				HAL_Delay(500);
-				continue;
-			}
-			last_pub = now;
+		/* 3) Handle the messages received: acknowledged already, they no longer hold up the reads */
+		(void) MQTTInboundDispatch(&mqtt_inq, 0);
+
+		/* 4) Publish the queued messages, oldest first, a rate-limited batch per round */
+		rc = mqtt_queue_drain(&mqtt_q, &mc);
+		if (rc < 0) {
+			msg_error("MQTT: publish failed rc=%d -> reset\n", rc);
+			mqtt_hard_reset(&net, &mc);
+			HAL_Delay(500);
+			continue;
 		}
 	}
 }
 
 
-static int mqtt_client_publish(MQTTClient *client, device_config_t* dev) {
-	MQTTMessage mqmsg;
+/* Add a telemetry sample to the batch: mqtt_main() publishes the batches once the broker is reachable. */
+static int mqtt_client_publish(device_config_t* dev) {
+	int32_t values[3];
 
-	snprintf(mqtt_pubtopic, MQTT_TOPIC_BUFFER_SIZE, "/sensors/%s",
-			dev->MQClientId);
 #ifdef SENSORS
 	/*Read data from sensors*/
 	pub_data.temperature = BSP_TSENSOR_ReadTemp();
 	pub_data.humidity = BSP_HSENSOR_ReadHumidity();
 #endif
-	getTimestamp(ts.ts, sizeof(ts.ts));
-	pub_data.tstamp = &(ts.ts[0]);
+	values[0] = status_data.LedOn ? 1 : 0;
+	values[1] = (int32_t) (pub_data.temperature * 9.0 / 5.0) + 32;	// from celcius to farenheit
+	values[2] = (int32_t) pub_data.humidity;
 
-	/*create Json object to publish data*/
-	cJSON *publish_data = cJSON_CreateObject();
-	cJSON_AddStringToObject(publish_data, "ID", dev->MQClientId);
-	cJSON_AddBoolToObject(publish_data, "LedOn", status_data.LedOn);
-	cJSON_AddNumberToObject(publish_data, "Temperature",
-			(int)(pub_data.temperature * 9.0 / 5.0) + 32.0);	// from celcius to farenheit
-	cJSON_AddNumberToObject(publish_data, "Humidity", (int)pub_data.humidity);
-	cJSON_AddStringToObject(publish_data, "timestamp", pub_data.tstamp);
-	cJSON_AddStringToObject(publish_data, "MacAddress", pub_data.mac);
-	// Convert JSON to String
-	char *msg = cJSON_Print(publish_data);
-	if (msg == NULL) {
-	    cJSON_Delete(publish_data);
-	    return -1; // Handle allocation failure
+	rc = mqtt_batch_add(&mqtt_batch, HAL_GetTick(), values, 3);
+	if (rc != MQSUCCESS) {
+		msg_error("Telemetry sample dropped, rc = %d...", rc);
 	}
-	strcpy(mqtt_msg, msg);
-	cJSON_Delete(publish_data);
-	rc = strlen(mqtt_msg);
-	free(msg);
+	return rc;
+}
 
-	if ((rc < 0) || (rc >= MQTT_MSG_BUFFER_SIZE)) {
-		msg_error("MQTT Telemetry message formatting error...");
-	} else {
-		mqmsg.qos = QOS0;
-		mqmsg.payload = (char*) mqtt_msg;
-		mqmsg.payloadlen = strlen(mqtt_msg);
+/* Members of a telemetry batch before its samples, taken when its first sample is added. */
+static int mqtt_batch_head(void *ctx, char *buf, size_t size) {
+	device_config_t *dev = (device_config_t*) ctx;
 
-		rc = MQTTPublish(client, mqtt_pubtopic, &mqmsg);
+	getTimestamp(ts.ts, sizeof(ts.ts));
+	pub_data.tstamp = &(ts.ts[0]);
+	return snprintf(buf, size, "\"ID\":\"%s\",\"MacAddress\":\"%s\",\"timestamp\":\"%s\","
+			"\"f\":[\"dt\",\"LedOn\",\"Temperature\",\"Humidity\"]",
+			dev->MQClientId, pub_data.mac, pub_data.tstamp);
+}
 
-		if (rc != MQSUCCESS) {
-			msg_error("Failed mqtt publishing %s on %s",
-					(char* )(mqmsg.payload), mqtt_pubtopic);
-		}
+/* Queue a telemetry batch: mqtt_main() publishes it once the broker is reachable. */
+static int mqtt_batch_publish(void *ctx, const char *payload, size_t len) {
+	device_config_t *dev = (device_config_t*) ctx;
 
-		if (rc == MQSUCCESS) {
-			/* Visual notification of the telemetry publication: LED blink. */
-			msg_info("#\n");
-			msg_info("MQTT publication topic: %s \tpayload: %s", mqtt_pubtopic,
-					mqtt_msg);
-		} else {
-			msg_error("Telemetry publication failed...");
-		}
+	snprintf(mqtt_pubtopic, MQTT_TOPIC_BUFFER_SIZE, "/sensors/%s",
+			dev->MQClientId);
+	/* QoS1: a queued message is only removed once acknowledged by the broker. */
+	rc = mqtt_queue_push(&mqtt_q, mqtt_pubtopic, payload, len, QOS1, 0);
+
+	if (rc == MQSUCCESS) {
+		msg_info("#\n");
+		msg_info("MQTT telemetry queued (%lu) topic: %s \tpayload: %s",
+				(unsigned long) mqtt_queue_depth(&mqtt_q), mqtt_pubtopic, payload);
+	} else {
+		msg_error("Telemetry message dropped, rc = %d...", rc);
 	}
 	return rc;
-
 }
 
 
@@ -261,6 +290,20 @@ void mqtt_start(void)
 //	dev.tls_dev_key = NULL;
 
 	net_macaddr_t  macAddr;
+	mqtt_queue_store_t *store = NULL;
+
+#ifdef MQTT_QUEUE_FLASH_START
+	if (mqtt_queue_flash_open(&mqtt_q_flash, &mqtt_q_store) == 0) {
+		store = &mqtt_q_store;
+	} else {
+		msg_error("MQTT offline queue: flash segment unusable, RAM only\n");
+	}
+#endif
+	mqtt_queue_init(&mqtt_q, mqtt_q_ram, sizeof(mqtt_q_ram), store, NULL);
+
+	mqtt_batch_conf_t batch_conf = { BATCH_MAX_SAMPLES, BATCH_MAX_BYTES, BATCH_MAX_AGE_MS,
+									 BATCH_MSG_OVERHEAD, mqtt_batch_head, mqtt_batch_publish, &dev };
+	mqtt_batch_init(&mqtt_batch, mqtt_batch_buf, sizeof(mqtt_batch_buf), &batch_conf);
 
 	/* Network init, just in case there network is not connected yet*/
 	rc = mqtt_network_init(&net, &dev);
@@ -276,6 +319,10 @@ void mqtt_start(void)
 
 	msg_debug("MQTT network connection created with success");
 
+	net_sup_conf_t sup_conf = { RECONN_MIN_MS, RECONN_MAX_MS, RECONN_BREAKER_FAILS,
+								RECONN_BREAKER_OPEN_MS, RECONN_LINKUP_SPREAD_MS };
+	net_sup_init(&mqtt_sup, "mqtt", net.netHandle, &sup_conf);
+
 	net_get_mac_address(net.netHandle, &macAddr);
 	sprintf(pub_data.mac, "%02X:%02X:%02X:%02X:%02X:%02X", macAddr.mac[0],macAddr.mac[1],
 															macAddr.mac[2],macAddr.mac[3],
@@ -284,12 +331,15 @@ void mqtt_start(void)
 	/*MQTT init just set some variables for the context, no return messages*/
 	MQTTClientInit(&mc, &net, MQTT_CMD_TIMEOUT, mqtt_send_buffer,
 	MQTT_SEND_BUFFER_SIZE, mqtt_read_buffer, MQTT_READ_BUFFER_SIZE);
+	MQTTInboundQueueInit(&mqtt_inq, NULL, NULL);
+	MQTTSetInboundQueue(&mc, &mqtt_inq);
 
 	/* MQTT connect */
 	options.clientID.cstring = dev.MQClientId;
 	options.username.cstring = dev.MQUserName;
 	options.password.cstring = dev.MQUserPwd;
-	options.keepAliveInterval = 60;
+	options.keepAliveInterval = net_sock_is_probed(net.sockHandle) ? MQTT_KEEPALIVE_S : MQTT_KEEPALIVE_UNPROBED_S;
+	options.MQTTVersion = 5;	/* topic aliases: the telemetry topic goes in full once per connection */
 	options.will.message.cstring = "will message";
 	options.will.qos = 1;
 	options.will.retained = 0;
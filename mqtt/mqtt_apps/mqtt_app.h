@@ -10,8 +10,21 @@
 
 #define YIELD_MS          200
 #define PUB_INTERVAL_MS  60000	/* in milliseconds*/
+#define SAMPLE_INTERVAL_MS 10000	/* telemetry sampling, in milliseconds */
+#define BATCH_MAX_SAMPLES        16        /* telemetry batch flushed at this many samples, */
+#define BATCH_MAX_BYTES          1024      /* at this many bytes (MQTT_QUEUE_PAYLOAD_MAX at most), */
+#define BATCH_MAX_AGE_MS         PUB_INTERVAL_MS	/* or this long after its first sample */
+#define BATCH_MSG_OVERHEAD       32        /* MQTT fixed header, topic and packet id of a telemetry message */
+#define MQTT_KEEPALIVE_S         60        /* MQTT keepalive, in seconds, when the socket probes find a lost connection, */
+#define MQTT_KEEPALIVE_UNPROBED_S 15       /* and when they cannot: the PINGREQs find it within 30 s, as the probes do */
 #define RECONN_MIN_MS    1000
 #define RECONN_MAX_MS   	30000
+#define RECONN_BREAKER_FAILS     10        /* consecutive failures before the broker is left alone */
+#define RECONN_BREAKER_OPEN_MS   300000    /* how long it is left alone */
+#define RECONN_LINKUP_SPREAD_MS  5000      /* first retry after a link-up, spread over this window */
+#define MQTT_QUEUE_RAM_SIZE      4096      /* offline publish queue, RAM part */
+/* #define MQTT_QUEUE_FLASH_START   0x080F8000 */ /* offline publish queue spill to flash: last 32 kB of bank 2 */
+#define MQTT_QUEUE_FLASH_SIZE    0x8000
 
 void mqtt_start(void);
 void mqtt_main(void);
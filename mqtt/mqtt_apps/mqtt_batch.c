@@ -0,0 +1,237 @@
+/*
+ * mqtt_batch.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Daruin Solano
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "mqtt_batch.h"
+
+/* Private defines -----------------------------------------------------------*/
+#define BATCH_SAMPLES	"\"s\":["	/**< Opens the array of the samples, after the head members. */
+#define BATCH_CLOSE		"]}"
+#define BATCH_CLOSE_LEN	2
+
+/* Private function prototypes -----------------------------------------------*/
+static int batch_open(mqtt_batch_t *b, uint32_t tick);
+static int batch_sample(char *s, uint32_t dt, const int32_t *values, int n, int *dt_len);
+static int batch_flush(mqtt_batch_t *b, uint32_t *cause);
+static uint32_t batch_limit(mqtt_batch_t *b);
+
+/* Functions Definition ------------------------------------------------------*/
+
+/**
+ * @brief  Set up an empty batch.
+ * @param  In: buf   Storage of the batch being filled. Must outlive the batch.
+ * @param  In: conf  Bounds and callbacks. flush() is required.
+ */
+int mqtt_batch_init(mqtt_batch_t *b, char *buf, size_t size, const mqtt_batch_conf_t *conf) {
+	if ((b == NULL) || (buf == NULL) || (conf == NULL) || (conf->flush == NULL)
+			|| (size < (sizeof(BATCH_SAMPLES) + BATCH_CLOSE_LEN + MQTT_BATCH_SAMPLE_MAX))) {
+		return FAILURE;
+	}
+	memset(b, 0, sizeof(mqtt_batch_t));
+	b->buf = buf;
+	b->size = size;
+	b->conf = *conf;
+	if (b->conf.max_samples == 0) {
+		b->conf.max_samples = 1;
+	}
+	return MQSUCCESS;
+}
+
+/**
+ * @brief  Add a sample to the batch: its tick and n values.
+ * @note   The batch may be flushed on the way: before the sample if it is too old or the sample
+ *         does not fit, after it once full.
+ * @retval MQSUCCESS, BUFFER_OVERFLOW if the sample is dropped: too many values, or too long for
+ *         an empty batch. Else the error of a failed flush.
+ */
+int mqtt_batch_add(mqtt_batch_t *b, uint32_t tick, const int32_t *values, int n) {
+	char sample[MQTT_BATCH_SAMPLE_MAX];
+	int sample_len;
+	int dt_len;
+	int rc = MQSUCCESS;
+
+	if ((n < 0) || (n > MQTT_BATCH_VALUES_MAX) || ((n > 0) && (values == NULL))) {
+		b->stats.dropped++;
+		return BUFFER_OVERFLOW;
+	}
+	if (b->stats.samples++ == 0) {
+		b->first_tick = tick;
+	}
+	b->last_tick = tick;
+
+	if ((b->len > 0) && (b->conf.max_age_ms > 0) && ((tick - b->t0) >= b->conf.max_age_ms)) {
+		rc = batch_flush(b, &b->stats.by_age);
+	}
+	sample_len = batch_sample(sample, (b->len > 0) ? tick - b->t0 : 0, values, n, &dt_len);
+	if (sample_len < 0) {
+		msg_error("mqtt_batch: sample too long, dropped\n");
+		b->stats.dropped++;
+		return (rc != MQSUCCESS) ? rc : BUFFER_OVERFLOW;
+	}
+	if ((b->len > 0) && ((b->len + 1 + sample_len + BATCH_CLOSE_LEN) > batch_limit(b))) {
+		int flushed = batch_flush(b, &b->stats.by_bytes);
+
+		rc = (rc != MQSUCCESS) ? rc : flushed;
+		sample_len = batch_sample(sample, 0, values, n, &dt_len); /* shorter: dt of 0 */
+	}
+	if (b->len == 0) {
+		int opened = batch_open(b, tick);
+
+		if (opened != MQSUCCESS) {
+			b->stats.dropped++;
+			return opened;
+		}
+	}
+	if ((b->len + ((b->count > 0) ? 1 : 0) + sample_len + BATCH_CLOSE_LEN) > batch_limit(b)) {
+		/* Too long even alone: the head leaves no room for it. */
+		msg_error("mqtt_batch: sample of %d bytes dropped\n", sample_len);
+		b->stats.dropped++;
+		if (b->count == 0) {
+			b->len = 0;
+		}
+		return BUFFER_OVERFLOW;
+	}
+
+	if (b->count > 0) {
+		b->buf[b->len++] = ',';
+	}
+	memcpy(&b->buf[b->len], sample, sample_len);
+	b->len += sample_len;
+	b->count++;
+	/* Alone, it would have carried the head and a dt of 0. */
+	b->single += b->head_len + (sample_len - dt_len + 2) + BATCH_CLOSE_LEN + b->conf.msg_overhead;
+
+	if (b->count >= b->conf.max_samples) {
+		int flushed = batch_flush(b, &b->stats.by_count);
+
+		rc = (rc != MQSUCCESS) ? rc : flushed;
+	}
+	return rc;
+}
+
+/**
+ * @brief  Flush the batch if its deadline passed. To be called regularly, samples or not.
+ * @retval MQSUCCESS, or the error of the flush.
+ */
+int mqtt_batch_poll(mqtt_batch_t *b, uint32_t tick) {
+	if ((b->len == 0) || (b->conf.max_age_ms == 0) || ((tick - b->t0) < b->conf.max_age_ms)) {
+		return MQSUCCESS;
+	}
+	b->last_tick = tick;
+	return batch_flush(b, &b->stats.by_age);
+}
+
+/** @brief  Flush the batch now, e.g. before going to sleep. */
+int mqtt_batch_flush(mqtt_batch_t *b) {
+	return batch_flush(b, NULL);
+}
+
+void mqtt_batch_get_stats(mqtt_batch_t *b, mqtt_batch_stats_t *stats) {
+	*stats = b->stats;
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/** Start a batch with the members of head(), at the tick of its first sample. */
+static int batch_open(mqtt_batch_t *b, uint32_t tick) {
+	uint32_t limit = batch_limit(b);
+	int len = 0;
+
+	b->buf[0] = '{';
+	if (b->conf.head != NULL) {
+		len = b->conf.head(b->conf.ctx, &b->buf[1], limit - 1);
+		if ((len < 0) || ((uint32_t) len >= (limit - 1))) {
+			msg_error("mqtt_batch: head failed (%d)\n", len);
+			return FAILURE;
+		}
+	}
+	b->len = 1 + len;
+	if (len > 0) {
+		b->buf[b->len++] = ',';
+	}
+	if ((b->len + sizeof(BATCH_SAMPLES) - 1 + BATCH_CLOSE_LEN) > limit) {
+		b->len = 0;
+		return BUFFER_OVERFLOW;
+	}
+	memcpy(&b->buf[b->len], BATCH_SAMPLES, sizeof(BATCH_SAMPLES) - 1);
+	b->len += sizeof(BATCH_SAMPLES) - 1;
+	b->head_len = b->len;
+	b->count = 0;
+	b->single = 0;
+	b->t0 = tick;
+	return MQSUCCESS;
+}
+
+/**
+ * Format "[dt,v0,v1...]" into s, of MQTT_BATCH_SAMPLE_MAX bytes. dt_len: length of "[dt".
+ * Length, or BUFFER_OVERFLOW if it does not fit: each part is checked against the room left.
+ */
+static int batch_sample(char *s, uint32_t dt, const int32_t *values, int n, int *dt_len) {
+	int len = snprintf(s, MQTT_BATCH_SAMPLE_MAX, "[%lu", (unsigned long) dt);
+	int i;
+
+	if ((len < 0) || (len >= MQTT_BATCH_SAMPLE_MAX)) {
+		return BUFFER_OVERFLOW;
+	}
+	*dt_len = len;
+	for (i = 0; i < n; i++) {
+		int k = snprintf(&s[len], MQTT_BATCH_SAMPLE_MAX - len, ",%ld", (long) values[i]);
+
+		if ((k < 0) || (k >= (MQTT_BATCH_SAMPLE_MAX - len))) {
+			return BUFFER_OVERFLOW;
+		}
+		len += k;
+	}
+	s[len++] = ']'; /* over the '\0': len was MQTT_BATCH_SAMPLE_MAX - 1 at most */
+	return len;
+}
+
+/** Close the open batch and hand it to flush(). It is dropped if flush() fails. */
+static int batch_flush(mqtt_batch_t *b, uint32_t *cause) {
+	uint32_t elapsed;
+	int rc;
+
+	if (b->len == 0) {
+		return MQSUCCESS;
+	}
+	memcpy(&b->buf[b->len], BATCH_CLOSE, BATCH_CLOSE_LEN);
+	b->len += BATCH_CLOSE_LEN;
+	b->buf[b->len] = '\0';
+
+	rc = b->conf.flush(b->conf.ctx, b->buf, b->len);
+	if (rc == MQSUCCESS) {
+		b->stats.messages++;
+		b->stats.batched += b->count;
+		b->stats.bytes += b->len + b->conf.msg_overhead;
+		b->stats.bytes_single += b->single;
+		if (cause != NULL) {
+			(*cause)++;
+		}
+		b->stats.ratio_pct = (uint32_t) (((uint64_t) b->stats.bytes_single * 100) / b->stats.bytes);
+		elapsed = MAX(b->last_tick - b->first_tick, 1);
+		b->stats.saved_mps_milli = (uint32_t) (((uint64_t) (b->stats.batched - b->stats.messages) * 1000000)
+				/ elapsed);
+		msg_info("mqtt_batch: %lu samples in %lu bytes, ratio %lu%%, %lu.%03lu msg/s saved\n",
+				(unsigned long) b->count, (unsigned long) b->len, (unsigned long) b->stats.ratio_pct,
+				(unsigned long) (b->stats.saved_mps_milli / 1000),
+				(unsigned long) (b->stats.saved_mps_milli % 1000));
+	} else {
+		msg_error("mqtt_batch: batch of %lu samples dropped (%d)\n", (unsigned long) b->count, rc);
+		b->stats.dropped += b->count;
+	}
+	b->len = 0;
+	b->count = 0;
+	return rc;
+}
+
+/** Longest message: max_bytes, within the buffer and its terminating '\0'. */
+static uint32_t batch_limit(mqtt_batch_t *b) {
+	if ((b->conf.max_bytes == 0) || (b->conf.max_bytes > (b->size - 1))) {
+		return b->size - 1;
+	}
+	return b->conf.max_bytes;
+}
@@ -0,0 +1,79 @@
+/*
+ * mqtt_batch.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Daruin Solano
+ */
+
+#ifndef MQTT_MQTT_APPS_MQTT_BATCH_H_
+#define MQTT_MQTT_APPS_MQTT_BATCH_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "MQTTClient.h"
+
+/* Telemetry batching: packs the samples taken between two publications into one message.
+ *  - A message is a JSON object: the members written by the head() callback when the batch
+ *    opens (device id, time of the first sample, names of the values...), then "s", the array
+ *    of the samples. A sample is an array of integers, led by its offset in ms from the first
+ *    sample of the batch:
+ *      {"ID":"IOT_STM32","f":["dt","LedOn","Temperature"],"s":[[0,1,72],[10000,1,73]]}
+ *  - The batch is handed to the flush() callback once it holds max_samples, when the next
+ *    sample would make it longer than max_bytes, or max_age_ms after its first sample.
+ *  - The statistics compare the batches with one message per sample, of the same form: bytes
+ *    sent, msg_overhead included, and messages per second saved.
+ *
+ *   mqtt_batch_init(&b, buf, sizeof(buf), &conf);
+ *   ... each sample: mqtt_batch_add(&b, HAL_GetTick(), values, 3);
+ *   ... in the client loop: mqtt_batch_poll(&b, HAL_GetTick());
+ */
+
+#define MQTT_BATCH_VALUES_MAX     8       /**< Most values per sample. */
+#define MQTT_BATCH_SAMPLE_MAX     (1 + 10 + 12 * MQTT_BATCH_VALUES_MAX + 1 + 1)  /**< Longest sample, "[dt,v...]" and its '\0'. */
+
+typedef struct {
+  uint16_t max_samples;     /**< Flush once the batch holds this many samples. */
+  uint16_t max_bytes;       /**< Longest message. At most the buffer size. */
+  uint32_t max_age_ms;      /**< Flush this long after the first sample of the batch. 0: no deadline. */
+  uint16_t msg_overhead;    /**< Bytes sent per message besides the payload: fixed header, topic... */
+  int (*head)(void * ctx, char * buf, size_t size);          /**< Members before "s", comma separated. Length, <0 on error. */
+  int (*flush)(void * ctx, const char * payload, size_t len); /**< Publish a batch. MQSUCCESS, or the batch is dropped. */
+  void * ctx;
+} mqtt_batch_conf_t;
+
+typedef struct {
+  uint32_t samples;         /**< Samples added. */
+  uint32_t batched;         /**< Samples flushed. */
+  uint32_t dropped;         /**< Samples lost: too long, or their batch failed. */
+  uint32_t messages;        /**< Batches flushed. */
+  uint32_t by_count;        /**< Flushes on max_samples... */
+  uint32_t by_bytes;        /**< ... on max_bytes... */
+  uint32_t by_age;          /**< ... on max_age_ms. */
+  uint32_t bytes;           /**< Sent for the batches, msg_overhead included. */
+  uint32_t bytes_single;    /**< Would have been sent for the same samples, one message each. */
+  uint32_t ratio_pct;       /**< bytes_single / bytes, in %. */
+  uint32_t saved_mps_milli; /**< Messages per second saved, in 1/1000, since the first sample. */
+} mqtt_batch_stats_t;
+
+typedef struct {
+  char * buf;               /**< Batch being filled. */
+  uint32_t size;
+  uint32_t len;             /**< 0: no batch open. */
+  uint32_t head_len;        /**< Length of the members from head(). */
+  uint32_t count;           /**< Samples of the open batch. */
+  uint32_t single;          /**< Their bytes, one message each. */
+  uint32_t t0;              /**< Tick of the first sample of the open batch. */
+  uint32_t first_tick;      /**< Tick of the first sample ever. */
+  uint32_t last_tick;       /**< Tick of the last sample or flush. */
+  mqtt_batch_conf_t conf;
+  mqtt_batch_stats_t stats;
+} mqtt_batch_t;
+
+int mqtt_batch_init(mqtt_batch_t * b, char * buf, size_t size, const mqtt_batch_conf_t * conf);
+int mqtt_batch_add(mqtt_batch_t * b, uint32_t tick, const int32_t * values, int n);
+int mqtt_batch_poll(mqtt_batch_t * b, uint32_t tick);
+int mqtt_batch_flush(mqtt_batch_t * b);
+void mqtt_batch_get_stats(mqtt_batch_t * b, mqtt_batch_stats_t * stats);
+
+#endif /* MQTT_MQTT_APPS_MQTT_BATCH_H_ */
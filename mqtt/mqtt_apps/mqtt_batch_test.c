@@ -0,0 +1,111 @@
+/*
+ * mqtt_batch_test.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Daruin Solano
+ *
+ *  Test of the telemetry batching with extreme samples: the largest dt and MQTT_BATCH_VALUES_MAX
+ *  values of INT32_MIN, the longest sample there is, then of INT32_MAX. The batch published must
+ *  hold them whole, and the sample buffer must not overflow (run it under a sanitizer).
+ *
+ *   int mqtt_batch_test(void);   0 if passed.
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "mqtt_batch.h"
+
+/* Private variables ---------------------------------------------------------*/
+static char test_out[512];		/**< Last batch published. */
+static int test_out_count;
+
+/* Private function prototypes -----------------------------------------------*/
+static int test_flush(void *ctx, const char *payload, size_t len);
+static int test_sample(char *s, size_t size, const char *dt, const char *value);
+static int test_check(const char *name, int cond);
+
+/* Functions Definition ------------------------------------------------------*/
+
+/**
+ * @brief  Run the test.
+ * @retval 0 if passed, else the number of checks failed.
+ */
+int mqtt_batch_test(void) {
+	static char buf[512];
+	mqtt_batch_conf_t conf = { 2, 0, 0, 0, NULL, test_flush, NULL };
+	int32_t values[MQTT_BATCH_VALUES_MAX];
+	char expected[sizeof(test_out)];
+	mqtt_batch_t b;
+	int failed = 0;
+	int len;
+	int i;
+
+	failed += test_check("init", mqtt_batch_init(&b, buf, sizeof(buf), &conf) == MQSUCCESS);
+	test_out_count = 0;
+
+	/* The longest sample: dt of UINT32_MAX (tick wrapped back to 0), INT32_MIN values. */
+	for (i = 0; i < MQTT_BATCH_VALUES_MAX; i++) {
+		values[i] = INT32_MIN;
+	}
+	failed += test_check("first sample", mqtt_batch_add(&b, 1, values, MQTT_BATCH_VALUES_MAX) == MQSUCCESS);
+	failed += test_check("longest sample", mqtt_batch_add(&b, 0, values, MQTT_BATCH_VALUES_MAX) == MQSUCCESS);
+	len = snprintf(expected, sizeof(expected), "{\"s\":[");
+	len += test_sample(&expected[len], sizeof(expected) - len, "0", "-2147483648");
+	expected[len++] = ',';
+	len += test_sample(&expected[len], sizeof(expected) - len, "4294967295", "-2147483648");
+	(void) snprintf(&expected[len], sizeof(expected) - len, "]}");
+	failed += test_check("longest sample published whole", (test_out_count == 1) && (strcmp(test_out, expected) == 0));
+	failed += test_check("longest sample fits MQTT_BATCH_SAMPLE_MAX",
+			(strlen("[4294967295]") + (MQTT_BATCH_VALUES_MAX * strlen(",-2147483648")) + 1) <= MQTT_BATCH_SAMPLE_MAX);
+
+	/* INT32_MAX values. */
+	for (i = 0; i < MQTT_BATCH_VALUES_MAX; i++) {
+		values[i] = INT32_MAX;
+	}
+	failed += test_check("largest values", mqtt_batch_add(&b, 0, values, MQTT_BATCH_VALUES_MAX) == MQSUCCESS);
+	failed += test_check("flush", mqtt_batch_flush(&b) == MQSUCCESS);
+	len = snprintf(expected, sizeof(expected), "{\"s\":[");
+	len += test_sample(&expected[len], sizeof(expected) - len, "0", "2147483647");
+	(void) snprintf(&expected[len], sizeof(expected) - len, "]}");
+	failed += test_check("largest values published whole", (test_out_count == 2) && (strcmp(test_out, expected) == 0));
+
+	/* Too many values: dropped. */
+	failed += test_check("too many values dropped",
+			mqtt_batch_add(&b, 0, values, MQTT_BATCH_VALUES_MAX + 1) == BUFFER_OVERFLOW);
+	failed += test_check("nothing else dropped", b.stats.dropped == 1);
+
+	printf("mqtt_batch_test: %s (%d failed)\n", (failed == 0) ? "passed" : "FAILED", failed);
+	return failed;
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+static int test_flush(void *ctx, const char *payload, size_t len) {
+	(void) ctx;
+	if (len >= sizeof(test_out)) {
+		return FAILURE;
+	}
+	memcpy(test_out, payload, len);
+	test_out[len] = '\0';
+	test_out_count++;
+	return MQSUCCESS;
+}
+
+/** "[dt,value...]", with MQTT_BATCH_VALUES_MAX times the value. */
+static int test_sample(char *s, size_t size, const char *dt, const char *value) {
+	int len = snprintf(s, size, "[%s", dt);
+	int i;
+
+	for (i = 0; i < MQTT_BATCH_VALUES_MAX; i++) {
+		len += snprintf(&s[len], size - len, ",%s", value);
+	}
+	len += snprintf(&s[len], size - len, "]");
+	return len;
+}
+
+static int test_check(const char *name, int cond) {
+	if (!cond) {
+		printf("mqtt_batch_test: %s FAILED\n", name);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,266 @@
+/*
+ * mqtt_queue.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Daruin Solano
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "mqtt_queue.h"
+
+/* Private defines -----------------------------------------------------------*/
+#define QUEUE_LEN_SIZE		2		/**< Length prefix of the records in the RAM ring. */
+#define QUEUE_CREDIT_UNIT	1000	/**< Credit of one message. */
+
+/* Private function prototypes -----------------------------------------------*/
+static void ram_write(mqtt_queue_t *q, uint32_t off, const uint8_t *data, uint32_t len);
+static void ram_read(mqtt_queue_t *q, uint32_t off, uint8_t *data, uint32_t len);
+static uint32_t ram_rec_len(mqtt_queue_t *q);
+static void ram_pop(mqtt_queue_t *q);
+static int queue_peek(mqtt_queue_t *q);
+static void queue_refill(mqtt_queue_t *q);
+
+/* Functions Definition ------------------------------------------------------*/
+
+/**
+ * @brief  Set up an empty queue.
+ * @param  In: ram    RAM ring storage. Must outlive the queue.
+ * @param  In: store  Persistent store, already opened. NULL: RAM only.
+ * @param  In: conf   NULL: MQTT_QUEUE_CONF_DEFAULT.
+ * @note   The messages left in the store by a previous run are kept: they will be published first.
+ */
+int mqtt_queue_init(mqtt_queue_t *q, uint8_t *ram, size_t ram_size, const mqtt_queue_store_t *store,
+		const mqtt_queue_conf_t *conf) {
+	static const mqtt_queue_conf_t conf_default = MQTT_QUEUE_CONF_DEFAULT;
+
+	if ((q == NULL) || (ram == NULL) || (ram_size < (QUEUE_LEN_SIZE + MQTT_QUEUE_REC_HDR))) {
+		return FAILURE;
+	}
+	memset(q, 0, sizeof(mqtt_queue_t));
+	q->ram = ram;
+	q->ram_size = ram_size;
+	q->store = store;
+	q->conf = (conf != NULL) ? *conf : conf_default;
+	if (q->conf.batch == 0) {
+		q->conf.batch = 1;
+	}
+	q->credit = q->conf.batch * QUEUE_CREDIT_UNIT;
+	q->refill_tick = HAL_GetTick();
+	q->stats.depth = mqtt_queue_depth(q);
+	q->stats.depth_max = q->stats.depth;
+	if (q->stats.depth > 0) {
+		msg_info("mqtt_queue: %lu messages recovered from the store\n", (unsigned long) q->stats.depth);
+	}
+	return MQSUCCESS;
+}
+
+/**
+ * @brief  Queue a message for publication.
+ * @retval MQSUCCESS, BUFFER_OVERFLOW if the topic or the payload is too long, FAILURE if the
+ *         store failed or is full. In both error cases the message is dropped.
+ */
+int mqtt_queue_push(mqtt_queue_t *q, const char *topic, const void *payload, size_t len,
+		enum QoS qos, unsigned char retained) {
+	size_t topic_len = (topic != NULL) ? strlen(topic) : 0;
+	uint32_t rec_len = MQTT_QUEUE_REC_HDR + topic_len + len;
+	uint32_t need = QUEUE_LEN_SIZE + rec_len;
+	uint8_t *rec = q->rec;
+
+	if ((topic_len == 0) || (topic_len > MQTT_QUEUE_TOPIC_MAX) || (len > MQTT_QUEUE_PAYLOAD_MAX)
+			|| ((q->store == NULL) && (need > q->ram_size))) {
+		q->stats.dropped++;
+		return BUFFER_OVERFLOW;
+	}
+	rec[0] = (uint8_t) ((qos & 0x03) | ((retained != 0) ? 0x04 : 0));
+	rec[1] = (uint8_t) topic_len;
+	rec[2] = (uint8_t) (len & 0xFF);
+	rec[3] = (uint8_t) (len >> 8);
+	memcpy(&rec[MQTT_QUEUE_REC_HDR], topic, topic_len);
+	if (len > 0) {
+		memcpy(&rec[MQTT_QUEUE_REC_HDR + topic_len], payload, len);
+	}
+
+	if ((q->store != NULL) && ((q->store->count(q->store->ctx) > 0) || ((q->ram_size - q->ram_used) < need))) {
+		/* Behind the messages already spilled, or the RAM ring is full. */
+		if (q->store->append(q->store->ctx, rec, rec_len) != 0) {
+			q->stats.dropped++;
+			msg_warning("mqtt_queue: store full, message on %s dropped\n", topic);
+			return FAILURE;
+		}
+		q->stats.spilled++;
+	} else {
+		uint8_t len_le[QUEUE_LEN_SIZE] = { (uint8_t) (rec_len & 0xFF), (uint8_t) (rec_len >> 8) };
+
+		while ((q->ram_size - q->ram_used) < need) {
+			ram_pop(q);
+			q->stats.dropped++;
+		}
+		ram_write(q, q->ram_head + q->ram_used, len_le, QUEUE_LEN_SIZE);
+		ram_write(q, q->ram_head + q->ram_used + QUEUE_LEN_SIZE, rec, rec_len);
+		q->ram_used += need;
+		q->ram_count++;
+	}
+	q->stats.pushed++;
+	q->stats.depth = mqtt_queue_depth(q);
+	q->stats.depth_max = MAX(q->stats.depth_max, q->stats.depth);
+	return MQSUCCESS;
+}
+
+/**
+ * @brief  Publish the oldest queued messages, a batch at most, within the rate allowed.
+ * @note   Blocks for the publication of each message: up to the command timeout of the client
+ *         for the acknowledgement of a QoS1/QoS2 one.
+ * @note   A message the client cannot send (BUFFER_OVERFLOW) or the broker refuses (REFUSED) is
+ *         dropped, so that it does not block the queue.
+ * @retval Messages published or dropped, or FAILURE if a publication failed otherwise: the message
+ *         is kept and the connection is most likely to be reset.
+ */
+int mqtt_queue_drain(mqtt_queue_t *q, MQTTClient *c) {
+	int count = 0;
+
+	queue_refill(q);
+	while ((count < q->conf.batch) && (mqtt_queue_depth(q) > 0)
+			&& ((q->conf.rate == 0) || (q->credit >= QUEUE_CREDIT_UNIT))) {
+		MQTTMessage msg;
+		int rec_len = queue_peek(q);
+		int rc;
+
+		if (rec_len < MQTT_QUEUE_REC_HDR) {
+			/* Unreadable record: skip it rather than block the queue. */
+			msg_error("mqtt_queue: bad record (%d) dropped\n", rec_len);
+			if (q->ram_count > 0) {
+				ram_pop(q);
+			} else if (q->store->pop(q->store->ctx) != 0) {
+				return FAILURE;
+			}
+			q->stats.dropped++;
+			continue;
+		}
+		memset(&msg, 0, sizeof(msg));
+		msg.qos = (enum QoS) (q->rec[0] & 0x03);
+		msg.retained = (q->rec[0] & 0x04) ? 1 : 0;
+		msg.payloadlen = q->rec[2] | (q->rec[3] << 8);
+		msg.payload = &q->rec[MQTT_QUEUE_REC_HDR + q->rec[1]];
+		memcpy(q->topic, &q->rec[MQTT_QUEUE_REC_HDR], q->rec[1]);
+		q->topic[q->rec[1]] = '\0';
+
+		if (!q->draining) {
+			q->draining = true;
+			q->drain_start = HAL_GetTick();
+			q->drain_count = 0;
+		}
+		rc = MQTTPublish(c, q->topic, &msg);
+		if ((rc != MQSUCCESS) && (rc != BUFFER_OVERFLOW) && (rc != REFUSED)) {
+			/* Link down or no acknowledgement: kept for the next connection. */
+			msg_error("mqtt_queue: publication on %s failed (%d), %lu messages left\n", q->topic, rc,
+					(unsigned long) mqtt_queue_depth(q));
+			return FAILURE;
+		}
+		if (q->ram_count > 0) {
+			ram_pop(q);
+		} else {
+			(void) q->store->pop(q->store->ctx);
+		}
+		count++;
+		q->credit = (q->credit >= QUEUE_CREDIT_UNIT) ? q->credit - QUEUE_CREDIT_UNIT : 0;
+		if (rc != MQSUCCESS) {
+			/* Too long for the send buffer, or refused by the broker: it would be every time. */
+			msg_error("mqtt_queue: publication on %s rejected (%d), message dropped\n", q->topic, rc);
+			q->stats.rejected++;
+			q->stats.dropped++;
+			continue;
+		}
+		q->drain_count++;
+		q->stats.drained++;
+	}
+
+	q->stats.depth = mqtt_queue_depth(q);
+	if (q->draining && (q->stats.depth == 0)) {
+		uint32_t elapsed = MAX(HAL_GetTick() - q->drain_start, 1);
+
+		q->draining = false;
+		q->stats.drain_rate = (uint32_t) (((uint64_t) q->drain_count * 1000) / elapsed);
+		if (q->drain_count > 1) {
+			msg_info("mqtt_queue: %lu messages drained in %lu ms (%lu msg/s)\n",
+					(unsigned long) q->drain_count, (unsigned long) elapsed,
+					(unsigned long) q->stats.drain_rate);
+		}
+	}
+	return count;
+}
+
+/** @brief  Messages queued, RAM and store. */
+uint32_t mqtt_queue_depth(mqtt_queue_t *q) {
+	return q->ram_count + ((q->store != NULL) ? q->store->count(q->store->ctx) : 0);
+}
+
+void mqtt_queue_get_stats(mqtt_queue_t *q, mqtt_queue_stats_t *stats) {
+	q->stats.depth = mqtt_queue_depth(q);
+	q->stats.ram_bytes = q->ram_used;
+	*stats = q->stats;
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+static void ram_write(mqtt_queue_t *q, uint32_t off, const uint8_t *data, uint32_t len) {
+	uint32_t pos = off % q->ram_size;
+	uint32_t first = MIN(len, q->ram_size - pos);
+
+	memcpy(&q->ram[pos], data, first);
+	memcpy(q->ram, &data[first], len - first);
+}
+
+static void ram_read(mqtt_queue_t *q, uint32_t off, uint8_t *data, uint32_t len) {
+	uint32_t pos = off % q->ram_size;
+	uint32_t first = MIN(len, q->ram_size - pos);
+
+	memcpy(data, &q->ram[pos], first);
+	memcpy(&data[first], q->ram, len - first);
+}
+
+/** Length of the oldest record of the RAM ring. */
+static uint32_t ram_rec_len(mqtt_queue_t *q) {
+	uint8_t len_le[QUEUE_LEN_SIZE];
+
+	ram_read(q, q->ram_head, len_le, QUEUE_LEN_SIZE);
+	return len_le[0] | (len_le[1] << 8);
+}
+
+static void ram_pop(mqtt_queue_t *q) {
+	uint32_t size = QUEUE_LEN_SIZE + ram_rec_len(q);
+
+	q->ram_head = (q->ram_head + size) % q->ram_size;
+	q->ram_used -= size;
+	q->ram_count--;
+	if (q->ram_count == 0) {
+		q->ram_head = 0;
+		q->ram_used = 0;
+	}
+}
+
+/** Copy the oldest record to q->rec: from the RAM ring first, which holds the oldest ones. */
+static int queue_peek(mqtt_queue_t *q) {
+	int len;
+
+	if (q->ram_count > 0) {
+		len = (int) ram_rec_len(q);
+		ram_read(q, q->ram_head + QUEUE_LEN_SIZE, q->rec, len);
+	} else {
+		len = q->store->peek(q->store->ctx, q->rec, sizeof(q->rec));
+	}
+	if ((len >= MQTT_QUEUE_REC_HDR)
+			&& (len != (MQTT_QUEUE_REC_HDR + q->rec[1] + (q->rec[2] | (q->rec[3] << 8))))) {
+		len = FAILURE;
+	}
+	return len;
+}
+
+/** Token bucket: rate messages per second, up to a batch in advance. */
+static void queue_refill(mqtt_queue_t *q) {
+	uint32_t now = HAL_GetTick();
+	uint32_t max = q->conf.batch * QUEUE_CREDIT_UNIT;
+	uint64_t credit = q->credit + ((uint64_t) (now - q->refill_tick) * q->conf.rate);
+
+	q->credit = (uint32_t) MIN(credit, max);
+	q->refill_tick = now;
+}
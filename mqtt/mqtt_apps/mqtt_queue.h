@@ -0,0 +1,134 @@
+/*
+ * mqtt_queue.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Daruin Solano
+ */
+
+#ifndef MQTT_MQTT_APPS_MQTT_QUEUE_H_
+#define MQTT_MQTT_APPS_MQTT_QUEUE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "MQTTClient.h"
+
+/* Offline publish queue: keeps the messages published while the broker cannot be reached and
+ * sends them, oldest first, once it is back.
+ *  - The messages are held in a RAM ring. When it is full they spill to an optional persistent
+ *    store: a log segment in flash, or a file on the host. Without a store, the oldest message
+ *    is dropped to make room.
+ *  - Once the store holds a message, the newer ones follow it there: the order is kept, and the
+ *    store drains after the RAM ring.
+ *  - mqtt_queue_drain() publishes a batch at most per call, paced by a token bucket so that a
+ *    long backlog does not starve the other traffic of the connection. A message is removed
+ *    only once MQTTPublish() succeeded, i.e. once acknowledged for QoS1 and QoS2, or once it
+ *    failed for good: too long for the send buffer of the client, or refused by the broker.
+ *
+ *   mqtt_queue_init(&q, ram, sizeof(ram), &store, NULL);
+ *   ... connected or not: mqtt_queue_push(&q, topic, payload, len, QOS1, 0);
+ *   ... in the client loop: if (MQTTIsConnected(&mc)) mqtt_queue_drain(&q, &mc);
+ */
+
+#define MQTT_QUEUE_TOPIC_MAX      128     /**< Longest topic, \0 excluded. */
+#define MQTT_QUEUE_PAYLOAD_MAX    1024    /**< Longest payload. */
+#define MQTT_QUEUE_REC_HDR        4       /**< Record header: flags, topic length, payload length (LE16). */
+#define MQTT_QUEUE_REC_MAX        (MQTT_QUEUE_REC_HDR + MQTT_QUEUE_TOPIC_MAX + MQTT_QUEUE_PAYLOAD_MAX)
+
+/** Persistent store of the spilled records. The records are opaque byte strings, in FIFO order. */
+typedef struct {
+  int (*append)(void * ctx, const uint8_t * rec, size_t len);  /**< 0, or <0 if full or failed. */
+  int (*peek)(void * ctx, uint8_t * rec, size_t size);         /**< Length of the oldest record, 0 if none, <0 on error. */
+  int (*pop)(void * ctx);                                      /**< Remove the oldest record. 0, or <0 on error. */
+  uint32_t (*count)(void * ctx);                               /**< Records held. */
+  void * ctx;
+} mqtt_queue_store_t;
+
+typedef struct {
+  uint16_t batch;           /**< Max messages published per mqtt_queue_drain() call. */
+  uint16_t rate;            /**< Max messages per second. 0: not paced. */
+} mqtt_queue_conf_t;
+
+#define MQTT_QUEUE_CONF_DEFAULT   { 8, 20 }
+
+typedef struct {
+  uint32_t depth;           /**< Messages queued, RAM and store. */
+  uint32_t depth_max;       /**< Highest depth seen. */
+  uint32_t ram_bytes;       /**< RAM ring occupancy. */
+  uint32_t pushed;
+  uint32_t spilled;         /**< Pushed to the store. */
+  uint32_t dropped;         /**< Lost: RAM ring full without a store, store full or failing, too long, or rejected. */
+  uint32_t rejected;        /**< Dropped by mqtt_queue_drain(): the client or the broker rejected it. */
+  uint32_t drained;         /**< Published by mqtt_queue_drain(). */
+  uint32_t drain_rate;      /**< Messages per second of the last complete drain, from non-empty to empty. */
+} mqtt_queue_stats_t;
+
+typedef struct {
+  uint8_t * ram;            /**< RAM ring: records prefixed by their length (LE16). */
+  uint32_t ram_size;
+  uint32_t ram_head;        /**< Offset of the oldest record. */
+  uint32_t ram_used;        /**< Bytes used. */
+  uint32_t ram_count;       /**< Records held. */
+  const mqtt_queue_store_t * store;
+  mqtt_queue_conf_t conf;
+  uint32_t credit;          /**< Token bucket, in 1/1000 message. */
+  uint32_t refill_tick;     /**< Tick of the last refill. */
+  bool draining;            /**< A drain run is in progress: its start and count are being measured. */
+  uint32_t drain_start;
+  uint32_t drain_count;
+  mqtt_queue_stats_t stats;
+  uint8_t rec[MQTT_QUEUE_REC_MAX];            /**< Record being pushed or published. */
+  char topic[MQTT_QUEUE_TOPIC_MAX + 1];
+} mqtt_queue_t;
+
+int mqtt_queue_init(mqtt_queue_t * q, uint8_t * ram, size_t ram_size, const mqtt_queue_store_t * store,
+                    const mqtt_queue_conf_t * conf);
+int mqtt_queue_push(mqtt_queue_t * q, const char * topic, const void * payload, size_t len,
+                    enum QoS qos, unsigned char retained);
+int mqtt_queue_drain(mqtt_queue_t * q, MQTTClient * c);
+uint32_t mqtt_queue_depth(mqtt_queue_t * q);
+void mqtt_queue_get_stats(mqtt_queue_t * q, mqtt_queue_stats_t * stats);
+
+/* Stores --------------------------------------------------------------------*/
+
+#ifdef USE_HOST
+/** File store: a log of length-prefixed records after a header { read offset, count }. The file
+ *  is truncated whenever it becomes empty. */
+typedef struct {
+  FILE * f;
+  uint32_t max_size;        /**< Max file size in bytes. 0: no limit. */
+  uint32_t read_off;        /**< Offset of the oldest record. */
+  uint32_t end;             /**< File size. */
+  uint32_t count;
+} mqtt_queue_file_t;
+
+int mqtt_queue_file_open(mqtt_queue_file_t * fs, mqtt_queue_store_t * store, const char * path,
+                         uint32_t max_size);
+void mqtt_queue_file_close(mqtt_queue_file_t * fs);
+#endif /* USE_HOST */
+
+/** Flash store: a circular log over a memory-mapped flash region, written by double words.
+ *  - Each record is a header { magic, length, sequence }, a status double word programmed to 0
+ *    when the record is consumed, and the data padded to 8 bytes. A record does not cross a page.
+ *  - A page is erased when the log enters it, which requires it to hold no live record: the
+ *    store is full when the write position reaches the page of the oldest live record.
+ *  - mqtt_queue_flash_open() finds the records back after a reset from their sequence numbers.
+ *
+ *  The caller sets the region and the flash operations before mqtt_queue_flash_open(). NULL
+ *  operations select the STM32L4 HAL ones. */
+typedef struct {
+  uintptr_t start;          /**< Region address, page aligned. */
+  uint32_t size;            /**< Region size, a multiple of the page size, 2 pages at least. */
+  uint32_t page;            /**< Erase page size. */
+  int (*erase)(uintptr_t addr);                                   /**< Erase the page at addr. 0, or <0. */
+  int (*program)(uintptr_t addr, const uint8_t * data, size_t len); /**< Program erased flash. len multiple of 8. 0, or <0. */
+  /* State */
+  uintptr_t head;           /**< Oldest live record. */
+  uintptr_t tail;           /**< Next write position. */
+  uint32_t count;           /**< Live records. */
+  uint32_t seq;             /**< Sequence number of the next record. */
+} mqtt_queue_flash_t;
+
+int mqtt_queue_flash_open(mqtt_queue_flash_t * fl, mqtt_queue_store_t * store);
+
+#endif /* MQTT_MQTT_APPS_MQTT_QUEUE_H_ */
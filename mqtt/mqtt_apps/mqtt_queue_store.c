@@ -0,0 +1,459 @@
+/*
+ * mqtt_queue_store.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Daruin Solano
+ *
+ *  Persistent stores of the MQTT offline queue: a file on the host, a flash log segment on the
+ *  target. See mqtt_queue.h.
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "mqtt_queue.h"
+#ifdef USE_HOST
+#include <unistd.h>
+#endif
+
+/* Private defines -----------------------------------------------------------*/
+#define FILE_MAGIC			0x5154514DUL	/**< "MQTQ" */
+#define FILE_HDR_SIZE		12				/**< magic, read offset, count: LE32 each. */
+
+#define FLASH_MAGIC			0x51E5
+#define FLASH_HDR_SIZE		16				/**< Header and status double words. */
+#define FLASH_ALIGN8(x)		(((x) + 7) & ~7UL)
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct {
+	uint16_t magic;
+	uint16_t len;
+	uint32_t seq;
+} flash_hdr_t;
+
+/* Private function prototypes -----------------------------------------------*/
+#ifdef USE_HOST
+static int file_append(void *ctx, const uint8_t *rec, size_t len);
+static int file_peek(void *ctx, uint8_t *rec, size_t size);
+static int file_pop(void *ctx);
+static uint32_t file_count(void *ctx);
+static int file_sync_hdr(mqtt_queue_file_t *fs);
+static void put_le32(uint8_t *p, uint32_t v);
+static uint32_t get_le32(const uint8_t *p);
+#else
+static int flash_hal_erase(uintptr_t addr);
+static int flash_hal_program(uintptr_t addr, const uint8_t *data, size_t len);
+#endif /* USE_HOST */
+static int flash_append(void *ctx, const uint8_t *rec, size_t len);
+static int flash_peek(void *ctx, uint8_t *rec, size_t size);
+static int flash_pop(void *ctx);
+static uint32_t flash_count(void *ctx);
+static uintptr_t flash_next_page(mqtt_queue_flash_t *fl, uintptr_t addr);
+static bool flash_blank(uintptr_t addr, size_t len);
+static bool flash_rec_at(mqtt_queue_flash_t *fl, uintptr_t addr, flash_hdr_t *hdr, bool *live);
+static void flash_skip(mqtt_queue_flash_t *fl);
+
+/* Functions Definition ------------------------------------------------------*/
+
+#ifdef USE_HOST
+/**
+ * @brief  Open, or create, a file store, and fill the store interface.
+ * @retval 0, or -1 if the file cannot be opened or created.
+ */
+int mqtt_queue_file_open(mqtt_queue_file_t *fs, mqtt_queue_store_t *store, const char *path,
+		uint32_t max_size) {
+	uint8_t hdr[FILE_HDR_SIZE];
+	long end;
+
+	memset(fs, 0, sizeof(mqtt_queue_file_t));
+	fs->max_size = max_size;
+	fs->f = fopen(path, "r+b");
+	if ((fs->f != NULL) && (fread(hdr, 1, FILE_HDR_SIZE, fs->f) == FILE_HDR_SIZE)
+			&& (get_le32(hdr) == FILE_MAGIC) && (fseek(fs->f, 0, SEEK_END) == 0)
+			&& ((end = ftell(fs->f)) >= FILE_HDR_SIZE)) {
+		fs->read_off = get_le32(&hdr[4]);
+		fs->count = get_le32(&hdr[8]);
+		fs->end = (uint32_t) end;
+		if ((fs->read_off < FILE_HDR_SIZE) || (fs->read_off > fs->end)) {
+			msg_warning("mqtt_queue_file: %s is corrupted, reset\n", path);
+			fs->count = 0;
+		}
+	} else {
+		if (fs->f != NULL) {
+			fclose(fs->f);
+		}
+		fs->f = fopen(path, "w+b");
+		if (fs->f == NULL) {
+			msg_error("mqtt_queue_file: cannot create %s\n", path);
+			return -1;
+		}
+		fs->count = 0;
+	}
+	if (fs->count == 0) {
+		fs->read_off = fs->end = FILE_HDR_SIZE;
+		if ((ftruncate(fileno(fs->f), 0) != 0) || (file_sync_hdr(fs) != 0)) {
+			fclose(fs->f);
+			fs->f = NULL;
+			return -1;
+		}
+	}
+	store->append = file_append;
+	store->peek = file_peek;
+	store->pop = file_pop;
+	store->count = file_count;
+	store->ctx = fs;
+	return 0;
+}
+
+void mqtt_queue_file_close(mqtt_queue_file_t *fs) {
+	if (fs->f != NULL) {
+		fclose(fs->f);
+		fs->f = NULL;
+	}
+}
+#endif /* USE_HOST */
+
+/**
+ * @brief  Open a flash store over the region set in fl, recover its records, and fill the store
+ *         interface.
+ * @retval 0, or -1 if the region is not usable.
+ */
+int mqtt_queue_flash_open(mqtt_queue_flash_t *fl, mqtt_queue_store_t *store) {
+	uint32_t seq_max = 0;
+	uint32_t seq_min = 0;
+	bool found = false;
+
+	if ((fl->page < (FLASH_HDR_SIZE + FLASH_ALIGN8(MQTT_QUEUE_REC_MAX))) || ((fl->size % fl->page) != 0)
+			|| ((fl->size / fl->page) < 2) || ((fl->start % 8) != 0)) {
+		return -1;
+	}
+#ifndef USE_HOST
+	if (fl->erase == NULL) {
+		fl->erase = flash_hal_erase;
+	}
+	if (fl->program == NULL) {
+		fl->program = flash_hal_program;
+	}
+#endif /* USE_HOST */
+	if ((fl->erase == NULL) || (fl->program == NULL)) {
+		return -1;
+	}
+
+	/* The oldest live record is the head; the write position follows the newest record. */
+	fl->count = 0;
+	fl->head = fl->tail = fl->start;
+	for (uintptr_t page = fl->start; page < (fl->start + fl->size); page += fl->page) {
+		uintptr_t addr = page;
+		flash_hdr_t hdr;
+		bool live;
+
+		while (flash_rec_at(fl, addr, &hdr, &live)) {
+			if (!found || ((int32_t) (hdr.seq - seq_max) > 0)) {
+				seq_max = hdr.seq;
+				fl->tail = addr + FLASH_HDR_SIZE + FLASH_ALIGN8(hdr.len);
+			}
+			if (live && ((fl->count == 0) || ((int32_t) (hdr.seq - seq_min) < 0))) {
+				seq_min = hdr.seq;
+				fl->head = addr;
+			}
+			fl->count += live ? 1 : 0;
+			found = true;
+			addr += FLASH_HDR_SIZE + FLASH_ALIGN8(hdr.len);
+		}
+	}
+	fl->seq = found ? seq_max + 1 : 0;
+	if (fl->tail == (fl->start + fl->size)) {
+		fl->tail = fl->start;
+	}
+	if (fl->count == 0) {
+		fl->head = fl->tail;
+	}
+
+	store->append = flash_append;
+	store->peek = flash_peek;
+	store->pop = flash_pop;
+	store->count = flash_count;
+	store->ctx = fl;
+	return 0;
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+#ifdef USE_HOST
+static int file_append(void *ctx, const uint8_t *rec, size_t len) {
+	mqtt_queue_file_t *fs = (mqtt_queue_file_t*) ctx;
+	uint8_t len_le[2] = { (uint8_t) (len & 0xFF), (uint8_t) (len >> 8) };
+
+	if ((fs->max_size != 0) && ((fs->end + sizeof(len_le) + len) > fs->max_size)) {
+		return -1;
+	}
+	if ((fseek(fs->f, fs->end, SEEK_SET) != 0) || (fwrite(len_le, 1, sizeof(len_le), fs->f) != sizeof(len_le))
+			|| (fwrite(rec, 1, len, fs->f) != len)) {
+		return -1;
+	}
+	fs->end += sizeof(len_le) + len;
+	fs->count++;
+	return file_sync_hdr(fs);
+}
+
+static int file_peek(void *ctx, uint8_t *rec, size_t size) {
+	mqtt_queue_file_t *fs = (mqtt_queue_file_t*) ctx;
+	uint8_t len_le[2];
+	size_t len;
+
+	if (fs->count == 0) {
+		return 0;
+	}
+	if ((fseek(fs->f, fs->read_off, SEEK_SET) != 0) || (fread(len_le, 1, sizeof(len_le), fs->f) != sizeof(len_le))) {
+		return -1;
+	}
+	len = len_le[0] | (len_le[1] << 8);
+	if ((len > size) || (fread(rec, 1, len, fs->f) != len)) {
+		return -1;
+	}
+	return (int) len;
+}
+
+static int file_pop(void *ctx) {
+	mqtt_queue_file_t *fs = (mqtt_queue_file_t*) ctx;
+	uint8_t len_le[2];
+
+	if (fs->count == 0) {
+		return -1;
+	}
+	if ((fseek(fs->f, fs->read_off, SEEK_SET) != 0) || (fread(len_le, 1, sizeof(len_le), fs->f) != sizeof(len_le))) {
+		return -1;
+	}
+	fs->read_off += sizeof(len_le) + (len_le[0] | (len_le[1] << 8));
+	fs->count--;
+	if (fs->count == 0) {
+		/* Empty: start over, the file does not grow while the broker is reachable. */
+		fs->read_off = fs->end = FILE_HDR_SIZE;
+		fflush(fs->f);
+		if (ftruncate(fileno(fs->f), FILE_HDR_SIZE) != 0) {
+			return -1;
+		}
+	}
+	return file_sync_hdr(fs);
+}
+
+static uint32_t file_count(void *ctx) {
+	return ((mqtt_queue_file_t*) ctx)->count;
+}
+
+static int file_sync_hdr(mqtt_queue_file_t *fs) {
+	uint8_t hdr[FILE_HDR_SIZE];
+
+	put_le32(hdr, FILE_MAGIC);
+	put_le32(&hdr[4], fs->read_off);
+	put_le32(&hdr[8], fs->count);
+	if ((fseek(fs->f, 0, SEEK_SET) != 0) || (fwrite(hdr, 1, FILE_HDR_SIZE, fs->f) != FILE_HDR_SIZE)
+			|| (fflush(fs->f) != 0)) {
+		return -1;
+	}
+	return 0;
+}
+
+static void put_le32(uint8_t *p, uint32_t v) {
+	p[0] = (uint8_t) v;
+	p[1] = (uint8_t) (v >> 8);
+	p[2] = (uint8_t) (v >> 16);
+	p[3] = (uint8_t) (v >> 24);
+}
+
+static uint32_t get_le32(const uint8_t *p) {
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+#else
+
+static int flash_hal_erase(uintptr_t addr) {
+	FLASH_EraseInitTypeDef erase;
+	uint32_t page_error = 0;
+	HAL_StatusTypeDef st;
+
+	memset(&erase, 0, sizeof(erase));
+	erase.TypeErase = FLASH_TYPEERASE_PAGES;
+	erase.Banks = ((addr - FLASH_BASE) < FLASH_BANK_SIZE) ? FLASH_BANK_1 : FLASH_BANK_2;
+	erase.Page = ((addr - FLASH_BASE) % FLASH_BANK_SIZE) / FLASH_PAGE_SIZE;
+	erase.NbPages = 1;
+	HAL_FLASH_Unlock();
+	__HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_ALL_ERRORS);
+	st = HAL_FLASHEx_Erase(&erase, &page_error);
+	HAL_FLASH_Lock();
+	return (st == HAL_OK) ? 0 : -1;
+}
+
+static int flash_hal_program(uintptr_t addr, const uint8_t *data, size_t len) {
+	HAL_StatusTypeDef st = HAL_OK;
+
+	HAL_FLASH_Unlock();
+	__HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_ALL_ERRORS);
+	for (size_t off = 0; (off < len) && (st == HAL_OK); off += 8) {
+		uint64_t dword;
+
+		memcpy(&dword, &data[off], sizeof(dword));
+		st = HAL_FLASH_Program(FLASH_TYPEPROGRAM_DOUBLEWORD, addr + off, dword);
+	}
+	HAL_FLASH_Lock();
+	return (st == HAL_OK) ? 0 : -1;
+}
+#endif /* USE_HOST */
+
+static int flash_append(void *ctx, const uint8_t *rec, size_t len) {
+	mqtt_queue_flash_t *fl = (mqtt_queue_flash_t*) ctx;
+	uint32_t size = FLASH_HDR_SIZE + FLASH_ALIGN8(len);
+	uint32_t pages = fl->size / fl->page;
+	uint8_t dword[8];
+	flash_hdr_t hdr;
+
+	if ((len == 0) || (size > fl->page)) {
+		return -1;
+	}
+	for (uint32_t tries = 0; tries <= pages; tries++) {
+		uint32_t off = (fl->tail - fl->start) % fl->page;
+
+		if ((off != 0) && ((off + size) > fl->page)) {
+			fl->tail = flash_next_page(fl, fl->tail);
+			continue;
+		}
+		if (off == 0) {
+			/* Entering a page: it must hold no live record. */
+			if ((fl->count > 0) && ((fl->head - ((fl->head - fl->start) % fl->page)) == fl->tail)) {
+				return -1;
+			}
+			if (!flash_blank(fl->tail, fl->page) && (fl->erase(fl->tail) != 0)) {
+				return -1;
+			}
+		}
+		if (!flash_blank(fl->tail, size)) {
+			/* Left over by an interrupted write. */
+			fl->tail = flash_next_page(fl, fl->tail);
+			continue;
+		}
+
+		/* The data first, the header last: a record is only seen once complete. */
+		if ((len >= 8) && (fl->program(fl->tail + FLASH_HDR_SIZE, rec, len & ~7UL) != 0)) {
+			return -1;
+		}
+		if ((len % 8) != 0) {
+			memset(dword, 0xFF, sizeof(dword));
+			memcpy(dword, &rec[len & ~7UL], len % 8);
+			if (fl->program(fl->tail + FLASH_HDR_SIZE + (len & ~7UL), dword, sizeof(dword)) != 0) {
+				return -1;
+			}
+		}
+		hdr.magic = FLASH_MAGIC;
+		hdr.len = (uint16_t) len;
+		hdr.seq = fl->seq;
+		memcpy(dword, &hdr, sizeof(dword));
+		if (fl->program(fl->tail, dword, sizeof(dword)) != 0) {
+			return -1;
+		}
+		if (fl->count == 0) {
+			fl->head = fl->tail;
+		}
+		fl->tail += size;
+		if (fl->tail == (fl->start + fl->size)) {
+			fl->tail = fl->start;
+		}
+		fl->seq++;
+		fl->count++;
+		return 0;
+	}
+	return -1;
+}
+
+static int flash_peek(void *ctx, uint8_t *rec, size_t size) {
+	mqtt_queue_flash_t *fl = (mqtt_queue_flash_t*) ctx;
+	flash_hdr_t hdr;
+	bool live;
+
+	if (fl->count == 0) {
+		return 0;
+	}
+	if (!flash_rec_at(fl, fl->head, &hdr, &live) || !live || (hdr.len > size)) {
+		return -1;
+	}
+	memcpy(rec, (const void*) (fl->head + FLASH_HDR_SIZE), hdr.len);
+	return hdr.len;
+}
+
+static int flash_pop(void *ctx) {
+	mqtt_queue_flash_t *fl = (mqtt_queue_flash_t*) ctx;
+	uint8_t consumed[8] = { 0 };
+	flash_hdr_t hdr;
+	bool live;
+
+	if (fl->count == 0) {
+		return -1;
+	}
+	if (!flash_rec_at(fl, fl->head, &hdr, &live)) {
+		return -1;
+	}
+	if (fl->program(fl->head + 8, consumed, sizeof(consumed)) != 0) {
+		return -1;
+	}
+	fl->count--;
+	fl->head += FLASH_HDR_SIZE + FLASH_ALIGN8(hdr.len);
+	flash_skip(fl);
+	return 0;
+}
+
+static uint32_t flash_count(void *ctx) {
+	return ((mqtt_queue_flash_t*) ctx)->count;
+}
+
+static uintptr_t flash_next_page(mqtt_queue_flash_t *fl, uintptr_t addr) {
+	uint32_t page = (uint32_t) ((addr - fl->start) / fl->page) + 1;
+
+	return fl->start + ((page * fl->page) % fl->size);
+}
+
+static bool flash_blank(uintptr_t addr, size_t len) {
+	const uint8_t *p = (const uint8_t*) addr;
+
+	for (size_t i = 0; i < len; i++) {
+		if (p[i] != 0xFF) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/** Valid record header at addr, within its page. */
+static bool flash_rec_at(mqtt_queue_flash_t *fl, uintptr_t addr, flash_hdr_t *hdr, bool *live) {
+	uint32_t off = (addr - fl->start) % fl->page;
+
+	if ((addr >= (fl->start + fl->size)) || ((off + FLASH_HDR_SIZE) > fl->page)) {
+		return false;
+	}
+	memcpy(hdr, (const void*) addr, sizeof(flash_hdr_t));
+	if ((hdr->magic != FLASH_MAGIC) || ((off + FLASH_HDR_SIZE + FLASH_ALIGN8(hdr->len)) > fl->page)) {
+		return false;
+	}
+	*live = flash_blank(addr + 8, 8);
+	return true;
+}
+
+/** Move the head to the next live record, across the end of the pages and the consumed records. */
+static void flash_skip(mqtt_queue_flash_t *fl) {
+	uint32_t pages = fl->size / fl->page;
+	flash_hdr_t hdr;
+	bool live;
+
+	if (fl->count == 0) {
+		fl->head = fl->tail;
+		return;
+	}
+	for (uint32_t i = 0; i <= pages; ) {
+		fl->head = fl->start + ((fl->head - fl->start) % fl->size);
+		if (!flash_rec_at(fl, fl->head, &hdr, &live)) {
+			/* No more record in this page. */
+			fl->head = flash_next_page(fl, fl->head);
+			i++;
+		} else if (live) {
+			return;
+		} else {
+			fl->head += FLASH_HDR_SIZE + FLASH_ALIGN8(hdr.len);
+		}
+	}
+}
@@ -0,0 +1,193 @@
+/*
+ * mqtt_queue_test.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Daruin Solano
+ *
+ *  Host test of the offline queue over the file store, against a fake broker in memory:
+ *   - a message the client always rejects (longer than its send buffer) is dropped and counted,
+ *     the messages around it are published in order and the queue does not stall on it;
+ *   - a message whose publication fails on the link is kept, and published once reconnected.
+ *
+ *   int mqtt_queue_test(const char *path);   path: scratch file of the store. 0 if passed.
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "mqtt_queue.h"
+
+#ifdef USE_HOST
+#include <unistd.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define TEST_TOPIC			"/t/q"
+#define TEST_SEND_BUF		256		/**< The messages longer than this are rejected by the client. */
+#define TEST_REJECTED		6		/**< Number of the message rejected. */
+#define TEST_REJECTED_LEN	600
+#define TEST_MESSAGES		12
+#define TEST_RETRIED		100		/**< Numbers of the messages published after a link failure. */
+
+/* Private variables ---------------------------------------------------------*/
+static unsigned char test_rx[64];	/**< Acknowledgements of the fake broker, read by the client. */
+static int test_rx_len;
+static int test_link_down;
+static int test_got[TEST_MESSAGES * 2];	/**< Numbers of the messages published, in order. */
+static int test_got_count;
+
+/* Private function prototypes -----------------------------------------------*/
+static int test_read(Network *n, unsigned char *buf, int len, int timeout_ms);
+static int test_write(Network *n, unsigned char *buf, int len, int timeout_ms);
+static int test_disconnect(Network *n);
+static int test_push(mqtt_queue_t *q, int number, size_t len);
+static int test_drain(mqtt_queue_t *q, MQTTClient *c);
+static int test_check(const char *name, int cond);
+
+/* Functions Definition ------------------------------------------------------*/
+
+/**
+ * @brief  Run the test.
+ * @retval 0 if passed, else the number of checks failed.
+ */
+int mqtt_queue_test(const char *path) {
+	static unsigned char sendbuf[TEST_SEND_BUF];
+	static unsigned char readbuf[256];
+	static uint8_t ram[128];		/**< A few records: the others, and the long one, spill to the file. */
+	Network net = { test_read, test_write, test_disconnect };
+	MQTTPacket_connectData options = MQTTPacket_connectData_initializer;
+	mqtt_queue_conf_t conf = { 4, 0 };
+	mqtt_queue_stats_t stats;
+	mqtt_queue_store_t store;
+	mqtt_queue_file_t fs;
+	mqtt_queue_t q;
+	MQTTClient c;
+	int in_order = 1;
+	int failed = 0;
+	int i;
+
+	(void) unlink(path);
+	if (mqtt_queue_file_open(&fs, &store, path, 0) != 0) {
+		return test_check("file store open", 0);
+	}
+	(void) mqtt_queue_init(&q, ram, sizeof(ram), &store, &conf);
+	MQTTClientInit(&c, &net, 1000, sendbuf, sizeof(sendbuf), readbuf, sizeof(readbuf));
+	test_rx_len = 0;
+	test_link_down = 0;
+	test_got_count = 0;
+	failed += test_check("connect", MQTTConnect(&c, &options) == MQSUCCESS);
+
+	/* A message always rejected, amid others: dropped, the others go on. */
+	for (i = 0; i < TEST_MESSAGES; i++) {
+		failed += test_check("push", test_push(&q, i, (i == TEST_REJECTED) ? TEST_REJECTED_LEN : 16) == MQSUCCESS);
+	}
+	mqtt_queue_get_stats(&q, &stats);
+	failed += test_check("long message in the file store", stats.spilled > 0);
+	failed += test_check("drain never fails on the rejected message", test_drain(&q, &c) == MQSUCCESS);
+	for (i = 0; i < test_got_count; i++) {
+		in_order &= (test_got[i] == (i + ((i >= TEST_REJECTED) ? 1 : 0)));
+	}
+	failed += test_check("the others published in order",
+			(test_got_count == (TEST_MESSAGES - 1)) && in_order);
+	mqtt_queue_get_stats(&q, &stats);
+	failed += test_check("rejected counted", (stats.rejected == 1) && (stats.dropped == 1));
+	failed += test_check("queue and file store empty", (stats.depth == 0) && (store.count(store.ctx) == 0));
+	failed += test_check("still connected", MQTTIsConnected(&c));
+
+	/* A link failure: kept, and published once reconnected. */
+	test_got_count = 0;
+	failed += test_check("push", test_push(&q, TEST_RETRIED, 16) == MQSUCCESS);
+	failed += test_check("push", test_push(&q, TEST_RETRIED + 1, 16) == MQSUCCESS);
+	test_link_down = 1;
+	failed += test_check("link failure reported", mqtt_queue_drain(&q, &c) == FAILURE);
+	failed += test_check("link failure keeps the messages", mqtt_queue_depth(&q) == 2);
+	test_link_down = 0;
+	failed += test_check("reconnect", MQTTConnect(&c, &options) == MQSUCCESS);
+	failed += test_check("drain after reconnection", test_drain(&q, &c) == MQSUCCESS);
+	failed += test_check("kept messages published", (test_got_count == 2) && (test_got[0] == TEST_RETRIED)
+			&& (test_got[1] == (TEST_RETRIED + 1)));
+	mqtt_queue_get_stats(&q, &stats);
+	failed += test_check("nothing else dropped", stats.dropped == 1);
+
+	mqtt_queue_file_close(&fs);
+	(void) unlink(path);
+	printf("mqtt_queue_test: %s (%d failed)\n", (failed == 0) ? "passed" : "FAILED", failed);
+	return failed;
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+static int test_read(Network *n, unsigned char *buf, int len, int timeout_ms) {
+	int k = MIN(len, test_rx_len);
+
+	(void) n;
+	(void) timeout_ms;
+	memcpy(buf, test_rx, k);
+	memmove(test_rx, &test_rx[k], test_rx_len - k);
+	test_rx_len -= k;
+	return k;
+}
+
+/** The fake broker: acknowledges the CONNECT and the QoS1 PUBLISH, and records their numbers. */
+static int test_write(Network *n, unsigned char *buf, int len, int timeout_ms) {
+	MQTTHeader header;
+
+	(void) n;
+	(void) timeout_ms;
+	if (test_link_down) {
+		return -1;
+	}
+	header.byte = buf[0];
+	if (header.bits.type == CONNECT) {
+		test_rx_len += MQTTSerialize_connack(&test_rx[test_rx_len], sizeof(test_rx) - test_rx_len, 0, 0);
+	} else if (header.bits.type == PUBLISH) {
+		unsigned char dup, retained;
+		unsigned short id;
+		MQTTString topic;
+		unsigned char *payload;
+		int qos, payloadlen;
+
+		if (MQTTDeserialize_publish(&dup, &qos, &retained, &id, &topic, &payload, &payloadlen, buf, len) == 1) {
+			if (test_got_count < (int) (sizeof(test_got) / sizeof(test_got[0]))) {
+				test_got[test_got_count++] = atoi((char *) payload);
+			}
+			if (qos == QOS1) {
+				test_rx_len += MQTTSerialize_ack(&test_rx[test_rx_len], sizeof(test_rx) - test_rx_len, PUBACK, 0, id);
+			}
+		}
+	}
+	return len;
+}
+
+static int test_disconnect(Network *n) {
+	(void) n;
+	test_rx_len = 0;
+	return 0;
+}
+
+/** Queue message number, of len bytes: its number then padding. */
+static int test_push(mqtt_queue_t *q, int number, size_t len) {
+	char payload[TEST_REJECTED_LEN];
+	int k = snprintf(payload, sizeof(payload), "%d ", number);
+
+	memset(&payload[k], '.', len - k);
+	return mqtt_queue_push(q, TEST_TOPIC, payload, len, QOS1, 0);
+}
+
+/** Drain until empty, the calls limited. MQSUCCESS, or FAILURE if a call failed or it stalled. */
+static int test_drain(mqtt_queue_t *q, MQTTClient *c) {
+	int rounds;
+
+	for (rounds = 0; (rounds < (TEST_MESSAGES * 2)) && (mqtt_queue_depth(q) > 0); rounds++) {
+		if (mqtt_queue_drain(q, c) < 0) {
+			return FAILURE;
+		}
+	}
+	return (mqtt_queue_depth(q) == 0) ? MQSUCCESS : FAILURE;
+}
+
+static int test_check(const char *name, int cond) {
+	if (!cond) {
+		printf("mqtt_queue_test: %s FAILED\n", name);
+		return 1;
+	}
+	return 0;
+}
+#endif /* USE_HOST */
@@ -19,24 +19,52 @@
 
 #include <string.h>
 
-static int deliverMessage(MQTTClient* c, MQTTString* topicName, MQTTMessage* message);
+#define MQTT_CONNECT_PROPERTIES 9   /* MQTT 5: properties of CONNECT, the topic alias and receive maximums included */
+#define MQTT_CONNACK_PROPERTIES 12  /* MQTT 5: properties of CONNACK, the user properties give way first */
+#define MQTT_PUBLISH_PROPERTIES 8   /* MQTT 5: properties of an incoming publish, passed to its handler */
+#define DELIVERY_QUEUED 1           /* deliverMessage: the ack is sent once the handlers returned */
+#define MQTT_READ_VIEW_MAX 0xFFFF   /* most bytes asked of a zero-copy read: what the stack holds */
+
+static int deliverMessage(MQTTClient* c, MQTTString* topicName, MQTTMessage* message, MQTTProperties* properties);
+static int sendInboundAcks(MQTTClient* c);
 static int keepalive(MQTTClient* c);
 static void MQTTCleanSession(MQTTClient* c);
 static void MQTTCloseSession(MQTTClient* c);
 static int cycle(MQTTClient* c, Timer* timer);
+static int readStaged(MQTTClient* c, unsigned char* dst, int n, Timer* timer);
+static void releaseView(MQTTClient* c);
+static int streamPublish(MQTTClient* c, MQTTMessage* msg);
+static int drainPublishQueue(MQTTClient* c);
+static int readAck(MQTTClient* c, unsigned short* packetid, unsigned char* reasonCode);
+static int topicAliasIn(MQTTClient* c, MQTTString* topicName, MQTTProperties* properties);
+static MQTTTopicAlias* topicAliasOut(MQTTClient* c, const char* topicName, int* known);
+static void resetTopicAliases(MQTTClient* c);
+static int inflightWindow(MQTTClient* c);
 static int waitfor(MQTTClient* c, int packet_type, Timer* timer);
+static InflightMessage* findInflight(MQTTClient* c, unsigned short id);
+static void completeInflight(MQTTClient* c, InflightMessage* m, int rc);
+static int sendInflight(MQTTClient* c, InflightMessage* m, unsigned char dup, Timer* timer);
+static int resendInflight(MQTTClient* c, Timer* timer);
+static int publish(MQTTClient* c, const char* topicName, MQTTMessage* message, const MQTTIovec* iov, int iovcnt,
+        publishCompleteHandler fp, void* context, Timer* timer);
+static int sendPublish(MQTTClient* c, unsigned char dup, enum QoS qos, unsigned char retained, unsigned short id,
+        const char* topicName, const MQTTIovec* iov, int iovcnt, Timer* timer);
 void MQTTRun(void* parm);
 
 
 
-static void NewMessageData(MessageData* md, MQTTString* aTopicName, MQTTMessage* aMessage) {
+static void NewMessageData(MessageData* md, MQTTString* aTopicName, MQTTMessage* aMessage, MQTTProperties* properties) {
     md->topicName = aTopicName;
     md->message = aMessage;
+    md->properties = properties;
 }
 
 
 static int getNextPacketId(MQTTClient *c) {
-    return c->next_packetid = (c->next_packetid == MAX_PACKET_ID) ? 1 : c->next_packetid + 1;
+    do
+        c->next_packetid = (c->next_packetid == MAX_PACKET_ID) ? 1 : c->next_packetid + 1;
+    while (findInflight(c, c->next_packetid) != NULL); /* still in use by an unacknowledged publish */
+    return c->next_packetid;
 }
 
 
@@ -66,11 +94,9 @@ static int sendPacket(MQTTClient* c, int length, Timer* timer)
 void MQTTClientInit(MQTTClient* c, Network* network, unsigned int command_timeout_ms,
 		unsigned char* sendbuf, size_t sendbuf_size, unsigned char* readbuf, size_t readbuf_size)
 {
-    int i;
     c->ipstack = network;
 
-    for (i = 0; i < MAX_MESSAGE_HANDLERS; ++i)
-        c->messageHandlers[i].topicFilter = 0;
+    MQTTTopicTrieInit(&c->subscriptions);
     c->command_timeout_ms = command_timeout_ms;
     c->buf = sendbuf;
     c->buf_size = sendbuf_size;
@@ -80,7 +106,22 @@ void MQTTClientInit(MQTTClient* c, Network* network, unsigned int command_timeou
     c->cleansession = 0;
     c->ping_outstanding = 0;
     c->defaultMessageHandler = NULL;
+    c->chunkHandler = NULL;
+    c->stream_len = 0;
 	  c->next_packetid = 1;
+    memset(c->inflight, 0, sizeof(c->inflight));
+    c->inflight_window = MAX_INFLIGHT_MESSAGES;
+    c->inflight_seq = 0;
+    c->pubq = NULL;
+    c->inq = NULL;
+    c->stage_head = c->stage_tail = 0;
+    memset(&c->view, 0, sizeof(c->view));
+    c->view_head = 0;
+    c->packet = readbuf;
+    c->packet_len = 0;
+    c->MQTTVersion = 4;
+    c->receiveMaximum = 65535;
+    resetTopicAliases(c);
     TimerInit(&c->last_sent);
     TimerInit(&c->last_received);
 #if defined(MQTT_TASK)
@@ -89,68 +130,131 @@ void MQTTClientInit(MQTTClient* c, Network* network, unsigned int command_timeou
 }
 
 
-static int decodePacket(MQTTClient* c, int* value, int timeout)
+/* Read whatever the network has into the free part of the staging buffer: one read.
+ * Zero-copy: the few bytes left in the view, a fixed header cut by the end of a network buffer,
+ * join the staged ones, and the view is replaced by the next one. */
+static int fillStage(MQTTClient* c, Timer* timer)
+{
+    unsigned int viewed = (unsigned int)c->view.len - c->view_head;
+    int rc;
+
+    if (c->stage_head == c->stage_tail)
+        c->stage_head = c->stage_tail = 0;
+    else if (c->stage_head > 0)
+    {
+        memmove(c->stage, c->stage + c->stage_head, c->stage_tail - c->stage_head);
+        c->stage_tail -= c->stage_head;
+        c->stage_head = 0;
+    }
+    if (c->ipstack->mqttreadbuf == NULL)
+    {
+        rc = c->ipstack->mqttread(c->ipstack, c->stage + c->stage_tail, sizeof(c->stage) - c->stage_tail, TimerLeftMS(timer));
+        if (rc > 0)
+            c->stage_tail += rc;
+        return rc;
+    }
+    if (viewed > 0)
+    {
+        memcpy(c->stage + c->stage_tail, c->view.data + c->view_head, viewed);
+        c->stage_tail += viewed;
+    }
+    releaseView(c);
+    return c->ipstack->mqttreadbuf(c->ipstack, &c->view, MQTT_READ_VIEW_MAX, TimerLeftMS(timer));
+}
+
+
+/* Give the view back to the network stack */
+static void releaseView(MQTTClient* c)
+{
+    if (c->view.data != NULL)
+        c->ipstack->mqttreleasebuf(c->ipstack, &c->view);
+    memset(&c->view, 0, sizeof(c->view));
+    c->view_head = 0;
+}
+
+
+/* Byte i of those read and not parsed: the staged ones, then the rest of the view */
+static unsigned char peekStaged(MQTTClient* c, unsigned int i)
+{
+    unsigned int staged = c->stage_tail - c->stage_head;
+
+    return (i < staged) ? c->stage[c->stage_head + i] : c->view.data[c->view_head + i - staged];
+}
+
+
+/* Parse the fixed header at the head of the bytes read.
+ * Returns its length, 0 if not fully read yet, MQTTPACKET_READ_ERROR if malformed. */
+static int decodePacket(MQTTClient* c, int* value)
 {
-    unsigned char i;
+    unsigned int avail = (c->stage_tail - c->stage_head) + ((unsigned int)c->view.len - c->view_head);
     int multiplier = 1;
-    int len = 0;
-    const int MAX_NO_OF_REMAINING_LENGTH_BYTES = 4;
+    unsigned int len = 1;
+    const unsigned int MAX_NO_OF_REMAINING_LENGTH_BYTES = 4;
 
     *value = 0;
     do
     {
-        int rc = MQTTPACKET_READ_ERROR;
-
-        if (++len > MAX_NO_OF_REMAINING_LENGTH_BYTES)
-        {
-            rc = MQTTPACKET_READ_ERROR; /* bad data */
-            goto exit;
-        }
-        rc = c->ipstack->mqttread(c->ipstack, &i, 1, timeout);
-        if (rc != 1)
-            goto exit;
-        *value += (i & 127) * multiplier;
+        if (len > MAX_NO_OF_REMAINING_LENGTH_BYTES)
+            return MQTTPACKET_READ_ERROR; /* bad data */
+        if (len >= avail)
+            return 0;
+        *value += (peekStaged(c, len) & 127) * multiplier;
         multiplier *= 128;
-    } while ((i & 128) != 0);
-exit:
+    } while ((peekStaged(c, len++) & 128) != 0);
     return len;
 }
 
 
+/* The network is read through the staging buffer: a read takes whatever is available, and the
+ * headers are parsed out of it. A burst of small packets is read at once, then parsed one by
+ * one by the next calls without reading the network again.
+ * Zero-copy (mqttreadbuf), the view stands for the staging buffer: a publish is copied from it
+ * into readbuf, the other packets are parsed in place when whole in the view. */
 static int readPacket(MQTTClient* c, Timer* timer)
 {
     MQTTHeader header = {0};
     int len = 0;
     int rem_len = 0;
+    int rc = 0;
 
-    /* 1. read the header byte.  This has the packet type in it */
-    int rc = c->ipstack->mqttread(c->ipstack, c->readbuf, 1, TimerLeftMS(timer));
-    if (rc != 1)
-        goto exit;
-
-    len = 1;
-    /* 2. read the remaining length.  This is variable in itself */
-    decodePacket(c, &rem_len, TimerLeftMS(timer));
-    len += MQTTPacket_encode(c->readbuf + 1, rem_len); /* put the original remaining length back into the buffer */
-
-    if (rem_len > (c->readbuf_size - len))
+    /* 1. the fixed header: the packet type byte and the remaining length */
+    while ((len = decodePacket(c, &rem_len)) == 0)
     {
-        rc = BUFFER_OVERFLOW;
-        goto exit;
+        if ((rc = fillStage(c, timer)) <= 0)
+            goto exit; /* nothing more for now: the header bytes already read are kept */
     }
-
-    /* 3. read the rest of the buffer using a callback to supply the rest of the data */
-    if (rem_len > 0)
+    if (len < 0)
     {
-      rc = c->ipstack->mqttread(c->ipstack, c->readbuf + len, rem_len, TimerLeftMS(timer));
-      if (rc != rem_len)
-      {
-        rc = 0;
+        rc = FAILURE;
         goto exit;
-      }
     }
+    header.byte = peekStaged(c, 0);
+    if (rem_len > (int)(c->readbuf_size - len))
+    {
+        if (header.bits.type != PUBLISH)
+        {
+            rc = BUFFER_OVERFLOW;
+            goto exit;
+        }
+        /* too large for readbuf: only the fixed header is taken, cycle streams the rest */
+        if ((rc = readStaged(c, c->readbuf, len, timer)) < 0)
+            goto exit;
+        c->stream_len = rem_len;
+    }
+    /* 2. the packet */
+    else if (header.bits.type != PUBLISH && c->stage_head == c->stage_tail &&
+            c->view.len - c->view_head >= (size_t)(len + rem_len))
+    {
+        /* in place: the handlers of a publish may read the network again, not an ack */
+        c->packet = (unsigned char*)c->view.data + c->view_head;
+        c->view_head += len + rem_len;
+    }
+    else if ((rc = readStaged(c, c->readbuf, len + rem_len, timer)) < 0)
+        goto exit;
+    else
+        c->packet = c->readbuf;
+    c->packet_len = len + rem_len;
 
-    header.byte = c->readbuf[0];
     rc = header.bits.type;
     if (c->keepAliveInterval > 0)
         TimerCountdown(&c->last_received, c->keepAliveInterval); // record the fact that we have successfully received a packet
@@ -159,67 +263,277 @@ exit:
 }
 
 
-// assume topic filter and name is in correct format
-// # can only be at end
-// + and # can only be next to separator
-static char isTopicMatched(char* topicFilter, MQTTString* topicName)
+/* Copy n bytes of the stream to dst: what is staged, then the rest. The rest is read through the
+ * staging buffer when it fits, to catch the next packets with it, else straight into dst.
+ * Zero-copy, it is copied from the views.
+ * Returns n, FAILURE if the timer expires first - the packet is cut: the stream is lost - or the
+ * network error. */
+static int readStaged(MQTTClient* c, unsigned char* dst, int n, Timer* timer)
 {
-    char* curf = topicFilter;
-    char* curn = topicName->lenstring.data;
-    char* curn_end = curn + topicName->lenstring.len;
+    int rc = 0;
 
-    while (*curf && curn < curn_end)
+    while (rc < n)
     {
-        if (*curn == '/' && *curf != '/')
-            break;
-        if (*curf != '+' && *curf != '#' && *curf != *curn)
-            break;
-        if (*curf == '+')
-        {   // skip until we meet the next separator, or end of string
-            char* nextpos = curn + 1;
-            while (nextpos < curn_end && *nextpos != '/')
-                nextpos = ++curn + 1;
+        int staged = (int)(c->stage_tail - c->stage_head);
+
+        if (staged > 0)
+        {
+            staged = (staged < n - rc) ? staged : n - rc;
+            memcpy(dst + rc, c->stage + c->stage_head, staged);
+            c->stage_head += staged;
+            rc += staged;
+            continue;
+        }
+        staged = (int)(c->view.len - c->view_head);
+        if (staged > 0)
+        {
+            staged = (staged < n - rc) ? staged : n - rc;
+            memcpy(dst + rc, c->view.data + c->view_head, staged);
+            c->view_head += staged;
+            rc += staged;
+            continue;
         }
-        else if (*curf == '#')
-            curn = curn_end - 1;    // skip until end of string
-        curf++;
-        curn++;
-    };
+        if (TimerIsExpired(timer))
+            return FAILURE;
+        if (c->ipstack->mqttreadbuf != NULL || n - rc < (int)sizeof(c->stage))
+            staged = fillStage(c, timer);
+        else if ((staged = c->ipstack->mqttread(c->ipstack, dst + rc, n - rc, TimerLeftMS(timer))) > 0)
+            rc += staged;
+        if (staged < 0)
+            return staged;
+    }
+    return rc;
+}
+
+
+/* Deliver the publish whose fixed header readPacket took, chunk by chunk as it is read. readbuf
+ * holds the fixed header byte, the variable header, then each chunk in turn. The command timeout
+ * applies to each chunk rather than to the whole payload. */
+static int streamPublish(MQTTClient* c, MQTTMessage* msg)
+{
+    MQTTHeader header = {0};
+    MQTTString topicName = MQTTString_initializer;
+    MQTTProperty array[MQTT_PUBLISH_PROPERTIES];
+    MQTTProperties props = {0, MQTT_PUBLISH_PROPERTIES, 0, array};
+    MessageChunk chunk;
+    Timer timer;
+    unsigned char* vh = c->readbuf + 1;
+    int room = (int)c->readbuf_size - 1,        /* for the variable header and the chunks */
+        left = c->stream_len,
+        topiclen = 0,
+        vhlen = 0,
+        idlen = 0,
+        size = 0;
+
+    c->stream_len = 0;
+    header.byte = c->readbuf[0];
+    idlen = (header.bits.qos > 0) ? 2 : 0;
+    TimerInit(&timer);
+    TimerCountdownMS(&timer, c->command_timeout_ms);
+    if (c->readbuf_size < 4 || readStaged(c, vh, 2, &timer) != 2)
+        return FAILURE;
+    topiclen = (vh[0] << 8) | vh[1];
+    vhlen = 2 + topiclen + idlen;
+    if (vhlen >= room || vhlen > left || readStaged(c, vh + 2, vhlen - 2, &timer) != vhlen - 2)
+        return FAILURE;   /* the topic itself does not fit */
+    if (c->MQTTVersion == 5)
+    {
+        /* the properties: their length, a byte at a time, then them */
+        unsigned char* start = vh + vhlen;
+        unsigned char* end;
+        int propslen = 0,
+            multiplier = 1;
 
-    return (curn == curn_end) && (*curf == '\0');
+        do
+        {
+            if (vhlen - (start - vh) >= 4 || vhlen + 1 >= room || vhlen + 1 > left ||
+                    readStaged(c, vh + vhlen, 1, &timer) != 1)
+                return FAILURE;
+            propslen += (vh[vhlen] & 127) * multiplier;
+            multiplier *= 128;
+        } while ((vh[vhlen++] & 128) != 0);
+        if (propslen >= room - vhlen || propslen > left - vhlen ||
+                readStaged(c, vh + vhlen, propslen, &timer) != propslen)
+            return FAILURE;
+        vhlen += propslen;
+        end = vh + vhlen;
+        if (!MQTTProperties_read(&props, &start, end))
+            return FAILURE;
+    }
+    size = room - vhlen;     /* room left for the chunks */
+    left -= vhlen;
+
+    msg->qos = (enum QoS)header.bits.qos;
+    msg->retained = header.bits.retain;
+    msg->dup = header.bits.dup;
+    msg->id = (idlen > 0) ? (vh[2 + topiclen] << 8) | vh[3 + topiclen] : 0;
+    topicName.lenstring.len = topiclen;
+    topicName.lenstring.data = (char*)vh + 2;
+    if (c->MQTTVersion == 5 && topicAliasIn(c, &topicName, &props) != MQSUCCESS)
+        return FAILURE;
+    chunk.message = msg;
+    chunk.topicName = &topicName;
+    chunk.properties = (c->MQTTVersion == 5) ? &props : NULL;
+    chunk.offset = 0;
+    chunk.total = left;
+
+    while (left > 0)
+    {
+        int n = (left < size) ? left : size;
+
+        TimerCountdownMS(&timer, c->command_timeout_ms);
+        if (readStaged(c, vh + vhlen, n, &timer) != n)
+            return FAILURE;
+        msg->payload = vh + vhlen;
+        msg->payloadlen = n;
+        if (c->chunkHandler != NULL)
+            c->chunkHandler(&chunk);
+        chunk.offset += n;
+        left -= n;
+    }
+    return MQSUCCESS;
 }
 
 
-int deliverMessage(MQTTClient* c, MQTTString* topicName, MQTTMessage* message)
+typedef struct Delivery
 {
-    int i;
-    int rc = FAILURE;
+    MQTTClient* c;
+    MessageData md;
+    int queued;     /* slots taken in the inbound queue, since the last handler run here */
+    int lost;       /* a handler matched, but the message could not be queued for it */
+} Delivery;
+
+
+/* Send the acks of the queued publishes handled since, in the order of the publishes */
+static int sendInboundAcks(MQTTClient* c)
+{
+    MQTTInboundQueue* q = c->inq;
+    int rc = MQSUCCESS;
+    Timer timer;
 
-    // we have to find the right message handler - indexed by topic
-    for (i = 0; i < MAX_MESSAGE_HANDLERS; ++i)
+    if (q == NULL)
+        return MQSUCCESS;
+    TimerInit(&timer);
+    TimerCountdownMS(&timer, c->command_timeout_ms);
+    while (q->acked != q->tail)
     {
-        if (c->messageHandlers[i].topicFilter != 0 && (MQTTPacket_equals(topicName, (char*)c->messageHandlers[i].topicFilter) ||
-                isTopicMatched((char*)c->messageHandlers[i].topicFilter, topicName)))
+        MQTTInboundSlot* slot = &q->slots[q->acked & (MQTT_INQ_SLOTS - 1)];
+
+        if (atomic_load_explicit(&slot->seq, memory_order_acquire) != q->acked + MQTT_INQ_SLOTS)
+            break; /* its handler has not returned yet */
+        if (slot->ack)
         {
-            if (c->messageHandlers[i].fp != NULL)
-            {
-                MessageData md;
-                NewMessageData(&md, topicName, message);
-                c->messageHandlers[i].fp(&md);
-                rc = MQSUCCESS;
-            }
+            int len = MQTTSerialize_ack(c->buf, c->buf_size, (slot->qos == QOS1) ? PUBACK : PUBREC, 0, slot->id);
+
+            if (len <= 0 || (rc = sendPacket(c, len, &timer)) != MQSUCCESS)
+                return FAILURE;
+            slot->ack = 0;
         }
+        q->acked++;
     }
+    return rc;
+}
 
-    if (rc == FAILURE && c->defaultMessageHandler != NULL)
+
+/* Hand the message to the workers of the inbound queue, or run the handler now if there are none */
+static void callMessageHandler(messageHandler fp, void* context)
+{
+    Delivery* d = (Delivery*)context;
+    MQTTInboundQueue* q = d->c->inq;
+    MQTTString* topicName = d->md.topicName;
+    MQTTMessage* message = d->md.message;
+    const char* topic = topicName->lenstring.data;
+    size_t topiclen = topicName->lenstring.len;
+    int rc;
+
+    if (q == NULL)
     {
-        MessageData md;
-        NewMessageData(&md, topicName, message);
-        c->defaultMessageHandler(&md);
-        rc = MQSUCCESS;
+        fp(&d->md);
+        return;
+    }
+    if (topicName->cstring != NULL)
+    {
+        topic = topicName->cstring;
+        topiclen = strlen(topicName->cstring);
+    }
+    rc = MQTTInboundQueuePush(q, fp, topic, topiclen, message->payload, message->payloadlen,
+            message->qos, message->retained, message->dup, message->id);
+    if (rc == FAILURE && sendInboundAcks(d->c) == MQSUCCESS)
+    {
+        /* the slots handled but not acked yet are free now */
+        rc = MQTTInboundQueuePush(q, fp, topic, topiclen, message->payload, message->payloadlen,
+                message->qos, message->retained, message->dup, message->id);
+    }
+    if (rc == MQSUCCESS)
+    {
+        d->queued++;
+        return;
     }
 
-    return rc;
+    if (q->signal == NULL)
+    {
+        /* no workers: this task dispatches, so the handlers queued first run first, and are acked first */
+        MQTTInboundDispatch(q, 0);
+        if (sendInboundAcks(d->c) != MQSUCCESS)
+        {
+            d->lost = 1;
+            return;
+        }
+        d->queued = 0;
+        q->inline_calls++;
+        fp(&d->md);
+    }
+    else
+    {
+        /* the read loop does not wait for the workers: the message is not acknowledged */
+        if (rc == BUFFER_OVERFLOW)
+            q->too_large++;
+        else
+            q->dropped++;
+        d->lost = 1;
+    }
+}
+
+
+/* The ack of a publish handled now waits for those of the publishes queued before, if any */
+static int deferAck(MQTTClient* c, MQTTMessage* message)
+{
+    MQTTInboundQueue* q = c->inq;
+
+    if (q == NULL || message->qos == QOS0 || sendInboundAcks(c) != MQSUCCESS || q->acked == q->tail)
+        return MQSUCCESS;
+    if (MQTTInboundQueuePush(q, NULL, "", 0, NULL, 0, message->qos, 0, 0, message->id) != MQSUCCESS)
+        return FAILURE;
+    q->slots[(q->tail - 1) & (MQTT_INQ_SLOTS - 1)].ack = 1;
+    return DELIVERY_QUEUED;
+}
+
+
+/**
+ * Run or queue the handlers of a message.
+ * @return MQSUCCESS: the handlers returned, or none matched, DELIVERY_QUEUED: the ack is sent by
+ *         sendInboundAcks, FAILURE: the message was not queued for one of its handlers at least.
+ */
+int deliverMessage(MQTTClient* c, MQTTString* topicName, MQTTMessage* message, MQTTProperties* properties)
+{
+    Delivery d;
+
+    // we have to find the right message handlers - indexed by topic
+    d.c = c;
+    d.queued = 0;
+    d.lost = 0;
+    NewMessageData(&d.md, topicName, message, properties);
+    if (MQTTTopicTrieMatch(&c->subscriptions, topicName, callMessageHandler, &d) == 0 &&
+            c->defaultMessageHandler != NULL)
+        callMessageHandler(c->defaultMessageHandler, &d);
+
+    if (d.lost)
+        return FAILURE;
+    if (d.queued == 0)
+        return deferAck(c, message);
+    if (message->qos != QOS0)
+        c->inq->slots[(c->inq->tail - 1) & (MQTT_INQ_SLOTS - 1)].ack = 1; /* on the last slot: all handlers returned */
+    return DELIVERY_QUEUED;
 }
 
 
@@ -255,17 +569,25 @@ exit:
 
 void MQTTCleanSession(MQTTClient* c)
 {
-    int i = 0;
-
-    for (i = 0; i < MAX_MESSAGE_HANDLERS; ++i)
-        c->messageHandlers[i].topicFilter = NULL;
+    MQTTTopicTrieClear(&c->subscriptions);
 }
 
 
 void MQTTCloseSession(MQTTClient* c)
 {
+    unsigned int pos;
+
+    if (c->inq != NULL)
+    {
+        /* the packet ids of the lost connection: the server sends these publishes again */
+        for (pos = c->inq->acked; pos != c->inq->tail; ++pos)
+            c->inq->slots[pos & (MQTT_INQ_SLOTS - 1)].ack = 0;
+    }
     c->ping_outstanding = 0;
     c->isconnected = 0;
+    c->stage_head = c->stage_tail = 0; /* whatever is left belongs to the lost connection */
+    releaseView(c);
+    c->stream_len = 0;
     if (c->cleansession){
     	MQTTCleanSession(c);
     	c->ipstack->mqttdisconnect(c->ipstack);
@@ -276,9 +598,16 @@ void MQTTCloseSession(MQTTClient* c)
 int cycle(MQTTClient* c, Timer* timer)
 {
     int len = 0,
-        rc = MQSUCCESS;
+        rc = MQSUCCESS,
+        delivery = MQSUCCESS;
+    int packet_type;
 
-    int packet_type = readPacket(c, timer);     /* read the socket, see what work is due */
+    if (sendInboundAcks(c) != MQSUCCESS)        /* of the messages handled since */
+    {
+        rc = packet_type = FAILURE;
+        goto exit;
+    }
+    packet_type = readPacket(c, timer);         /* read the socket, see what work is due */
 
     switch (packet_type)
     {
@@ -289,22 +618,71 @@ int cycle(MQTTClient* c, Timer* timer)
         case 0: /* timed out reading packet */
             break;
         case CONNACK:
-        case PUBACK:
         case SUBACK:
             break;
+        case PUBACK:
+        case PUBCOMP:
+        {
+            unsigned short mypacketid;
+            unsigned char reasonCode;
+            InflightMessage* m;
+            if (readAck(c, &mypacketid, &reasonCode) != 1)
+                rc = FAILURE;
+            else if ((m = findInflight(c, mypacketid)) != NULL &&
+                    m->qos == ((packet_type == PUBACK) ? QOS1 : QOS2))
+                completeInflight(c, m, (reasonCode < MQTTREASONCODE_UNSPECIFIED_ERROR) ? MQSUCCESS : REFUSED);
+            if (rc == FAILURE)
+                goto exit;
+            break;
+        }
         case PUBLISH:
         {
             MQTTString topicName;
             MQTTMessage msg;
+            MQTTProperty array[MQTT_PUBLISH_PROPERTIES];
+            MQTTProperties props = {0, MQTT_PUBLISH_PROPERTIES, 0, array};
             int intQoS;
             msg.payloadlen = 0; /* this is a size_t, but deserialize publish sets this as int */
-            if (MQTTDeserialize_publish(&msg.dup, &intQoS, &msg.retained, &msg.id, &topicName,
-               (unsigned char**)&msg.payload, (int*)&msg.payloadlen, c->readbuf, c->readbuf_size) != 1)
+            if (c->stream_len > 0)
+            {
+                /* too large for readbuf: delivered by chunks to the chunk handler */
+                if ((rc = streamPublish(c, &msg)) != MQSUCCESS)
+                    goto exit;
+                delivery = deferAck(c, &msg);
+            }
+            else if (c->MQTTVersion == 5)
+            {
+                if (MQTTV5Deserialize_publish(&msg.dup, &intQoS, &msg.retained, &msg.id, &topicName, &props,
+                   (unsigned char**)&msg.payload, (int*)&msg.payloadlen, c->packet, c->packet_len) != 1)
+                    goto exit;
+                if ((rc = topicAliasIn(c, &topicName, &props)) != MQSUCCESS)
+                    goto exit;
+                msg.qos = (enum QoS)intQoS;
+                delivery = deliverMessage(c, &topicName, &msg, &props);
+            }
+            else
+            {
+                if (MQTTDeserialize_publish(&msg.dup, &intQoS, &msg.retained, &msg.id, &topicName,
+                   (unsigned char**)&msg.payload, (int*)&msg.payloadlen, c->packet, c->packet_len) != 1)
+                    goto exit;
+                msg.qos = (enum QoS)intQoS;
+                delivery = deliverMessage(c, &topicName, &msg, NULL);
+            }
+            if (msg.qos != QOS0 && delivery == FAILURE)
+            {
+                /* not acknowledged: the session is closed for the server to send it again */
+                rc = FAILURE;
                 goto exit;
-            msg.qos = (enum QoS)intQoS;
-            deliverMessage(c, &topicName, &msg);
-            if (msg.qos != QOS0)
+            }
+            if (msg.qos != QOS0 && delivery == MQSUCCESS)
             {
+                Timer ackTimer;
+                if (TimerIsExpired(timer))
+                {
+                    /* a handler run here outlasted the timeout of the caller: the ack gets its own */
+                    TimerInit(&ackTimer);
+                    TimerCountdownMS(&ackTimer, c->command_timeout_ms);
+                }
                 if (msg.qos == QOS1)
                     len = MQTTSerialize_ack(c->buf, c->buf_size, PUBACK, 0, msg.id);
                 else if (msg.qos == QOS2)
@@ -312,7 +690,7 @@ int cycle(MQTTClient* c, Timer* timer)
                 if (len <= 0)
                     rc = FAILURE;
                 else
-                    rc = sendPacket(c, len, timer);
+                    rc = sendPacket(c, len, TimerIsExpired(timer) ? &ackTimer : timer);
                 if (rc == FAILURE)
                     goto exit; // there was a problem
             }
@@ -322,24 +700,38 @@ int cycle(MQTTClient* c, Timer* timer)
         case PUBREL:
         {
             unsigned short mypacketid;
-            unsigned char dup, type;
-            if (MQTTDeserialize_ack(&type, &dup, &mypacketid, c->readbuf, c->readbuf_size) != 1)
+            unsigned char reasonCode;
+            if (readAck(c, &mypacketid, &reasonCode) != 1)
                 rc = FAILURE;
+            else if (packet_type == PUBREC && reasonCode >= MQTTREASONCODE_UNSPECIFIED_ERROR)
+            {
+                /* MQTT 5: refused by the server, which ends the exchange there */
+                InflightMessage* m = findInflight(c, mypacketid);
+                if (m != NULL && m->qos == QOS2)
+                    completeInflight(c, m, REFUSED);
+            }
             else if ((len = MQTTSerialize_ack(c->buf, c->buf_size,
                 (packet_type == PUBREC) ? PUBREL : PUBCOMP, 0, mypacketid)) <= 0)
                 rc = FAILURE;
             else if ((rc = sendPacket(c, len, timer)) != MQSUCCESS) // send the PUBREL packet
                 rc = FAILURE; // there was a problem
+            else if (packet_type == PUBREC)
+            {
+                InflightMessage* m = findInflight(c, mypacketid);
+                if (m != NULL && m->qos == QOS2)
+                    m->pubrel = 1; /* on reconnect, send the PUBREL again rather than the PUBLISH */
+            }
             if (rc == FAILURE)
                 goto exit; // there was a problem
             break;
         }
-
-        case PUBCOMP:
-            break;
         case PINGRESP:
             c->ping_outstanding = 0;
             break;
+        case DISCONNECT:
+            /* MQTT 5: the server closes the connection */
+            rc = FAILURE;
+            goto exit;
     }
 
     if (keepalive(c) != MQSUCCESS) {
@@ -366,7 +758,7 @@ int MQTTYield(MQTTClient* c, int timeout_ms)
 
 	  do
     {
-        if (cycle(c, &timer) < 0)
+        if (drainPublishQueue(c) < 0 || cycle(c, &timer) < 0)
         {
             rc = FAILURE;
             break;
@@ -390,7 +782,8 @@ void MQTTRun(void* parm)
 		MutexLock(&c->mutex,0);
 #endif
 		TimerCountdownMS(&timer, 500); /* Don't wait too long if no traffic is incoming */
-		cycle(c, &timer);
+		if (drainPublishQueue(c) >= 0)
+			cycle(c, &timer);
 #if defined(MQTT_TASK)
 		MutexUnlock(&c->mutex);
 #endif
@@ -424,7 +817,91 @@ int waitfor(MQTTClient* c, int packet_type, Timer* timer)
 
 
 
+/* Serialize the CONNECT packet into buf, with the topic alias maximum of the client for MQTT 5,
+ * and its receive maximum when workers handle the messages. Sets the defaults of the server limits
+ * in data. */
+static int serializeConnect(MQTTClient* c, MQTTPacket_connectData* options, MQTTProperties* connectProperties,
+        MQTTConnackData* data)
+{
+    MQTTProperty array[MQTT_CONNECT_PROPERTIES];
+    MQTTProperties props = {0, MQTT_CONNECT_PROPERTIES, 0, array};
+    MQTTProperty prop;
+    unsigned short receiveMaximum = 0;
+    int i;
+
+    if (c->inq != NULL && c->inq->signal != NULL)
+        receiveMaximum = MQTT_INQ_SLOTS; /* the publishes not acked wait in the inbound queue */
+    memset(data, 0, sizeof(MQTTConnackData));
+    data->receiveMaximum = 65535;
+    data->maximumQoS = QOS2;
+    data->retainAvailable = 1;
+    if (options->MQTTVersion != 5)
+        return MQTTSerialize_connect(c->buf, c->buf_size, options);
+
+    for (i = 0; connectProperties != NULL && i < connectProperties->count; ++i)
+    {
+        MQTTProperty* p = &connectProperties->array[i];
+
+        if (p->identifier == MQTTPROPERTY_CODE_TOPIC_ALIAS_MAXIMUM)
+            continue;
+        if (p->identifier == MQTTPROPERTY_CODE_RECEIVE_MAXIMUM && receiveMaximum > 0)
+        {
+            if (p->value.integer2 > 0 && p->value.integer2 < receiveMaximum)
+                receiveMaximum = p->value.integer2;
+            continue;
+        }
+        if (p->identifier == MQTTPROPERTY_CODE_SESSION_EXPIRY_INTERVAL)
+            data->sessionExpiry = p->value.integer4;
+        if (MQTTProperties_add(&props, p) != 0)
+            return FAILURE;
+    }
+    prop.identifier = MQTTPROPERTY_CODE_TOPIC_ALIAS_MAXIMUM;
+    prop.value.integer2 = MQTT_TOPIC_ALIASES;
+    if (MQTTProperties_add(&props, &prop) != 0)
+        return FAILURE;
+    prop.identifier = MQTTPROPERTY_CODE_RECEIVE_MAXIMUM;
+    prop.value.integer2 = receiveMaximum;
+    if (receiveMaximum > 0 && MQTTProperties_add(&props, &prop) != 0)
+        return FAILURE;
+    return MQTTV5Serialize_connect(c->buf, c->buf_size, options, &props, NULL);
+}
+
+
+/* MQTT 5: take the limits the server sets in its CONNACK */
+static void setServerLimits(MQTTClient* c, MQTTProperties* props, MQTTConnackData* data)
+{
+    MQTTProperty* p;
+
+    if ((p = MQTTProperties_find(props, MQTTPROPERTY_CODE_SESSION_EXPIRY_INTERVAL)) != NULL)
+        data->sessionExpiry = p->value.integer4;
+    if ((p = MQTTProperties_find(props, MQTTPROPERTY_CODE_RECEIVE_MAXIMUM)) != NULL && p->value.integer2 > 0)
+        data->receiveMaximum = p->value.integer2;
+    if ((p = MQTTProperties_find(props, MQTTPROPERTY_CODE_TOPIC_ALIAS_MAXIMUM)) != NULL)
+        data->topicAliasMaximum = p->value.integer2;
+    if ((p = MQTTProperties_find(props, MQTTPROPERTY_CODE_SERVER_KEEP_ALIVE)) != NULL)
+        data->serverKeepAlive = p->value.integer2;
+    if ((p = MQTTProperties_find(props, MQTTPROPERTY_CODE_MAXIMUM_QOS)) != NULL)
+        data->maximumQoS = p->value.byte;
+    if ((p = MQTTProperties_find(props, MQTTPROPERTY_CODE_RETAIN_AVAILABLE)) != NULL)
+        data->retainAvailable = p->value.byte;
+    if ((p = MQTTProperties_find(props, MQTTPROPERTY_CODE_MAXIMUM_PACKET_SIZE)) != NULL)
+        data->maximumPacketSize = p->value.integer4;
+
+    c->receiveMaximum = data->receiveMaximum;
+    c->aliasOutMax = (data->topicAliasMaximum < MQTT_TOPIC_ALIASES) ? data->topicAliasMaximum : MQTT_TOPIC_ALIASES;
+    if (data->serverKeepAlive > 0)
+        c->keepAliveInterval = data->serverKeepAlive;
+}
+
+
 int MQTTConnectWithResults(MQTTClient* c, MQTTPacket_connectData* options, MQTTConnackData* data)
+{
+    return MQTTV5ConnectWithResults(c, options, NULL, data);
+}
+
+
+int MQTTV5ConnectWithResults(MQTTClient* c, MQTTPacket_connectData* options, MQTTProperties* connectProperties,
+        MQTTConnackData* data)
 {
     Timer connect_timer;
     int rc = FAILURE;
@@ -445,8 +922,14 @@ int MQTTConnectWithResults(MQTTClient* c, MQTTPacket_connectData* options, MQTTC
 
     c->keepAliveInterval = options->keepAliveInterval;
     c->cleansession = options->cleansession;
+    c->stage_head = c->stage_tail = 0;
+    releaseView(c);
+    c->stream_len = 0;
+    c->MQTTVersion = options->MQTTVersion;
+    c->receiveMaximum = 65535;
+    resetTopicAliases(c);   /* they do not outlive the connection */
     TimerCountdown(&c->last_received, c->keepAliveInterval);
-    if ((len = MQTTSerialize_connect(c->buf, c->buf_size, options)) <= 0)
+    if ((len = serializeConnect(c, options, connectProperties, data)) <= 0)
         goto exit;
     if ((rc = sendPacket(c, len, &connect_timer)) != MQSUCCESS)  // send the connect packet
         goto exit; // there was a problem
@@ -454,9 +937,19 @@ int MQTTConnectWithResults(MQTTClient* c, MQTTPacket_connectData* options, MQTTC
     // this will be a blocking call, wait for the connack
     if (waitfor(c, CONNACK, &connect_timer) == CONNACK)
     {
+        MQTTProperty array[MQTT_CONNACK_PROPERTIES];
+        MQTTProperties props = {0, MQTT_CONNACK_PROPERTIES, 0, array};
+
         data->rc = 0;
         data->sessionPresent = 0;
-        if (MQTTDeserialize_connack(&data->sessionPresent, &data->rc, c->readbuf, c->readbuf_size) == 1)
+        if (c->MQTTVersion == 5 &&
+                MQTTV5Deserialize_connack(&props, &data->sessionPresent, &data->rc, c->packet, c->packet_len) == 1)
+        {
+            if ((rc = data->rc) == MQSUCCESS)
+                setServerLimits(c, &props, data);
+        }
+        else if (c->MQTTVersion != 5 &&
+                MQTTDeserialize_connack(&data->sessionPresent, &data->rc, c->packet, c->packet_len) == 1)
             rc = data->rc;
         else
             rc = FAILURE;
@@ -464,6 +957,9 @@ int MQTTConnectWithResults(MQTTClient* c, MQTTPacket_connectData* options, MQTTC
     else
         rc = FAILURE;
 
+    if (rc == MQSUCCESS)
+        rc = resendInflight(c, &connect_timer); /* the publishes not acknowledged on the previous connection */
+
 exit:
     if (rc == MQSUCCESS)
     {
@@ -488,43 +984,16 @@ int MQTTConnect(MQTTClient* c, MQTTPacket_connectData* options)
 
 int MQTTSetMessageHandler(MQTTClient* c, const char* topicFilter, messageHandler messageHandler)
 {
-    int rc = FAILURE;
-    int i = -1;
+    /* The filter is copied: the caller's string need not be kept */
+    if (messageHandler == NULL) /* remove existing */
+        return MQTTTopicTrieRemove(&c->subscriptions, topicFilter);
+    return MQTTTopicTrieAdd(&c->subscriptions, topicFilter, messageHandler);
+}
 
-    /* first check for an existing matching slot */
-    for (i = 0; i < MAX_MESSAGE_HANDLERS; ++i)
-    {
-        if (c->messageHandlers[i].topicFilter != NULL && strcmp(c->messageHandlers[i].topicFilter, topicFilter) == 0)
-        {
-            if (messageHandler == NULL) /* remove existing */
-            {
-                c->messageHandlers[i].topicFilter = NULL;
-                c->messageHandlers[i].fp = NULL;
-            }
-            rc = MQSUCCESS; /* return i when adding new subscription */
-            break;
-        }
-    }
-    /* if no existing, look for empty slot (unless we are removing) */
-    if (messageHandler != NULL) {
-        if (rc == FAILURE)
-        {
-            for (i = 0; i < MAX_MESSAGE_HANDLERS; ++i)
-            {
-                if (c->messageHandlers[i].topicFilter == NULL)
-                {
-                    rc = MQSUCCESS;
-                    break;
-                }
-            }
-        }
-        if (i < MAX_MESSAGE_HANDLERS)
-        {
-            c->messageHandlers[i].topicFilter = topicFilter;
-            c->messageHandlers[i].fp = messageHandler;
-        }
-    }
-    return rc;
+
+void MQTTSetChunkHandler(MQTTClient* c, chunkHandler chunkHandler)
+{
+    c->chunkHandler = chunkHandler;
 }
 
 
@@ -546,7 +1015,10 @@ int MQTTSubscribeWithResults(MQTTClient* c, const char* topicFilter, enum QoS qo
     TimerInit(&timer);
     TimerCountdownMS(&timer, c->command_timeout_ms);
 
-    len = MQTTSerialize_subscribe(c->buf, c->buf_size, 0, getNextPacketId(c), 1, &topic, (int*)&qos);
+    if (c->MQTTVersion == 5)
+        len = MQTTV5Serialize_subscribe(c->buf, c->buf_size, 0, getNextPacketId(c), NULL, 1, &topic, (int*)&qos, NULL);
+    else
+        len = MQTTSerialize_subscribe(c->buf, c->buf_size, 0, getNextPacketId(c), 1, &topic, (int*)&qos);
     if (len <= 0)
         goto exit;
     if ((rc = sendPacket(c, len, &timer)) != MQSUCCESS) // send the subscribe packet
@@ -557,9 +1029,13 @@ int MQTTSubscribeWithResults(MQTTClient* c, const char* topicFilter, enum QoS qo
         int count = 0;
         unsigned short mypacketid;
         data->grantedQoS = QOS0;
-        if (MQTTDeserialize_suback(&mypacketid, 1, &count, (int*)&data->grantedQoS, c->readbuf, c->readbuf_size) == 1)
+        if (c->MQTTVersion == 5)
+            len = MQTTV5Deserialize_suback(NULL, &mypacketid, 1, &count, (int*)&data->grantedQoS, c->packet, c->packet_len);
+        else
+            len = MQTTDeserialize_suback(&mypacketid, 1, &count, (int*)&data->grantedQoS, c->packet, c->packet_len);
+        if (len == 1)
         {
-            if (data->grantedQoS != 0x80)
+            if (data->grantedQoS < SUBFAIL) /* MQTT 5: any reason code from 0x80 on is a failure */
                 rc = MQTTSetMessageHandler(c, topicFilter, messageHandler);
         }
     }
@@ -601,7 +1077,11 @@ int MQTTUnsubscribe(MQTTClient* c, const char* topicFilter)
     TimerInit(&timer);
     TimerCountdownMS(&timer, c->command_timeout_ms);
 
-    if ((len = MQTTSerialize_unsubscribe(c->buf, c->buf_size, 0, getNextPacketId(c), 1, &topic)) <= 0)
+    if (c->MQTTVersion == 5)
+        len = MQTTV5Serialize_unsubscribe(c->buf, c->buf_size, 0, getNextPacketId(c), NULL, 1, &topic);
+    else
+        len = MQTTSerialize_unsubscribe(c->buf, c->buf_size, 0, getNextPacketId(c), 1, &topic);
+    if (len <= 0)
         goto exit;
     if ((rc = sendPacket(c, len, &timer)) != MQSUCCESS) // send the subscribe packet
         goto exit; // there was a problem
@@ -609,7 +1089,13 @@ int MQTTUnsubscribe(MQTTClient* c, const char* topicFilter)
     if (waitfor(c, UNSUBACK, &timer) == UNSUBACK)
     {
         unsigned short mypacketid;  // should be the same as the packetid above
-        if (MQTTDeserialize_unsuback(&mypacketid, c->readbuf, c->readbuf_size) == 1)
+        int count = 0,
+            reasonCode = 0;
+        if (c->MQTTVersion == 5)
+            len = MQTTV5Deserialize_unsuback(NULL, &mypacketid, 1, &count, &reasonCode, c->packet, c->packet_len);
+        else
+            len = MQTTDeserialize_unsuback(&mypacketid, c->packet, c->packet_len);
+        if (len == 1)
         {
             /* remove the subscription message handler associated with this topic, if there is one */
             MQTTSetMessageHandler(c, topicFilter, NULL);
@@ -628,14 +1114,36 @@ exit:
 }
 
 
+typedef struct
+{
+    int done;
+    int rc;
+} SyncPublish;
+
+
+static void syncPublishComplete(unsigned short id, int rc, void* context)
+{
+    SyncPublish* sp = (SyncPublish*)context;
+    (void)id;
+    sp->done = 1;
+    sp->rc = rc;
+}
+
+
 int MQTTPublish(MQTTClient* c, const char* topicName, MQTTMessage* message)
+{
+    return MQTTPublishv(c, topicName, message, NULL, 0);
+}
+
+
+int MQTTPublishv(MQTTClient* c, const char* topicName, MQTTMessage* message, const MQTTIovec* iov, int iovcnt)
 {
     int rc = FAILURE;
     Timer timer;
-    MQTTString topic = MQTTString_initializer;
-    topic.cstring = (char *)topicName;
-    int len = 0;
+    SyncPublish sp = {0, FAILURE};
 
+    if (iov != NULL && (iovcnt <= 0 || iovcnt > MQTT_PUBLISH_MAX_IOV))
+        return BUFFER_OVERFLOW;
 #if defined(MQTT_TASK)
 	  MutexLock(&c->mutex,0);
 #endif
@@ -645,47 +1153,484 @@ int MQTTPublish(MQTTClient* c, const char* topicName, MQTTMessage* message)
     TimerInit(&timer);
     TimerCountdownMS(&timer, c->command_timeout_ms);
 
-    if (message->qos == QOS1 || message->qos == QOS2)
-        message->id = getNextPacketId(c);
+    if ((rc = publish(c, topicName, message, iov, iovcnt, syncPublishComplete, &sp, &timer)) != MQSUCCESS)
+        goto exit;
+    if (message->qos == QOS0)
+        goto exit;
 
-    len = MQTTSerialize_publish(c->buf, c->buf_size, 0, message->qos, message->retained, message->id,
-              topic, (unsigned char*)message->payload, message->payloadlen);
+    while (!sp.done)
+    {
+        if (TimerIsExpired(&timer) || cycle(c, &timer) < 0)
+            break;
+    }
+    if (!sp.done)
+    {
+        InflightMessage* m = findInflight(c, message->id);
+        if (m != NULL)
+            memset(m, 0, sizeof(InflightMessage)); /* sp goes out of scope: not to be completed later */
+        rc = FAILURE;
+    }
+    else
+        rc = sp.rc;
+
+exit:
+    if (rc == FAILURE && c->isconnected)
+        MQTTCloseSession(c);
+#if defined(MQTT_TASK)
+	  MutexUnlock(&c->mutex);
+#endif
+    return rc;
+}
+
+
+int MQTTPublishAsync(MQTTClient* c, const char* topicName, MQTTMessage* message,
+        publishCompleteHandler fp, void* context)
+{
+    return MQTTPublishvAsync(c, topicName, message, NULL, 0, fp, context);
+}
+
+
+int MQTTPublishvAsync(MQTTClient* c, const char* topicName, MQTTMessage* message, const MQTTIovec* iov, int iovcnt,
+        publishCompleteHandler fp, void* context)
+{
+    int rc = FAILURE;
+    Timer timer;
+
+    if (iov != NULL && (iovcnt <= 0 || iovcnt > MQTT_PUBLISH_MAX_IOV))
+        return BUFFER_OVERFLOW;
+#if defined(MQTT_TASK)
+	  MutexLock(&c->mutex,0);
+#endif
+	  if (!c->isconnected)
+		    goto exit;
+
+    TimerInit(&timer);
+    TimerCountdownMS(&timer, c->command_timeout_ms);
+
+    rc = publish(c, topicName, message, iov, iovcnt, fp, context, &timer);
+
+exit:
+    if (rc == FAILURE && c->isconnected)
+        MQTTCloseSession(c);
+#if defined(MQTT_TASK)
+	  MutexUnlock(&c->mutex);
+#endif
+    return rc;
+}
+
+
+void MQTTSetPublishQueue(MQTTClient* c, MQTTPublishQueue* q)
+{
+#if defined(MQTT_TASK)
+	  MutexLock(&c->mutex,0);
+#endif
+    c->pubq = q;
+#if defined(MQTT_TASK)
+	  MutexUnlock(&c->mutex);
+#endif
+}
+
+
+void MQTTSetInboundQueue(MQTTClient* c, MQTTInboundQueue* q)
+{
+#if defined(MQTT_TASK)
+	  MutexLock(&c->mutex,0);
+#endif
+    c->inq = q;
+#if defined(MQTT_TASK)
+	  MutexUnlock(&c->mutex);
+#endif
+}
+
+
+int MQTTPublishQueued(MQTTClient* c, const char* topicName, MQTTMessage* message)
+{
+    MQTTPublishQueue* q = c->pubq;
+
+    if (q == NULL)
+        return FAILURE;
+    return MQTTPublishQueuePush(q, topicName, message->qos, message->retained, message->payload, message->payloadlen);
+}
+
+
+int MQTTSetInflightWindow(MQTTClient* c, unsigned int window)
+{
+    if (window == 0 || window > MAX_INFLIGHT_MESSAGES)
+        return FAILURE;
+    c->inflight_window = window;
+    return MQSUCCESS;
+}
+
+
+/* QoS1/QoS2 publishes which may await their acks: the window, within the receive maximum of the server */
+static int inflightWindow(MQTTClient* c)
+{
+    return (c->receiveMaximum < c->inflight_window) ? c->receiveMaximum : (int)c->inflight_window;
+}
+
+
+int MQTTInflightCount(MQTTClient* c)
+{
+    int i, count = 0;
+
+    for (i = 0; i < MAX_INFLIGHT_MESSAGES; ++i)
+        if (c->inflight[i].id != 0)
+            ++count;
+    return count;
+}
+
+
+void MQTTAbortInflight(MQTTClient* c)
+{
+    int i;
+
+#if defined(MQTT_TASK)
+	  MutexLock(&c->mutex,0);
+#endif
+    for (i = 0; i < MAX_INFLIGHT_MESSAGES; ++i)
+        if (c->inflight[i].id != 0)
+            completeInflight(c, &c->inflight[i], FAILURE);
+#if defined(MQTT_TASK)
+	  MutexUnlock(&c->mutex);
+#endif
+}
+
+
+/* Send a publish, and for QoS1/QoS2 keep it in the in-flight window. Waits for a free slot while the
+ * window is full, reading the acks meanwhile. iov NULL: the payload is message->payload. */
+static int publish(MQTTClient* c, const char* topicName, MQTTMessage* message, const MQTTIovec* iov, int iovcnt,
+        publishCompleteHandler fp, void* context, Timer* timer)
+{
+    int rc = FAILURE;
+    InflightMessage* m = NULL;
+    MQTTIovec payload;
+
+    payload.base = (const unsigned char*)message->payload;
+    payload.len = message->payloadlen;
+    if (iov == NULL)
+    {
+        iov = &payload;
+        iovcnt = 1;
+    }
+    if (message->qos == QOS0)
+    {
+        rc = sendPublish(c, 0, message->qos, message->retained, message->id, topicName, iov, iovcnt, timer);
+        if (rc == MQSUCCESS && fp != NULL)
+            fp(0, MQSUCCESS, context);
+        return rc;
+    }
+
+    while (MQTTInflightCount(c) >= inflightWindow(c))
+    {
+        if (TimerIsExpired(timer) || cycle(c, timer) < 0)
+            return FAILURE; /* the broker does not acknowledge */
+    }
+    m = findInflight(c, 0);
+
+    message->id = getNextPacketId(c);
+    m->qos = message->qos;
+    m->retained = message->retained;
+    m->pubrel = 0;
+    m->seq = c->inflight_seq++;
+    m->topicName = topicName;
+    m->payload = payload;
+    m->iov = (iov == &payload) ? &m->payload : iov;
+    m->iovcnt = iovcnt;
+    m->fp = fp;
+    m->context = context;
+    m->id = message->id;
+
+    if ((rc = sendInflight(c, m, 0, timer)) != MQSUCCESS)
+        memset(m, 0, sizeof(InflightMessage)); /* not sent: the caller gets the error instead */
+    return rc;
+}
+
+
+/* Send a publish packet. It is assembled in buf and sent in one write when it fits there. A larger
+ * one goes by a gather write: the header from buf, then the payload segments from where they are.
+ * MQTT 5: the topic goes with an alias the first time, and is replaced by it afterwards. */
+static int sendPublish(MQTTClient* c, unsigned char dup, enum QoS qos, unsigned char retained, unsigned short id,
+        const char* topicName, const MQTTIovec* iov, int iovcnt, Timer* timer)
+{
+    MQTTString topic = MQTTString_initializer;
+    MQTTIovec vec[MQTT_PUBLISH_MAX_IOV + 1];
+    MQTTProperty alias;
+    MQTTProperties props = {0, 1, 0, &alias};
+    MQTTTopicAlias* a = NULL;
+    size_t payloadlen = 0,
+        total = 0,
+        sent = 0;
+    int len = 0,
+        first = 0,
+        known = 0,
+        rc = MQSUCCESS,
+        i;
+
+    for (i = 0; i < iovcnt; ++i)
+        payloadlen += iov[i].len;
+    topic.cstring = (char *)topicName;
+    if (c->MQTTVersion == 5)
+    {
+        if ((a = topicAliasOut(c, topicName, &known)) != NULL)
+        {
+            alias.identifier = MQTTPROPERTY_CODE_TOPIC_ALIAS;
+            alias.value.integer2 = (unsigned short)(a - c->aliasOut) + 1;
+            MQTTProperties_add(&props, &alias);
+            if (known)
+                topic.cstring = ""; /* the server has it already */
+        }
+        len = MQTTV5Serialize_publishHeader(c->buf, c->buf_size, dup, qos, retained, id, topic, &props, (int)payloadlen);
+    }
+    else
+        len = MQTTSerialize_publishHeader(c->buf, c->buf_size, dup, qos, retained, id, topic, (int)payloadlen);
     if (len <= 0)
+        return FAILURE;
+
+    /* One write per packet: a backend without its own gather write (WiFi, TLS) would send the
+     * header and the payload apart. */
+    if (len + payloadlen <= c->buf_size)
+    {
+        for (i = 0; i < iovcnt; ++i)
+        {
+            memcpy(&c->buf[len], iov[i].base, iov[i].len);
+            len += iov[i].len;
+        }
+        rc = sendPacket(c, len, timer);
         goto exit;
-    if ((rc = sendPacket(c, len, &timer)) != MQSUCCESS) // send the subscribe packet
-        goto exit; // there was a problem
+    }
+    if (c->ipstack->mqttwritev == NULL)
+        return BUFFER_OVERFLOW;
+
+    vec[0].base = c->buf;
+    vec[0].len = len;
+    memcpy(&vec[1], iov, iovcnt * sizeof(MQTTIovec));
+    total = len + payloadlen;
+    while (sent < total && !TimerIsExpired(timer))
+    {
+        int rc = c->ipstack->mqttwritev(c->ipstack, &vec[first], iovcnt + 1 - first, TimerLeftMS(timer));
+        size_t done;
 
-    if (message->qos == QOS1)
+        if (rc < 0)  // there was an error writing the data
+            break;
+        sent += rc;
+        /* short write: resume inside the first segment not completely sent */
+        for (done = rc; first <= iovcnt && done >= vec[first].len; ++first)
+            done -= vec[first].len;
+        if (first <= iovcnt)
+        {
+            vec[first].base += done;
+            vec[first].len -= done;
+        }
+    }
+    if (sent != total)
+        return FAILURE;
+    TimerCountdown(&c->last_sent, c->keepAliveInterval); // record the fact that we have successfully sent the packet
+
+exit:
+    if (rc == MQSUCCESS && a != NULL)
     {
-        if (waitfor(c, PUBACK, &timer) == PUBACK)
+        /* the server knows the alias once the packet is out */
+        if (!known)
         {
-            unsigned short mypacketid;
-            unsigned char dup, type;
-            if (MQTTDeserialize_ack(&type, &dup, &mypacketid, c->readbuf, c->readbuf_size) != 1)
-                rc = FAILURE;
+            a->len = (unsigned short)strlen(topicName);
+            memcpy(a->topic, topicName, a->len);
         }
-        else
-            rc = FAILURE;
+        a->used = ++c->aliasUse;
     }
-    else if (message->qos == QOS2)
+    return rc;
+}
+
+
+/* MQTT 5: the alias of an outgoing topic, NULL if it gets none. *known: the server has the topic
+ * for it already. Else the alias is a free one, or the least recently used one, and the publish
+ * sets it to the topic. */
+static MQTTTopicAlias* topicAliasOut(MQTTClient* c, const char* topicName, int* known)
+{
+    MQTTTopicAlias* lru = NULL;
+    size_t len = strlen(topicName);
+    int i;
+
+    *known = 0;
+    if (len >= MQTT_TOPIC_ALIAS_SIZE)
+        return NULL;
+    for (i = 0; i < c->aliasOutMax; ++i)
     {
-        if (waitfor(c, PUBCOMP, &timer) == PUBCOMP)
+        MQTTTopicAlias* a = &c->aliasOut[i];
+
+        if (a->used != 0 && a->len == len && memcmp(a->topic, topicName, len) == 0)
         {
-            unsigned short mypacketid;
-            unsigned char dup, type;
-            if (MQTTDeserialize_ack(&type, &dup, &mypacketid, c->readbuf, c->readbuf_size) != 1)
-                rc = FAILURE;
+            *known = 1;
+            return a;
+        }
+        if (lru == NULL || a->used < lru->used)
+            lru = a;
+    }
+    return lru;
+}
+
+
+/* MQTT 5: the topic of an incoming publish. With a topic alias, a topic sets the alias, and an empty
+ * topic is the one of the alias. FAILURE: an alias the client did not offer, or never set. */
+static int topicAliasIn(MQTTClient* c, MQTTString* topicName, MQTTProperties* properties)
+{
+    MQTTProperty* alias = MQTTProperties_find(properties, MQTTPROPERTY_CODE_TOPIC_ALIAS);
+    MQTTTopicAlias* a;
+
+    if (alias == NULL)
+        return (topicName->lenstring.len > 0) ? MQSUCCESS : FAILURE;
+    if (alias->value.integer2 == 0 || alias->value.integer2 > MQTT_TOPIC_ALIASES)
+        return FAILURE;
+    a = &c->aliasIn[alias->value.integer2 - 1];
+    if (topicName->lenstring.len > 0)
+    {
+        /* too long to be kept: the alias is left unset, and fails when used alone */
+        a->len = (topicName->lenstring.len < MQTT_TOPIC_ALIAS_SIZE) ? topicName->lenstring.len : 0;
+        memcpy(a->topic, topicName->lenstring.data, a->len);
+        return MQSUCCESS;
+    }
+    if (a->len == 0)
+        return FAILURE;
+    topicName->lenstring.data = a->topic;
+    topicName->lenstring.len = a->len;
+    return MQSUCCESS;
+}
+
+
+static void resetTopicAliases(MQTTClient* c)
+{
+    c->aliasOutMax = 0;
+    c->aliasUse = 0;
+    memset(c->aliasOut, 0, sizeof(c->aliasOut));
+    memset(c->aliasIn, 0, sizeof(c->aliasIn));
+}
+
+
+/* Read the ack of the packet read last. MQTT 5: with its reason code, its properties are skipped. */
+static int readAck(MQTTClient* c, unsigned short* packetid, unsigned char* reasonCode)
+{
+    unsigned char dup, type;
+
+    *reasonCode = MQTTREASONCODE_SUCCESS;
+    if (c->MQTTVersion == 5)
+        return MQTTV5Deserialize_ack(&type, &dup, packetid, reasonCode, NULL, c->packet, c->packet_len);
+    return MQTTDeserialize_ack(&type, &dup, packetid, c->packet, c->packet_len);
+}
+
+
+static void publishQueueComplete(unsigned short id, int rc, void* context)
+{
+    (void)id;
+    (void)rc;
+    MQTTPublishQueueRelease((MQTTPublishSlot*)context);
+}
+
+
+/* Publish the queued messages, oldest first, while the in-flight window has room. Their slot is
+ * released on completion. A message which cannot be sent stays queued for the next connection;
+ * one which can never be sent is dropped. Each send has the command timeout, whatever the time
+ * left to the caller's cycle. */
+static int drainPublishQueue(MQTTClient* c)
+{
+    MQTTPublishSlot* slot;
+    Timer timer;
+    int rc = MQSUCCESS;
+
+    if (c->pubq == NULL)
+        return MQSUCCESS;
+    while (c->isconnected && (slot = MQTTPublishQueuePeek(c->pubq)) != NULL)
+    {
+        MQTTMessage msg;
+
+        if (slot->qos != QOS0 && MQTTInflightCount(c) >= inflightWindow(c))
+            break; /* the acks are read by cycle */
+        memset(&msg, 0, sizeof(msg));
+        msg.qos = (enum QoS)slot->qos;
+        msg.retained = slot->retained;
+        msg.payload = slot->data + slot->topiclen + 1;
+        msg.payloadlen = slot->payloadlen;
+        TimerInit(&timer);
+        TimerCountdownMS(&timer, c->command_timeout_ms);
+        rc = publish(c, (const char*)slot->data, &msg, NULL, 0, publishQueueComplete, slot, &timer);
+        if (rc == FAILURE)
+        {
+            MQTTCloseSession(c);
+            break;
         }
+        MQTTPublishQueuePop(c->pubq);
+        if (rc == MQSUCCESS)
+            c->pubq->sent++;
         else
-            rc = FAILURE;
+        {
+            MQTTPublishQueueRelease(slot);
+            c->pubq->dropped++;
+            rc = MQSUCCESS;
+        }
     }
+    return rc;
+}
 
-exit:
-    if (rc == FAILURE)
-        MQTTCloseSession(c);
-#if defined(MQTT_TASK)
-	  MutexUnlock(&c->mutex);
-#endif
+
+/* Slot of the in-flight publish id. id 0: a free slot. */
+static InflightMessage* findInflight(MQTTClient* c, unsigned short id)
+{
+    int i;
+
+    for (i = 0; i < MAX_INFLIGHT_MESSAGES; ++i)
+        if (c->inflight[i].id == id)
+            return &c->inflight[i];
+    return NULL;
+}
+
+
+static void completeInflight(MQTTClient* c, InflightMessage* m, int rc)
+{
+    publishCompleteHandler fp = m->fp;
+    void* context = m->context;
+    unsigned short id = m->id;
+
+    (void)c;
+    memset(m, 0, sizeof(InflightMessage)); /* free before the handler, which may publish again */
+    if (fp != NULL)
+        fp(id, rc, context);
+}
+
+
+static int sendInflight(MQTTClient* c, InflightMessage* m, unsigned char dup, Timer* timer)
+{
+    int len = 0;
+
+    if (!m->pubrel)
+        return sendPublish(c, dup, m->qos, m->retained, m->id, m->topicName, m->iov, m->iovcnt, timer);
+    if ((len = MQTTSerialize_ack(c->buf, c->buf_size, PUBREL, 0, m->id)) <= 0)
+        return FAILURE;
+    return sendPacket(c, len, timer);
+}
+
+
+/* Send the unacknowledged publishes again, in their original order, with DUP set. */
+static int resendInflight(MQTTClient* c, Timer* timer)
+{
+    int rc = MQSUCCESS;
+    unsigned int start = c->inflight_seq;
+
+    while (rc == MQSUCCESS)
+    {
+        InflightMessage* next = NULL;
+        int i;
+
+        /* oldest not resent yet: the resent ones get new sequence numbers, from start on */
+        for (i = 0; i < MAX_INFLIGHT_MESSAGES; ++i)
+        {
+            InflightMessage* m = &c->inflight[i];
+            if (m->id != 0 && (int)(m->seq - start) < 0 &&
+                    (next == NULL || (int)(m->seq - next->seq) < 0))
+                next = m;
+        }
+        if (next == NULL)
+            break;
+        next->seq = c->inflight_seq++;
+        rc = sendInflight(c, next, 1, timer);
+    }
     return rc;
 }
 
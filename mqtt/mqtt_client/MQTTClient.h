@@ -37,10 +37,17 @@
 //#define MQTT_TASK
 
 #include "MQTTPacket.h"
+#include "MQTTTopicTrie.h"
+#include "MQTTPublishQueue.h"
+#include "MQTTInboundQueue.h"
 #include "net.conf.h"
 #include <stdio.h>
 #include "net_mqtt.h"
 
+#if defined(MQTT_READ_BUFFER_SIZE) && MQTT_INQ_SLOT_SIZE < MQTT_READ_BUFFER_SIZE
+#error "MQTT_INQ_SLOT_SIZE must be MQTT_READ_BUFFER_SIZE at least"
+#endif
+
 #ifdef MQTT_TASK
 #include <cmsis_os.h>
 #endif
@@ -57,14 +64,34 @@
 
 #define MAX_PACKET_ID 65535 /* according to the MQTT specification - do not change! */
 
-#if !defined(MAX_MESSAGE_HANDLERS)
-#define MAX_MESSAGE_HANDLERS 5 /* redefinable - how many subscriptions do you want? */
+#if !defined(MQTT_READ_STAGE_SIZE)
+#define MQTT_READ_STAGE_SIZE 256 /* redefinable - most bytes taken from the network by one read */
+#endif
+
+#if !defined(MQTT_PUBLISH_MAX_IOV)
+#define MQTT_PUBLISH_MAX_IOV 4 /* redefinable - most payload segments of a MQTTPublishv */
+#endif
+
+#if !defined(MAX_INFLIGHT_MESSAGES)
+#define MAX_INFLIGHT_MESSAGES 8 /* redefinable - how many QoS1/QoS2 publishes may await their acks */
+#endif
+
+#if !defined(MQTT_TOPIC_ALIASES)
+#define MQTT_TOPIC_ALIASES 4 /* redefinable - MQTT 5 topic aliases kept each way, 1 at least */
+#endif
+
+#if !defined(MQTT_TOPIC_ALIAS_SIZE)
+#define MQTT_TOPIC_ALIAS_SIZE 64 /* redefinable - longest topic given an alias, + 1 */
+#endif
+
+#if MQTT_TOPIC_ALIASES < 1
+#error "MQTT_TOPIC_ALIASES must be 1 at least"
 #endif
 
 enum QoS { QOS0, QOS1, QOS2, SUBFAIL=0x80 };
 
 /* all failure return codes must be negative */
-enum returnCode { BUFFER_OVERFLOW = -2, FAILURE = -1, MQSUCCESS = 0 };
+enum returnCode { REFUSED = -3, BUFFER_OVERFLOW = -2, FAILURE = -1, MQSUCCESS = 0 };
 
 /* The Platform specific header must define the Network and Timer structures and functions
  * which operate on them.
@@ -73,6 +100,9 @@ typedef struct Network
 {
 	int (*mqttread)(Network*, unsigned char* read_buffer, int, int);
 	int (*mqttwrite)(Network*, unsigned char* send_buffer, int, int);
+	int (*mqttwritev)(Network*, const MQTTIovec* segments, int, int); (optional)
+	int (*mqttreadbuf)(Network*, MQTTBuf* view, int, int); (optional)
+	int (*mqttreleasebuf)(Network*, MQTTBuf* view); (with mqttreadbuf)
 } Network;*/
 
 /* The Timer structure must be defined in the platform specific header,
@@ -88,16 +118,31 @@ typedef struct MQTTMessage
     size_t 			payloadlen;
 } MQTTMessage;
 
+/* Payload segment of MQTTPublishv, sent from where it is */
+typedef net_iovec_t MQTTIovec;
+
+/* Bytes read without copying, in the receive buffers of the network stack */
+typedef net_buf_t MQTTBuf;
+
 typedef struct MessageData
 {
     MQTTMessage* message;
     MQTTString* topicName;
+    MQTTProperties* properties; /* MQTT 5: of the publish, the topic alias excepted. NULL in 3.1.1 */
 } MessageData;
 
 typedef struct MQTTConnackData
 {
-    unsigned char rc;
+    unsigned char rc;           /* MQTT 5: the reason code */
     unsigned char sessionPresent;
+    /* MQTT 5: the limits of the server, from the CONNACK properties, or their defaults */
+    unsigned int sessionExpiry;         /* seconds the session outlives the connection */
+    unsigned short receiveMaximum;      /* QoS1/QoS2 publishes it takes unacknowledged */
+    unsigned short topicAliasMaximum;   /* 0: no topic alias */
+    unsigned short serverKeepAlive;     /* keep alive to use instead of the one asked, 0: none */
+    unsigned char maximumQoS;
+    unsigned char retainAvailable;
+    unsigned int maximumPacketSize;     /* 0: no limit */
 } MQTTConnackData;
 
 typedef struct MQTTSubackData
@@ -107,6 +152,48 @@ typedef struct MQTTSubackData
 
 typedef void (*messageHandler)(MessageData*);
 
+/* Part of a publish too large for the read buffer, delivered as it is read. The chunks come in
+ * order: offset 0 first, offset + payloadlen == total last. */
+typedef struct MessageChunk
+{
+    MQTTMessage* message;       /* payload, payloadlen: this chunk */
+    MQTTString* topicName;
+    MQTTProperties* properties; /* as in MessageData */
+    size_t offset;              /* of the chunk in the payload */
+    size_t total;               /* payload length of the whole message */
+} MessageChunk;
+
+typedef void (*chunkHandler)(MessageChunk*);
+
+/** Completion of a QoS1/QoS2 publish: rc is MQSUCCESS once PUBACK/PUBCOMP is received,
+ *  FAILURE if the message was dropped (MQTTAbortInflight), REFUSED if the MQTT 5 server
+ *  acknowledged it with a failure reason code. */
+typedef void (*publishCompleteHandler)(unsigned short id, int rc, void* context);
+
+/* QoS1/QoS2 publish awaiting its acks. The topic and payload belong to the caller until completion. */
+typedef struct InflightMessage
+{
+    unsigned short id;          /* 0: free slot */
+    enum QoS qos;
+    unsigned char retained;
+    unsigned char pubrel;       /* QoS2: PUBREC received and PUBREL sent */
+    unsigned int seq;           /* send order, kept when retransmitting */
+    const char* topicName;
+    const MQTTIovec* iov;       /* payload segments: &payload, or those of MQTTPublishv */
+    int iovcnt;
+    MQTTIovec payload;          /* payload of MQTTPublish/MQTTPublishAsync */
+    publishCompleteHandler fp;
+    void* context;
+} InflightMessage;
+
+/* MQTT 5 topic alias: a number standing for a topic on the connection */
+typedef struct MQTTTopicAlias
+{
+    unsigned int used;          /* outgoing: order of last use, 0: free */
+    unsigned short len;         /* 0: not set */
+    char topic[MQTT_TOPIC_ALIAS_SIZE];
+} MQTTTopicAlias;
+
 typedef struct MQTTClient
 {
     unsigned int next_packetid,
@@ -120,13 +207,33 @@ typedef struct MQTTClient
     int isconnected;
     int cleansession;
 
-    struct MessageHandlers
-    {
-        const char* topicFilter;
-        void (*fp) (MessageData*);
-    } messageHandlers[MAX_MESSAGE_HANDLERS];      /* Message handlers are indexed by subscription topic */
+    MQTTTopicTrie subscriptions;      /* Message handlers are indexed by subscription topic, MAX_SUBSCRIPTIONS at most */
 
     void (*defaultMessageHandler) (MessageData*);
+    void (*chunkHandler) (MessageChunk*);
+    int stream_len;             /* remaining length of a publish to be streamed, 0: none */
+
+    MQTTPublishQueue* pubq;           /* messages queued by the other tasks, or NULL */
+    MQTTInboundQueue* inq;            /* message handlers run by the worker tasks, or NULL: in the read loop */
+
+    InflightMessage inflight[MAX_INFLIGHT_MESSAGES];
+    unsigned int inflight_window,   /* max messages in inflight[] */
+      inflight_seq;
+
+    unsigned char stage[MQTT_READ_STAGE_SIZE];  /* bytes read from the network, not parsed yet */
+    unsigned int stage_head,    /* first byte not parsed */
+      stage_tail;               /* end of the bytes read */
+    MQTTBuf view;               /* zero-copy read (mqttreadbuf): its bytes follow the staged ones */
+    unsigned int view_head;     /* first byte of the view not parsed */
+    unsigned char* packet;      /* the packet read last: in readbuf, or in place in the view */
+    int packet_len;
+
+    unsigned char MQTTVersion;  /* of the connection: 3, 4 or 5 */
+    unsigned short receiveMaximum;  /* MQTT 5: of the server, bounds inflight_window */
+    unsigned short aliasOutMax; /* MQTT 5: outgoing aliases in use, at most the server's maximum */
+    unsigned int aliasUse;
+    MQTTTopicAlias aliasOut[MQTT_TOPIC_ALIASES];    /* alias n is aliasOut[n - 1] */
+    MQTTTopicAlias aliasIn[MQTT_TOPIC_ALIASES];
 
     Network* ipstack;
     Timer last_sent, last_received;
@@ -164,6 +271,21 @@ DLLExport int MQTTConnectWithResults(MQTTClient* client, MQTTPacket_connectData*
  */
 DLLExport int MQTTConnect(MQTTClient* client, MQTTPacket_connectData* options);
 
+/** MQTT V5 Connect - MQTTConnectWithResults with the properties of the CONNECT packet, when
+ *  options->MQTTVersion is 5. With MQTT 5, the client offers the server MQTT_TOPIC_ALIASES
+ *  topic aliases, and gives its outgoing topics aliases as long as the server takes them: a
+ *  topic is sent in full once per connection only. The receive maximum of the server bounds
+ *  the in-flight window.
+ *  @param options - connect options
+ *  @param connectProperties - session expiry interval, receive maximum... at most 7. The
+ *         topic alias maximum is set by the client, and the receive maximum is MQTT_INQ_SLOTS at
+ *         most when workers handle the messages (MQTTSetInboundQueue). NULL: none.
+ *  @param data - the connack reason code, and the limits of the server
+ *  @return success code
+ */
+DLLExport int MQTTV5ConnectWithResults(MQTTClient* client, MQTTPacket_connectData* options,
+    MQTTProperties* connectProperties, MQTTConnackData* data);
+
 /** MQTT Publish - send an MQTT publish packet and wait for all acks to complete for all QoSs
  *  @param client - the client object to use
  *  @param topic - the topic to publish to
@@ -172,6 +294,83 @@ DLLExport int MQTTConnect(MQTTClient* client, MQTTPacket_connectData* options);
  */
 DLLExport int MQTTPublish(MQTTClient* client, const char*, MQTTMessage*);
 
+/** MQTT PublishAsync - send an MQTT publish packet without waiting for its acks.
+ *  QoS1/QoS2 messages stay in the in-flight window until PUBACK/PUBCOMP, in any order, then fp is called.
+ *  They are sent again with DUP set after a reconnection with MQTTConnect.
+ *  The call only blocks, up to command_timeout_ms, while the window is full.
+ *  @param client - the client object to use
+ *  @param topic - the topic to publish to. Must stay valid until completion.
+ *  @param message - the message to send. message->id is set. The payload must stay valid until completion.
+ *  @param fp - completion handler, or NULL. Called from MQTTYield/MQTTRun, or at once for QoS0.
+ *  @param context - passed to fp
+ *  @return success code
+ */
+DLLExport int MQTTPublishAsync(MQTTClient* client, const char*, MQTTMessage*, publishCompleteHandler fp, void* context);
+
+/** MQTT Publishv - MQTTPublish of a payload made of segments. A packet which fits in the send buffer
+ *  is assembled there and sent in one write. A larger one is sent by reference with mqttwritev: only
+ *  its header goes through the send buffer; without mqttwritev, it cannot be sent.
+ *  @param client - the client object to use
+ *  @param topic - the topic to publish to
+ *  @param message - the qos and retained flag of the message. Its payload is ignored.
+ *  @param iov - the payload segments, in order
+ *  @param iovcnt - 1 to MQTT_PUBLISH_MAX_IOV
+ *  @return success code. BUFFER_OVERFLOW if the packet cannot be sent, the connection is kept.
+ */
+DLLExport int MQTTPublishv(MQTTClient* client, const char*, MQTTMessage*, const MQTTIovec* iov, int iovcnt);
+
+/** MQTT PublishvAsync - MQTTPublishAsync of a payload made of segments, as MQTTPublishv.
+ *  The segments array and the data they point to must stay valid until completion.
+ */
+DLLExport int MQTTPublishvAsync(MQTTClient* client, const char*, MQTTMessage*, const MQTTIovec* iov, int iovcnt,
+        publishCompleteHandler fp, void* context);
+
+/** MQTT SetPublishQueue - attach the queue of MQTTPublishQueued
+ *  @param client - the client object to use
+ *  @param queue - initialized with MQTTPublishQueueInit. Must outlive the client.
+ */
+DLLExport void MQTTSetPublishQueue(MQTTClient* client, MQTTPublishQueue* queue);
+
+/** MQTT SetInboundQueue - run the message handlers in worker tasks rather than in the read loop
+ *  The incoming publishes are copied to the queue, and acknowledged once their handlers returned.
+ *  The workers call MQTTInboundDispatch(queue, ...) to run their handlers. When no slot is free,
+ *  the read loop does not wait: a QoS1/QoS2 message is then left unacknowledged and the session
+ *  closed, for the server to send it again. See MQTTInboundQueue.h.
+ *  @param client - the client object to use
+ *  @param queue - initialized with MQTTInboundQueueInit, or NULL to call the handlers in the read
+ *  loop again. Must outlive the client.
+ */
+DLLExport void MQTTSetInboundQueue(MQTTClient* client, MQTTInboundQueue* queue);
+
+/** MQTT PublishQueued - queue a message for the task running the client, without waiting for it.
+ *  Lock-free: safe from any task, whether the client is busy or not. The topic and payload are
+ *  copied. The message is published by the next MQTTYield/MQTTRun cycle, once connected.
+ *  @param client - the client object to use
+ *  @param topic - the topic to publish to
+ *  @param message - the message to send. message->id is not set.
+ *  @return success code. FAILURE if the queue is full or not set.
+ */
+DLLExport int MQTTPublishQueued(MQTTClient* client, const char*, MQTTMessage*);
+
+/** MQTT SetInflightWindow - set how many QoS1/QoS2 publishes may await their acks
+ *  @param client - the client object to use
+ *  @param window - 1 (stop and wait) to MAX_INFLIGHT_MESSAGES (default)
+ *  @return success code
+ */
+DLLExport int MQTTSetInflightWindow(MQTTClient* client, unsigned int window);
+
+/** MQTT InflightCount - number of QoS1/QoS2 publishes awaiting their acks
+ *  @param client - the client object to use
+ *  @return message count
+ */
+DLLExport int MQTTInflightCount(MQTTClient* client);
+
+/** MQTT AbortInflight - drop the publishes awaiting their acks, instead of sending them again
+ *  on the next connection. Their handlers are called with FAILURE.
+ *  @param client - the client object to use
+ */
+DLLExport void MQTTAbortInflight(MQTTClient* client);
+
 /** MQTT SetMessageHandler - set or remove a per topic message handler
  *  @param client - the client object to use
  *  @param topicFilter - the topic filter set the message handler for
@@ -180,6 +379,15 @@ DLLExport int MQTTPublish(MQTTClient* client, const char*, MQTTMessage*);
  */
 DLLExport int MQTTSetMessageHandler(MQTTClient* c, const char* topicFilter, messageHandler messageHandler);
 
+/** MQTT SetChunkHandler - set the handler of the publishes too large for the read buffer
+ *  Their payload is passed to it by chunks as it is read, in the space of the read buffer left by
+ *  the topic, whatever the topic. Without a chunk handler, such publishes are acknowledged and
+ *  dropped, and the connection is kept.
+ *  @param client - the client object to use
+ *  @param chunkHandler - pointer to the chunk handler function or NULL to remove
+ */
+DLLExport void MQTTSetChunkHandler(MQTTClient* c, chunkHandler chunkHandler);
+
 /** MQTT Subscribe - send an MQTT subscribe packet and wait for suback before returning.
  *  @param client - the client object to use
  *  @param topicFilter - the topic filter to subscribe to
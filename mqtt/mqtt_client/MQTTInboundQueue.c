@@ -0,0 +1,138 @@
+/*
+ * MQTTInboundQueue.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Daruin Solano
+ */
+
+#include "MQTTClient.h"
+
+#include <string.h>
+
+
+void MQTTInboundQueueInit(MQTTInboundQueue* q, void (*signal)(void* context), void* context)
+{
+    unsigned int i;
+
+    memset(q, 0, sizeof(MQTTInboundQueue));
+    for (i = 0; i < MQTT_INQ_SLOTS; ++i)
+        atomic_init(&q->slots[i].seq, i);
+    atomic_init(&q->head, 0);
+    atomic_init(&q->handled, 0);
+    atomic_init(&q->busy, 0);
+    atomic_init(&q->busy_max, 0);
+    q->signal = signal;
+    q->context = context;
+}
+
+
+/**
+ * Queue a message for its handler. Called by the client for each handler a publish matches.
+ * @param handler - NULL: the slot only holds the ack of a publish no handler matched
+ * @return MQSUCCESS, BUFFER_OVERFLOW if the topic and payload do not fit a slot, FAILURE if
+ *         no slot is free. Nothing is queued then.
+ */
+int MQTTInboundQueuePush(MQTTInboundQueue* q, void (*handler)(struct MessageData*),
+        const char* topic, size_t topiclen, const void* payload, size_t payloadlen,
+        unsigned char qos, unsigned char retained, unsigned char dup, unsigned short id)
+{
+    unsigned int pos = q->tail;
+    MQTTInboundSlot* slot = &q->slots[pos & (MQTT_INQ_SLOTS - 1)];
+
+    if (topiclen + 1 + payloadlen + 1 > MQTT_INQ_SLOT_SIZE)
+        return BUFFER_OVERFLOW;
+    if (pos - q->acked >= MQTT_INQ_SLOTS ||
+            atomic_load_explicit(&slot->seq, memory_order_acquire) != pos)
+        return FAILURE; /* still being handled, or not taken yet, or not acked, from the previous round */
+
+    slot->handler = handler;
+    slot->qos = qos;
+    slot->retained = retained;
+    slot->dup = dup;
+    slot->id = id;
+    slot->ack = 0;
+    slot->topiclen = (unsigned short)topiclen;
+    slot->payloadlen = (unsigned short)payloadlen;
+    memcpy(slot->data, topic, topiclen);
+    slot->data[topiclen] = '\0';
+    if (payloadlen > 0)
+        memcpy(slot->data + topiclen + 1, payload, payloadlen);
+    slot->data[topiclen + 1 + payloadlen] = '\0';
+    atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+    q->tail = pos + 1;
+    q->queued++;
+    if (q->signal != NULL)
+        q->signal(q->context);
+    return MQSUCCESS;
+}
+
+
+/* Take the oldest message not taken yet, or NULL */
+static MQTTInboundSlot* takeSlot(MQTTInboundQueue* q)
+{
+    unsigned int pos = atomic_load_explicit(&q->head, memory_order_relaxed);
+
+    for (;;)
+    {
+        MQTTInboundSlot* slot = &q->slots[pos & (MQTT_INQ_SLOTS - 1)];
+        int diff = (int)(atomic_load_explicit(&slot->seq, memory_order_acquire) - (pos + 1));
+
+        if (diff == 0)
+        {
+            /* filled: take it, unless another worker was faster - pos is then reloaded */
+            if (atomic_compare_exchange_weak_explicit(&q->head, &pos, pos + 1,
+                    memory_order_relaxed, memory_order_relaxed))
+                return slot;
+        }
+        else if (diff < 0)
+            return NULL; /* empty */
+        else
+            pos = atomic_load_explicit(&q->head, memory_order_relaxed);
+    }
+}
+
+
+/**
+ * Run the handlers of the queued messages, oldest first. For the worker tasks.
+ * @param max - most messages handled by this call, 0: until the queue is empty
+ * @return the number of messages handled
+ */
+int MQTTInboundDispatch(MQTTInboundQueue* q, int max)
+{
+    MQTTInboundSlot* slot;
+    int count = 0;
+
+    while ((max == 0 || count < max) && (slot = takeSlot(q)) != NULL)
+    {
+        MQTTMessage msg;
+        MQTTString topicName = MQTTString_initializer;
+        MessageData md;
+        unsigned int busy = atomic_fetch_add_explicit(&q->busy, 1, memory_order_relaxed) + 1;
+        unsigned int busy_max = atomic_load_explicit(&q->busy_max, memory_order_relaxed);
+        unsigned int seq;
+
+        while (busy > busy_max && !atomic_compare_exchange_weak_explicit(&q->busy_max, &busy_max, busy,
+                memory_order_relaxed, memory_order_relaxed))
+            ;
+        msg.qos = (enum QoS)slot->qos;
+        msg.retained = slot->retained;
+        msg.dup = slot->dup;
+        msg.id = slot->id;
+        msg.payload = slot->data + slot->topiclen + 1;
+        msg.payloadlen = slot->payloadlen;
+        topicName.lenstring.data = (char*)slot->data;
+        topicName.lenstring.len = slot->topiclen;
+        md.message = &msg;
+        md.topicName = &topicName;
+        md.properties = NULL;
+        if (slot->handler != NULL)
+            slot->handler(&md);
+
+        seq = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+        atomic_store_explicit(&slot->seq, seq - 1 + MQTT_INQ_SLOTS, memory_order_release);
+        atomic_fetch_sub_explicit(&q->busy, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&q->handled, 1, memory_order_relaxed);
+        ++count;
+    }
+    return count;
+}
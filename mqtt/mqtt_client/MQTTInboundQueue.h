@@ -0,0 +1,93 @@
+/*
+ * MQTTInboundQueue.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Daruin Solano
+ */
+
+#if !defined(MQTT_INBOUND_QUEUE_H_)
+#define MQTT_INBOUND_QUEUE_H_
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+/* Inbound dispatch queue: the message handlers run in worker tasks, not in the read loop.
+ *  - The task running the client copies each incoming publish into a free slot, with the
+ *    handler it matched, and goes on: the keepalive and the reads are not held up by the
+ *    handlers. A publish matching several handlers takes a slot per handler.
+ *  - Any number of worker tasks call MQTTInboundDispatch: as many handlers run at a time as
+ *    there are workers. With one worker, the messages are handled in order. A queue without a
+ *    signal has no workers: the task running the client dispatches it itself, e.g. after each
+ *    yield.
+ *  - A QoS1/QoS2 publish is acknowledged once its handlers returned, by the task running the
+ *    client, in the order of the publishes: its slot is taken again only then (acked). With
+ *    MQTT 5 and workers, the client asks the server for a receive maximum of MQTT_INQ_SLOTS.
+ *  - A handler never runs in the read loop while workers may run handlers too. When no slot is
+ *    free, the read loop does not wait: the message is dropped (dropped), as is a message whose
+ *    topic and payload do not fit a slot (too_large). A QoS1/QoS2 message dropped is not
+ *    acknowledged: the client closes the session, for the server to send it again.
+ *    Without workers, the read loop runs the queued handlers first, then that of the message:
+ *    nothing is lost, and the order is kept.
+ *  - The MQTT 5 properties are not kept: the handlers get NULL. The chunks of the publishes
+ *    streamed still go to the chunk handler in the read loop.
+ *  - Each slot carries a sequence number (bounded MPMC queue of D. Vyukov, with a single
+ *    producer: the client, under its mutex): the producer fills the slot at position pos while
+ *    its sequence is pos and publishes it by setting it to pos + 1. A worker owns it once it
+ *    moved the head past pos, and gives it back by setting it to pos + MQTT_INQ_SLOTS.
+ */
+
+#if !defined(MQTT_INQ_SLOTS)
+#define MQTT_INQ_SLOTS 4 /* redefinable - power of 2: messages awaiting or being handled */
+#endif
+
+#if !defined(MQTT_INQ_SLOT_SIZE)
+#define MQTT_INQ_SLOT_SIZE 600 /* redefinable - most topic bytes + 1 + payload bytes + 1 of a message.
+                                 * MQTT_READ_BUFFER_SIZE at least: any publish read whole fits a slot. */
+#endif
+
+#if (MQTT_INQ_SLOTS & (MQTT_INQ_SLOTS - 1)) != 0
+#error "MQTT_INQ_SLOTS must be a power of 2"
+#endif
+
+struct MessageData;
+
+typedef struct MQTTInboundSlot
+{
+    atomic_uint seq;
+    void (*handler)(struct MessageData*);
+    unsigned char qos;
+    unsigned char retained;
+    unsigned char dup;
+    unsigned short id;
+    unsigned char ack;                  /* producer only: the PUBACK/PUBREC of id is due once handled */
+    unsigned short topiclen;            /* the topic is data, '\0' terminated */
+    unsigned short payloadlen;          /* the payload follows the topic, '\0' terminated */
+    unsigned char data[MQTT_INQ_SLOT_SIZE];
+} MQTTInboundSlot;
+
+typedef struct MQTTInboundQueue
+{
+    MQTTInboundSlot slots[MQTT_INQ_SLOTS];
+    unsigned int tail;                  /* next position to be filled. Producer only. */
+    unsigned int acked;                 /* producer only: oldest position whose ack may be due */
+    atomic_uint head;                   /* next position to be taken by a worker */
+    void (*signal)(void* context);      /* a message was queued: wake a worker. Or NULL. */
+    void* context;
+    unsigned int queued;                /* producer only */
+    unsigned int inline_calls;          /* producer only: handled in the read loop, no workers */
+    unsigned int dropped;               /* producer only: no slot free */
+    unsigned int too_large;             /* producer only: dropped, the topic and payload do not fit a slot */
+    atomic_uint handled;
+    atomic_uint busy;                   /* handlers running */
+    atomic_uint busy_max;
+} MQTTInboundQueue;
+
+void MQTTInboundQueueInit(MQTTInboundQueue* q, void (*signal)(void* context), void* context);
+int MQTTInboundQueuePush(MQTTInboundQueue* q, void (*handler)(struct MessageData*),
+        const char* topic, size_t topiclen, const void* payload, size_t payloadlen,
+        unsigned char qos, unsigned char retained, unsigned char dup, unsigned short id);
+
+/* Worker side, from any number of tasks */
+int MQTTInboundDispatch(MQTTInboundQueue* q, int max);
+
+#endif /* MQTT_INBOUND_QUEUE_H_ */
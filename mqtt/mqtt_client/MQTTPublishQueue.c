@@ -0,0 +1,104 @@
+/*
+ * MQTTPublishQueue.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Daruin Solano
+ */
+
+#include "MQTTClient.h"
+
+#include <string.h>
+
+
+void MQTTPublishQueueInit(MQTTPublishQueue* q)
+{
+    unsigned int i;
+
+    memset(q, 0, sizeof(MQTTPublishQueue));
+    for (i = 0; i < MQTT_PUBQ_SLOTS; ++i)
+        atomic_init(&q->slots[i].seq, i);
+    atomic_init(&q->tail, 0);
+    atomic_init(&q->pushed, 0);
+    atomic_init(&q->refused, 0);
+}
+
+
+/**
+ * Queue a message for the MQTT task. Safe from any task, and never blocks.
+ * @return MQSUCCESS, BUFFER_OVERFLOW if the topic and payload do not fit a slot, FAILURE if
+ *         no slot is free.
+ */
+int MQTTPublishQueuePush(MQTTPublishQueue* q, const char* topicName, int qos, unsigned char retained,
+        const void* payload, size_t payloadlen)
+{
+    size_t topiclen = strlen(topicName);
+    unsigned int pos = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    MQTTPublishSlot* slot;
+
+    if (topiclen == 0 || topiclen + 1 + payloadlen > MQTT_PUBQ_SLOT_SIZE || qos < QOS0 || qos > QOS2)
+    {
+        atomic_fetch_add_explicit(&q->refused, 1, memory_order_relaxed);
+        return BUFFER_OVERFLOW;
+    }
+
+    for (;;)
+    {
+        int diff;
+
+        slot = &q->slots[pos & (MQTT_PUBQ_SLOTS - 1)];
+        diff = (int)(atomic_load_explicit(&slot->seq, memory_order_acquire) - pos);
+        if (diff == 0)
+        {
+            /* free: claim it, unless another producer was faster - pos is then reloaded */
+            if (atomic_compare_exchange_weak_explicit(&q->tail, &pos, pos + 1,
+                    memory_order_relaxed, memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+        {
+            /* not given back yet by the consumer, for the previous round */
+            atomic_fetch_add_explicit(&q->refused, 1, memory_order_relaxed);
+            return FAILURE;
+        }
+        else
+            pos = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    }
+
+    slot->qos = (unsigned char)qos;
+    slot->retained = retained;
+    slot->topiclen = (unsigned short)topiclen;
+    slot->payloadlen = (unsigned short)payloadlen;
+    memcpy(slot->data, topicName, topiclen + 1);
+    if (payloadlen > 0)
+        memcpy(slot->data + topiclen + 1, payload, payloadlen);
+    atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+    atomic_fetch_add_explicit(&q->pushed, 1, memory_order_relaxed);
+    return MQSUCCESS;
+}
+
+
+/** Oldest message not published yet, or NULL. The slot is read-only. */
+MQTTPublishSlot* MQTTPublishQueuePeek(MQTTPublishQueue* q)
+{
+    MQTTPublishSlot* slot = &q->slots[q->head & (MQTT_PUBQ_SLOTS - 1)];
+
+    if (atomic_load_explicit(&slot->seq, memory_order_acquire) != q->head + 1)
+        return NULL; /* empty, or still being filled */
+    return slot;
+}
+
+
+/** Move past the slot returned by MQTTPublishQueuePeek. It stays in use until released. */
+void MQTTPublishQueuePop(MQTTPublishQueue* q)
+{
+    q->head++;
+}
+
+
+/** Give a slot back to the producers, once its message is no longer needed. */
+void MQTTPublishQueueRelease(MQTTPublishSlot* slot)
+{
+    unsigned int seq = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+
+    atomic_store_explicit(&slot->seq, seq - 1 + MQTT_PUBQ_SLOTS, memory_order_release);
+}
@@ -0,0 +1,71 @@
+/*
+ * MQTTPublishQueue.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Daruin Solano
+ */
+
+#if !defined(MQTT_PUBLISH_QUEUE_H_)
+#define MQTT_PUBLISH_QUEUE_H_
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+/* Publish queue of the MQTT task: any number of producer tasks, one consumer, no lock.
+ *  - A producer copies the topic and payload of its message into a free slot and returns. It
+ *    never waits for the client mutex nor touches the socket; when no slot is free, the message
+ *    is refused at once.
+ *  - The MQTT task publishes the queued messages, oldest first, from MQTTYield/MQTTRun. Only the
+ *    packet header goes through the send buffer: the payload is sent from the slot.
+ *  - A slot is given back once its publish completes: at once for QoS0, on PUBACK/PUBCOMP for
+ *    QoS1/QoS2. A slot still awaiting its acks is not reused: the producers find the queue
+ *    full when they come round to it.
+ *  - Each slot carries a sequence number (bounded MPMC queue of D. Vyukov, with a single
+ *    consumer): a producer owns the slot at position pos once it moved the tail past pos while
+ *    the slot sequence was pos; it publishes the slot by setting the sequence to pos + 1. The
+ *    consumer gives it back by setting it to pos + MQTT_PUBQ_SLOTS.
+ */
+
+#if !defined(MQTT_PUBQ_SLOTS)
+#define MQTT_PUBQ_SLOTS 8 /* redefinable - power of 2: messages queued or awaiting their acks */
+#endif
+
+#if !defined(MQTT_PUBQ_SLOT_SIZE)
+#define MQTT_PUBQ_SLOT_SIZE 256 /* redefinable - most topic bytes + 1 + payload bytes of a message */
+#endif
+
+#if (MQTT_PUBQ_SLOTS & (MQTT_PUBQ_SLOTS - 1)) != 0
+#error "MQTT_PUBQ_SLOTS must be a power of 2"
+#endif
+
+typedef struct MQTTPublishSlot
+{
+    atomic_uint seq;
+    unsigned char qos;
+    unsigned char retained;
+    unsigned short topiclen;            /* the topic is data, '\0' terminated */
+    unsigned short payloadlen;          /* the payload follows the topic */
+    unsigned char data[MQTT_PUBQ_SLOT_SIZE];
+} MQTTPublishSlot;
+
+typedef struct MQTTPublishQueue
+{
+    MQTTPublishSlot slots[MQTT_PUBQ_SLOTS];
+    atomic_uint tail;                   /* next position to be taken by a producer */
+    unsigned int head;                  /* next position to be published. Consumer only. */
+    atomic_uint pushed;
+    atomic_uint refused;                /* queue full, or message larger than a slot */
+    unsigned int sent;                  /* consumer only */
+    unsigned int dropped;               /* consumer only: could not be sent */
+} MQTTPublishQueue;
+
+void MQTTPublishQueueInit(MQTTPublishQueue* q);
+int MQTTPublishQueuePush(MQTTPublishQueue* q, const char* topicName, int qos, unsigned char retained,
+        const void* payload, size_t payloadlen);
+
+/* Consumer side, for the MQTT task */
+MQTTPublishSlot* MQTTPublishQueuePeek(MQTTPublishQueue* q);
+void MQTTPublishQueuePop(MQTTPublishQueue* q);
+void MQTTPublishQueueRelease(MQTTPublishSlot* slot);
+
+#endif /* MQTT_PUBLISH_QUEUE_H_ */
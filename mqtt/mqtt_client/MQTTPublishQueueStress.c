@@ -0,0 +1,164 @@
+/*
+ * MQTTPublishQueueStress.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Daruin Solano
+ *
+ *  Multi-producer stress test of the publish queue, on the host (pthreads): producers threads
+ *  push messages numbered per producer as fast as the queue takes them, one consumer takes them
+ *  out as the MQTT task does, holding a few slots for a while like QoS1 messages awaiting their
+ *  PUBACK, and giving them back out of order.
+ *  Every message must come out exactly once, whole, and in the order of its producer.
+ *
+ *    int MQTTPublishQueueStress(int producers, int messages);
+ */
+
+#include "MQTTClient.h"
+
+#if defined(USE_HOST)
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STRESS_PRODUCERS_MAX 16
+#define STRESS_HELD_MAX 3       /* slots held by the consumer, as if awaiting their acks */
+
+typedef struct StressProducer
+{
+    MQTTPublishQueue* q;
+    pthread_t thread;
+    unsigned int id;
+    unsigned int messages;
+    unsigned int retries;       /* pushes refused, queue full */
+} StressProducer;
+
+typedef struct StressPayload
+{
+    unsigned int id;
+    unsigned int number;
+    unsigned int check;
+} StressPayload;
+
+static atomic_int stress_done;
+
+static unsigned int stressCheck(unsigned int id, unsigned int number)
+{
+    return (id * 2654435761u) ^ number;
+}
+
+
+static void* stressProducer(void* arg)
+{
+    StressProducer* p = (StressProducer*)arg;
+    char topic[16];
+    unsigned int i;
+
+    snprintf(topic, sizeof(topic), "p/%u", p->id);
+    for (i = 0; i < p->messages; ++i)
+    {
+        StressPayload pl = { p->id, i, stressCheck(p->id, i) };
+
+        while (MQTTPublishQueuePush(p->q, topic, i & 1, 0, &pl, sizeof(pl)) != MQSUCCESS)
+        {
+            p->retries++;
+            sched_yield();
+        }
+    }
+    atomic_fetch_add(&stress_done, 1);
+    return NULL;
+}
+
+
+/**
+ * Run producers threads pushing messages each, and consume them in the calling thread.
+ * @return MQSUCCESS, or FAILURE if a message was lost, duplicated, altered or out of order.
+ */
+int MQTTPublishQueueStress(int producers, int messages)
+{
+    static MQTTPublishQueue q;
+    StressProducer p[STRESS_PRODUCERS_MAX];
+    unsigned int next[STRESS_PRODUCERS_MAX] = { 0 };
+    MQTTPublishSlot* held[STRESS_HELD_MAX];
+    unsigned long consumed = 0, errors = 0, retries = 0;
+    unsigned int rnd = 1;
+    int nheld = 0;
+    int started = 0;
+    int i;
+
+    if (producers <= 0 || producers > STRESS_PRODUCERS_MAX || messages <= 0)
+        return FAILURE;
+    MQTTPublishQueueInit(&q);
+    atomic_store(&stress_done, 0);
+    for (i = 0; i < producers; ++i)
+    {
+        p[i].q = &q;
+        p[i].id = i;
+        p[i].messages = messages;
+        p[i].retries = 0;
+        if (pthread_create(&p[i].thread, NULL, stressProducer, &p[i]) != 0)
+            break;
+        ++started;
+    }
+    if (started < producers)
+    {
+        errors++;
+        producers = started;
+    }
+
+    for (;;)
+    {
+        MQTTPublishSlot* s = MQTTPublishQueuePeek(&q);
+        StressPayload pl;
+        char topic[16];
+
+        if (s == NULL)
+        {
+            /* the producers may be waiting for the slots held */
+            if (atomic_load(&stress_done) == producers && MQTTPublishQueuePeek(&q) == NULL)
+                break;
+            if (nheld > 0)
+                MQTTPublishQueueRelease(held[--nheld]);
+            sched_yield();
+            continue;
+        }
+        memcpy(&pl, s->data + s->topiclen + 1, sizeof(pl));
+        snprintf(topic, sizeof(topic), "p/%u", pl.id);
+        if (pl.id >= (unsigned int)producers || pl.number != next[pl.id] || pl.check != stressCheck(pl.id, pl.number)
+                || strcmp((char*)s->data, topic) != 0 || s->payloadlen != sizeof(pl) || s->qos != (pl.number & 1))
+            errors++;
+        else
+            next[pl.id]++;
+        consumed++;
+        MQTTPublishQueuePop(&q);
+
+        /* hold one slot in four, give back one held in eight: the releases come out of order */
+        rnd = rnd * 1103515245 + 12345;
+        if (((rnd >> 16) & 3) == 0 && nheld < STRESS_HELD_MAX)
+            held[nheld++] = s;
+        else
+            MQTTPublishQueueRelease(s);
+        if (nheld > 0 && (nheld == STRESS_HELD_MAX || ((rnd >> 20) & 7) == 0))
+        {
+            int k = (rnd >> 8) % nheld;
+
+            MQTTPublishQueueRelease(held[k]);
+            held[k] = held[--nheld];
+        }
+    }
+    while (nheld > 0)
+        MQTTPublishQueueRelease(held[--nheld]);
+
+    for (i = 0; i < producers; ++i)
+    {
+        pthread_join(p[i].thread, NULL);
+        retries += p[i].retries;
+        if (next[i] != (unsigned int)messages)
+            errors++;
+    }
+    printf("MQTTPublishQueueStress: %d producers, %lu of %lu messages consumed, %lu errors, %lu retries on full\n",
+            producers, consumed, (unsigned long)producers * messages, errors, retries);
+    return (errors == 0 && consumed == (unsigned long)producers * messages) ? MQSUCCESS : FAILURE;
+}
+
+#endif /* USE_HOST */
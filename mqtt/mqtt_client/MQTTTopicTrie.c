@@ -0,0 +1,367 @@
+/*
+ * MQTTTopicTrie.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Daruin Solano
+ */
+
+#include "MQTTClient.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define TRIE_TABLE_MIN 16
+
+static unsigned int levelHash(MQTTTopicNode* parent, const char* level, size_t len);
+static MQTTTopicNode* findChild(MQTTTopicTrie* t, MQTTTopicNode* parent, const char* level, size_t len);
+static MQTTTopicNode* addChild(MQTTTopicTrie* t, MQTTTopicNode* parent, const char* level, size_t len);
+static int growTable(MQTTTopicTrie* t);
+static void prune(MQTTTopicTrie* t, MQTTTopicNode* node);
+static int matchLevel(MQTTTopicTrie* t, MQTTTopicNode* node, const char* level, const char* end,
+        MQTTTopicMatchHandler cb, void* context);
+static int matchNode(MQTTTopicTrie* t, MQTTTopicNode* node, const char* level_end, const char* end,
+        MQTTTopicMatchHandler cb, void* context);
+
+
+void MQTTTopicTrieInit(MQTTTopicTrie* t)
+{
+    memset(t, 0, sizeof(MQTTTopicTrie));
+}
+
+
+/**
+ * Add a filter, or replace the handler of a filter already held.
+ * @return MQSUCCESS, or FAILURE if the filter is not valid, if MAX_SUBSCRIPTIONS are held
+ *         or if the memory is exhausted.
+ */
+int MQTTTopicTrieAdd(MQTTTopicTrie* t, const char* topicFilter, void (*fp)(struct MessageData*))
+{
+    MQTTTopicNode* node = &t->root;
+    const char* level = topicFilter;
+
+    if (fp == NULL || !MQTTTopicFilterValid(topicFilter))
+        return FAILURE;
+
+    for (;;)
+    {
+        const char* level_end = strchr(level, '/');
+        size_t len = (level_end != NULL) ? (size_t)(level_end - level) : strlen(level);
+        MQTTTopicNode* child = findChild(t, node, level, len);
+
+        if (child == NULL)
+        {
+            if (t->count >= MAX_SUBSCRIPTIONS || (child = addChild(t, node, level, len)) == NULL)
+            {
+                prune(t, node);
+                return FAILURE;
+            }
+        }
+        node = child;
+        if (level_end == NULL)
+            break;
+        level = level_end + 1;
+    }
+
+    if (node->fp == NULL)
+        t->count++;
+    node->fp = fp;
+    return MQSUCCESS;
+}
+
+
+/** @return MQSUCCESS, or FAILURE if the filter is not held. */
+int MQTTTopicTrieRemove(MQTTTopicTrie* t, const char* topicFilter)
+{
+    MQTTTopicNode* node = &t->root;
+    const char* level = topicFilter;
+
+    if (!MQTTTopicFilterValid(topicFilter))
+        return FAILURE;
+
+    for (;;)
+    {
+        const char* level_end = strchr(level, '/');
+        size_t len = (level_end != NULL) ? (size_t)(level_end - level) : strlen(level);
+
+        if ((node = findChild(t, node, level, len)) == NULL)
+            return FAILURE;
+        if (level_end == NULL)
+            break;
+        level = level_end + 1;
+    }
+    if (node->fp == NULL)
+        return FAILURE;
+
+    node->fp = NULL;
+    t->count--;
+    prune(t, node);
+    return MQSUCCESS;
+}
+
+
+/**
+ * Call cb for each filter matching topicName. A handler subscribed under several matching
+ * filters is called once per filter, as the MQTT specification allows.
+ * @return the number of matching filters.
+ */
+int MQTTTopicTrieMatch(MQTTTopicTrie* t, MQTTString* topicName, MQTTTopicMatchHandler cb, void* context)
+{
+    const char* topic = topicName->cstring;
+    size_t len;
+
+    if (t->count == 0)
+        return 0;
+    if (topic != NULL)
+        len = strlen(topic);
+    else
+    {
+        topic = topicName->lenstring.data;
+        len = topicName->lenstring.len;
+    }
+    return matchLevel(t, &t->root, topic, topic + len, cb, context);
+}
+
+
+/** Remove all the filters and release the memory. */
+void MQTTTopicTrieClear(MQTTTopicTrie* t)
+{
+    unsigned int i;
+
+    for (i = 0; i < t->tableSize; ++i)
+    {
+        MQTTTopicNode* node = t->table[i];
+
+        while (node != NULL)
+        {
+            MQTTTopicNode* next = node->hnext;
+            MQTTTopicFree(node);
+            node = next;
+        }
+    }
+    if (t->tableSize > 0)
+        MQTTTopicFree(t->table);
+    MQTTTopicTrieInit(t);
+}
+
+
+/**
+ * Topic filter syntax: '#' only as the whole last level, '+' only as a whole level, no empty
+ * filter. Empty levels are valid.
+ */
+int MQTTTopicFilterValid(const char* topicFilter)
+{
+    const char* p = topicFilter;
+
+    if (p == NULL || *p == '\0')
+        return 0;
+    for (; *p != '\0'; ++p)
+    {
+        if (*p != '+' && *p != '#')
+            continue;
+        if (p != topicFilter && p[-1] != '/')
+            return 0;
+        if (*p == '#' && p[1] != '\0')
+            return 0;
+        if (*p == '+' && p[1] != '\0' && p[1] != '/')
+            return 0;
+    }
+    return 1;
+}
+
+
+/** Match of a single filter against a topic, level by level, without the trie. */
+int MQTTTopicMatches(const char* topicFilter, MQTTString* topicName)
+{
+    const char* curf = topicFilter;
+    const char* curn = (topicName->cstring != NULL) ? topicName->cstring : topicName->lenstring.data;
+    const char* curn_end = curn + ((topicName->cstring != NULL) ? strlen(topicName->cstring) : (size_t)topicName->lenstring.len);
+
+    if (curn < curn_end && *curn == '$' && (*curf == '+' || *curf == '#'))
+        return 0;
+    for (;;)
+    {
+        const char* f_end = strchr(curf, '/');
+        const char* n_end = memchr(curn, '/', curn_end - curn);
+        size_t flen = (f_end != NULL) ? (size_t)(f_end - curf) : strlen(curf);
+        size_t nlen = (n_end != NULL) ? (size_t)(n_end - curn) : (size_t)(curn_end - curn);
+
+        if (flen == 1 && *curf == '#')
+            return 1;
+        if (!(flen == 1 && *curf == '+') && (flen != nlen || memcmp(curf, curn, flen) != 0))
+            return 0;
+        if (f_end == NULL || n_end == NULL)
+        {
+            /* "a/#" also matches "a" */
+            return (f_end == NULL && n_end == NULL) || (n_end == NULL && strcmp(f_end, "/#") == 0);
+        }
+        curf = f_end + 1;
+        curn = n_end + 1;
+    }
+}
+
+
+static unsigned int levelHash(MQTTTopicNode* parent, const char* level, size_t len)
+{
+    unsigned int h = 2166136261u ^ (unsigned int)(uintptr_t)parent;   /* FNV-1a */
+    size_t i;
+
+    for (i = 0; i < len; ++i)
+    {
+        h ^= (unsigned char)level[i];
+        h *= 16777619u;
+    }
+    return h ^ (h >> 15);
+}
+
+
+static MQTTTopicNode* findChild(MQTTTopicTrie* t, MQTTTopicNode* parent, const char* level, size_t len)
+{
+    MQTTTopicNode* node;
+
+    if (len == 1 && *level == '+')
+        return parent->plus;
+    if (len == 1 && *level == '#')
+        return parent->hash;
+    if (parent->children == 0)
+        return NULL;
+    for (node = t->table[levelHash(parent, level, len) & (t->tableSize - 1)]; node != NULL; node = node->hnext)
+    {
+        if (node->parent == parent && node->len == len && memcmp(node->level, level, len) == 0)
+            return node;
+    }
+    return NULL;
+}
+
+
+static MQTTTopicNode* addChild(MQTTTopicTrie* t, MQTTTopicNode* parent, const char* level, size_t len)
+{
+    MQTTTopicNode* node;
+    MQTTTopicNode** bucket;
+
+    if (len > 0xFFFF || (t->nodes >= t->tableSize && growTable(t) != MQSUCCESS))
+        return NULL;
+    if ((node = MQTTTopicMalloc(sizeof(MQTTTopicNode) + len)) == NULL)
+        return NULL;
+    memset(node, 0, sizeof(MQTTTopicNode));
+    node->parent = parent;
+    node->len = (unsigned short)len;
+    node->level = (char*)(node + 1);
+    memcpy(node->level, level, len);
+
+    /* The wildcard nodes are in the table too, for MQTTTopicTrieClear(), but found from their parent. */
+    bucket = &t->table[levelHash(parent, level, len) & (t->tableSize - 1)];
+    node->hnext = *bucket;
+    *bucket = node;
+    parent->children++;
+    t->nodes++;
+    if (len == 1 && *level == '+')
+        parent->plus = node;
+    else if (len == 1 && *level == '#')
+        parent->hash = node;
+    return node;
+}
+
+
+/* One bucket per literal node at most: the chains stay short. */
+static int growTable(MQTTTopicTrie* t)
+{
+    unsigned int size = (t->tableSize > 0) ? t->tableSize * 2 : TRIE_TABLE_MIN;
+    MQTTTopicNode** table = MQTTTopicMalloc(size * sizeof(MQTTTopicNode*));
+    unsigned int i;
+
+    if (table == NULL)
+        return FAILURE;
+    memset(table, 0, size * sizeof(MQTTTopicNode*));
+    for (i = 0; i < t->tableSize; ++i)
+    {
+        MQTTTopicNode* node = t->table[i];
+
+        while (node != NULL)
+        {
+            MQTTTopicNode* next = node->hnext;
+            MQTTTopicNode** bucket = &table[levelHash(node->parent, node->level, node->len) & (size - 1)];
+
+            node->hnext = *bucket;
+            *bucket = node;
+            node = next;
+        }
+    }
+    if (t->tableSize > 0)
+        MQTTTopicFree(t->table);
+    t->table = table;
+    t->tableSize = size;
+    return MQSUCCESS;
+}
+
+
+/* Free node and its ancestors as long as they lead to no filter. */
+static void prune(MQTTTopicTrie* t, MQTTTopicNode* node)
+{
+    while (node != &t->root && node->fp == NULL && node->children == 0)
+    {
+        MQTTTopicNode* parent = node->parent;
+        MQTTTopicNode** bucket = &t->table[levelHash(parent, node->level, node->len) & (t->tableSize - 1)];
+
+        while (*bucket != node)
+            bucket = &(*bucket)->hnext;
+        *bucket = node->hnext;
+        parent->children--;
+        t->nodes--;
+        if (parent->plus == node)
+            parent->plus = NULL;
+        else if (parent->hash == node)
+            parent->hash = NULL;
+        MQTTTopicFree(node);
+        node = parent;
+    }
+}
+
+
+/* Filters under node matching the topic levels from level to end. */
+static int matchLevel(MQTTTopicTrie* t, MQTTTopicNode* node, const char* level, const char* end,
+        MQTTTopicMatchHandler cb, void* context)
+{
+    const char* level_end = memchr(level, '/', end - level);
+    int wildcards = !(node == &t->root && level < end && *level == '$');
+    MQTTTopicNode* child;
+    size_t len;
+    int count = 0;
+
+    if (level_end == NULL)
+        level_end = end;
+    len = level_end - level;
+    if (wildcards && node->hash != NULL && node->hash->fp != NULL)
+    {
+        cb(node->hash->fp, context);
+        count++;
+    }
+    if (wildcards && node->plus != NULL)
+        count += matchNode(t, node->plus, level_end, end, cb, context);
+    /* A '+' or '#' in a topic name is invalid: it must not select the wildcard children. */
+    if (!(len == 1 && (*level == '+' || *level == '#')) && (child = findChild(t, node, level, len)) != NULL)
+        count += matchNode(t, child, level_end, end, cb, context);
+    return count;
+}
+
+
+/* node matched the level ending at level_end. */
+static int matchNode(MQTTTopicTrie* t, MQTTTopicNode* node, const char* level_end, const char* end,
+        MQTTTopicMatchHandler cb, void* context)
+{
+    int count = 0;
+
+    if (level_end < end)
+        return matchLevel(t, node, level_end + 1, end, cb, context);
+    if (node->fp != NULL)
+    {
+        cb(node->fp, context);
+        count++;
+    }
+    if (node->hash != NULL && node->hash->fp != NULL)
+    {
+        /* "a/#" also matches "a" */
+        cb(node->hash->fp, context);
+        count++;
+    }
+    return count;
+}
@@ -0,0 +1,69 @@
+/*
+ * MQTTTopicTrie.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Daruin Solano
+ */
+
+#if !defined(MQTT_TOPIC_TRIE_H_)
+#define MQTT_TOPIC_TRIE_H_
+
+#include <stddef.h>
+#include "MQTTPacket.h"
+
+/* Subscription index of the client: a trie of the topic filter levels.
+ *  - Each node is a level of one or more filters. Its children are held in a hash table shared
+ *    by the whole trie, keyed by the parent node and the level string; its "+" and "#" children
+ *    are also linked directly.
+ *  - Matching a topic walks its levels: the cost grows with the depth of the topic and with
+ *    the wildcard branches actually subscribed, not with the number of subscriptions.
+ *  - The trie owns copies of the filters: the caller's strings need not outlive the call.
+ *  - As in the MQTT specification, "+" and "#" at the first level do not match topics
+ *    starting with '$'.
+ */
+
+#if !defined(MAX_SUBSCRIPTIONS)
+#define MAX_SUBSCRIPTIONS 256 /* redefinable - upper bound of the filters held by a client */
+#endif
+
+#if !defined(MQTTTopicMalloc)
+#define MQTTTopicMalloc malloc
+#define MQTTTopicFree free
+#endif
+
+struct MessageData;
+
+typedef struct MQTTTopicNode
+{
+    struct MQTTTopicNode* parent;
+    struct MQTTTopicNode* hnext;        /* next node in the same hash bucket */
+    struct MQTTTopicNode* plus;         /* "+" child */
+    struct MQTTTopicNode* hash;         /* "#" child */
+    unsigned int children;              /* children, all held in the hash table */
+    void (*fp)(struct MessageData*);    /* handler of the filter ending at this level. NULL: none */
+    unsigned short len;
+    char* level;                        /* level string, not terminated. Allocated with the node. */
+} MQTTTopicNode;
+
+typedef struct MQTTTopicTrie
+{
+    MQTTTopicNode root;
+    MQTTTopicNode** table;              /* nodes, by hash of (parent, level) */
+    unsigned int tableSize;             /* power of 2. 0: not allocated yet */
+    unsigned int nodes;                 /* nodes in the table, the root excluded */
+    unsigned int count;                 /* filters held */
+} MQTTTopicTrie;
+
+/** Called for each filter matching a topic, with the handler of the filter. */
+typedef void (*MQTTTopicMatchHandler)(void (*fp)(struct MessageData*), void* context);
+
+void MQTTTopicTrieInit(MQTTTopicTrie* t);
+int MQTTTopicTrieAdd(MQTTTopicTrie* t, const char* topicFilter, void (*fp)(struct MessageData*));
+int MQTTTopicTrieRemove(MQTTTopicTrie* t, const char* topicFilter);
+int MQTTTopicTrieMatch(MQTTTopicTrie* t, MQTTString* topicName, MQTTTopicMatchHandler cb, void* context);
+void MQTTTopicTrieClear(MQTTTopicTrie* t);
+
+int MQTTTopicFilterValid(const char* topicFilter);
+int MQTTTopicMatches(const char* topicFilter, MQTTString* topicName);
+
+#endif /* MQTT_TOPIC_TRIE_H_ */
@@ -0,0 +1,119 @@
+/*
+ * MQTTTopicTrieBench.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Daruin Solano
+ *
+ *  Dispatch microbenchmark of the subscription index: the same topics matched against the same
+ *  filters through the trie, and by a scan of all the filters as the client used to do.
+ *  The filters mix literal ones with "+" and "#" ones; both methods must find the same matches.
+ *
+ *    int MQTTTopicTrieBench(int subscriptions, int messages);
+ */
+
+#include "MQTTClient.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_FILTER_SIZE 48
+#define BENCH_SITES 16
+
+static unsigned long bench_calls;
+
+static void benchHandler(MessageData* md)
+{
+    (void)md;
+}
+
+static void benchCount(messageHandler fp, void* context)
+{
+    (void)fp;
+    (void)context;
+    bench_calls++;
+}
+
+static void benchFilter(char* filter, int i)
+{
+    int site = i % BENCH_SITES;
+    int dev = i / BENCH_SITES;
+
+    if (i % 16 == 15)
+        snprintf(filter, BENCH_FILTER_SIZE, "site/+/dev/%d/temp", dev);
+    else if (i % 8 == 7)
+        snprintf(filter, BENCH_FILTER_SIZE, "site/%d/+/%d/#", site, dev);
+    else
+        snprintf(filter, BENCH_FILTER_SIZE, "site/%d/dev/%d/temp", site, dev);
+}
+
+
+/**
+ * Dispatch messages topics through the trie and through the linear scan, with subscriptions
+ * filters held, and log the cost per message of each.
+ * @return MQSUCCESS, or FAILURE if the memory is short or the two methods disagree.
+ */
+int MQTTTopicTrieBench(int subscriptions, int messages)
+{
+    MQTTTopicTrie trie;
+    char* filters;
+    char topic[BENCH_FILTER_SIZE];
+    MQTTString name = MQTTString_initializer;
+    unsigned long trie_calls, scan_calls = 0;
+    uint64_t t0, trie_us, scan_us;
+    int i, j;
+
+    if (subscriptions <= 0 || subscriptions > MAX_SUBSCRIPTIONS || messages <= 0)
+        return FAILURE;
+    if ((filters = malloc((size_t)subscriptions * BENCH_FILTER_SIZE)) == NULL)
+        return FAILURE;
+
+    MQTTTopicTrieInit(&trie);
+    for (i = 0; i < subscriptions; ++i)
+    {
+        benchFilter(&filters[i * BENCH_FILTER_SIZE], i);
+        if (MQTTTopicTrieAdd(&trie, &filters[i * BENCH_FILTER_SIZE], benchHandler) != MQSUCCESS)
+        {
+            MQTTTopicTrieClear(&trie);
+            free(filters);
+            return FAILURE;
+        }
+    }
+    name.cstring = topic;
+
+    bench_calls = 0;
+    t0 = net_clock_us();
+    for (i = 0; i < messages; ++i)
+    {
+        /* One topic in four has no subscriber */
+        snprintf(topic, sizeof(topic), "site/%d/dev/%d/temp", i % BENCH_SITES, (i % (subscriptions + subscriptions / 3)) / BENCH_SITES);
+        (void) MQTTTopicTrieMatch(&trie, &name, benchCount, NULL);
+    }
+    trie_us = net_clock_us() - t0;
+    trie_calls = bench_calls;
+
+    t0 = net_clock_us();
+    for (i = 0; i < messages; ++i)
+    {
+        snprintf(topic, sizeof(topic), "site/%d/dev/%d/temp", i % BENCH_SITES, (i % (subscriptions + subscriptions / 3)) / BENCH_SITES);
+        for (j = 0; j < subscriptions; ++j)
+        {
+            if (MQTTTopicMatches(&filters[j * BENCH_FILTER_SIZE], &name))
+                scan_calls++;
+        }
+    }
+    scan_us = net_clock_us() - t0;
+
+    msg_info("MQTTTopicTrieBench: %d filters (%u nodes), %d messages, %lu matches\n",
+            subscriptions, trie.nodes, messages, trie_calls);
+    msg_info("MQTTTopicTrieBench: trie %lu ns/msg, scan %lu ns/msg\n",
+            (unsigned long)((trie_us * 1000) / messages), (unsigned long)((scan_us * 1000) / messages));
+
+    MQTTTopicTrieClear(&trie);
+    free(filters);
+    if (trie_calls != scan_calls)
+    {
+        msg_error("MQTTTopicTrieBench: %lu matches by the scan\n", scan_calls);
+        return FAILURE;
+    }
+    return MQSUCCESS;
+}
@@ -18,16 +18,20 @@
 #include "StackTrace.h"
 
 #include <string.h>
-static int MQTTSerialize_connectLength(MQTTPacket_connectData* options);
+static int MQTTSerialize_connectLength(MQTTPacket_connectData* options, MQTTProperties* connectProperties,
+		MQTTProperties* willProperties);
 static int MQTTSerialize_zero(unsigned char* buf, int buflen, unsigned char packettype);
 
 
 /**
   * Determines the length of the MQTT connect packet that would be produced using the supplied connect options.
   * @param options the options to be used to build the connect packet
+  * @param connectProperties the MQTT 5 properties of the connect packet
+  * @param willProperties the MQTT 5 properties of the will message
   * @return the length of buffer needed to contain the serialized version of the packet
   */
-int MQTTSerialize_connectLength(MQTTPacket_connectData* options)
+int MQTTSerialize_connectLength(MQTTPacket_connectData* options, MQTTProperties* connectProperties,
+		MQTTProperties* willProperties)
 {
 	int len = 0;
 
@@ -37,10 +41,16 @@ int MQTTSerialize_connectLength(MQTTPacket_connectData* options)
 		len = 12; /* variable depending on MQTT or MQIsdp */
 	else if (options->MQTTVersion == 4)
 		len = 10;
+	else if (options->MQTTVersion == 5)
+		len = 10 + MQTTProperties_len(connectProperties);
 
 	len += MQTTstrlen(options->clientID)+2;
 	if (options->willFlag)
+	{
 		len += MQTTstrlen(options->will.topicName)+2 + MQTTstrlen(options->will.message)+2;
+		if (options->MQTTVersion == 5)
+			len += MQTTProperties_len(willProperties);
+	}
 	if (options->username.cstring || options->username.lenstring.data)
 		len += MQTTstrlen(options->username)+2;
 	if (options->password.cstring || options->password.lenstring.data)
@@ -59,6 +69,24 @@ int MQTTSerialize_connectLength(MQTTPacket_connectData* options)
   * @return serialized length, or error if 0
   */
 int MQTTSerialize_connect(unsigned char* buf, int buflen, MQTTPacket_connectData* options)
+{
+	return MQTTV5Serialize_connect(buf, buflen, options, NULL, NULL);
+}
+
+
+/**
+  * Serializes the connect options into the buffer, with the MQTT 5 properties when
+  * options->MQTTVersion is 5. They are ignored for the earlier versions.
+  * @param buf the buffer into which the packet will be serialized
+  * @param len the length in bytes of the supplied buffer
+  * @param options the options to be used to build the connect packet
+  * @param connectProperties the properties of the connect packet: session expiry interval, receive maximum,
+  *        topic alias maximum... NULL: none
+  * @param willProperties the properties of the will message. NULL: none
+  * @return serialized length, or error if 0
+  */
+int MQTTV5Serialize_connect(unsigned char* buf, int buflen, MQTTPacket_connectData* options,
+		MQTTProperties* connectProperties, MQTTProperties* willProperties)
 {
 	unsigned char *ptr = buf;
 	MQTTHeader header = {0};
@@ -67,7 +95,7 @@ int MQTTSerialize_connect(unsigned char* buf, int buflen, MQTTPacket_connectData
 	int rc = -1;
 
 	FUNC_ENTRY;
-	if (MQTTPacket_len(len = MQTTSerialize_connectLength(options)) > buflen)
+	if (MQTTPacket_len(len = MQTTSerialize_connectLength(options, connectProperties, willProperties)) > buflen)
 	{
 		rc = MQTTPACKET_BUFFER_TOO_SHORT;
 		goto exit;
@@ -79,10 +107,10 @@ int MQTTSerialize_connect(unsigned char* buf, int buflen, MQTTPacket_connectData
 
 	ptr += MQTTPacket_encode(ptr, len); /* write remaining length */
 
-	if (options->MQTTVersion == 4)
+	if (options->MQTTVersion == 4 || options->MQTTVersion == 5)
 	{
 		writeCString(&ptr, "MQTT");
-		writeChar(&ptr, (char) 4);
+		writeChar(&ptr, (char) options->MQTTVersion);
 	}
 	else
 	{
@@ -106,9 +134,13 @@ int MQTTSerialize_connect(unsigned char* buf, int buflen, MQTTPacket_connectData
 
 	writeChar(&ptr, flags.all);
 	writeInt(&ptr, options->keepAliveInterval);
+	if (options->MQTTVersion == 5)
+		MQTTProperties_write(&ptr, connectProperties);
 	writeMQTTString(&ptr, options->clientID);
 	if (options->willFlag)
 	{
+		if (options->MQTTVersion == 5)
+			MQTTProperties_write(&ptr, willProperties);
 		writeMQTTString(&ptr, options->will.topicName);
 		writeMQTTString(&ptr, options->will.message);
 	}
@@ -162,6 +194,51 @@ exit:
 }
 
 
+/**
+  * Deserializes the supplied (wire) buffer into MQTT 5 connack data
+  * @param connackProperties returned properties: the limits of the server. NULL: skipped
+  * @param sessionPresent the session present flag returned
+  * @param reasonCode returned integer value of the connack reason code
+  * @param buf the raw buffer data, of the correct length determined by the remaining length field
+  * @param len the length in bytes of the data in the supplied buffer
+  * @return error code.  1 is success, 0 is failure
+  */
+int MQTTV5Deserialize_connack(MQTTProperties* connackProperties, unsigned char* sessionPresent, unsigned char* reasonCode,
+		unsigned char* buf, int buflen)
+{
+	MQTTHeader header = {0};
+	unsigned char* curdata = buf;
+	unsigned char* enddata = NULL;
+	int rc = 0;
+	int mylen;
+	MQTTConnackFlags flags = {0};
+
+	FUNC_ENTRY;
+	header.byte = readChar(&curdata);
+	if (header.bits.type != CONNACK)
+		goto exit;
+
+	curdata += MQTTPacket_decodeBuf(curdata, &mylen); /* read remaining length */
+	enddata = curdata + mylen;
+	if (enddata - curdata < 2 || enddata > buf + buflen)
+		goto exit;
+
+	flags.all = readChar(&curdata);
+	*sessionPresent = flags.bits.sessionpresent;
+	*reasonCode = readChar(&curdata);
+
+	if (connackProperties != NULL)
+		connackProperties->count = connackProperties->length = 0;
+	if (curdata < enddata && !MQTTProperties_read(connackProperties, &curdata, enddata))
+		goto exit;
+
+	rc = 1;
+exit:
+	FUNC_EXIT_RC(rc);
+	return rc;
+}
+
+
 /**
   * Serializes a 0-length packet into the supplied buffer, ready for writing to a socket
   * @param buf the buffer into which the packet will be serialized
@@ -205,6 +282,87 @@ int MQTTSerialize_disconnect(unsigned char* buf, int buflen)
 }
 
 
+/**
+  * Serializes an MQTT 5 disconnect packet into the supplied buffer, ready for writing to a socket.
+  * The reason code and properties are left out when they are 0 and none.
+  * @param buf the buffer into which the packet will be serialized
+  * @param buflen the length in bytes of the supplied buffer, to avoid overruns
+  * @param reasonCode the reason of the disconnection
+  * @param properties the properties of the disconnect packet. NULL: none
+  * @return serialized length, or error if 0
+  */
+int MQTTV5Serialize_disconnect(unsigned char* buf, int buflen, unsigned char reasonCode, MQTTProperties* properties)
+{
+	MQTTHeader header = {0};
+	int rc = -1;
+	int rem_len = 0;
+	unsigned char *ptr = buf;
+
+	FUNC_ENTRY;
+	if (properties != NULL && properties->count > 0)
+		rem_len = 1 + MQTTProperties_len(properties);
+	else if (reasonCode != MQTTREASONCODE_NORMAL_DISCONNECTION)
+		rem_len = 1;
+	if (MQTTPacket_len(rem_len) > buflen)
+	{
+		rc = MQTTPACKET_BUFFER_TOO_SHORT;
+		goto exit;
+	}
+	header.byte = 0;
+	header.bits.type = DISCONNECT;
+	writeChar(&ptr, header.byte); /* write header */
+
+	ptr += MQTTPacket_encode(ptr, rem_len); /* write remaining length */
+	if (rem_len > 0)
+		writeChar(&ptr, reasonCode);
+	if (rem_len > 1)
+		MQTTProperties_write(&ptr, properties);
+	rc = ptr - buf;
+exit:
+	FUNC_EXIT_RC(rc);
+	return rc;
+}
+
+
+/**
+  * Deserializes the supplied (wire) buffer into MQTT 5 disconnect data, as sent by the server
+  * @param properties returned properties: reason string, server reference... NULL: skipped
+  * @param reasonCode returned integer value of the disconnect reason code
+  * @param buf the raw buffer data, of the correct length determined by the remaining length field
+  * @param buflen the length in bytes of the data in the supplied buffer
+  * @return error code.  1 is success, 0 is failure
+  */
+int MQTTV5Deserialize_disconnect(MQTTProperties* properties, unsigned char* reasonCode, unsigned char* buf, int buflen)
+{
+	MQTTHeader header = {0};
+	unsigned char* curdata = buf;
+	unsigned char* enddata = NULL;
+	int rc = 0;
+	int mylen;
+
+	FUNC_ENTRY;
+	header.byte = readChar(&curdata);
+	if (header.bits.type != DISCONNECT)
+		goto exit;
+
+	curdata += MQTTPacket_decodeBuf(curdata, &mylen); /* read remaining length */
+	enddata = curdata + mylen;
+	if (enddata > buf + buflen)
+		goto exit;
+
+	*reasonCode = (curdata < enddata) ? readChar(&curdata) : MQTTREASONCODE_NORMAL_DISCONNECTION;
+	if (properties != NULL)
+		properties->count = properties->length = 0;
+	if (curdata < enddata && !MQTTProperties_read(properties, &curdata, enddata))
+		goto exit;
+
+	rc = 1;
+exit:
+	FUNC_EXIT_RC(rc);
+	return rc;
+}
+
+
 /**
   * Serializes a disconnect packet into the supplied buffer, ready for writing to a socket
   * @param buf the buffer into which the packet will be serialized
@@ -148,3 +148,46 @@ exit:
 	return rc;
 }
 
+
+/**
+  * Serializes the MQTT 5 connack packet into the supplied buffer.
+  * @param buf the buffer into which the packet will be serialized
+  * @param buflen the length in bytes of the supplied buffer
+  * @param reasonCode the connack reason code to be used
+  * @param sessionPresent the sessionPresent flag
+  * @param connackProperties the properties of the connack packet: the limits of the server. NULL: none
+  * @return serialized length, or error if 0
+  */
+int MQTTV5Serialize_connack(unsigned char* buf, int buflen, unsigned char reasonCode, unsigned char sessionPresent,
+		MQTTProperties* connackProperties)
+{
+	MQTTHeader header = {0};
+	int rc = 0;
+	int rem_len = 2 + MQTTProperties_len(connackProperties);
+	unsigned char *ptr = buf;
+	MQTTConnackFlags flags = {0};
+
+	FUNC_ENTRY;
+	if (MQTTPacket_len(rem_len) > buflen)
+	{
+		rc = MQTTPACKET_BUFFER_TOO_SHORT;
+		goto exit;
+	}
+	header.byte = 0;
+	header.bits.type = CONNACK;
+	writeChar(&ptr, header.byte); /* write header */
+
+	ptr += MQTTPacket_encode(ptr, rem_len); /* write remaining length */
+
+	flags.all = 0;
+	flags.bits.sessionpresent = sessionPresent;
+	writeChar(&ptr, flags.all);
+	writeChar(&ptr, reasonCode);
+	MQTTProperties_write(&ptr, connackProperties);
+
+	rc = ptr - buf;
+exit:
+	FUNC_EXIT_RC(rc);
+	return rc;
+}
+
@@ -20,6 +20,9 @@
 
 #define min(a, b) ((a < b) ? 1 : 0)
 
+static int MQTTDeserialize_publishV(unsigned char* dup, int* qos, unsigned char* retained, unsigned short* packetid, MQTTString* topicName,
+		int v5, MQTTProperties* properties, unsigned char** payload, int* payloadlen, unsigned char* buf, int buflen);
+
 /**
   * Deserializes the supplied (wire) buffer into publish data
   * @param dup returned integer - the MQTT dup flag
@@ -35,6 +38,34 @@
   */
 int MQTTDeserialize_publish(unsigned char* dup, int* qos, unsigned char* retained, unsigned short* packetid, MQTTString* topicName,
 		unsigned char** payload, int* payloadlen, unsigned char* buf, int buflen)
+{
+	return MQTTDeserialize_publishV(dup, qos, retained, packetid, topicName, 0, NULL, payload, payloadlen, buf, buflen);
+}
+
+
+/**
+  * Deserializes the supplied (wire) buffer into MQTT 5 publish data
+  * @param dup returned integer - the MQTT dup flag
+  * @param qos returned integer - the MQTT QoS value
+  * @param retained returned integer - the MQTT retained flag
+  * @param packetid returned integer - the MQTT packet identifier
+  * @param topicName returned MQTTString - the MQTT topic in the publish, empty when a topic alias stands for it
+  * @param properties returned MQTTProperties - the properties of the publish: topic alias... NULL: skipped
+  * @param payload returned byte buffer - the MQTT publish payload
+  * @param payloadlen returned integer - the length of the MQTT payload
+  * @param buf the raw buffer data, of the correct length determined by the remaining length field
+  * @param buflen the length in bytes of the data in the supplied buffer
+  * @return error code.  1 is success
+  */
+int MQTTV5Deserialize_publish(unsigned char* dup, int* qos, unsigned char* retained, unsigned short* packetid, MQTTString* topicName,
+		MQTTProperties* properties, unsigned char** payload, int* payloadlen, unsigned char* buf, int buflen)
+{
+	return MQTTDeserialize_publishV(dup, qos, retained, packetid, topicName, 1, properties, payload, payloadlen, buf, buflen);
+}
+
+
+int MQTTDeserialize_publishV(unsigned char* dup, int* qos, unsigned char* retained, unsigned short* packetid, MQTTString* topicName,
+		int v5, MQTTProperties* properties, unsigned char** payload, int* payloadlen, unsigned char* buf, int buflen)
 {
 	MQTTHeader header = {0};
 	unsigned char* curdata = buf;
@@ -58,7 +89,14 @@ int MQTTDeserialize_publish(unsigned char* dup, int* qos, unsigned char* retaine
 		goto exit;
 
 	if (*qos > 0)
+	{
+		if (enddata - curdata < 2)
+			goto exit;
 		*packetid = readInt(&curdata);
+	}
+
+	if (v5 && !MQTTProperties_read(properties, &curdata, enddata))
+		goto exit;
 
 	*payloadlen = enddata - curdata;
 	*payload = curdata;
@@ -105,3 +143,48 @@ exit:
 	return rc;
 }
 
+
+/**
+  * Deserializes the supplied (wire) buffer into an MQTT 5 ack
+  * @param packettype returned integer - the MQTT packet type
+  * @param dup returned integer - the MQTT dup flag
+  * @param packetid returned integer - the MQTT packet identifier
+  * @param reasonCode returned integer - the MQTT 5 reason code, success when left out
+  * @param properties returned MQTTProperties - the properties of the ack: reason string... NULL: skipped
+  * @param buf the raw buffer data, of the correct length determined by the remaining length field
+  * @param buflen the length in bytes of the data in the supplied buffer
+  * @return error code.  1 is success, 0 is failure
+  */
+int MQTTV5Deserialize_ack(unsigned char* packettype, unsigned char* dup, unsigned short* packetid,
+		unsigned char* reasonCode, MQTTProperties* properties, unsigned char* buf, int buflen)
+{
+	MQTTHeader header = {0};
+	unsigned char* curdata = buf;
+	unsigned char* enddata = NULL;
+	int rc = 0;
+	int mylen;
+
+	FUNC_ENTRY;
+	header.byte = readChar(&curdata);
+	*dup = header.bits.dup;
+	*packettype = header.bits.type;
+
+	curdata += MQTTPacket_decodeBuf(curdata, &mylen); /* read remaining length */
+	enddata = curdata + mylen;
+
+	if (enddata - curdata < 2 || enddata > buf + buflen)
+		goto exit;
+	*packetid = readInt(&curdata);
+
+	*reasonCode = (curdata < enddata) ? readChar(&curdata) : MQTTREASONCODE_SUCCESS;
+	if (properties != NULL)
+		properties->count = properties->length = 0;
+	if (curdata < enddata && !MQTTProperties_read(properties, &curdata, enddata))
+		goto exit;
+
+	rc = 1;
+exit:
+	FUNC_EXIT_RC(rc);
+	return rc;
+}
+
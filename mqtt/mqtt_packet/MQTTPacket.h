@@ -44,7 +44,7 @@ enum msgTypes
 {
 	CONNECT = 1, CONNACK, PUBLISH, PUBACK, PUBREC, PUBREL,
 	PUBCOMP, SUBSCRIBE, SUBACK, UNSUBSCRIBE, UNSUBACK,
-	PINGREQ, PINGRESP, DISCONNECT
+	PINGREQ, PINGRESP, DISCONNECT, AUTH
 };
 
 /**
@@ -88,6 +88,8 @@ typedef struct
 
 int MQTTstrlen(MQTTString mqttstring);
 
+#include "MQTTReasonCodes.h"
+#include "MQTTProperties.h"
 #include "MQTTConnect.h"
 #include "MQTTPublish.h"
 #include "MQTTSubscribe.h"
@@ -96,6 +98,10 @@ int MQTTstrlen(MQTTString mqttstring);
 
 DLLExport int MQTTSerialize_ack(unsigned char* buf, int buflen, unsigned char type, unsigned char dup, unsigned short packetid);
 DLLExport int MQTTDeserialize_ack(unsigned char* packettype, unsigned char* dup, unsigned short* packetid, unsigned char* buf, int buflen);
+DLLExport int MQTTV5Serialize_ack(unsigned char* buf, int buflen, unsigned char type, unsigned char dup, unsigned short packetid,
+		unsigned char reasonCode, MQTTProperties* properties);
+DLLExport int MQTTV5Deserialize_ack(unsigned char* packettype, unsigned char* dup, unsigned short* packetid,
+		unsigned char* reasonCode, MQTTProperties* properties, unsigned char* buf, int buflen);
 
 int MQTTPacket_len(int rem_len);
 DLLExport int MQTTPacket_equals(MQTTString* a, char* b);
@@ -0,0 +1,370 @@
+/*
+ * MQTTProperties.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Daruin Solano
+ */
+
+#include "MQTTPacket.h"
+#include "StackTrace.h"
+
+#include <string.h>
+
+static const struct
+{
+	unsigned char identifier;
+	unsigned char type;
+} namesToTypes[] =
+{
+	{MQTTPROPERTY_CODE_PAYLOAD_FORMAT_INDICATOR, MQTTPROPERTY_TYPE_BYTE},
+	{MQTTPROPERTY_CODE_MESSAGE_EXPIRY_INTERVAL, MQTTPROPERTY_TYPE_FOUR_BYTE_INTEGER},
+	{MQTTPROPERTY_CODE_CONTENT_TYPE, MQTTPROPERTY_TYPE_UTF_8_ENCODED_STRING},
+	{MQTTPROPERTY_CODE_RESPONSE_TOPIC, MQTTPROPERTY_TYPE_UTF_8_ENCODED_STRING},
+	{MQTTPROPERTY_CODE_CORRELATION_DATA, MQTTPROPERTY_TYPE_BINARY_DATA},
+	{MQTTPROPERTY_CODE_SUBSCRIPTION_IDENTIFIER, MQTTPROPERTY_TYPE_VARIABLE_BYTE_INTEGER},
+	{MQTTPROPERTY_CODE_SESSION_EXPIRY_INTERVAL, MQTTPROPERTY_TYPE_FOUR_BYTE_INTEGER},
+	{MQTTPROPERTY_CODE_ASSIGNED_CLIENT_IDENTIFIER, MQTTPROPERTY_TYPE_UTF_8_ENCODED_STRING},
+	{MQTTPROPERTY_CODE_SERVER_KEEP_ALIVE, MQTTPROPERTY_TYPE_TWO_BYTE_INTEGER},
+	{MQTTPROPERTY_CODE_AUTHENTICATION_METHOD, MQTTPROPERTY_TYPE_UTF_8_ENCODED_STRING},
+	{MQTTPROPERTY_CODE_AUTHENTICATION_DATA, MQTTPROPERTY_TYPE_BINARY_DATA},
+	{MQTTPROPERTY_CODE_REQUEST_PROBLEM_INFORMATION, MQTTPROPERTY_TYPE_BYTE},
+	{MQTTPROPERTY_CODE_WILL_DELAY_INTERVAL, MQTTPROPERTY_TYPE_FOUR_BYTE_INTEGER},
+	{MQTTPROPERTY_CODE_REQUEST_RESPONSE_INFORMATION, MQTTPROPERTY_TYPE_BYTE},
+	{MQTTPROPERTY_CODE_RESPONSE_INFORMATION, MQTTPROPERTY_TYPE_UTF_8_ENCODED_STRING},
+	{MQTTPROPERTY_CODE_SERVER_REFERENCE, MQTTPROPERTY_TYPE_UTF_8_ENCODED_STRING},
+	{MQTTPROPERTY_CODE_REASON_STRING, MQTTPROPERTY_TYPE_UTF_8_ENCODED_STRING},
+	{MQTTPROPERTY_CODE_RECEIVE_MAXIMUM, MQTTPROPERTY_TYPE_TWO_BYTE_INTEGER},
+	{MQTTPROPERTY_CODE_TOPIC_ALIAS_MAXIMUM, MQTTPROPERTY_TYPE_TWO_BYTE_INTEGER},
+	{MQTTPROPERTY_CODE_TOPIC_ALIAS, MQTTPROPERTY_TYPE_TWO_BYTE_INTEGER},
+	{MQTTPROPERTY_CODE_MAXIMUM_QOS, MQTTPROPERTY_TYPE_BYTE},
+	{MQTTPROPERTY_CODE_RETAIN_AVAILABLE, MQTTPROPERTY_TYPE_BYTE},
+	{MQTTPROPERTY_CODE_USER_PROPERTY, MQTTPROPERTY_TYPE_UTF_8_STRING_PAIR},
+	{MQTTPROPERTY_CODE_MAXIMUM_PACKET_SIZE, MQTTPROPERTY_TYPE_FOUR_BYTE_INTEGER},
+	{MQTTPROPERTY_CODE_WILDCARD_SUBSCRIPTION_AVAILABLE, MQTTPROPERTY_TYPE_BYTE},
+	{MQTTPROPERTY_CODE_SUBSCRIPTION_IDENTIFIERS_AVAILABLE, MQTTPROPERTY_TYPE_BYTE},
+	{MQTTPROPERTY_CODE_SHARED_SUBSCRIPTION_AVAILABLE, MQTTPROPERTY_TYPE_BYTE}
+};
+
+
+/**
+  * Gives the type of the value of a property
+  * @param identifier the property identifier
+  * @return one of enum MQTTPropertyTypes, -1 if the identifier is unknown
+  */
+int MQTTProperty_getType(int identifier)
+{
+	int i;
+
+	for (i = 0; i < (int)(sizeof(namesToTypes) / sizeof(namesToTypes[0])); ++i)
+	{
+		if (namesToTypes[i].identifier == identifier)
+			return namesToTypes[i].type;
+	}
+	return -1;
+}
+
+
+/* Length of the variable byte integer encoding of value */
+static int MQTTPacket_VBIlen(unsigned int value)
+{
+	if (value < 128)
+		return 1;
+	if (value < 16384)
+		return 2;
+	if (value < 2097152)
+		return 3;
+	return 4;
+}
+
+
+/* Serialized length of a property, or -1 if it cannot be serialized */
+static int MQTTProperty_len(const MQTTProperty* prop)
+{
+	int len = 1; /* the identifier, a variable byte integer below 128 */
+
+	switch (MQTTProperty_getType(prop->identifier))
+	{
+		case MQTTPROPERTY_TYPE_BYTE:
+			return len + 1;
+		case MQTTPROPERTY_TYPE_TWO_BYTE_INTEGER:
+			return len + 2;
+		case MQTTPROPERTY_TYPE_FOUR_BYTE_INTEGER:
+			return len + 4;
+		case MQTTPROPERTY_TYPE_VARIABLE_BYTE_INTEGER:
+			if (prop->value.integer4 > 268435455)
+				return -1;
+			return len + MQTTPacket_VBIlen(prop->value.integer4);
+		case MQTTPROPERTY_TYPE_BINARY_DATA:
+		case MQTTPROPERTY_TYPE_UTF_8_ENCODED_STRING:
+			if (prop->value.data.len < 0 || prop->value.data.len > 65535)
+				return -1;
+			return len + 2 + prop->value.data.len;
+		case MQTTPROPERTY_TYPE_UTF_8_STRING_PAIR:
+			if (prop->value.data.len < 0 || prop->value.data.len > 65535 ||
+				prop->value.value.len < 0 || prop->value.value.len > 65535)
+				return -1;
+			return len + 2 + prop->value.data.len + 2 + prop->value.value.len;
+		default:
+			return -1;
+	}
+}
+
+
+/**
+  * Determines the serialized length of properties, their length field included
+  * @param props the properties. NULL: none.
+  * @return the length of buffer needed to contain the serialized properties
+  */
+int MQTTProperties_len(MQTTProperties* props)
+{
+	if (props == NULL)
+		return 1;
+	return MQTTPacket_VBIlen(props->length) + props->length;
+}
+
+
+/**
+  * Appends a property to the array of the properties. Its string data is not copied.
+  * @param props the properties
+  * @param prop the property to add
+  * @return 0 on success, -1 if the array is full or the property invalid
+  */
+int MQTTProperties_add(MQTTProperties* props, const MQTTProperty* prop)
+{
+	int len = MQTTProperty_len(prop);
+	int rc = -1;
+
+	FUNC_ENTRY;
+	if (len < 0 || props->count >= props->max_count)
+		goto exit;
+	props->array[props->count++] = *prop;
+	props->length += len;
+	rc = 0;
+exit:
+	FUNC_EXIT_RC(rc);
+	return rc;
+}
+
+
+/**
+  * Finds a property by its identifier
+  * @param props the properties. NULL: none.
+  * @param identifier the property identifier
+  * @return the first property of that identifier, or NULL
+  */
+MQTTProperty* MQTTProperties_find(MQTTProperties* props, int identifier)
+{
+	int i;
+
+	if (props == NULL)
+		return NULL;
+	for (i = 0; i < props->count; ++i)
+	{
+		if (props->array[i].identifier == identifier)
+			return &props->array[i];
+	}
+	return NULL;
+}
+
+
+static void writeInt4(unsigned char** pptr, unsigned int anInt)
+{
+	**pptr = (unsigned char)(anInt >> 24);
+	(*pptr)++;
+	**pptr = (unsigned char)(anInt >> 16);
+	(*pptr)++;
+	**pptr = (unsigned char)(anInt >> 8);
+	(*pptr)++;
+	**pptr = (unsigned char)anInt;
+	(*pptr)++;
+}
+
+
+static unsigned int readInt4(unsigned char** pptr)
+{
+	unsigned char* ptr = *pptr;
+	unsigned int value = ((unsigned int)ptr[0] << 24) | ((unsigned int)ptr[1] << 16) | (ptr[2] << 8) | ptr[3];
+
+	*pptr += 4;
+	return value;
+}
+
+
+static void writeLenString(unsigned char** pptr, MQTTLenString string)
+{
+	writeInt(pptr, string.len);
+	if (string.len > 0)
+	{
+		memcpy(*pptr, string.data, string.len);
+		*pptr += string.len;
+	}
+}
+
+
+/**
+  * Serializes properties, preceded by their length
+  * @param pptr pointer to the output buffer - incremented by the number of bytes written
+  * @param properties the properties. NULL: none, a zero length is written.
+  * @return the number of bytes written
+  */
+int MQTTProperties_write(unsigned char** pptr, MQTTProperties* properties)
+{
+	unsigned char* start = *pptr;
+	int i;
+
+	FUNC_ENTRY;
+	if (properties == NULL)
+	{
+		writeChar(pptr, 0);
+		goto exit;
+	}
+	*pptr += MQTTPacket_encode(*pptr, properties->length);
+	for (i = 0; i < properties->count; ++i)
+	{
+		MQTTProperty* prop = &properties->array[i];
+
+		*pptr += MQTTPacket_encode(*pptr, prop->identifier);
+		switch (MQTTProperty_getType(prop->identifier))
+		{
+			case MQTTPROPERTY_TYPE_BYTE:
+				writeChar(pptr, prop->value.byte);
+				break;
+			case MQTTPROPERTY_TYPE_TWO_BYTE_INTEGER:
+				writeInt(pptr, prop->value.integer2);
+				break;
+			case MQTTPROPERTY_TYPE_FOUR_BYTE_INTEGER:
+				writeInt4(pptr, prop->value.integer4);
+				break;
+			case MQTTPROPERTY_TYPE_VARIABLE_BYTE_INTEGER:
+				*pptr += MQTTPacket_encode(*pptr, prop->value.integer4);
+				break;
+			case MQTTPROPERTY_TYPE_BINARY_DATA:
+			case MQTTPROPERTY_TYPE_UTF_8_ENCODED_STRING:
+				writeLenString(pptr, prop->value.data);
+				break;
+			case MQTTPROPERTY_TYPE_UTF_8_STRING_PAIR:
+				writeLenString(pptr, prop->value.data);
+				writeLenString(pptr, prop->value.value);
+				break;
+		}
+	}
+exit:
+	FUNC_EXIT_RC(*pptr - start);
+	return *pptr - start;
+}
+
+
+/* Reads a variable byte integer, within enddata. Returns 1 on success, 0 if malformed. */
+static int readVBI(unsigned char** pptr, unsigned char* enddata, unsigned int* value)
+{
+	unsigned int multiplier = 1;
+	int len = 0;
+
+	*value = 0;
+	do
+	{
+		if (++len > 4 || *pptr >= enddata)
+			return 0;
+		*value += (**pptr & 127) * multiplier;
+		multiplier *= 128;
+	} while ((*(*pptr)++ & 128) != 0);
+	return 1;
+}
+
+
+/**
+  * Deserializes properties, preceded by their length. The strings point into the buffer.
+  * When the array is full, the properties which do not fit are skipped, and a user property
+  * gives way to any other property.
+  * @param properties the properties read. NULL: they are skipped.
+  * @param pptr pointer to the input buffer - incremented by the number of bytes used
+  * @param enddata pointer to the end of the data: do not read beyond
+  * @return 1 if successful, 0 if the properties are malformed
+  */
+int MQTTProperties_read(MQTTProperties* properties, unsigned char** pptr, unsigned char* enddata)
+{
+	unsigned int length = 0;
+	unsigned char* end;
+	int rc = 0;
+
+	FUNC_ENTRY;
+	if (!readVBI(pptr, enddata, &length) || (unsigned int)(enddata - *pptr) < length)
+		goto exit;
+	end = *pptr + length;
+	if (properties == NULL)
+	{
+		*pptr = end;
+		rc = 1;
+		goto exit;
+	}
+	properties->count = 0;
+	properties->length = length;
+	while (*pptr < end)
+	{
+		MQTTProperty prop;
+		MQTTString string = MQTTString_initializer;
+		unsigned int identifier = 0;
+		int i;
+
+		memset(&prop, 0, sizeof(prop));
+		if (!readVBI(pptr, end, &identifier))
+			goto exit;
+		prop.identifier = identifier;
+		switch (MQTTProperty_getType(identifier))
+		{
+			case MQTTPROPERTY_TYPE_BYTE:
+				if (end - *pptr < 1)
+					goto exit;
+				prop.value.byte = readChar(pptr);
+				break;
+			case MQTTPROPERTY_TYPE_TWO_BYTE_INTEGER:
+				if (end - *pptr < 2)
+					goto exit;
+				prop.value.integer2 = readInt(pptr);
+				break;
+			case MQTTPROPERTY_TYPE_FOUR_BYTE_INTEGER:
+				if (end - *pptr < 4)
+					goto exit;
+				prop.value.integer4 = readInt4(pptr);
+				break;
+			case MQTTPROPERTY_TYPE_VARIABLE_BYTE_INTEGER:
+				if (!readVBI(pptr, end, &prop.value.integer4))
+					goto exit;
+				break;
+			case MQTTPROPERTY_TYPE_BINARY_DATA:
+			case MQTTPROPERTY_TYPE_UTF_8_ENCODED_STRING:
+				if (!readMQTTLenString(&string, pptr, end))
+					goto exit;
+				prop.value.data = string.lenstring;
+				break;
+			case MQTTPROPERTY_TYPE_UTF_8_STRING_PAIR:
+				if (!readMQTTLenString(&string, pptr, end))
+					goto exit;
+				prop.value.data = string.lenstring;
+				if (!readMQTTLenString(&string, pptr, end))
+					goto exit;
+				prop.value.value = string.lenstring;
+				break;
+			default:
+				goto exit; /* unknown identifier: the length of its value is unknown too */
+		}
+
+		if (properties->count < properties->max_count)
+			properties->array[properties->count++] = prop;
+		else if (identifier != MQTTPROPERTY_CODE_USER_PROPERTY)
+		{
+			for (i = properties->count - 1; i >= 0; --i)
+			{
+				if (properties->array[i].identifier == MQTTPROPERTY_CODE_USER_PROPERTY)
+				{
+					properties->array[i] = prop;
+					break;
+				}
+			}
+		}
+	}
+	rc = 1;
+exit:
+	FUNC_EXIT_RC(rc);
+	return rc;
+}
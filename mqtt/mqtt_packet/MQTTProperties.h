@@ -0,0 +1,103 @@
+/*
+ * MQTTProperties.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Daruin Solano
+ */
+
+#if !defined(MQTTPROPERTIES_H_)
+#define MQTTPROPERTIES_H_
+
+#if !defined(DLLImport)
+  #define DLLImport
+#endif
+#if !defined(DLLExport)
+  #define DLLExport
+#endif
+
+/**
+ * The MQTT 5 property identifiers.
+ */
+enum MQTTPropertyCodes {
+	MQTTPROPERTY_CODE_PAYLOAD_FORMAT_INDICATOR = 1,
+	MQTTPROPERTY_CODE_MESSAGE_EXPIRY_INTERVAL = 2,
+	MQTTPROPERTY_CODE_CONTENT_TYPE = 3,
+	MQTTPROPERTY_CODE_RESPONSE_TOPIC = 8,
+	MQTTPROPERTY_CODE_CORRELATION_DATA = 9,
+	MQTTPROPERTY_CODE_SUBSCRIPTION_IDENTIFIER = 11,
+	MQTTPROPERTY_CODE_SESSION_EXPIRY_INTERVAL = 17,
+	MQTTPROPERTY_CODE_ASSIGNED_CLIENT_IDENTIFIER = 18,
+	MQTTPROPERTY_CODE_SERVER_KEEP_ALIVE = 19,
+	MQTTPROPERTY_CODE_AUTHENTICATION_METHOD = 21,
+	MQTTPROPERTY_CODE_AUTHENTICATION_DATA = 22,
+	MQTTPROPERTY_CODE_REQUEST_PROBLEM_INFORMATION = 23,
+	MQTTPROPERTY_CODE_WILL_DELAY_INTERVAL = 24,
+	MQTTPROPERTY_CODE_REQUEST_RESPONSE_INFORMATION = 25,
+	MQTTPROPERTY_CODE_RESPONSE_INFORMATION = 26,
+	MQTTPROPERTY_CODE_SERVER_REFERENCE = 28,
+	MQTTPROPERTY_CODE_REASON_STRING = 31,
+	MQTTPROPERTY_CODE_RECEIVE_MAXIMUM = 33,
+	MQTTPROPERTY_CODE_TOPIC_ALIAS_MAXIMUM = 34,
+	MQTTPROPERTY_CODE_TOPIC_ALIAS = 35,
+	MQTTPROPERTY_CODE_MAXIMUM_QOS = 36,
+	MQTTPROPERTY_CODE_RETAIN_AVAILABLE = 37,
+	MQTTPROPERTY_CODE_USER_PROPERTY = 38,
+	MQTTPROPERTY_CODE_MAXIMUM_PACKET_SIZE = 39,
+	MQTTPROPERTY_CODE_WILDCARD_SUBSCRIPTION_AVAILABLE = 40,
+	MQTTPROPERTY_CODE_SUBSCRIPTION_IDENTIFIERS_AVAILABLE = 41,
+	MQTTPROPERTY_CODE_SHARED_SUBSCRIPTION_AVAILABLE = 42
+};
+
+/**
+ * The types of the property values.
+ */
+enum MQTTPropertyTypes {
+	MQTTPROPERTY_TYPE_BYTE,
+	MQTTPROPERTY_TYPE_TWO_BYTE_INTEGER,
+	MQTTPROPERTY_TYPE_FOUR_BYTE_INTEGER,
+	MQTTPROPERTY_TYPE_VARIABLE_BYTE_INTEGER,
+	MQTTPROPERTY_TYPE_BINARY_DATA,
+	MQTTPROPERTY_TYPE_UTF_8_ENCODED_STRING,
+	MQTTPROPERTY_TYPE_UTF_8_STRING_PAIR
+};
+
+/**
+ * A property: its identifier and its value, of the type of the identifier.
+ * The data of the strings is not copied: a deserialized property points into the packet.
+ */
+typedef struct
+{
+	int identifier; /**< one of enum MQTTPropertyCodes */
+	union {
+		unsigned char byte;
+		unsigned short integer2;
+		unsigned int integer4; /**< four byte and variable byte integers */
+		struct {
+			MQTTLenString data;  /**< binary data, string, or name of a string pair */
+			MQTTLenString value; /**< value of a string pair */
+		};
+	} value;
+} MQTTProperty;
+
+/**
+ * The properties of a packet, in an array provided by the caller.
+ */
+typedef struct MQTTProperties
+{
+	int count;     /**< the number of properties in the array */
+	int max_count; /**< the size of the array */
+	int length;    /**< the serialized length of the properties, their length field excluded */
+	MQTTProperty* array;
+} MQTTProperties;
+
+#define MQTTProperties_initializer {0, 0, 0, NULL}
+
+DLLExport int MQTTProperty_getType(int identifier);
+DLLExport int MQTTProperties_len(MQTTProperties* props);
+DLLExport int MQTTProperties_add(MQTTProperties* props, const MQTTProperty* prop);
+DLLExport MQTTProperty* MQTTProperties_find(MQTTProperties* props, int identifier);
+
+int MQTTProperties_write(unsigned char** pptr, MQTTProperties* properties);
+int MQTTProperties_read(MQTTProperties* properties, unsigned char** pptr, unsigned char* enddata);
+
+#endif /* MQTTPROPERTIES_H_ */
@@ -20,20 +20,25 @@
 
 #include <string.h>
 
-static int MQTTSerialize_publishLength(int qos, MQTTString topicName, int payloadlen);
+static int MQTTSerialize_publishLength(int qos, MQTTString topicName, int propslen, int payloadlen);
+static int MQTTSerialize_publishV(unsigned char* buf, int buflen, unsigned char dup, int qos, unsigned char retained, unsigned short packetid,
+		MQTTString topicName, int v5, MQTTProperties* properties, unsigned char* payload, int payloadlen);
+static int MQTTSerialize_publishHeaderV(unsigned char* buf, int buflen, unsigned char dup, int qos, unsigned char retained, unsigned short packetid,
+		MQTTString topicName, int v5, MQTTProperties* properties, int payloadlen);
 
 /**
   * Determines the length of the MQTT publish packet that would be produced using the supplied parameters
   * @param qos the MQTT QoS of the publish (packetid is omitted for QoS 0)
   * @param topicName the topic name to be used in the publish  
+  * @param propslen the length of the MQTT 5 properties, 0 for MQTT 3.1.1
   * @param payloadlen the length of the payload to be sent
   * @return the length of buffer needed to contain the serialized version of the packet
   */
-int MQTTSerialize_publishLength(int qos, MQTTString topicName, int payloadlen)
+int MQTTSerialize_publishLength(int qos, MQTTString topicName, int propslen, int payloadlen)
 {
 	int len = 0;
 
-	len += 2 + MQTTstrlen(topicName) + payloadlen;
+	len += 2 + MQTTstrlen(topicName) + propslen + payloadlen;
 	if (qos > 0)
 		len += 2; /* packetid */
 	return len;
@@ -55,6 +60,99 @@ int MQTTSerialize_publishLength(int qos, MQTTString topicName, int payloadlen)
   */
 int MQTTSerialize_publish(unsigned char* buf, int buflen, unsigned char dup, int qos, unsigned char retained, unsigned short packetid,
 		MQTTString topicName, unsigned char* payload, int payloadlen)
+{
+	return MQTTSerialize_publishV(buf, buflen, dup, qos, retained, packetid, topicName, 0, NULL, payload, payloadlen);
+}
+
+
+/**
+  * Serializes the supplied MQTT 5 publish data into the supplied buffer, ready for sending
+  * @param buf the buffer into which the packet will be serialized
+  * @param buflen the length in bytes of the supplied buffer
+  * @param dup integer - the MQTT dup flag
+  * @param qos integer - the MQTT QoS value
+  * @param retained integer - the MQTT retained flag
+  * @param packetid integer - the MQTT packet identifier
+  * @param topicName MQTTString - the MQTT topic in the publish, empty when a topic alias stands for it
+  * @param properties MQTTProperties - the properties of the publish: topic alias... NULL: none
+  * @param payload byte buffer - the MQTT publish payload
+  * @param payloadlen integer - the length of the MQTT payload
+  * @return the length of the serialized data.  <= 0 indicates error
+  */
+int MQTTV5Serialize_publish(unsigned char* buf, int buflen, unsigned char dup, int qos, unsigned char retained, unsigned short packetid,
+		MQTTString topicName, MQTTProperties* properties, unsigned char* payload, int payloadlen)
+{
+	return MQTTSerialize_publishV(buf, buflen, dup, qos, retained, packetid, topicName, 1, properties, payload, payloadlen);
+}
+
+
+int MQTTSerialize_publishV(unsigned char* buf, int buflen, unsigned char dup, int qos, unsigned char retained, unsigned short packetid,
+		MQTTString topicName, int v5, MQTTProperties* properties, unsigned char* payload, int payloadlen)
+{
+	int rc = 0;
+
+	FUNC_ENTRY;
+	if (MQTTPacket_len(MQTTSerialize_publishLength(qos, topicName, v5 ? MQTTProperties_len(properties) : 0, payloadlen)) > buflen)
+	{
+		rc = MQTTPACKET_BUFFER_TOO_SHORT;
+		goto exit;
+	}
+
+	if ((rc = MQTTSerialize_publishHeaderV(buf, buflen, dup, qos, retained, packetid, topicName, v5, properties, payloadlen)) > 0)
+	{
+		memcpy(buf + rc, payload, payloadlen);
+		rc += payloadlen;
+	}
+
+exit:
+	FUNC_EXIT_RC(rc);
+	return rc;
+}
+
+
+/**
+  * Serializes the publish packet up to the payload: fixed header, topic and packet identifier.
+  * The payloadlen bytes of payload are to be sent right after it, from wherever they are.
+  * @param buf the buffer into which the header will be serialized
+  * @param buflen the length in bytes of the supplied buffer
+  * @param dup integer - the MQTT dup flag
+  * @param qos integer - the MQTT QoS value
+  * @param retained integer - the MQTT retained flag
+  * @param packetid integer - the MQTT packet identifier
+  * @param topicName MQTTString - the MQTT topic in the publish
+  * @param payloadlen integer - the length of the MQTT payload which follows
+  * @return the length of the serialized header.  <= 0 indicates error
+  */
+int MQTTSerialize_publishHeader(unsigned char* buf, int buflen, unsigned char dup, int qos, unsigned char retained, unsigned short packetid,
+		MQTTString topicName, int payloadlen)
+{
+	return MQTTSerialize_publishHeaderV(buf, buflen, dup, qos, retained, packetid, topicName, 0, NULL, payloadlen);
+}
+
+
+/**
+  * Serializes the MQTT 5 publish packet up to the payload: fixed header, topic, packet identifier
+  * and properties. The payloadlen bytes of payload are to be sent right after it.
+  * @param buf the buffer into which the header will be serialized
+  * @param buflen the length in bytes of the supplied buffer
+  * @param dup integer - the MQTT dup flag
+  * @param qos integer - the MQTT QoS value
+  * @param retained integer - the MQTT retained flag
+  * @param packetid integer - the MQTT packet identifier
+  * @param topicName MQTTString - the MQTT topic in the publish, empty when a topic alias stands for it
+  * @param properties MQTTProperties - the properties of the publish: topic alias... NULL: none
+  * @param payloadlen integer - the length of the MQTT payload which follows
+  * @return the length of the serialized header.  <= 0 indicates error
+  */
+int MQTTV5Serialize_publishHeader(unsigned char* buf, int buflen, unsigned char dup, int qos, unsigned char retained, unsigned short packetid,
+		MQTTString topicName, MQTTProperties* properties, int payloadlen)
+{
+	return MQTTSerialize_publishHeaderV(buf, buflen, dup, qos, retained, packetid, topicName, 1, properties, payloadlen);
+}
+
+
+int MQTTSerialize_publishHeaderV(unsigned char* buf, int buflen, unsigned char dup, int qos, unsigned char retained, unsigned short packetid,
+		MQTTString topicName, int v5, MQTTProperties* properties, int payloadlen)
 {
 	unsigned char *ptr = buf;
 	MQTTHeader header = {0};
@@ -62,7 +160,8 @@ int MQTTSerialize_publish(unsigned char* buf, int buflen, unsigned char dup, int
 	int rc = 0;
 
 	FUNC_ENTRY;
-	if (MQTTPacket_len(rem_len = MQTTSerialize_publishLength(qos, topicName, payloadlen)) > buflen)
+	rem_len = MQTTSerialize_publishLength(qos, topicName, v5 ? MQTTProperties_len(properties) : 0, payloadlen);
+	if (payloadlen < 0 || rem_len > 268435455 || MQTTPacket_len(rem_len) - payloadlen > buflen)
 	{
 		rc = MQTTPACKET_BUFFER_TOO_SHORT;
 		goto exit;
@@ -81,8 +180,8 @@ int MQTTSerialize_publish(unsigned char* buf, int buflen, unsigned char dup, int
 	if (qos > 0)
 		writeInt(&ptr, packetid);
 
-	memcpy(ptr, payload, payloadlen);
-	ptr += payloadlen;
+	if (v5)
+		MQTTProperties_write(&ptr, properties);
 
 	rc = ptr - buf;
 
@@ -103,13 +202,37 @@ exit:
   * @return serialized length, or error if 0
   */
 int MQTTSerialize_ack(unsigned char* buf, int buflen, unsigned char packettype, unsigned char dup, unsigned short packetid)
+{
+	return MQTTV5Serialize_ack(buf, buflen, packettype, dup, packetid, MQTTREASONCODE_SUCCESS, NULL);
+}
+
+
+/**
+  * Serializes the MQTT 5 ack packet into the supplied buffer. The reason code and properties
+  * are left out when they are success and none: the packet is then the MQTT 3.1.1 one.
+  * @param buf the buffer into which the packet will be serialized
+  * @param buflen the length in bytes of the supplied buffer
+  * @param type the MQTT packet type
+  * @param dup the MQTT dup flag
+  * @param packetid the MQTT packet identifier
+  * @param reasonCode the MQTT 5 reason code
+  * @param properties the MQTT 5 properties. NULL: none
+  * @return serialized length, or error if 0
+  */
+int MQTTV5Serialize_ack(unsigned char* buf, int buflen, unsigned char packettype, unsigned char dup, unsigned short packetid,
+		unsigned char reasonCode, MQTTProperties* properties)
 {
 	MQTTHeader header = {0};
 	int rc = 0;
+	int rem_len = 2;
 	unsigned char *ptr = buf;
 
 	FUNC_ENTRY;
-	if (buflen < 4)
+	if (properties != NULL && properties->count > 0)
+		rem_len = 3 + MQTTProperties_len(properties);
+	else if (reasonCode != MQTTREASONCODE_SUCCESS)
+		rem_len = 3;
+	if (MQTTPacket_len(rem_len) > buflen)
 	{
 		rc = MQTTPACKET_BUFFER_TOO_SHORT;
 		goto exit;
@@ -119,8 +242,12 @@ int MQTTSerialize_ack(unsigned char* buf, int buflen, unsigned char packettype,
 	header.bits.qos = (packettype == PUBREL) ? 1 : 0;
 	writeChar(&ptr, header.byte); /* write header */
 
-	ptr += MQTTPacket_encode(ptr, 2); /* write remaining length */
+	ptr += MQTTPacket_encode(ptr, rem_len); /* write remaining length */
 	writeInt(&ptr, packetid);
+	if (rem_len > 2)
+		writeChar(&ptr, reasonCode);
+	if (rem_len > 3)
+		MQTTProperties_write(&ptr, properties);
 	rc = ptr - buf;
 exit:
 	FUNC_EXIT_RC(rc);
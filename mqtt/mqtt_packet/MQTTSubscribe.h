@@ -35,5 +35,26 @@ DLLExport int MQTTSerialize_suback(unsigned char* buf, int buflen, unsigned shor
 
 DLLExport int MQTTDeserialize_suback(unsigned short* packetid, int maxcount, int* count, int grantedQoSs[], unsigned char* buf, int len);
 
+/**
+ * The MQTT 5 subscription options of a topic filter, besides its QoS.
+ */
+typedef struct
+{
+	unsigned char noLocal;           /**< 1: not to receive the messages published by this client */
+	unsigned char retainAsPublished; /**< 1: to keep the retained flag of the messages as published */
+	unsigned char retainHandling;    /**< 0: send the retained messages, 1: only for a new subscription, 2: not */
+} MQTTSubscribe_options;
+
+#define MQTTSubscribe_options_initializer {0, 0, 0}
+
+DLLExport int MQTTV5Serialize_subscribe(unsigned char* buf, int buflen, unsigned char dup, unsigned short packetid,
+		MQTTProperties* properties, int count, MQTTString topicFilters[], int requestedQoSs[], MQTTSubscribe_options options[]);
+
+DLLExport int MQTTV5Serialize_suback(unsigned char* buf, int buflen, unsigned short packetid, MQTTProperties* properties,
+		int count, int* reasonCodes);
+
+DLLExport int MQTTV5Deserialize_suback(MQTTProperties* properties, unsigned short* packetid, int maxcount, int* count,
+		int reasonCodes[], unsigned char* buf, int len);
+
 
 #endif /* MQTTSUBSCRIBE_H_ */
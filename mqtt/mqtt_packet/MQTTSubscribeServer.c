@@ -110,3 +110,46 @@ exit:
 }
 
 
+/**
+  * Serializes the supplied MQTT 5 suback data into the supplied buffer, ready for sending
+  * @param buf the buffer into which the packet will be serialized
+  * @param buflen the length in bytes of the supplied buffer
+  * @param packetid integer - the MQTT packet identifier
+  * @param properties - the properties of the suback packet. NULL: none
+  * @param count - number of members in the reasonCodes array
+  * @param reasonCodes - array of reason codes: granted QoS, or failures
+  * @return the length of the serialized data.  <= 0 indicates error
+  */
+int MQTTV5Serialize_suback(unsigned char* buf, int buflen, unsigned short packetid, MQTTProperties* properties,
+		int count, int* reasonCodes)
+{
+	MQTTHeader header = {0};
+	int rc = -1;
+	int rem_len = 2 + MQTTProperties_len(properties) + count;
+	unsigned char *ptr = buf;
+	int i;
+
+	FUNC_ENTRY;
+	if (MQTTPacket_len(rem_len) > buflen)
+	{
+		rc = MQTTPACKET_BUFFER_TOO_SHORT;
+		goto exit;
+	}
+	header.byte = 0;
+	header.bits.type = SUBACK;
+	writeChar(&ptr, header.byte); /* write header */
+
+	ptr += MQTTPacket_encode(ptr, rem_len); /* write remaining length */
+
+	writeInt(&ptr, packetid);
+	MQTTProperties_write(&ptr, properties);
+
+	for (i = 0; i < count; ++i)
+		writeChar(&ptr, reasonCodes[i]);
+
+	rc = ptr - buf;
+exit:
+	FUNC_EXIT_RC(rc);
+	return rc;
+}
+
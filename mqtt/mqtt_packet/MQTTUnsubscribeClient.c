@@ -18,18 +18,21 @@
 #include "StackTrace.h"
 
 #include <string.h>
-static int MQTTSerialize_unsubscribeLength(int count, MQTTString topicFilters[]);
+static int MQTTSerialize_unsubscribeLength(int count, MQTTString topicFilters[], int propslen);
+static int MQTTSerialize_unsubscribeV(unsigned char* buf, int buflen, unsigned char dup, unsigned short packetid, int v5,
+		MQTTProperties* properties, int count, MQTTString topicFilters[]);
 
 /**
   * Determines the length of the MQTT unsubscribe packet that would be produced using the supplied parameters
   * @param count the number of topic filter strings in topicFilters
   * @param topicFilters the array of topic filter strings to be used in the publish
+  * @param propslen the length of the MQTT 5 properties, 0 for MQTT 3.1.1
   * @return the length of buffer needed to contain the serialized version of the packet
   */
-int MQTTSerialize_unsubscribeLength(int count, MQTTString topicFilters[])
+int MQTTSerialize_unsubscribeLength(int count, MQTTString topicFilters[], int propslen)
 {
 	int i;
-	int len = 2; /* packetid */
+	int len = 2 + propslen; /* packetid */
 
 	for (i = 0; i < count; ++i)
 		len += 2 + MQTTstrlen(topicFilters[i]); /* length + topic*/
@@ -49,6 +52,31 @@ int MQTTSerialize_unsubscribeLength(int count, MQTTString topicFilters[])
   */
 int MQTTSerialize_unsubscribe(unsigned char* buf, int buflen, unsigned char dup, unsigned short packetid,
 		int count, MQTTString topicFilters[])
+{
+	return MQTTSerialize_unsubscribeV(buf, buflen, dup, packetid, 0, NULL, count, topicFilters);
+}
+
+
+/**
+  * Serializes the supplied MQTT 5 unsubscribe data into the supplied buffer, ready for sending
+  * @param buf the raw buffer data, of the correct length determined by the remaining length field
+  * @param buflen the length in bytes of the data in the supplied buffer
+  * @param dup integer - the MQTT dup flag
+  * @param packetid integer - the MQTT packet identifier
+  * @param properties - the properties of the unsubscribe. NULL: none
+  * @param count - number of members in the topicFilters array
+  * @param topicFilters - array of topic filter names
+  * @return the length of the serialized data.  <= 0 indicates error
+  */
+int MQTTV5Serialize_unsubscribe(unsigned char* buf, int buflen, unsigned char dup, unsigned short packetid,
+		MQTTProperties* properties, int count, MQTTString topicFilters[])
+{
+	return MQTTSerialize_unsubscribeV(buf, buflen, dup, packetid, 1, properties, count, topicFilters);
+}
+
+
+int MQTTSerialize_unsubscribeV(unsigned char* buf, int buflen, unsigned char dup, unsigned short packetid, int v5,
+		MQTTProperties* properties, int count, MQTTString topicFilters[])
 {
 	unsigned char *ptr = buf;
 	MQTTHeader header = {0};
@@ -57,7 +85,8 @@ int MQTTSerialize_unsubscribe(unsigned char* buf, int buflen, unsigned char dup,
 	int i = 0;
 
 	FUNC_ENTRY;
-	if (MQTTPacket_len(rem_len = MQTTSerialize_unsubscribeLength(count, topicFilters)) > buflen)
+	if (MQTTPacket_len(rem_len = MQTTSerialize_unsubscribeLength(count, topicFilters,
+			v5 ? MQTTProperties_len(properties) : 0)) > buflen)
 	{
 		rc = MQTTPACKET_BUFFER_TOO_SHORT;
 		goto exit;
@@ -73,6 +102,9 @@ int MQTTSerialize_unsubscribe(unsigned char* buf, int buflen, unsigned char dup,
 
 	writeInt(&ptr, packetid);
 
+	if (v5)
+		MQTTProperties_write(&ptr, properties);
+
 	for (i = 0; i < count; ++i)
 		writeMQTTString(&ptr, topicFilters[i]);
 
@@ -105,3 +137,51 @@ int MQTTDeserialize_unsuback(unsigned short* packetid, unsigned char* buf, int b
 }
 
 
+/**
+  * Deserializes the supplied (wire) buffer into MQTT 5 unsuback data
+  * @param properties returned properties - reason string... NULL: skipped
+  * @param packetid returned integer - the MQTT packet identifier
+  * @param maxcount - the maximum number of members allowed in the reasonCodes array
+  * @param count returned integer - number of members in the reasonCodes array
+  * @param reasonCodes returned array of integers - one reason code per topic filter
+  * @param buf the raw buffer data, of the correct length determined by the remaining length field
+  * @param buflen the length in bytes of the data in the supplied buffer
+  * @return error code.  1 is success, 0 is failure
+  */
+int MQTTV5Deserialize_unsuback(MQTTProperties* properties, unsigned short* packetid, int maxcount, int* count,
+		int reasonCodes[], unsigned char* buf, int buflen)
+{
+	MQTTHeader header = {0};
+	unsigned char* curdata = buf;
+	unsigned char* enddata = NULL;
+	int rc = 0;
+	int mylen;
+
+	FUNC_ENTRY;
+	header.byte = readChar(&curdata);
+	if (header.bits.type != UNSUBACK)
+		goto exit;
+
+	curdata += MQTTPacket_decodeBuf(curdata, &mylen); /* read remaining length */
+	enddata = curdata + mylen;
+	if (enddata - curdata < 2 || enddata > buf + buflen)
+		goto exit;
+
+	*packetid = readInt(&curdata);
+	if (!MQTTProperties_read(properties, &curdata, enddata))
+		goto exit;
+
+	*count = 0;
+	while (curdata < enddata)
+	{
+		if (*count >= maxcount)
+			goto exit;
+		reasonCodes[(*count)++] = readChar(&curdata);
+	}
+
+	rc = 1;
+exit:
+	FUNC_EXIT_RC(rc);
+	return rc;
+}
+
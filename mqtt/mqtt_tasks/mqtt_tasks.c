@@ -18,10 +18,18 @@
 #include "utils_datetime.h"
 #include "net.h"
 #include "mqtt_tasks.h"
+#include "mqtt_batch.h"
+
+#define TELEMETRY_SAMPLE_MS		10000	/* telemetry sampling period */
+#define TELEMETRY_BATCH_SAMPLES	16		/* telemetry batch flushed at this many samples, */
+#define TELEMETRY_BATCH_AGE_MS	60000	/* or this long after its first sample, or when full */
+#define TELEMETRY_MSG_OVERHEAD	24		/* MQTT fixed header and topic of a telemetry message */
 
 int 	mqtt_publish_helper(void *mqtt_ctxt, const char *topic, const char *msg);
 void 	check_MqttConnection_Task(void* argument);
 void 	allpurposeMessageHandler(MessageData *data);
+static int telemetry_batch_head(void *ctx, char *buf, size_t size);
+static int telemetry_batch_publish(void *ctx, const char *payload, size_t len);
 
 extern net_hnd_t 		hnet;	/*Network handle*/
 extern net_sockhnd_t  	sock;	/*Socket handle*/
@@ -41,6 +49,17 @@ const osThreadAttr_t mqttPublishTask_attributes = {
   .priority = (osPriority_t) osPriorityHigh
 };
 osThreadId_t mqttPublishTaskHandle;
+
+#define MQTT_DISPATCH_WORKERS	1	/* message handlers run at a time: allpurposeMessageHandler shares mqtt_msg */
+const osThreadAttr_t mqttDispatchTask_attributes = {
+  .name = "mqttDispatchTask",
+  .stack_size = 1024 * 4,
+  .priority = (osPriority_t) osPriorityNormal
+};
+static osSemaphoreId_t mqtt_inq_sem;	/* a message queued for each token */
+static MQTTInboundQueue mqtt_inq;		/* incoming messages, handled by the dispatch tasks */
+static void mqtt_inq_signal(void* context);
+void mqtt_dispatch_task(void* argument);
 #endif
 /*For use in MQTT client task*/
 pub_data_t pub_data = { MODEL_DEFAULT_MAC, 0 };
@@ -50,6 +69,9 @@ status_data_t status_data = { MODEL_DEFAULT_MAC,
 
 static unsigned char mqtt_send_buffer[MQTT_SEND_BUFFER_SIZE];
 static unsigned char mqtt_read_buffer[MQTT_READ_BUFFER_SIZE];
+static MQTTPublishQueue mqtt_pubq;	/* telemetry handed over to the task running the client */
+static mqtt_batch_t telemetry_batch;	/* telemetry samples, one message per batch */
+static char telemetry_batch_buf[MQTT_PUBQ_SLOT_SIZE];
 
 /* Warning: The subscribed topics names strings must be allocated separately,
  * because Paho does not copy them and uses references to dispatch the incoming message. */
@@ -108,11 +130,23 @@ void mqtt_setup_tsk_env(void)
 	/*MQTT init just set some variables for the context, no return messages*/
 	MQTTClientInit(&mc, &net, MQTT_CMD_TIMEOUT, mqtt_send_buffer,
 	MQTT_SEND_BUFFER_SIZE, mqtt_read_buffer, MQTT_READ_BUFFER_SIZE);
+	MQTTPublishQueueInit(&mqtt_pubq);
+	MQTTSetPublishQueue(&mc, &mqtt_pubq);
+#if defined(MQTT_TASK)
+	/* The handlers run in the dispatch tasks: the yield task acks and reads on meanwhile. */
+	mqtt_inq_sem = osSemaphoreNew(MQTT_INQ_SLOTS, 0, NULL);
+	MQTTInboundQueueInit(&mqtt_inq, mqtt_inq_signal, mqtt_inq_sem);
+	MQTTSetInboundQueue(&mc, &mqtt_inq);
+	for (int i = 0; i < MQTT_DISPATCH_WORKERS; i++) {
+		osThreadNew(mqtt_dispatch_task, NULL, &mqttDispatchTask_attributes);
+	}
+#endif
 
 	/************************************************************/
 
 	/* MQTT connect */
 	options.clientID.cstring = dev.MQClientId;
+	options.MQTTVersion = 5;	/* topic aliases: the telemetry topic goes in full once per connection */
 
 	rc = MQTTConnect(&mc, &options);
 	if (rc != 0) {
@@ -148,86 +182,125 @@ void mqtt_setup_tsk_env(void)
  */
 void check_MqttConnection_Task(void* argument) {
 	MQTTClient* client = (MQTTClient*) argument;
+	net_sup_t sup;
 	int r;
+
+	net_sup_init(&sup, "mqtt", net.netHandle, NULL);
 	for(;;)
 	{
-		if (MQTTYield(client, 1000) != MQSUCCESS) {
-			msg_debug("MQTT Disconnected, attempting to reconnect...\n");
-			MQTTDisconnect(client);
-				msg_debug("re-initiating socket connection...\n");
-				r = mqtt_network_init(&net, dev.HostName,atoi(dev.HostPort));
-				if (r != NET_OK) {
-					r = NET_ERR;
-					msg_error("error opening socket for mqtt client connection...\n");
-				}
-				if (MQTTConnect(client, &options) == SUCCESS) {
-					msg_debug("MQTT Reconnected Successfully!\n");
-				} else {
-					msg_error("MQTT Reconnection Failed!\n");
-				}
+		if (MQTTYield(client, 1000) == MQSUCCESS) {
+			continue;
+		}
+		if (!net_sup_ready(&sup)) {	/* backing off, breaker open or link down */
+			HAL_Delay(MIN(net_sup_wait_ms(&sup), 1000));
+			continue;
 		}
-		HAL_Delay(30000);	// runs each 15 secs
+		msg_debug("MQTT Disconnected, attempting to reconnect...\n");
+		MQTTDisconnect(client);
+		net.mqttdisconnect(&net);
+		msg_debug("re-initiating socket connection...\n");
+		r = mqtt_network_open(&net, &dev);
+		if (r != NET_OK) {
+			msg_error("error opening socket for mqtt client connection...\n");
+		} else if (MQTTConnect(client, &options) == SUCCESS) {
+			msg_debug("MQTT Reconnected Successfully!\n");
+			net_sup_success(&sup);
+			continue;
+		}
+		msg_error("MQTT Reconnection Failed!\n");
+		net_sup_failure(&sup);
 	}
 }
 
 
 
+#if defined(MQTT_TASK)
+static void mqtt_inq_signal(void* context) {
+	osSemaphoreRelease((osSemaphoreId_t) context);
+}
+
+
+/*
+ * This task runs the handlers of the incoming messages, one per token of the semaphore
+ */
+void mqtt_dispatch_task(void* argument) {
+	for(;;)
+	{
+		if (osSemaphoreAcquire(mqtt_inq_sem, osWaitForever) == osOK) {
+			(void) MQTTInboundDispatch(&mqtt_inq, 1);
+		}
+	}
+}
+#endif
+
+
 void mqtt_client_publish_task(MQTTClient* client){
 //	MQTTClient* client = (MQTTClient*) argument;
-	MQTTMessage mqmsg;
-
+	snprintf(mqtt_pubtopic, MQTT_TOPIC_BUFFER_SIZE, "/sensors/%s",	dev.MQClientId);
+	/* A batch goes to the publish queue in one slot, with its topic. */
+	mqtt_batch_conf_t conf = { TELEMETRY_BATCH_SAMPLES, MQTT_PUBQ_SLOT_SIZE - strlen(mqtt_pubtopic) - 1,
+							   TELEMETRY_BATCH_AGE_MS, TELEMETRY_MSG_OVERHEAD,
+							   telemetry_batch_head, telemetry_batch_publish, client };
+	int32_t values[3];
+
+	mqtt_batch_init(&telemetry_batch, telemetry_batch_buf, sizeof(telemetry_batch_buf), &conf);
 	for(;;){
-		snprintf(mqtt_pubtopic, MQTT_TOPIC_BUFFER_SIZE, "/sensors/%s",	dev.MQClientId);
 #ifdef SENSORS
 		/*Read data from sensors*/
 		pub_data.temperature = BSP_TSENSOR_ReadTemp();
 		pub_data.humidity = BSP_HSENSOR_ReadHumidity();
 #endif
-		rtc_gettime(&rtc);
-		pub_data.ts = rtc.unixtime;
-
-		/*create Json object to publish data*/
-		cJSON* publish_data =cJSON_CreateObject();
-		cJSON_AddBoolToObject(publish_data, "LedOn", status_data.LedOn);
-		cJSON_AddNumberToObject(publish_data, "Temperature", (pub_data.temperature * 9.0 / 5.0) + 32.0);
-		cJSON_AddNumberToObject(publish_data, "Humidity", pub_data.humidity);
-		cJSON_AddNumberToObject(publish_data, "TelemetryInterval", pub_data.ts);
-		cJSON_AddStringToObject(publish_data, "MacAddress", pub_data.mac);
-		// Convert JSON to String
-		char *msg = cJSON_Print(publish_data);
-		strcpy(mqtt_msg, msg);
-		cJSON_Delete(publish_data);
-		rc = strlen(mqtt_msg);
-
-
-		if ((rc < 0) || (rc >= MQTT_MSG_BUFFER_SIZE)) {
-			msg_error("Telemetry message formatting error.\n");
-		} else {
-			mqmsg.qos = QOS0;
-			mqmsg.payload = (char*) mqtt_msg;
-			mqmsg.payloadlen = strlen(mqtt_msg);
-
-			rc = MQTTPublish(client, mqtt_pubtopic, &mqmsg);
-			if (rc != MQSUCCESS) {
-				msg_error("Failed publishing %s on %s\n", (char* )(mqmsg.payload),
-						mqtt_pubtopic);
-			}
-
-			if (rc == MQSUCCESS) {
-				/* Visual notification of the telemetry publication: LED blink. */
-				msg_info("#\n");
-				msg_info("publication topic: %s \tpayload: %s\n", mqtt_pubtopic, mqtt_msg);
-			} else {
-				msg_error("Telemetry publication failed.\n");
-			}
-
-			rc = MQTTYield(client, 500);
-			if (rc) {
-				msg_error("Yield failed. Reconnection needed?.\n");
-			}
+		values[0] = status_data.LedOn ? 1 : 0;
+		values[1] = (int32_t) ((pub_data.temperature * 9.0 / 5.0) + 32.0);
+		values[2] = (int32_t) pub_data.humidity;
+
+		/* Queued for publication once the batch is full or old enough. */
+		rc = mqtt_batch_add(&telemetry_batch, HAL_GetTick(), values, 3);
+		if (rc != MQSUCCESS) {
+			msg_error("Telemetry publication failed.\n");
+		}
+
+		rc = MQTTYield(client, 500);
+		if (rc) {
+			msg_error("Yield failed. Reconnection needed?.\n");
 		}
-		HAL_Delay(60000);
+		HAL_Delay(TELEMETRY_SAMPLE_MS);
+		(void) mqtt_batch_poll(&telemetry_batch, HAL_GetTick());
+	}
+}
+
+
+/* Members of a telemetry batch before its samples: the time of its first sample. */
+static int telemetry_batch_head(void *ctx, char *buf, size_t size) {
+	rtc_gettime(&rtc);
+	pub_data.ts = rtc.unixtime;
+	return snprintf(buf, size, "\"MacAddress\":\"%s\",\"TelemetryInterval\":%lu,"
+			"\"f\":[\"dt\",\"LedOn\",\"Temperature\",\"Humidity\"]",
+			pub_data.mac, (unsigned long) pub_data.ts);
+}
+
+
+static int telemetry_batch_publish(void *ctx, const char *payload, size_t len) {
+	MQTTClient* client = (MQTTClient*) ctx;
+	MQTTMessage mqmsg;
+
+	mqmsg.qos = QOS0;
+	mqmsg.retained = 0;
+	mqmsg.payload = (char*) payload;
+	mqmsg.payloadlen = len;
+
+	/* Copied to the publish queue: published by the next MQTTYield/MQTTRun cycle,
+	 * without waiting here for the client mutex. */
+	rc = MQTTPublishQueued(client, mqtt_pubtopic, &mqmsg);
+	if (rc != MQSUCCESS) {
+		msg_error("Failed queueing %s on %s\n", (char* )(mqmsg.payload),
+				mqtt_pubtopic);
+	} else {
+		/* Visual notification of the telemetry publication: LED blink. */
+		msg_info("#\n");
+		msg_info("publication queued topic: %s \tpayload: %s\n", mqtt_pubtopic, payload);
 	}
+	return rc;
 }
 
 
@@ -0,0 +1,20 @@
+/*
+ * net_test_mbedtls_config.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Daruin Solano
+ *
+ *  mbedTLS configuration of the host tests: the project one, plus the server side that the loopback
+ *  server of net_tls_mfl_test.c needs. Build mbedTLS and netsock alike with
+ *
+ *      -DUSE_HOST -Inetsock/host -DMBEDTLS_CONFIG_FILE="\"net_test_mbedtls_config.h\""
+ */
+
+#ifndef NET_HOST_NET_TEST_MBEDTLS_CONFIG_H_
+#define NET_HOST_NET_TEST_MBEDTLS_CONFIG_H_
+
+#define MBEDTLS_SSL_SRV_C
+
+#include "httpclient_mbedtls_config.h"
+
+#endif /* NET_HOST_NET_TEST_MBEDTLS_CONFIG_H_ */
@@ -0,0 +1,51 @@
+/*
+ * stm32l4xx_hal.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Daruin Solano
+ *
+ *  Host build (USE_HOST) replacement of the STM32 HAL header: only the HAL services used by the
+ *  network and protocol code, on top of POSIX. Put netsock/host ahead of the board include paths.
+ */
+
+#ifndef NET_HOST_STM32L4XX_HAL_H_
+#define NET_HOST_STM32L4XX_HAL_H_
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <errno.h>
+#include <stdint.h>
+#include <time.h>
+
+typedef enum {
+  HAL_OK       = 0x00U,
+  HAL_ERROR    = 0x01U,
+  HAL_BUSY     = 0x02U,
+  HAL_TIMEOUT  = 0x03U
+} HAL_StatusTypeDef;
+
+/** No hardware RNG: the entropy comes from getrandom(), see net_tcp_host.c. */
+typedef struct {
+  void * Instance;
+} RNG_HandleTypeDef;
+
+/** Millisecond tick from the monotonic clock. Wraps around like the SysTick counter. */
+static inline uint32_t HAL_GetTick(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t) ((uint64_t) ts.tv_sec * 1000U + (uint64_t) ts.tv_nsec / 1000000U);
+}
+
+static inline void HAL_Delay(uint32_t Delay)
+{
+  struct timespec ts;
+  ts.tv_sec = Delay / 1000U;
+  ts.tv_nsec = (long) (Delay % 1000U) * 1000000L;
+  while ((nanosleep(&ts, &ts) != 0) && (errno == EINTR))
+  {
+  }
+}
+
+#endif /* NET_HOST_STM32L4XX_HAL_H_ */
@@ -13,9 +13,14 @@
 //#include "stm32l4xx_hal_iwdg.h"
 #include "version.h"
 
+#ifdef USE_HOST
+/* Linux host build: -DUSE_HOST, with netsock/host ahead in the include path. No board peripherals. */
+#else
 #define SENSORS
 #define USE_WIFI
+#endif /* USE_HOST */
 #define USE_MBED_TLS
+/* #define USE_LWIP_NETCONN */	/* With USE_LWIP: netconn backend. net_sock_recv_buf() hands out pbuf views instead of copies. */
 
 #ifdef RFU
 #include "rfu.h"
@@ -36,7 +41,9 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdbool.h>
+#ifndef USE_HOST
 #include "flash.h"
+#endif /* USE_HOST */
 
 
 #ifdef FIREWALL_MBEDLIB
@@ -45,7 +52,9 @@
 #endif /* FIREWALL_MBEDLIB */
 
 #include "net.h"
+#ifndef USE_HOST
 #include "iot_flash_config.h"
+#endif /* USE_HOST */
 #include "msg.h"
 #include "timer.h"
 #include "rtc.h"
@@ -69,6 +78,8 @@ extern int mbedtls_hardware_poll( void *data, unsigned char *output, size_t len,
 #define NET_IF  NET_IF_ETH
 #elif defined(USE_C2C)
 #define NET_IF  NET_IF_C2C
+#elif defined(USE_HOST)
+#define NET_IF  NET_IF_HOST
 #endif
 
 #define WIFI_STORED_CREDENTIALS		1
@@ -79,14 +90,16 @@ void    Error_Handler(void);
 //uint8_t Button_WaitForPush(uint32_t timeout);
 //uint8_t Button_WaitForMultiPush(uint32_t timeout);
 //void    Periph_Config(void);
-extern SPI_HandleTypeDef hspi3;
 extern RNG_HandleTypeDef hrng;
-extern RTC_HandleTypeDef hrtc;
 extern net_hnd_t hnet;
 extern RTC_t rtc;
+#ifndef USE_HOST
+extern SPI_HandleTypeDef hspi3;
+extern RTC_HandleTypeDef hrtc;
 
 
 extern const user_config_t *lUserConfigPtr;
+#endif /* USE_HOST */
 static volatile uint8_t button_flags = 0;
 
 
@@ -50,6 +50,7 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include "net_clock.h"
 
 /** Function return codes. */
 #define  NET_OK          0   /**< Success */
@@ -60,6 +61,7 @@
 #define  NET_NOT_FOUND  -5   /**< The remote host could not be reached. */
 #define  NET_AUTH       -6   /**< The remote host cound not be authentified. */
 #define  NET_NO_DATA	  -11
+#define  NET_IN_PROGRESS -12  /**< A non-blocking operation was started and is not completed yet. */
 
 /* Socket options definitions:
  * Important: All contents are passed by reference.
@@ -77,6 +79,17 @@
  *            Default option:   tls_server_verification
  *  
  *    tls_server_name           Check pattern for the server certificate verification. String.  TLS lib configuration.
+ *    tls_max_frag_len          Max fragment length in bytes: 512, 1024, 2048, 4096. Ascii.     TLS lib configuration.
+ *                                  Negotiated with the server (RFC 6066). Also bounds the size of the
+ *                                  socket TLS record buffers once the handshake is over.
+ *            Default option:   none (MBEDTLS_SSL_MAX_CONTENT_LEN records)
+ *    tls_profile               "default" or "lean". String.                                    TLS lib configuration.
+ *                                  lean: ECDHE-ECDSA over secp256r1 with AES-128-GCM and SHA-256 only.
+ *                                  The server certificate chain must be ECDSA P-256.
+ *            Default option:   default (every suite and curve of the mbedTLS configuration)
+ *    tls_ciphersuites          Comma separated mbedTLS ciphersuite names. String.              TLS lib configuration.
+ *                                  eg. "TLS-ECDHE-ECDSA-WITH-AES-128-GCM-SHA256". Up to 8 entries.
+ *                                  Takes precedence over the tls_profile suite. NULL restores the default.
  *    sock_blocking             NULL.                                                           The recv calls are blocking until
  *                                                                                                  - at least one byte may be returned,
  *                                                                                                  - or the sock_read_timeout is reached.
@@ -86,6 +99,24 @@
  *  
  *    sock_read_timeout       Timeout in ms. Ascii format.
  *    sock_write_timeout      Timeout in ms. Ascii format.                                    Applied to TCP sockets only.
+ *    sock_batch_size         Send queue size in bytes. Ascii format.                         Batching backends only (C2C TCP).
+ *                                net_sock_send() queues the payload and returns; the queue is sent in one go
+ *                                when it is full, when sock_batch_deadline is reached, before a receive,
+ *                                or on net_sock_flush(). "0" sends each payload at once.
+ *                                If a queue fails to go out, its payloads are lost and the stream is
+ *                                broken: the next send, receive and flush calls fail with that error
+ *                                until the socket is closed.
+ *            Default option:   0
+ *    sock_batch_deadline     Max time in ms a payload is held in the send queue. Ascii format.
+ *                                Checked by the socket calls and by net_batch_poll().
+ *            Default option:   5000
+ *    sock_keepalive          "idle,interval,count" in ms, ms and probes. Ascii format.        TCP and TLS sockets whose backend can probe.
+ *                                Once nothing was received for idle ms, the connection is probed every
+ *                                interval ms; after count unanswered probes, or at once if the transport
+ *                                reports the connection lost, the socket is dead: the socket calls fail with
+ *                                NET_EOF without blocking. The probes are run by the receive calls which
+ *                                return no data, and by net_keepalive_poll(). "0" disables the probing.
+ *            Default option:   0
  */
 
 typedef enum{
@@ -97,10 +128,16 @@ typedef enum{
 	tls_server_verification,	//content NULL
 	tls_server_noverification,	//content NULL
 	tls_server_name,			// content Check pattern for the server certificate verification. String.
+	tls_max_frag_len,			// content Max fragment length in bytes. Ascii format.
+	tls_profile,				// content "default" or "lean". String.
+	tls_ciphersuites,			// content Comma separated ciphersuite names. String.
 	sock_blocking,
 	sock_noblocking,
 	sock_read_timeout,
-	sock_write_timeout
+	sock_write_timeout,
+	sock_batch_size,
+	sock_batch_deadline,
+	sock_keepalive
 }setopt_t;
 
 
@@ -114,7 +151,8 @@ typedef enum {
   NET_IF_WLAN,
   NET_IF_ETH,
   NET_IF_C2C,
-  NET_IF_BNEP
+  NET_IF_BNEP,
+  NET_IF_HOST             /**< Linux sockets of a development host (USE_HOST). */
 } net_if_t;
 
 /** Socket protocol. */
@@ -123,7 +161,8 @@ typedef enum {
   NET_PROTO_TCP,
   NET_PROTO_TLS,
   NET_PROTO_UDP,
-  NET_PROTO_MQTT
+  NET_PROTO_MQTT,
+  NET_PROTO_DTLS          /**< DTLS 1.2 over a UDP socket of the interface. Takes the tls_* options. Needs MBEDTLS_SSL_PROTO_DTLS in the mbedTLS config. */
 } net_proto_t;
 
 /** IP protocol version. */
@@ -144,6 +183,62 @@ typedef struct {
 } net_ipaddr_t;
 
 
+/** View on received bytes, see net_sock_recv_buf(). */
+typedef struct {
+  const uint8_t * data;   /**< First received byte. Read-only. */
+  size_t len;             /**< Number of bytes in the view. */
+  void * priv;            /**< Backend reference held until net_sock_release_buf(). */
+} net_buf_t;
+
+#define NET_IOV_MAX   8   /**< Most segments of a net_sock_sendv() call. */
+
+/** Segment of a gather write, see net_sock_sendv(). */
+typedef struct {
+  const uint8_t * base;   /**< First byte. Only read, and only during the call. */
+  size_t len;
+} net_iovec_t;
+
+#define NET_STATS_LAT_BUCKETS   12  /**< Latency histogram buckets: <1 ms, then [2^(i-1), 2^i) ms, the last one >= 1024 ms. */
+
+/** Traffic counters of one direction. All the counters wrap around at 2^32. */
+typedef struct {
+  uint32_t calls;         /**< Calls to the socket backend, empty and failed ones included. */
+  uint32_t bytes;         /**< Payload bytes transferred. */
+  uint32_t timeouts;      /**< NET_TIMEOUT returns. */
+  uint32_t eofs;          /**< NET_EOF returns. */
+  uint32_t errors;        /**< Other negative returns. */
+  uint32_t lat_max_ms;    /**< Longest call which transferred data. */
+  uint32_t lat_hist[NET_STATS_LAT_BUCKETS]; /**< Duration of the calls which transferred data. */
+} net_stats_dir_t;
+
+/** Socket or interface counters, see net_sock_get_stats() and net_get_stats(). */
+typedef struct {
+  net_stats_dir_t rx;     /**< net_sock_recv(), net_sock_recv_buf(), net_sock_recvfrom(). */
+  net_stats_dir_t tx;     /**< net_sock_send(), net_sock_sendv(), net_sock_sendto(). */
+} net_stats_t;
+
+/** Send queue of a batching socket, see net_sock_get_batch_stats(). */
+typedef struct {
+  uint32_t queued_bytes;      /**< Bytes waiting in the queue. */
+  uint32_t queued_msgs;       /**< net_sock_send() payloads waiting in the queue. */
+  uint32_t flushes;           /**< Flushes which sent data, i.e. radio sessions. */
+  uint32_t flushed_msgs;      /**< Payloads sent by these flushes. */
+  uint32_t flush_errors;      /**< Failed flushes. The queued payload is dropped, the socket fails from then on. */
+  uint32_t flush_lat_last_ms; /**< Duration of the last flush. */
+  uint32_t flush_lat_max_ms;  /**< Longest flush. */
+  uint32_t hold_max_ms;       /**< Longest time a payload waited in the queue. */
+} net_batch_stats_t;
+
+/**
+ * @brief   Callback type: visit the counters of a socket, see net_sock_foreach_stats().
+ * @param   In:   sockhnd   Socket.
+ * @param   In:   proto     Socket protocol.
+ * @param   In:   stats     Snapshot of the socket counters.
+ * @param   In:   arg       Caller argument.
+ */
+typedef void net_sock_stats_cb_t(net_sockhnd_t sockhnd, net_proto_t proto, const net_stats_t * stats, void * arg);
+
+
 /**
  * @brief   Callback type: initialize the network interface and connect to the LAN.
  * @param   In:   if_ctxt       Pointer to the interface-specific native context.
@@ -261,6 +356,45 @@ int net_sock_create(net_hnd_t nethnd, net_sockhnd_t * sockhnd, net_proto_t proto
 // UDP variant: the remoteport must not be filled (will be overridden by sendto).
 int net_sock_open(net_sockhnd_t sockhnd, const char * hostname, net_ipaddr_t * ipAddress, int remoteport, int localport);
 
+/**
+ * @brief   Start opening a socket without blocking the caller for the whole connection setup.
+ * @note    For NET_PROTO_TLS sockets, the TCP connection is opened and the TLS handshake is
+ *          then driven by net_sock_open_step(), one handshake state per call.
+ *          Same for NET_PROTO_DTLS sockets, whose lost handshake flights are retransmitted by the
+ *          net_sock_open_step() calls made once the retransmission timeout is over.
+ *          The other protocols are opened synchronously, as by net_sock_open().
+ * @param   In:   sockhnd     Socket.
+ * @param   In:   hostname    Destination host. Hostname or IP address string.
+ * @param   In:   remoteport  Destination port.
+ * @param   In:   localport   Local port.
+ * @retval  Status
+ *            NET_OK          Success. The socket is open.
+ *            NET_IN_PROGRESS The connection is pending. Call net_sock_open_step() until it completes.
+ *            NET_ERR         Internal error.
+ *            NET_NOT_FOUND   The remote host could not be reached, or its name could not be resolved.
+ */
+int net_sock_open_start(net_sockhnd_t sockhnd, const char * hostname, int remoteport, int localport);
+
+/**
+ * @brief   Advance a connection started by net_sock_open_start().
+ * @note    Never waits for the remote host: returns as soon as the underlying socket has no more data.
+ *          Intended to be called from the main loop or a task, e.g. when the socket is readable.
+ * @param   In:   sockhnd   Socket.
+ * @retval  Status
+ *            NET_OK          Success. The socket is open.
+ *            NET_IN_PROGRESS The connection is still pending.
+ *            NET_AUTH        The remote host cound not be authentified.
+ *            NET_ERR         Internal error. The socket is closed.
+ */
+int net_sock_open_step(net_sockhnd_t sockhnd);
+
+/**
+ * @brief   Tell whether a connection started by net_sock_open_start() is completed.
+ * @param   In:   sockhnd   Socket.
+ * @retval  true if no connection is pending on the socket.
+ */
+bool net_sock_open_is_done(net_sockhnd_t sockhnd);
+
 /**
  * @brief   Set a socket option.
  * @note    May be called before the socket is opened.
@@ -300,6 +434,45 @@ int net_sock_recv(net_sockhnd_t sockhnd, uint8_t * const buf, size_t len);
 // Out: remoteport, allocated by the caller.
 int net_sock_recvfrom(net_sockhnd_t sockhnd, uint8_t * const buf, size_t len, net_ipaddr_t * remoteaddress, int * remoteport);
 
+/**
+ * @brief   Read from a socket without copying: the returned view points into the receive buffers of the
+ *          network stack when the socket backend supports it (lwIP netconn backend, USE_LWIP_NETCONN),
+ *          or into a buffer allocated for the call otherwise.
+ * @note    Same blocking and timeout behaviour as net_sock_recv().
+ *          The view stays valid, even after the socket is closed, until it is passed to net_sock_release_buf(),
+ *          which must be done before net_sock_destroy().
+ *          Holding views pins network buffers: release them as soon as the bytes are parsed.
+ * @param   In:   sockhnd   Socket.
+ * @param   Out:  view      Received bytes. Set to an empty view if nothing was received.
+ * @param   In:   maxlen    Maximum length of the view. A view may be shorter than what is available.
+ * @retval  Status
+ *            >=0           Success. Number of bytes in the view.
+ *            NET_TIMEOUT   In "sock_blocking" mode, the read timeout was reached.
+ *            NET_EOF       The connection was closed.
+ *            NET_ERR       Internal error.
+ *            NET_PARAM     Invalid parameter passed.
+ */
+int net_sock_recv_buf(net_sockhnd_t sockhnd, net_buf_t * view, size_t maxlen);
+
+/**
+ * @brief   Release a view returned by net_sock_recv_buf(). Releasing an empty view does nothing.
+ * @param   In:   sockhnd   Socket.
+ * @param   In:   view      View to be released. Cleared on return.
+ * @retval  Status
+ *            NET_OK        Success.
+ *            NET_PARAM     Invalid parameter passed.
+ */
+int net_sock_release_buf(net_sockhnd_t sockhnd, net_buf_t * view);
+
+/**
+ * @brief   Tell whether net_sock_recv_buf() hands out views on the receive buffers of the network stack.
+ *          Otherwise each view is a buffer allocated and filled by net_sock_recv(): a reader with a buffer
+ *          of its own is better off with net_sock_recv().
+ * @param   In:   sockhnd   Socket.
+ * @retval  true if the backend of the socket receives without copying.
+ */
+bool net_sock_is_zero_copy(net_sockhnd_t sockhnd);
+
 /**
  * @brief   Send through a socket.
  * @param   In:   sockhnd   Socket.
@@ -313,6 +486,24 @@ int net_sock_recvfrom(net_sockhnd_t sockhnd, uint8_t * const buf, size_t len, ne
  *            NET_PARAM     Invalid parameter passed.
  */
 int net_sock_send(net_sockhnd_t sockhnd, const uint8_t * buf, size_t len);
+
+/**
+ * @brief   Send the segments of a message in order, as one write: a header and a payload kept
+ *          elsewhere are sent without being copied together first.
+ * @note    Gather write of the backend when it has one. Otherwise the short segments are
+ *          coalesced into a small buffer and the others sent in place.
+ * @param   In:   sockhnd   Socket.
+ * @param   In:   iov       Segments, NET_IOV_MAX at most.
+ * @param   In:   iovcnt    Number of segments.
+ * @retval  Status
+ *            >=0           Success, number of bytes written: fewer than the total means the next
+ *                          ones are to be sent by another call.
+ *            NET_TIMEOUT   In "sock_blocking" mode, the send timeout was reached.
+ *            NET_EOF       The connection was closed.
+ *            NET_ERR       Internal error.
+ *            NET_PARAM     Invalid parameter passed.
+ */
+int net_sock_sendv(net_sockhnd_t sockhnd, const net_iovec_t * iov, int iovcnt);
 // UDP variant
 // In: remoteaddress
 // In: remoteport
@@ -339,6 +530,121 @@ int net_sock_close(net_sockhnd_t sockhnd);
  */
 int net_sock_destroy(net_sockhnd_t sockhnd);
 
+/**
+ * @brief   Snapshot the traffic counters of a socket.
+ * @note    The counters are updated without locking: a snapshot taken while another task uses the
+ *          socket may mix values from before and after a call.
+ * @param   In:   sockhnd   Socket.
+ * @param   Out:  stats     Counters. Allocated by the caller.
+ * @retval  Status
+ *            NET_OK        Success.
+ *            NET_PARAM     Invalid parameter passed, or the counters are disabled (NET_STATS == 0).
+ */
+int net_sock_get_stats(net_sockhnd_t sockhnd, net_stats_t * stats);
+
+/**
+ * @brief   Snapshot the traffic counters of a network interface: the sum of all the sockets created on it
+ *          since net_init() or net_reset_stats(), destroyed ones included.
+ * @note    The TLS sockets of the mbedTLS backend are not summed up, their traffic is counted by their
+ *          underlying TCP socket.
+ * @param   In:   nethnd    Network interface.
+ * @param   Out:  stats     Counters. Allocated by the caller.
+ * @retval  Status
+ *            NET_OK        Success.
+ *            NET_PARAM     Invalid parameter passed, or the counters are disabled (NET_STATS == 0).
+ */
+int net_get_stats(net_hnd_t nethnd, net_stats_t * stats);
+
+/**
+ * @brief   Call cb with a snapshot of the counters of each socket of a network interface.
+ * @note    The callback must not create or destroy sockets.
+ * @param   In:   nethnd    Network interface.
+ * @param   In:   cb        Callback.
+ * @param   In:   arg       Passed to the callback.
+ * @retval  Status
+ *            NET_OK        Success.
+ *            NET_PARAM     Invalid parameter passed, or the counters are disabled (NET_STATS == 0).
+ */
+int net_sock_foreach_stats(net_hnd_t nethnd, net_sock_stats_cb_t * cb, void * arg);
+
+/**
+ * @brief   Clear the counters of a network interface and of all its sockets.
+ * @param   In:   nethnd    Network interface.
+ * @retval  Status
+ *            NET_OK        Success.
+ *            NET_PARAM     Invalid parameter passed, or the counters are disabled (NET_STATS == 0).
+ */
+int net_reset_stats(net_hnd_t nethnd);
+
+/**
+ * @brief   Send the payload queued on a batching socket (see sock_batch_size) without waiting for
+ *          the queue to fill up or for the deadline.
+ * @param   In:   sockhnd   Socket.
+ * @retval  Status
+ *            NET_OK        Success, or nothing to send.
+ *            NET_TIMEOUT   The send timeout was reached. The queued payload is dropped.
+ *            NET_ERR       Internal error. The queued payload is dropped.
+ *            Once a flush failed, by this call or another, its error is returned until the socket
+ *            is closed.
+ */
+int net_sock_flush(net_sockhnd_t sockhnd);
+
+/**
+ * @brief   Send the queues of the batching sockets of an interface whose sock_batch_deadline is
+ *          reached. The other queued sockets are sent along, in the same radio session.
+ * @note    To be called periodically when the sockets may stay idle past their deadline.
+ * @param   In:   nethnd    Network interface.
+ * @retval  Status
+ *            NET_OK        Success, or nothing was due.
+ *            NET_PARAM     Invalid parameter passed.
+ *            <0            Error of the first failed flush.
+ */
+int net_batch_poll(net_hnd_t nethnd);
+
+/**
+ * @brief   Snapshot the send queue counters of a socket.
+ * @param   In:   sockhnd   Socket.
+ * @param   Out:  stats     Counters. Allocated by the caller. All zero if the socket never batched.
+ * @retval  Status
+ *            NET_OK        Success.
+ *            NET_PARAM     Invalid parameter passed.
+ */
+int net_sock_get_batch_stats(net_sockhnd_t sockhnd, net_batch_stats_t * stats);
+
+/**
+ * @brief   Run the due sock_keepalive probes of the sockets of an interface. To be called
+ *          periodically for the sockets which may not be read for a while.
+ * @param   In:   nethnd    Network interface.
+ * @retval  Number of dead sockets on the interface, or NET_PARAM.
+ */
+int net_keepalive_poll(net_hnd_t nethnd);
+
+/**
+ * @brief   Tell whether a socket was found dead by the sock_keepalive probes.
+ * @param   In:   sockhnd   Socket.
+ * @retval  false once the connection is known to be lost, until it is re-opened.
+ */
+bool net_sock_is_alive(net_sockhnd_t sockhnd);
+
+/**
+ * @brief   Tell whether a socket is watched by sock_keepalive probes. A TLS socket is known once
+ *          opened: its backend may not probe its TCP connection (e.g. ES-WiFi). Without probes, a
+ *          lost connection is found by the protocol above, e.g. the MQTT keepalive.
+ * @param   In:   sockhnd   Socket.
+ * @retval  true if sock_keepalive is set and the backend can probe the connection.
+ */
+bool net_sock_is_probed(net_sockhnd_t sockhnd);
+
+/**
+ * @brief   Bound the blocking calls on a socket by an absolute deadline, in addition to its read and
+ *          write timeouts: e.g. one deadline for all the reads of a protocol message.
+ *          The deadline is passed down to the underlying layers (TCP under TLS).
+ * @param   In:   sockhnd   Socket.
+ * @param   In:   deadline  See net_deadline_in(). NET_DEADLINE_NONE to remove it.
+ * @retval  NET_OK, NET_PARAM.
+ */
+int net_sock_set_deadline(net_sockhnd_t sockhnd, net_deadline_t deadline);
+
 bool net_is_up(net_hnd_t hnet);
 
 
@@ -0,0 +1,78 @@
+/*
+ * net_clock.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Daruin Solano
+ */
+
+#ifndef NET_INC_NET_CLOCK_H_
+#define NET_INC_NET_CLOCK_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Monotonic clock and deadlines of the blocking socket calls.
+ *  - net_clock_ms() is the HAL tick; net_clock_us() adds the sub-millisecond part where the
+ *    hardware gives it (SysTick on the bare metal target, CLOCK_MONOTONIC on the host).
+ *    Neither call locks or loops: they may be used from any context.
+ *  - A deadline is an absolute tick, computed once when a call starts. Its remaining time is
+ *    what a loop hands to the driver at each iteration, instead of the full timeout.
+ *  - The deadlines are carried across the socket layers: a layer calling the one below (TLS
+ *    over TCP) sets its own deadline on the underlying socket for the duration of the call,
+ *    and the underlying socket stops at the earlier of it and of its own timeout.
+ *
+ *   net_deadline_t dl = net_deadline_in(timeout_ms);
+ *   while (!done && !net_deadline_expired(dl)) { driver_call(..., net_deadline_left_ms(dl)); }
+ */
+
+/** Absolute deadline. A zeroed one is not armed: it never expires. */
+typedef struct {
+  uint32_t due;             /**< net_clock_ms() value at which it expires. */
+  bool armed;               /**< false: no deadline. */
+} net_deadline_t;
+
+#define NET_DEADLINE_NONE   ((net_deadline_t) { 0, false })
+
+uint32_t net_clock_ms(void);
+uint64_t net_clock_us(void);
+
+/** @brief  Deadline timeout_ms from now. */
+static inline net_deadline_t net_deadline_in(uint32_t timeout_ms)
+{
+  net_deadline_t dl = { net_clock_ms() + timeout_ms, true };
+  return dl;
+}
+
+/** @brief  The earlier of two deadlines. */
+static inline net_deadline_t net_deadline_min(net_deadline_t a, net_deadline_t b)
+{
+  if (!a.armed)
+  {
+    return b;
+  }
+  if (!b.armed)
+  {
+    return a;
+  }
+  return ((int32_t) (a.due - b.due) <= 0) ? a : b;
+}
+
+/** @brief  Time left until the deadline, in ms. 0 once expired, UINT32_MAX if not armed. */
+static inline uint32_t net_deadline_left_ms(net_deadline_t dl)
+{
+  int32_t left;
+
+  if (!dl.armed)
+  {
+    return UINT32_MAX;
+  }
+  left = (int32_t) (dl.due - net_clock_ms());
+  return (left > 0) ? (uint32_t) left : 0;
+}
+
+static inline bool net_deadline_expired(net_deadline_t dl)
+{
+  return dl.armed && ((int32_t) (dl.due - net_clock_ms()) <= 0);
+}
+
+#endif /* NET_INC_NET_CLOCK_H_ */
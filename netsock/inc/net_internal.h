@@ -48,10 +48,16 @@
 /* Includes ------------------------------------------------------------------*/
 #include <stdlib.h>   /* atoi() */
 #include <stdbool.h>
+#ifndef USE_HOST
 #include "main.h"
+#endif /* USE_HOST */
 #include "msg.h"
 #include "net.h"
 #include "net_srv.h"
+#include "net_rng.h"
+#include "net_pool.h"
+#include "net_sup.h"
+#include "net_mp.h"
 #include "net.conf.h"
 #include "log.h"
 
@@ -74,8 +80,10 @@
 #include "mbedtls/debug.h"
 #include "mbedtls/timing.h"
 #include "mbedtls_net.h"  /* mbedTLS data callbacks, implemented on WiFi_LL */
+#ifndef USE_HOST
 #include "heap.h"         /* memory allocator overloading */
 #include "aws_cert.h"
+#endif /* USE_HOST */
 #endif /* USE_MBED_TLS */
 
 
@@ -95,6 +103,23 @@
 #define NET_DEFAULT_BLOCKING_WRITE_TIMEOUT  2000
 #define NET_DEFAULT_BLOCKING_READ_TIMEOUT   2000
 #define NET_DEFAULT_BLOCKING                true
+#define NET_DEFAULT_BATCH_DEADLINE          5000  /**< sock_batch_deadline default. */
+
+#ifndef NET_STATS
+#define NET_STATS                           1     /**< Traffic and latency counters of net.c. 0 to compile them out. */
+#endif
+
+#ifdef USE_MBED_TLS
+#define NET_TLS_MAX_CIPHERSUITES            8     /**< Entries of the tls_ciphersuites socket option. */
+#if defined(MBEDTLS_KEY_EXCHANGE_ECDHE_ECDSA_ENABLED) && defined(MBEDTLS_GCM_C) && \
+    defined(MBEDTLS_ECP_DP_SECP256R1_ENABLED) && defined(MBEDTLS_SHA256_C)
+#define NET_TLS_LEAN_PROFILE                      /**< The "lean" tls_profile can be negotiated. */
+#endif
+#if defined(MBEDTLS_SSL_PROTO_DTLS)
+#define NET_DTLS_HS_TIMEOUT_MIN             1000  /**< First DTLS handshake retransmission timeout, in ms. Doubled on each retry. */
+#define NET_DTLS_HS_TIMEOUT_MAX             16000 /**< The DTLS handshake fails once the retransmission timeout exceeds it. */
+#endif
+#endif /* USE_MBED_TLS */
 
 
 /* Private typedef -----------------------------------------------------------*/
@@ -103,24 +128,44 @@ typedef struct net_sock_ctxt_s net_sock_ctxt_t;
 
 typedef int net_sock_create_t(net_hnd_t nethnd, net_sockhnd_t * sockhnd, net_proto_t proto);
 typedef int net_sock_open_t(net_sockhnd_t sockhnd, const char * hostname, int remoteport, int localport);
+typedef int net_sock_open_step_t(net_sockhnd_t sockhnd);
 typedef int net_sock_recv_t(net_sockhnd_t sockhnd, uint8_t * const buf, size_t len);
+typedef int net_sock_recv_buf_t(net_sockhnd_t sockhnd, net_buf_t * view, size_t maxlen);
+typedef int net_sock_release_buf_t(net_sockhnd_t sockhnd, net_buf_t * view);
 typedef int net_sock_recvfrom_t(net_sockhnd_t sockhnd, uint8_t * const buf, size_t len, net_ipaddr_t * remoteaddress, int * remoteport);
 typedef int net_sock_send_t(net_sockhnd_t sockhnd, const uint8_t * buf, size_t len);
+typedef int net_sock_sendv_t(net_sockhnd_t sockhnd, const net_iovec_t * iov, int iovcnt);
 typedef int net_sock_sendto_t(net_sockhnd_t sockhnd, const uint8_t * buf, size_t len,  net_ipaddr_t * remoteaddress, int remoteport);
 typedef int net_sock_close_t(net_sockhnd_t sockhnd);
 typedef int net_sock_destroy_t(net_sockhnd_t sockhnd);
+typedef int net_sock_flush_t(net_sockhnd_t sockhnd, bool force);
+typedef int net_sock_probe_t(net_sockhnd_t sockhnd, bool arm);
 
 typedef struct {
   net_sock_open_t     * open;
+  net_sock_open_t     * open_start;     /**< Optional. Non-blocking variant of open(). */
+  net_sock_open_step_t * open_step;     /**< Optional. Advances a connection started by open_start(). */
   net_sock_recv_t     * recv;
+  net_sock_recv_buf_t * recv_buf;       /**< Optional. Zero-copy variant of recv(). */
+  net_sock_release_buf_t * release_buf; /**< Optional. Mandatory with recv_buf(). */
   net_sock_recvfrom_t * recvfrom;
   net_sock_send_t     * send;
+  net_sock_sendv_t    * sendv;          /**< Optional. Gather write variant of send(). */
   net_sock_sendto_t   * sendto;
   net_sock_close_t    * close;
   net_sock_destroy_t  * destroy;
+  net_sock_flush_t    * flush;          /**< Optional. Sends the send queue: always if force, else only when due. */
+  net_sock_probe_t    * probe;          /**< Optional. Liveness check of an idle connection, see sock_keepalive.
+                                             arm: first probe since the open, the transport keepalive may be set up.
+                                             NET_OK: alive, NET_TIMEOUT: no answer, other: connection lost. */
 } net_sock_methods_t;
 
 #ifdef USE_MBED_TLS	/* For use with mbedTLS security stack*/
+typedef enum {
+  NET_TLS_PROFILE_DEFAULT = 0,  /**< Everything enabled in the mbedTLS configuration. */
+  NET_TLS_PROFILE_LEAN          /**< ECDHE-ECDSA, secp256r1, AES-128-GCM, SHA-256 only. */
+} net_tls_profile_t;
+
 typedef struct {
   unsigned char * tls_ca_certs; /**< Socket option. */
   unsigned char * tls_ca_crl;   /**< Socket option. */
@@ -130,9 +175,21 @@ typedef struct {
   size_t tls_dev_pwd_len;       /**< Socket option / meta. */
   bool tls_srv_verification;    /**< Socket option. */
   char * tls_srv_name;          /**< Socket option. */
+  uint8_t tls_mfl_code;         /**< Socket option. MBEDTLS_SSL_MAX_FRAG_LEN_xxx */
+  net_tls_profile_t tls_profile; /**< Socket option. */
+  int tls_ciphersuites[NET_TLS_MAX_CIPHERSUITES + 1]; /**< Socket option. Zero terminated, empty for the default list. */
+  uint32_t hs_start;            /**< Handshake start tick, for the duration log. */
+  bool hs_noblocking;           /**< The handshake is driven by net_sock_open_step(). */
+#if defined(MBEDTLS_SSL_PROTO_DTLS)
+  net_ipaddr_t dtls_peer;       /**< DTLS server address: the datagrams from other sources are dropped. */
+  int dtls_port;                /**< DTLS server port. */
+  uint32_t dtls_timer_start;    /**< Retransmission timer, see mbedtls_ssl_set_timer_cb(). */
+  uint32_t dtls_timer_int;      /**< Intermediate delay in ms. */
+  uint32_t dtls_timer_fin;      /**< Final delay in ms. 0: cancelled. */
+  mbedtls_ssl_session session;  /**< Session of the last DTLS handshake, offered again by the next open. */
+  bool session_saved;
+#endif /* MBEDTLS_SSL_PROTO_DTLS */
   /* mbedTLS objects */
-  mbedtls_entropy_context entropy;
-	mbedtls_ctr_drbg_context ctr_drbg;
 	mbedtls_ssl_context ssl;
 	mbedtls_ssl_config conf;
 	uint32_t flags;
@@ -150,8 +207,10 @@ struct net_sock_ctxt_s {
   net_sock_methods_t methods;           /**< Proto-specific function pointers. */
   net_proto_t proto;                    /**< Socket type. */
   bool blocking;                        /**< Socket option. */
+  bool open_pending;                    /**< A net_sock_open_start() connection is not completed yet. */
   uint16_t read_timeout;                /**< Socket option. */
   uint16_t write_timeout;               /**< Socket option. */
+  net_deadline_t deadline;              /**< Set by net_sock_set_deadline(), or by the layer above for the duration of a call. */
 #ifdef USE_MBED_TLS
   net_tls_data_t * tlsData;             /**< TLS specific context. */
 #else
@@ -160,6 +219,24 @@ struct net_sock_ctxt_s {
 #endif  /* USE_MBED_TLS */
   net_sockhnd_t underlying_sock_ctxt;   /**< Socket context of the underlying software layer. */
   int localport;                        /**< Local port number binding. Used by UDP sockets. */
+  uint32_t batch_size;                  /**< Socket option. 0: no send queue. */
+  uint32_t batch_deadline;              /**< Socket option. */
+  net_batch_stats_t batch_stats;        /**< Updated by the batching backends. */
+  uint32_t ka_idle;                     /**< Socket option sock_keepalive. 0: no probing. */
+  uint32_t ka_intvl;                    /**< Socket option sock_keepalive. */
+  uint8_t ka_cnt;                       /**< Socket option sock_keepalive. */
+  uint8_t ka_missed;                    /**< Consecutive unanswered probes. */
+  bool ka_armed;                        /**< The first probe since the open was done. */
+  bool ka_open;                         /**< Opened and not closed since: the probes are allowed. */
+  bool dead;                            /**< Found dead by the probes: the calls fail with NET_EOF. */
+  uint32_t last_heard;                  /**< Tick of the last received data or answered probe. */
+  uint32_t ka_last;                     /**< Tick of the last probe. */
+#ifdef USE_C2C
+  struct net_c2c_batch_s * c2c_batch;   /**< Send queue, allocated on the first batched send. */
+#endif /* USE_C2C */
+#if NET_STATS
+  net_stats_t stats;                    /**< Updated by net.c. */
+#endif
 };
 
 /** Network interface context. */
@@ -167,6 +244,9 @@ struct net_ctxt_s {
   net_if_t itf;
   bool net_is_up;
   net_sock_ctxt_t * sock_list;  /**< Linked list of the sockets opened on the network interface. */
+#if NET_STATS
+  net_stats_t stats;             /**< Sum of the socket counters, see net_get_stats(). */
+#endif
 #ifdef USE_LWIP
   struct netif lwip_netif;       /**< LwIP interface context. */
 #endif /* USE_LWIP */
@@ -181,8 +261,12 @@ struct net_ctxt_s {
 #define net_free(a)   free((a))
 
 int32_t net_timeout_left_ms(uint32_t init, uint32_t now, uint32_t timeout);
+net_deadline_t net_sock_deadline(net_sock_ctxt_t * sock, uint32_t timeout_ms);
 #ifdef USE_MBED_TLS
 extern int mbedtls_hardware_poll( void *data, unsigned char *output, size_t len, size_t *olen );
+#if defined(MBEDTLS_SSL_DTLS_HELLO_VERIFY) && defined(MBEDTLS_SSL_SRV_C) && defined(MBEDTLS_SSL_COOKIE_C)
+int net_tls_conf_dtls_cookies(mbedtls_ssl_config * conf);
+#endif
 #endif /* USE_MBED_TLS */
 
 
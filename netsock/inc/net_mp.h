@@ -0,0 +1,101 @@
+/*
+ * net_mp.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Daruin Solano
+ */
+
+#ifndef NET_INC_NET_MP_H_
+#define NET_INC_NET_MP_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "net.h"
+
+/* Multipath: failover of client connections between the interfaces brought up by net_init()
+ * (WLAN, ETH, C2C), above net.c.
+ *  - Each interface is probed periodically: the TCP connection setup time to a probe endpoint
+ *    gives its RTT, and a few failed probes in a row take it out of service. net_is_up() alone
+ *    is not enough: ETH and C2C always report up.
+ *  - A logical socket (net_mp_sock_t) is bound to a traffic class rather than to an interface.
+ *    It is (re)opened on the best interface for its class: the lowest RTT among the interfaces
+ *    preferred by the class, else the lowest RTT among the others.
+ *  - When its connection fails it is re-established on the best interface, and when a better
+ *    one is back, net_mp_sock_check() moves it there between two transactions.
+ *
+ *   net_mp_init(&mp, "example.com", 443);
+ *   net_mp_add_if(&mp, hwifi, "wlan", NET_MP_CLASS_TELEMETRY);
+ *   net_mp_add_if(&mp, heth, "eth", NET_MP_CLASS_BULK);
+ *   net_mp_add_if(&mp, hc2c, "c2c", 0);
+ *   ... periodically: net_mp_poll(&mp);
+ *
+ * A re-established connection is a new connection: the application protocol must start over
+ * (e.g. MQTT CONNECT) whenever net_mp_sock_generation() changed.
+ */
+
+#define NET_MP_MAX_IF             3       /**< One interface of each type: WLAN, ETH, C2C. */
+#define NET_MP_HOST_SIZE          80      /**< Max length of a host name, \0 included. */
+#define NET_MP_PROBE_INTERVAL     30000   /**< ms between two probes of an interface. */
+#define NET_MP_PROBE_FAILS        2       /**< Consecutive failed probes taking an interface out of service. */
+#define NET_MP_RTT_UNKNOWN        UINT32_MAX
+
+/** Traffic classes, as a bit mask of the classes preferring an interface. */
+typedef enum {
+  NET_MP_CLASS_TELEMETRY = 0x01,  /**< Small, latency sensitive messages. */
+  NET_MP_CLASS_BULK      = 0x02   /**< Transfers: firmware, logs, files. */
+} net_mp_class_t;
+
+typedef struct {
+  net_hnd_t nethnd;
+  const char * name;              /**< For the logs. */
+  uint8_t prefer;                 /**< net_mp_class_t mask of the classes preferring this interface. */
+  bool usable;                    /**< Link up and the last probes succeeded. */
+  uint8_t probe_fails;            /**< Consecutive failed probes. */
+  uint32_t rtt_ms;                /**< Smoothed probe RTT. NET_MP_RTT_UNKNOWN until the first success. */
+  uint32_t last_probe;            /**< Tick of the last probe. */
+  uint32_t probes;                /**< Probes done. */
+} net_mp_if_t;
+
+typedef struct {
+  net_mp_if_t itf[NET_MP_MAX_IF];
+  uint8_t count;
+  char probe_host[NET_MP_HOST_SIZE];
+  int probe_port;
+} net_mp_t;
+
+/**
+ * @brief   Callback type: configure a socket freshly created by net_mp, before it is opened
+ *          (TLS credentials, timeouts... see net_sock_setopt()).
+ * @retval  NET_OK, or an error to give the interface up.
+ */
+typedef int net_mp_setup_t(net_sockhnd_t sockhnd, void * arg);
+
+/** Logical client connection. */
+typedef struct {
+  net_mp_t * mp;
+  net_mp_class_t cls;
+  net_proto_t proto;
+  char host[NET_MP_HOST_SIZE];
+  int port;
+  net_mp_setup_t * setup;
+  void * setup_arg;
+  net_sockhnd_t sockhnd;          /**< Current connection. NULL: none. */
+  int itf;                        /**< Index of its interface in mp->itf. -1: none. */
+  uint32_t generation;            /**< Connections established so far. */
+} net_mp_sock_t;
+
+int net_mp_init(net_mp_t * mp, const char * probe_host, int probe_port);
+int net_mp_add_if(net_mp_t * mp, net_hnd_t nethnd, const char * name, uint8_t prefer);
+void net_mp_poll(net_mp_t * mp);
+void net_mp_probe(net_mp_t * mp, int itf);
+int net_mp_best(net_mp_t * mp, net_mp_class_t cls);
+
+int net_mp_sock_open(net_mp_sock_t * ms, net_mp_t * mp, net_mp_class_t cls, net_proto_t proto,
+                     const char * host, int port, net_mp_setup_t * setup, void * setup_arg);
+int net_mp_sock_send(net_mp_sock_t * ms, const uint8_t * buf, size_t len);
+int net_mp_sock_recv(net_mp_sock_t * ms, uint8_t * buf, size_t len);
+int net_mp_sock_check(net_mp_sock_t * ms);
+uint32_t net_mp_sock_generation(net_mp_sock_t * ms);
+int net_mp_sock_close(net_mp_sock_t * ms);
+
+#endif /* NET_INC_NET_MP_H_ */
@@ -25,6 +25,9 @@
 #define MQTT_SEND_BUFFER_SIZE             600
 #endif /* LITMUS_LOOP */
 #define MQTT_READ_BUFFER_SIZE             600
+#define MQTT_TLS_MAX_FRAG_LEN             "2048" /**< TLS record size negotiated for the MQTT socket. Ascii. "0" for the default. */
+#define MQTT_SOCK_KEEPALIVE               "15000,5000,3" /**< sock_keepalive of the MQTT socket: idle, interval in ms, probes. Ascii. */
+/* #define MQTT_TLS_PROFILE                "lean" */ /**< tls_profile of the MQTT socket. Needs an ECDSA P-256 broker certificate chain. */
 #define MQTT_CMD_TIMEOUT                  5000
 #define MAX_SOCKET_ERRORS_BEFORE_NETIF_RESET  3
 
@@ -44,6 +47,9 @@ typedef struct Network_s Network;
 
 typedef int net_read_t(Network* n, unsigned char* buffer, int len, int timeout_ms);
 typedef int net_write_t(Network* n, unsigned char* buffer, int len, int timeout_ms);
+typedef int net_writev_t(Network* n, const net_iovec_t* iov, int iovcnt, int timeout_ms);
+typedef int net_read_buf_t(Network* n, net_buf_t* view, int maxlen, int timeout_ms);
+typedef int net_release_buf_t(Network* n, net_buf_t* view);
 typedef int net_disconnect_t(Network* n);
 
 
@@ -96,6 +102,9 @@ struct Network_s
 	net_read_t       *	mqttread;
 	net_write_t      *	mqttwrite;
 	net_disconnect_t *	mqttdisconnect;
+	net_writev_t     *	mqttwritev;		/* Optional. Gather write: publishes larger than the send buffer are sent without copying their payload. */
+	net_read_buf_t   *	mqttreadbuf;	/* Optional. Zero-copy read: the packets are parsed in the receive buffers of the stack. */
+	net_release_buf_t *	mqttreleasebuf;	/* Mandatory with mqttreadbuf. */
 	net_hnd_t 			netHandle;
 	net_sockhnd_t	 	sockHandle;
 	uint16_t			port;
@@ -103,6 +112,7 @@ struct Network_s
 };
 
 int  mqtt_network_init(Network *n, device_config_t* dev);
+int  mqtt_network_open(Network *n, device_config_t* dev);
 void MutexLock(Mutex* mtx, int timeout);
 void MutexUnlock(Mutex* mtx);
 void MutexInit(Mutex* mtx);
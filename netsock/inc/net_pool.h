@@ -0,0 +1,36 @@
+/*
+ * net_pool.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Daruin Solano
+ */
+
+#ifndef NET_INC_NET_POOL_H_
+#define NET_INC_NET_POOL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "net.h"
+
+/* Pool of idle keep-alive client connections, keyed by interface, protocol, host and port.
+ * A connection is either in the pool or owned by exactly one user. Typical use:
+ *
+ *   if (net_pool_get(hnet, NET_PROTO_TLS, host, 443, &sock) != NET_OK) {
+ *     net_sock_create(), net_sock_setopt(), net_sock_open() as usual
+ *   }
+ *   ... request / complete response ...
+ *   keep-alive ? net_pool_put(sock, host, 443) : net_sock_close() + net_sock_destroy()
+ */
+
+#define NET_POOL_SIZE             2       /**< Max idle connections. The WiFi module has 4 sockets in all. */
+#define NET_POOL_HOST_SIZE        80      /**< Max length of a pooled host name, \0 included. */
+#define NET_POOL_IDLE_TIMEOUT     15000   /**< Idle connections are closed after this many ms. */
+#define NET_POOL_PROBE_TIMEOUT    1       /**< Read timeout (ms) of the health check of a reused connection. */
+
+int net_pool_init(void);
+int net_pool_get(net_hnd_t nethnd, net_proto_t proto, const char * host, int port, net_sockhnd_t * sockhnd);
+int net_pool_put(net_sockhnd_t sockhnd, const char * host, int port);
+void net_pool_expire(void);
+void net_pool_flush(net_hnd_t nethnd);
+
+#endif /* NET_INC_NET_POOL_H_ */
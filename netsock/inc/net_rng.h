@@ -0,0 +1,25 @@
+/*
+ * net_rng.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Daruin Solano
+ */
+
+#ifndef NET_INC_NET_RNG_H_
+#define NET_INC_NET_RNG_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Process-wide CTR_DRBG, seeded from the STM32 RNG through mbedtls_hardware_poll().
+ * Shared by all the TLS sockets and the WebSocket client. */
+
+#define NET_RNG_RESEED_INTERVAL   1000  /**< Number of DRBG requests between two automatic reseeds from the hardware RNG. */
+#define NET_RNG_POOL_SIZE         32    /**< Buffered output for short requests (masking keys, nonces). 0 to disable. */
+
+int net_rng_init(void);
+int net_rng_reseed(void);
+int net_rng_random(void *p_rng, unsigned char *output, size_t len);
+int net_rng_bytes(uint8_t *buf, size_t len);
+
+#endif /* NET_INC_NET_RNG_H_ */
@@ -0,0 +1,61 @@
+/*
+ * net_sup.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Daruin Solano
+ */
+
+#ifndef NET_INC_NET_SUP_H_
+#define NET_INC_NET_SUP_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "net.h"
+
+/* Connection supervisor: decides when a client may try to (re)connect to one endpoint.
+ *  - Jittered exponential backoff between failed attempts, so that the clients which lost
+ *    their connection at the same time do not retry in step.
+ *  - Circuit breaker: after breaker_threshold consecutive failures the endpoint is left alone
+ *    for breaker_open_ms, then a single trial attempt decides whether it closes again.
+ *  - Link supervision: no attempt while the interface is down; once it is up again, the
+ *    backoff is cleared and the first attempt is spread at random over linkup_spread_ms.
+ *
+ *   while (!connected) {
+ *     if (!net_sup_ready(&sup)) { HAL_Delay(net_sup_wait_ms(&sup)); continue; }
+ *     connect() == OK ? net_sup_success(&sup) : net_sup_failure(&sup);
+ *   }
+ */
+
+typedef enum {
+  NET_SUP_CLOSED = 0,       /**< Normal operation: attempts are paced by the backoff. */
+  NET_SUP_OPEN,             /**< Too many failures: no attempt until breaker_open_ms elapsed. */
+  NET_SUP_HALF_OPEN         /**< One trial attempt allowed. */
+} net_sup_breaker_t;
+
+typedef struct {
+  uint32_t backoff_min_ms;      /**< Backoff after the first failure. */
+  uint32_t backoff_max_ms;      /**< Cap of the exponential backoff. */
+  uint16_t breaker_threshold;   /**< Consecutive failures opening the breaker. 0: no breaker. */
+  uint32_t breaker_open_ms;     /**< Time the breaker stays open. */
+  uint32_t linkup_spread_ms;    /**< Window over which the first attempt after a link-up is spread. */
+} net_sup_conf_t;
+
+#define NET_SUP_CONF_DEFAULT  { 1000, 60000, 8, 300000, 3000 }
+
+typedef struct {
+  const char * name;            /**< Endpoint name, for the logs. */
+  net_hnd_t nethnd;             /**< Interface whose link is supervised. NULL: none. */
+  net_sup_conf_t conf;
+  net_sup_breaker_t breaker;
+  uint16_t failures;            /**< Consecutive failures. */
+  uint32_t next_try;            /**< Tick from which the next attempt is allowed. */
+  bool link_down;               /**< The link was seen down since the last attempt. */
+} net_sup_t;
+
+void net_sup_init(net_sup_t * sup, const char * name, net_hnd_t nethnd, const net_sup_conf_t * conf);
+bool net_sup_ready(net_sup_t * sup);
+uint32_t net_sup_wait_ms(net_sup_t * sup);
+void net_sup_success(net_sup_t * sup);
+void net_sup_failure(net_sup_t * sup);
+
+#endif /* NET_INC_NET_SUP_H_ */
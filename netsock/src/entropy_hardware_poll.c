@@ -46,6 +46,8 @@
 #include <string.h>
 #include "net.conf.h"
 
+#ifndef USE_HOST  /* Host builds: see net_tcp_host.c */
+
 int mbedtls_hardware_poll( void *data,
                     unsigned char *output, size_t len, size_t *olen );
 
@@ -71,4 +73,6 @@ int mbedtls_hardware_poll( void *data,
   return 0;
 }
 
+#endif /* USE_HOST */
+
 /************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
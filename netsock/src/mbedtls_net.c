@@ -46,7 +46,7 @@
 /* Includes ------------------------------------------------------------------*/
 #include "mbedtls_net.h"
 #include "mbedtls/ssl.h"
-#include "net.h"
+#include "net_internal.h"
 #include "msg.h"
 #include <string.h>
 
@@ -71,40 +71,31 @@ int mbedtls_net_recv(void *ctx, unsigned char *buf, size_t len)
 }
 
 
-/* Blocking interface implementation.*/
+/* Blocking interface implementation.
+ * The timeout is that of the TLS layer: the reads also stop at the deadline it set on the socket,
+ * so that the successive reads of one record do not each get the full timeout. */
 int mbedtls_net_recv_blocking(void *ctx, unsigned char *buf, size_t len, uint32_t timeout)
 {
+  net_sock_ctxt_t *sock = (net_sock_ctxt_t *) ctx;
   int ret = 0;
-  char stimeout[8];
   
-  if ((sizeof(stimeout) - 1) <= snprintf(stimeout, sizeof(stimeout), "%lu",timeout))
+  sock->read_timeout = (uint16_t) MIN(timeout, UINT16_MAX);
+  ret = net_sock_recv((net_sockhnd_t) ctx, buf, len);
+  
+  if (ret > 0)
   {
-    msg_error("mbedtls_net_recv_blocking(): out of range timeout %lu\n", timeout);
-    return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    return ret;
   }
-  
-  if (net_sock_setopt((net_sockhnd_t) ctx, "sock_read_timeout", (uint8_t *)stimeout, strlen(stimeout) + 1) == NET_OK)
+  switch(ret)
   {
-    ret = net_sock_recv((net_sockhnd_t) ctx, buf, len);
-  
-    if (ret > 0)
-    {
-      return ret;
-    }
-    else
-    {
-      switch(ret)
-      {
-        case 0:
-          return MBEDTLS_ERR_SSL_WANT_READ; 
-        case NET_TIMEOUT:
-          /* According to mbedtls headers, MBEDTLS_ERR_SSL_TIMEOUT should be returned. */
-          /* But it saturates the error log with false errors. By contrast, MBEDTLS_ERR_SSL_WANT_READ does not raise any error. */
-          return MBEDTLS_ERR_SSL_WANT_READ;
-        default:
-          ;
-      }
-    }
+    case 0:
+      return MBEDTLS_ERR_SSL_WANT_READ; 
+    case NET_TIMEOUT:
+      /* According to mbedtls headers, MBEDTLS_ERR_SSL_TIMEOUT should be returned. */
+      /* But it saturates the error log with false errors. By contrast, MBEDTLS_ERR_SSL_WANT_READ does not raise any error. */
+      return MBEDTLS_ERR_SSL_WANT_READ;
+    default:
+      ;
   }
   
   msg_error("mbedtls_net_recv_blocking(): error %d in net_sock_recv() - requestedLen=%d\n", ret, len);
@@ -58,14 +58,36 @@ extern int net_sock_create_c2c(net_hnd_t nethnd, net_sockhnd_t * sockhnd, net_pr
 extern int net_sock_create_lwip(net_hnd_t nethnd, net_sockhnd_t * sockhnd, net_proto_t proto);
 extern int net_get_hostaddress_lwip(net_hnd_t nethnd, net_ipaddr_t * ipAddress, const char * host);
 #endif /* USE_LWIP */
+#ifdef USE_HOST
+extern int net_sock_create_host(net_hnd_t nethnd, net_sockhnd_t * sockhnd, net_proto_t proto);
+extern int net_get_hostaddress_host(net_ipaddr_t * ipAddress, const char * host);
+extern int net_get_ip_address_host(net_ipaddr_t * ipAddress);
+extern int net_get_mac_address_host(net_macaddr_t * macAddress);
+#endif /* USE_HOST */
 #ifdef USE_MBED_TLS
 extern int net_sock_create_mbedtls(net_hnd_t nethnd, net_sockhnd_t * sockhnd, net_proto_t proto);
 #endif /* USE_MBED_TLS */
 
 /* Private defines -----------------------------------------------------------*/
+#if NET_STATS
+#define net_stats_tick()	net_clock_ms()
+#else
+#define net_stats_tick()	0U
+#define net_stats_record(sock, tx, rc, t0)	((void) (t0))
+#endif /* NET_STATS */
+#define NET_SENDV_BOUNCE_SIZE	128	/**< net_sock_sendv() without backend support: segments shorter than this are coalesced. */
+
 /* Private typedef -----------------------------------------------------------*/
 /* Private variables ---------------------------------------------------------*/
 /* Private function prototypes -----------------------------------------------*/
+#if NET_STATS
+static void net_stats_record(net_sock_ctxt_t *sock, bool tx, int rc, uint32_t t0);
+#endif /* NET_STATS */
+static void net_ka_reset(net_sock_ctxt_t *sock);
+static void net_ka_check(net_sock_ctxt_t *sock);
+static int net_ka_recv_done(net_sock_ctxt_t *sock, int rc);
+static int net_ka_parse(net_sock_ctxt_t *sock, char const *conf, size_t len);
+static bool net_sendv_chunk(net_sockhnd_t sockhnd, const uint8_t *buf, size_t len, int *sent, int *rc);
 
 /* Functions Definition ------------------------------------------------------*/
 
@@ -109,6 +131,14 @@ int net_init(net_hnd_t *nethnd, net_if_t interface, net_if_init_t *f_netinit) {
           }
           break;
     #endif /* USE_LWIP */
+#ifdef USE_HOST
+			case NET_IF_HOST:
+				ctxt->itf = interface;
+				if (f_netinit(NULL) == 0) {
+					rc = NET_OK;
+				}
+				break;
+#endif /* USE_HOST */
 			default:
 				msg_error("net_init: interface type of %d not implemented...",
 						interface)
@@ -121,6 +151,9 @@ int net_init(net_hnd_t *nethnd, net_if_t interface, net_if_init_t *f_netinit) {
 	if (rc == NET_OK) {
 		*nethnd = (net_hnd_t) ctxt;
 		ctxt->net_is_up = net_is_up(*nethnd);
+		/* Seed the shared DRBG now rather than at the first TLS connection. */
+		(void) net_rng_init();
+		(void) net_pool_init();
 	} else {
 		if (ctxt != NULL) {
 			net_free(ctxt);
@@ -137,6 +170,7 @@ int net_deinit(net_hnd_t nethnd, net_if_deinit_t *f_netdeinit) {
 	if (f_netdeinit == NULL) {
 		rc = NET_PARAM;
 	} else {
+		net_pool_flush(nethnd);
 		if (ctxt->sock_list != NULL) {
 			rc = NET_PARAM;
 		} else {
@@ -159,6 +193,12 @@ int net_deinit(net_hnd_t nethnd, net_if_deinit_t *f_netdeinit) {
           rc = NET_OK;
           break;
     #endif /* USE_LWIP */
+#ifdef USE_HOST
+			case NET_IF_HOST:
+				f_netdeinit(NULL);
+				rc = NET_OK;
+				break;
+#endif /* USE_HOST */
 			default:
 				msg_error("net_deinit: interface type of %d not implemented...",
 						ctxt->itf)
@@ -181,6 +221,7 @@ int net_reinit(net_hnd_t nethnd, net_if_reinit_t *f_netreinit) {
 	if (f_netreinit == NULL) {
 		rc = NET_PARAM;
 	} else {
+		net_pool_flush(nethnd);
 		if (ctxt->sock_list != NULL) {
 			rc = NET_PARAM;
 		} else {
@@ -203,6 +244,12 @@ int net_reinit(net_hnd_t nethnd, net_if_reinit_t *f_netreinit) {
           rc = NET_OK;
           break;
     #endif /* USE_LWIP */
+#ifdef USE_HOST
+			case NET_IF_HOST:
+				f_netreinit(NULL);
+				rc = NET_OK;
+				break;
+#endif /* USE_HOST */
 			default:
 				msg_error("net_reinit: interface type of %d not implemented.\n",
 						ctxt->itf)
@@ -276,6 +323,11 @@ int net_get_ip_address(net_hnd_t nethnd, net_ipaddr_t *ipAddress) {
         break;
       }
 #endif /* USE_LWIP */
+#ifdef USE_HOST
+		case NET_IF_HOST:
+			rc = net_get_ip_address_host(ipAddress);
+			break;
+#endif /* USE_HOST */
 		default:
 			msg_error(
 					"net_get_ip_address: interface type of %d not implemented.\n",
@@ -334,6 +386,11 @@ int net_get_mac_address(net_hnd_t nethnd, net_macaddr_t *macAddress) {
     }
     break;
 #endif /* USE_LWIP */
+#ifdef USE_HOST
+	case NET_IF_HOST:
+		rc = net_get_mac_address_host(macAddress);
+		break;
+#endif /* USE_HOST */
 	default:
 		msg_error(
 				"net_get_mac_address: interface type of %d not implemented.\n",
@@ -394,6 +451,11 @@ int net_get_hostaddress(net_hnd_t nethnd, net_ipaddr_t *ipAddress,
         return net_get_hostaddress_lwip(nethnd, ipAddress, host);
       }
 #endif /* USE_LWIP */
+#ifdef USE_HOST
+		case NET_IF_HOST:
+			rc = net_get_hostaddress_host(ipAddress, host);
+			break;
+#endif /* USE_HOST */
 		default:
 			msg_error(
 					"net_get_ip_address: interface type of %d not implemented.\n",
@@ -426,6 +488,10 @@ int net_sock_create(net_hnd_t nethnd, net_sockhnd_t *sockhnd, net_proto_t proto)
         case NET_IF_ETH:
           return net_sock_create_lwip(nethnd, sockhnd, proto);
 #endif /* USE_LWIP */
+#ifdef USE_HOST
+		case NET_IF_HOST:
+			return net_sock_create_host(nethnd, sockhnd, proto);
+#endif /* USE_HOST */
 		default:
 			;
 		}
@@ -433,6 +499,9 @@ int net_sock_create(net_hnd_t nethnd, net_sockhnd_t *sockhnd, net_proto_t proto)
 
 	case NET_PROTO_TLS:
 #ifdef USE_MBED_TLS
+#if defined(MBEDTLS_SSL_PROTO_DTLS)
+	case NET_PROTO_DTLS:
+#endif /* MBEDTLS_SSL_PROTO_DTLS */
       return net_sock_create_mbedtls(nethnd, sockhnd, proto);
 #else
 	case NET_PROTO_MQTT:	// use wifi module mqtt and tls stack
@@ -448,9 +517,92 @@ int net_sock_create(net_hnd_t nethnd, net_sockhnd_t *sockhnd, net_proto_t proto)
 int net_sock_open(net_sockhnd_t sockhnd, const char *hostname,
 		net_ipaddr_t *ipAddress, int remoteport, int localport) {
 	net_sock_ctxt_t *sock = (net_sock_ctxt_t*) sockhnd;
-	return sock->methods.open(sockhnd, hostname, remoteport, localport);
+	int rc = sock->methods.open(sockhnd, hostname, remoteport, localport);
+
+	if (rc == NET_OK) {
+		net_ka_reset(sock);
+	}
+	return rc;
 }
 
+int net_sock_open_start(net_sockhnd_t sockhnd, const char *hostname,
+		int remoteport, int localport) {
+	int rc = NET_ERR;
+	net_sock_ctxt_t *sock = (net_sock_ctxt_t*) sockhnd;
+
+	if (sock->methods.open_start == NULL) {
+		/* No asynchronous variant for this protocol: plain open. */
+		sock->open_pending = false;
+		rc = sock->methods.open(sockhnd, hostname, remoteport, localport);
+	} else {
+		rc = sock->methods.open_start(sockhnd, hostname, remoteport, localport);
+		sock->open_pending = (rc == NET_IN_PROGRESS);
+	}
+	if (rc == NET_OK) {
+		net_ka_reset(sock);
+	}
+	return rc;
+}
+
+int net_sock_open_step(net_sockhnd_t sockhnd) {
+	int rc = NET_OK;
+	net_sock_ctxt_t *sock = (net_sock_ctxt_t*) sockhnd;
+
+	if (sock->open_pending) {
+		rc = (sock->methods.open_step != NULL) ?
+				sock->methods.open_step(sockhnd) : NET_PARAM;
+		sock->open_pending = (rc == NET_IN_PROGRESS);
+		if (rc == NET_OK) {
+			net_ka_reset(sock);
+		}
+	}
+	return rc;
+}
+
+bool net_sock_open_is_done(net_sockhnd_t sockhnd) {
+	net_sock_ctxt_t *sock = (net_sock_ctxt_t*) sockhnd;
+	return !sock->open_pending;
+}
+
+#ifdef USE_MBED_TLS
+/**
+ * @brief   Parse a comma separated list of mbedTLS ciphersuite names
+ *          (eg. "TLS-ECDHE-ECDSA-WITH-AES-128-GCM-SHA256") into a zero terminated id list.
+ * @retval  NET_OK, or NET_PARAM if a name is unknown or the list is too long. ids is left empty on error.
+ */
+static int net_tls_parse_ciphersuites(int *ids, char const *list, size_t len) {
+	char name[64];
+	size_t n = 0;
+	size_t i = 0;
+
+	while ((i < len) && (list[i] != '\0')) {
+		size_t l = 0;
+		while ((i < len) && (list[i] != '\0') && (list[i] != ',')) {
+			if ((list[i] != ' ') && (l < sizeof(name) - 1)) {
+				name[l++] = list[i];
+			}
+			i++;
+		}
+		if (i < len && list[i] == ',') {
+			i++;
+		}
+		if (l == 0) {
+			continue;
+		}
+		name[l] = '\0';
+		if ((n == NET_TLS_MAX_CIPHERSUITES)
+				|| ((ids[n] = mbedtls_ssl_get_ciphersuite_id(name)) == 0)) {
+			msg_error("tls_ciphersuites: %s rejected.\n", name);
+			ids[0] = 0;
+			return NET_PARAM;
+		}
+		n++;
+	}
+	ids[n] = 0;
+	return (n > 0) ? NET_OK : NET_PARAM;
+}
+#endif /* USE_MBED_TLS */
+
 int net_sock_setopt(net_sockhnd_t sockhnd, const char *optname,
 		const uint8_t *optbuf, size_t optlen) {
 	int rc = NET_PARAM;
@@ -459,7 +611,7 @@ int net_sock_setopt(net_sockhnd_t sockhnd, const char *optname,
 
 #ifdef USE_MBED_TLS
   net_tls_data_t * tlsData = sock->tlsData;
-  if ( (sock->proto == NET_PROTO_TLS) && (tlsData != NULL) )
+  if ( ((sock->proto == NET_PROTO_TLS) || (sock->proto == NET_PROTO_DTLS)) && (tlsData != NULL) )
   {
     if (strcmp(optname, "tls_ca_certs") == 0)
     {
@@ -518,6 +670,54 @@ int net_sock_setopt(net_sockhnd_t sockhnd, const char *optname,
         rc = NET_OK;
       }
     }
+#if defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
+    if (strcmp(optname, "tls_max_frag_len") == 0)
+    {
+      if (has_opt_data)
+      {
+        rc = NET_OK;
+        switch (atoi((char const *) optbuf))
+        {
+          case 0:    tlsData->tls_mfl_code = MBEDTLS_SSL_MAX_FRAG_LEN_NONE; break;
+          case 512:  tlsData->tls_mfl_code = MBEDTLS_SSL_MAX_FRAG_LEN_512;  break;
+          case 1024: tlsData->tls_mfl_code = MBEDTLS_SSL_MAX_FRAG_LEN_1024; break;
+          case 2048: tlsData->tls_mfl_code = MBEDTLS_SSL_MAX_FRAG_LEN_2048; break;
+          case 4096: tlsData->tls_mfl_code = MBEDTLS_SSL_MAX_FRAG_LEN_4096; break;
+          default:   rc = NET_PARAM;
+        }
+      }
+    }
+#endif /* MBEDTLS_SSL_MAX_FRAGMENT_LENGTH */
+    if (strcmp(optname, "tls_profile") == 0)
+    {
+      if (has_opt_data)
+      {
+        if (strcmp((char const *) optbuf, "default") == 0)
+        {
+          tlsData->tls_profile = NET_TLS_PROFILE_DEFAULT;
+          rc = NET_OK;
+        }
+#ifdef NET_TLS_LEAN_PROFILE
+        if (strcmp((char const *) optbuf, "lean") == 0)
+        {
+          tlsData->tls_profile = NET_TLS_PROFILE_LEAN;
+          rc = NET_OK;
+        }
+#endif /* NET_TLS_LEAN_PROFILE */
+      }
+    }
+    if (strcmp(optname, "tls_ciphersuites") == 0)
+    {
+      if (has_opt_data)
+      {
+        rc = net_tls_parse_ciphersuites(tlsData->tls_ciphersuites, (char const *) optbuf, optlen);
+      }
+      else
+      {
+        tlsData->tls_ciphersuites[0] = 0;
+        rc = NET_OK;
+      }
+    }
   }
 #else
   WiFi_Tls_t * tlsData = sock->wifi_tls;
@@ -605,40 +805,209 @@ int net_sock_setopt(net_sockhnd_t sockhnd, const char *optname,
 			rc = NET_OK;
 		}
 	}
+	/* Only the backends with a send queue take the batching options. */
+	if ((strcmp(optname, "sock_batch_size") == 0) && (sock->methods.flush != NULL)) {
+		if (has_opt_data) {
+			/* The queued payload goes out with the former settings. */
+			(void) sock->methods.flush(sockhnd, true);
+			sock->batch_size = atoi((char const*) optbuf);
+			rc = NET_OK;
+		}
+	}
+	if ((strcmp(optname, "sock_batch_deadline") == 0) && (sock->methods.flush != NULL)) {
+		if (has_opt_data) {
+			sock->batch_deadline = atoi((char const*) optbuf);
+			rc = NET_OK;
+		}
+	}
+	if ((strcmp(optname, "sock_keepalive") == 0) && (sock->methods.probe != NULL)) {
+		if (has_opt_data) {
+			rc = net_ka_parse(sock, (char const*) optbuf, optlen);
+		}
+	}
 	return rc;
 }
 
 int net_sock_recv(net_sockhnd_t sockhnd, uint8_t *const buf, size_t len) {
+	int rc;
+	uint32_t t0;
 	net_sock_ctxt_t *sock = (net_sock_ctxt_t*) sockhnd;
-	return (sock->methods.recv != NULL) ?
-			sock->methods.recv(sockhnd, buf, len) : NET_PARAM;
+
+	if (sock->methods.recv == NULL) {
+		return NET_PARAM;
+	}
+	if (sock->dead) {
+		return NET_EOF;
+	}
+	t0 = net_stats_tick();
+	rc = sock->methods.recv(sockhnd, buf, len);
+	net_stats_record(sock, false, rc, t0);
+	return net_ka_recv_done(sock, rc);
+}
+
+int net_sock_recv_buf(net_sockhnd_t sockhnd, net_buf_t *view, size_t maxlen) {
+	int rc = NET_ERR;
+	uint32_t t0;
+	net_sock_ctxt_t *sock = (net_sock_ctxt_t*) sockhnd;
+	uint8_t *buf = NULL;
+
+	if ((view == NULL) || (maxlen == 0)) {
+		return NET_PARAM;
+	}
+	memset(view, 0, sizeof(net_buf_t));
+	if (sock->dead) {
+		return NET_EOF;
+	}
+
+	if (sock->methods.recv_buf != NULL) {
+		t0 = net_stats_tick();
+		rc = sock->methods.recv_buf(sockhnd, view, maxlen);
+		net_stats_record(sock, false, rc, t0);
+		return net_ka_recv_done(sock, rc);
+	}
+
+	/* No zero-copy support in the backend: receive into a buffer owned by the view. */
+	if (sock->methods.recv == NULL) {
+		return NET_PARAM;
+	}
+	buf = net_malloc(maxlen);
+	if (buf == NULL) {
+		msg_error("net_sock_recv_buf: allocation failed.\n");
+		return NET_ERR;
+	}
+	t0 = net_stats_tick();
+	rc = sock->methods.recv(sockhnd, buf, maxlen);
+	net_stats_record(sock, false, rc, t0);
+	if (rc > 0) {
+		view->data = buf;
+		view->len = (size_t) rc;
+		view->priv = buf;
+	} else {
+		net_free(buf);
+	}
+	return net_ka_recv_done(sock, rc);
+}
+
+int net_sock_release_buf(net_sockhnd_t sockhnd, net_buf_t *view) {
+	int rc = NET_OK;
+	net_sock_ctxt_t *sock = (net_sock_ctxt_t*) sockhnd;
+
+	if (view == NULL) {
+		return NET_PARAM;
+	}
+	if (view->priv != NULL) {
+		if (sock->methods.release_buf != NULL) {
+			rc = sock->methods.release_buf(sockhnd, view);
+		} else {
+			net_free(view->priv);
+		}
+	}
+	memset(view, 0, sizeof(net_buf_t));
+	return rc;
+}
+
+bool net_sock_is_zero_copy(net_sockhnd_t sockhnd) {
+	net_sock_ctxt_t *sock = (net_sock_ctxt_t*) sockhnd;
+	return (sock != NULL) && (sock->methods.recv_buf != NULL);
 }
 
 int net_sock_recvfrom(net_sockhnd_t sockhnd, uint8_t *const buf, size_t len,
 		net_ipaddr_t *remoteaddress, int *remoteport) {
+	int rc;
+	uint32_t t0;
 	net_sock_ctxt_t *sock = (net_sock_ctxt_t*) sockhnd;
-	return (sock->methods.recvfrom != NULL) ?
-			sock->methods.recvfrom(sockhnd, buf, len, remoteaddress,
-					remoteport) :
-			NET_PARAM;
+
+	if (sock->methods.recvfrom == NULL) {
+		return NET_PARAM;
+	}
+	t0 = net_stats_tick();
+	rc = sock->methods.recvfrom(sockhnd, buf, len, remoteaddress, remoteport);
+	net_stats_record(sock, false, rc, t0);
+	return rc;
 }
 
 int net_sock_send(net_sockhnd_t sockhnd, const uint8_t *buf, size_t len) {
+	int rc;
+	uint32_t t0;
 	net_sock_ctxt_t *sock = (net_sock_ctxt_t*) sockhnd;
-	return (sock->methods.send != NULL) ?
-			sock->methods.send(sockhnd, buf, len) : NET_PARAM;
+
+	if (sock->methods.send == NULL) {
+		return NET_PARAM;
+	}
+	if (sock->dead) {
+		return NET_EOF;
+	}
+	t0 = net_stats_tick();
+	rc = sock->methods.send(sockhnd, buf, len);
+	net_stats_record(sock, true, rc, t0);
+	return rc;
+}
+
+int net_sock_sendv(net_sockhnd_t sockhnd, const net_iovec_t *iov, int iovcnt) {
+	int rc = NET_OK;
+	int sent = 0;
+	uint32_t t0;
+	uint8_t bounce[NET_SENDV_BOUNCE_SIZE];
+	size_t pending = 0;
+	int i;
+	net_sock_ctxt_t *sock = (net_sock_ctxt_t*) sockhnd;
+
+	if ((iov == NULL) || (iovcnt <= 0) || (iovcnt > NET_IOV_MAX) || (sock->methods.send == NULL)) {
+		return NET_PARAM;
+	}
+	if (sock->dead) {
+		return NET_EOF;
+	}
+	if (sock->methods.sendv != NULL) {
+		t0 = net_stats_tick();
+		rc = sock->methods.sendv(sockhnd, iov, iovcnt);
+		net_stats_record(sock, true, rc, t0);
+		return rc;
+	}
+
+	/* One send() per long segment, from where it is; the short ones go together through bounce. */
+	for (i = 0; i < iovcnt; i++) {
+		if ((pending + iov[i].len) <= sizeof(bounce)) {
+			memcpy(&bounce[pending], iov[i].base, iov[i].len);
+			pending += iov[i].len;
+			continue;
+		}
+		if ((pending > 0) && !net_sendv_chunk(sockhnd, bounce, pending, &sent, &rc)) {
+			return (sent > 0) ? sent : rc;
+		}
+		pending = 0;
+		if (iov[i].len < sizeof(bounce)) {
+			memcpy(bounce, iov[i].base, iov[i].len);
+			pending = iov[i].len;
+		} else if (!net_sendv_chunk(sockhnd, iov[i].base, iov[i].len, &sent, &rc)) {
+			return (sent > 0) ? sent : rc;
+		}
+	}
+	if ((pending > 0) && !net_sendv_chunk(sockhnd, bounce, pending, &sent, &rc)) {
+		return (sent > 0) ? sent : rc;
+	}
+	return sent;
 }
 
 int net_sock_sendto(net_sockhnd_t sockhnd, const uint8_t *buf, size_t len,
 		net_ipaddr_t *remoteaddress, int remoteport) {
+	int rc;
+	uint32_t t0;
 	net_sock_ctxt_t *sock = (net_sock_ctxt_t*) sockhnd;
-	return (sock->methods.sendto != NULL) ?
-			sock->methods.sendto(sockhnd, buf, len, remoteaddress, remoteport) :
-			NET_PARAM;
+
+	if (sock->methods.sendto == NULL) {
+		return NET_PARAM;
+	}
+	t0 = net_stats_tick();
+	rc = sock->methods.sendto(sockhnd, buf, len, remoteaddress, remoteport);
+	net_stats_record(sock, true, rc, t0);
+	return rc;
 }
 
 int net_sock_close(net_sockhnd_t sockhnd) {
 	net_sock_ctxt_t *sock = (net_sock_ctxt_t*) sockhnd;
+	sock->ka_open = false;
+	sock->deadline = NET_DEADLINE_NONE;
 	return (sock->methods.close != NULL) ?
 			sock->methods.close(sockhnd) : NET_PARAM;
 }
@@ -649,27 +1018,319 @@ int net_sock_destroy(net_sockhnd_t sockhnd) {
 			sock->methods.destroy(sockhnd) : NET_PARAM;
 }
 
+int net_sock_flush(net_sockhnd_t sockhnd) {
+	net_sock_ctxt_t *sock = (net_sock_ctxt_t*) sockhnd;
+	return (sock->methods.flush != NULL) ?
+			sock->methods.flush(sockhnd, true) : NET_OK;
+}
+
+int net_batch_poll(net_hnd_t nethnd) {
+	net_ctxt_t *ctxt = (net_ctxt_t*) nethnd;
+	net_sock_ctxt_t *sock = NULL;
+	int rc = NET_OK;
+
+	if (ctxt == NULL) {
+		return NET_PARAM;
+	}
+	for (sock = ctxt->sock_list; sock != NULL; sock = sock->next) {
+		if ((sock->methods.flush != NULL) && (sock->batch_stats.queued_bytes > 0)) {
+			int ret = sock->methods.flush((net_sockhnd_t) sock, false);
+			if ((ret < 0) && (rc == NET_OK)) {
+				rc = ret;
+			}
+		}
+	}
+	return rc;
+}
+
+int net_keepalive_poll(net_hnd_t nethnd) {
+	net_ctxt_t *ctxt = (net_ctxt_t*) nethnd;
+	net_sock_ctxt_t *sock = NULL;
+	int dead = 0;
+
+	if (ctxt == NULL) {
+		return NET_PARAM;
+	}
+	for (sock = ctxt->sock_list; sock != NULL; sock = sock->next) {
+		net_ka_check(sock);
+		if (sock->dead) {
+			dead++;
+		}
+	}
+	return dead;
+}
+
+bool net_sock_is_alive(net_sockhnd_t sockhnd) {
+	net_sock_ctxt_t *sock = (net_sock_ctxt_t*) sockhnd;
+	return (sock != NULL) && !sock->dead;
+}
+
+bool net_sock_is_probed(net_sockhnd_t sockhnd) {
+	net_sock_ctxt_t *sock = (net_sock_ctxt_t*) sockhnd;
+	return (sock != NULL) && (sock->ka_idle != 0) && (sock->methods.probe != NULL);
+}
+
+int net_sock_set_deadline(net_sockhnd_t sockhnd, net_deadline_t deadline) {
+	net_sock_ctxt_t *sock = (net_sock_ctxt_t*) sockhnd;
+
+	if (sock == NULL) {
+		return NET_PARAM;
+	}
+	sock->deadline = deadline;
+	return NET_OK;
+}
+
+int net_sock_get_batch_stats(net_sockhnd_t sockhnd, net_batch_stats_t *stats) {
+	net_sock_ctxt_t *sock = (net_sock_ctxt_t*) sockhnd;
+
+	if ((sock == NULL) || (stats == NULL)) {
+		return NET_PARAM;
+	}
+	memcpy(stats, &sock->batch_stats, sizeof(net_batch_stats_t));
+	return NET_OK;
+}
+
+int net_sock_get_stats(net_sockhnd_t sockhnd, net_stats_t *stats) {
+#if NET_STATS
+	net_sock_ctxt_t *sock = (net_sock_ctxt_t*) sockhnd;
+
+	if ((sock == NULL) || (stats == NULL)) {
+		return NET_PARAM;
+	}
+	memcpy(stats, &sock->stats, sizeof(net_stats_t));
+	return NET_OK;
+#else
+	(void) sockhnd;
+	(void) stats;
+	return NET_PARAM;
+#endif /* NET_STATS */
+}
+
+int net_get_stats(net_hnd_t nethnd, net_stats_t *stats) {
+#if NET_STATS
+	net_ctxt_t *ctxt = (net_ctxt_t*) nethnd;
+
+	if ((ctxt == NULL) || (stats == NULL)) {
+		return NET_PARAM;
+	}
+	memcpy(stats, &ctxt->stats, sizeof(net_stats_t));
+	return NET_OK;
+#else
+	(void) nethnd;
+	(void) stats;
+	return NET_PARAM;
+#endif /* NET_STATS */
+}
+
+int net_sock_foreach_stats(net_hnd_t nethnd, net_sock_stats_cb_t *cb, void *arg) {
+#if NET_STATS
+	net_ctxt_t *ctxt = (net_ctxt_t*) nethnd;
+	net_sock_ctxt_t *sock = NULL;
+	net_stats_t snapshot;
+
+	if ((ctxt == NULL) || (cb == NULL)) {
+		return NET_PARAM;
+	}
+	for (sock = ctxt->sock_list; sock != NULL; sock = sock->next) {
+		memcpy(&snapshot, &sock->stats, sizeof(net_stats_t));
+		cb((net_sockhnd_t) sock, sock->proto, &snapshot, arg);
+	}
+	return NET_OK;
+#else
+	(void) nethnd;
+	(void) cb;
+	(void) arg;
+	return NET_PARAM;
+#endif /* NET_STATS */
+}
+
+int net_reset_stats(net_hnd_t nethnd) {
+#if NET_STATS
+	net_ctxt_t *ctxt = (net_ctxt_t*) nethnd;
+	net_sock_ctxt_t *sock = NULL;
+
+	if (ctxt == NULL) {
+		return NET_PARAM;
+	}
+	memset(&ctxt->stats, 0, sizeof(net_stats_t));
+	for (sock = ctxt->sock_list; sock != NULL; sock = sock->next) {
+		memset(&sock->stats, 0, sizeof(net_stats_t));
+	}
+	return NET_OK;
+#else
+	(void) nethnd;
+	return NET_PARAM;
+#endif /* NET_STATS */
+}
+
 /* Library Private Functions Definition ------------------------------------------------------*/
 
 /**
  * @brief   Return the integer difference between 'init + timeout' and 'now'.
  *          The implementation is robust to uint32_t overflows.
+ * @note    Kept for the callers outside netsock: the socket backends use net_sock_deadline().
  * @param   In:   init      Reference index.
  * @param   In:   now       Current index.
  * @param   In:   timeout   Target index.
  * @retval  Number of units from now to target.
  */
 int32_t net_timeout_left_ms(uint32_t init, uint32_t now, uint32_t timeout) {
-	int32_t ret = 0;
-	uint32_t wrap_end = 0;
+	return (int32_t) (init + timeout - now);
+}
+
+/**
+ * @brief   Deadline of a blocking call starting now on a socket: timeout_ms from now, or the
+ *          deadline set on the socket by the caller or by the layer above if it is earlier.
+ * @param   In:   timeout_ms  Timeout of the call, e.g. sock->read_timeout.
+ */
+net_deadline_t net_sock_deadline(net_sock_ctxt_t *sock, uint32_t timeout_ms) {
+	return net_deadline_min(net_deadline_in(timeout_ms), sock->deadline);
+}
+
+#if NET_STATS
+/** Account one call of a direction. The histogram only gets the calls which transferred data:
+ *  the empty non-blocking polls and the timeouts would bury the transfer latencies. */
+static void net_stats_update(net_stats_dir_t *d, int rc, uint32_t elapsed) {
+	uint32_t bucket = 0;
+	uint32_t ms = elapsed;
+
+	d->calls++;
+	if (rc > 0) {
+		d->bytes += (uint32_t) rc;
+		while ((ms != 0) && (bucket < (NET_STATS_LAT_BUCKETS - 1))) {
+			ms >>= 1;
+			bucket++;
+		}
+		d->lat_hist[bucket]++;
+		if (elapsed > d->lat_max_ms) {
+			d->lat_max_ms = elapsed;
+		}
+	} else if (rc == NET_TIMEOUT) {
+		d->timeouts++;
+	} else if (rc == NET_EOF) {
+		d->eofs++;
+	} else if ((rc < 0) && (rc != NET_NO_DATA)) {
+		d->errors++;
+	}
+}
+
+static void net_stats_record(net_sock_ctxt_t *sock, bool tx, int rc, uint32_t t0) {
+	uint32_t elapsed = net_clock_ms() - t0;
+
+	net_stats_update(tx ? &sock->stats.tx : &sock->stats.rx, rc, elapsed);
+#ifdef USE_MBED_TLS
+	/* Layered on a TCP or UDP socket of the same interface: the bytes would be counted twice. */
+	if ((sock->proto == NET_PROTO_TLS) || (sock->proto == NET_PROTO_DTLS)) {
+		return;
+	}
+#endif /* USE_MBED_TLS */
+	if (sock->net != NULL) {
+		net_stats_update(tx ? &sock->net->stats.tx : &sock->net->stats.rx, rc, elapsed);
+	}
+}
+#endif /* NET_STATS */
+
+/** A (re)opened connection starts alive, with a fresh idle period. */
+static void net_ka_reset(net_sock_ctxt_t *sock) {
+	sock->dead = false;
+	sock->ka_open = true;
+	sock->ka_armed = false;
+	sock->ka_missed = 0;
+	sock->last_heard = net_clock_ms();
+}
+
+/** Probe the connection if it is idle for ka_idle ms, or if the last probe is unanswered
+ *  since ka_intvl ms. */
+static void net_ka_check(net_sock_ctxt_t *sock) {
+	uint32_t now = net_clock_ms();
+	int rc = NET_OK;
+
+	if ((sock->ka_idle == 0) || !sock->ka_open || sock->dead || (sock->methods.probe == NULL)) {
+		return;
+	}
+	if ((sock->ka_missed == 0) ?
+			((now - sock->last_heard) < sock->ka_idle) : ((now - sock->ka_last) < sock->ka_intvl)) {
+		return;
+	}
+
+	sock->ka_last = now;
+	rc = sock->methods.probe((net_sockhnd_t) sock, !sock->ka_armed);
+	sock->ka_armed = true;
+	if (rc == NET_OK) {
+		sock->ka_missed = 0;
+		sock->last_heard = net_clock_ms();
+		return;
+	}
+	if ((rc == NET_TIMEOUT) && (++sock->ka_missed < sock->ka_cnt)) {
+		msg_debug("net_sock: probe %u/%u unanswered\n", sock->ka_missed, sock->ka_cnt);
+		return;
+	}
+	sock->dead = true;
+	msg_warning("net_sock: dead peer (%d), nothing heard for %lu ms\n", rc,
+			(unsigned long) (net_clock_ms() - sock->last_heard));
+}
+
+/** After a receive call: data proves the peer alive, no data is a chance to probe. */
+static int net_ka_recv_done(net_sock_ctxt_t *sock, int rc) {
+	if (rc > 0) {
+		sock->ka_missed = 0;
+		sock->last_heard = net_clock_ms();
+	} else if ((rc == 0) || (rc == NET_TIMEOUT) || (rc == NET_NO_DATA)) {
+		net_ka_check(sock);
+		if (sock->dead) {
+			rc = NET_EOF;
+		}
+	}
+	return rc;
+}
+
+/** sock_keepalive: "idle,interval,count", or "0". */
+static int net_ka_parse(net_sock_ctxt_t *sock, char const *conf, size_t len) {
+	char str[32];
+	char *p = NULL;
+	unsigned long idle = 0;
+	unsigned long intvl = 0;
+	unsigned long cnt = 0;
+
+	len = MIN(len, sizeof(str) - 1);
+	memcpy(str, conf, len);
+	str[len] = '\0';
 
-	if (now < init) { // Timer wrap-around detected
-					  // printf("Timer: wrap-around detected from %d to %d\n", init, now);
-		wrap_end = UINT32_MAX - init;
+	idle = strtoul(str, &p, 10);
+	if (idle != 0) {
+		if (*p++ != ',') {
+			return NET_PARAM;
+		}
+		intvl = strtoul(p, &p, 10);
+		if (*p++ != ',') {
+			return NET_PARAM;
+		}
+		cnt = strtoul(p, &p, 10);
+		if ((intvl == 0) || (cnt == 0) || (cnt > UINT8_MAX)) {
+			return NET_PARAM;
+		}
 	}
-	ret = wrap_end - (now - init) + timeout;
+	sock->ka_idle = idle;
+	sock->ka_intvl = intvl;
+	sock->ka_cnt = (uint8_t) cnt;
+	sock->ka_missed = 0;
+	return NET_OK;
+}
 
-	return ret;
+/** Send buf completely, unless a send() fails or writes nothing: then false, with its status in rc.
+ *  The bytes written are added to sent in both cases. */
+static bool net_sendv_chunk(net_sockhnd_t sockhnd, const uint8_t *buf, size_t len, int *sent, int *rc) {
+	size_t done = 0;
+
+	while (done < len) {
+		*rc = net_sock_send(sockhnd, &buf[done], len - done);
+		if (*rc <= 0) {
+			break;
+		}
+		done += *rc;
+	}
+	*sent += (int) done;
+	return (done == len);
 }
 
 bool net_is_up(net_hnd_t hnet) {
@@ -677,12 +1338,17 @@ bool net_is_up(net_hnd_t hnet) {
 		return 0;
 	net_ctxt_t *ctxt = (net_ctxt_t*) hnet;
 
-	if (!WIFI_Is_Connected()) {
-		ctxt->net_is_up = false;
-		return false;
-	} else
+	switch (ctxt->itf) {
+#ifdef USE_WIFI
+	case NET_IF_WLAN:
+		ctxt->net_is_up = WIFI_Is_Connected() ? true : false;
+		break;
+#endif /* USE_WIFI */
+	default:
+		/* No link state for the other interfaces: up once initialized. */
 		ctxt->net_is_up = true;
+	}
 
-	return true;
+	return ctxt->net_is_up;
 }
 /************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,52 @@
+/*
+ * net_clock.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Daruin Solano
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "net_internal.h"
+
+/* Private defines -----------------------------------------------------------*/
+/* The SysTick interpolation requires the HAL tick to be the SysTick interrupt. With an RTOS,
+ * the HAL time base is usually moved to a timer and the SysTick phase is unrelated to it. */
+#if !defined(USE_HOST) && !defined(HAS_RTOS) && !defined(MQTT_TASK)
+#define NET_CLOCK_SYSTICK
+#endif
+
+/* Functions Definition ------------------------------------------------------*/
+
+/** @brief  Milliseconds since the start, wrapping at 2^32. */
+uint32_t net_clock_ms(void) {
+	return HAL_GetTick();
+}
+
+/**
+ * @brief  Microseconds since the start. Sub-millisecond resolution on the host and on a bare
+ *         metal target; elsewhere the HAL tick in us. On the target, wraps with the ms tick.
+ * @note   On the target, a tick interrupt pending while the interrupts are masked is not
+ *         accounted: the value may then lag by up to 1 ms.
+ */
+uint64_t net_clock_us(void) {
+#if defined(USE_HOST)
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t) ts.tv_sec * 1000000) + ((uint64_t) ts.tv_nsec / 1000);
+#elif defined(NET_CLOCK_SYSTICK)
+	uint32_t load = SysTick->LOAD + 1;
+	uint32_t ms = HAL_GetTick();
+	uint32_t val = SysTick->VAL;
+
+	/* SysTick counts down from LOAD. One retry is enough when the tick moved under us: the
+	 * next one is 1 ms away. */
+	if (HAL_GetTick() != ms) {
+		ms = HAL_GetTick();
+		val = SysTick->VAL;
+	}
+	return ((uint64_t) ms * 1000) + (((uint64_t) (load - 1 - val) * 1000) / load);
+#else
+	return (uint64_t) HAL_GetTick() * 1000;
+#endif
+}
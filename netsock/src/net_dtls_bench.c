@@ -0,0 +1,174 @@
+/*
+ * net_dtls_bench.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Daruin Solano
+ *
+ *  Datagram throughput benchmark: plain UDP against DTLS (NET_PROTO_DTLS) to the same server,
+ *  plus the cost of a full and of a resumed DTLS handshake.
+ *  The server is expected to echo the datagrams (e.g. a DTLS echo service); the echoes are
+ *  counted when they come, but the rates are those of the sender.
+ *
+ *    int net_dtls_bench(net_hnd_t nethnd, const char *host, int port, const char *ca_certs,
+ *                       size_t dgram_len, uint32_t duration_ms);
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "net_internal.h"
+
+#if defined(USE_MBED_TLS) && defined(MBEDTLS_SSL_PROTO_DTLS)
+
+/* Private defines -----------------------------------------------------------*/
+#define BENCH_MAX_DGRAM			1024	/**< Largest benchmarked payload. */
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct {
+	uint32_t sent;			/**< Datagrams sent. */
+	uint32_t echoed;		/**< Datagrams received back. */
+	uint32_t errors;		/**< Failed sends. */
+	uint32_t elapsed_ms;
+} bench_run_t;
+
+/* Private variables ---------------------------------------------------------*/
+static uint8_t bench_tx[BENCH_MAX_DGRAM];
+static uint8_t bench_rx[BENCH_MAX_DGRAM];
+
+/* Private function prototypes -----------------------------------------------*/
+static int bench_dtls_open(net_hnd_t nethnd, net_sockhnd_t sock, const char *host, int port,
+		const char *ca_certs, uint32_t *hs_ms);
+static void bench_run(net_sockhnd_t sock, bool dtls, net_ipaddr_t *addr, int port,
+		size_t dgram_len, uint32_t duration_ms, bench_run_t *run);
+static void bench_report(const char *name, size_t dgram_len, const bench_run_t *run);
+
+/* Functions Definition ------------------------------------------------------*/
+
+/**
+ * @brief  Send dgram_len byte datagrams to host:port as fast as possible for duration_ms,
+ *         over UDP then over DTLS, and log the rates.
+ * @param  In: ca_certs   Root CA of the DTLS server, PEM. NULL: the server is not verified.
+ * @retval NET_OK, NET_PARAM, or the error of the socket which could not be opened.
+ */
+int net_dtls_bench(net_hnd_t nethnd, const char *host, int port, const char *ca_certs,
+		size_t dgram_len, uint32_t duration_ms) {
+	net_sockhnd_t sock = NULL;
+	net_ipaddr_t addr;
+	bench_run_t run;
+	uint32_t hs_full = 0;
+	uint32_t hs_resumed = 0;
+	int rc = NET_OK;
+
+	if ((nethnd == NULL) || (host == NULL) || (dgram_len == 0) || (dgram_len > BENCH_MAX_DGRAM)) {
+		return NET_PARAM;
+	}
+	for (size_t i = 0; i < dgram_len; i++) {
+		bench_tx[i] = (uint8_t) i;
+	}
+
+	/* Plain UDP: the baseline. */
+	rc = net_get_hostaddress(nethnd, &addr, host);
+	if (rc == NET_OK) {
+		rc = net_sock_create(nethnd, &sock, NET_PROTO_UDP);
+	}
+	if (rc == NET_OK) {
+		(void) net_sock_setopt(sock, "sock_noblocking", NULL, 0);
+		rc = net_sock_open(sock, host, NULL, 0, 0);
+		if (rc == NET_OK) {
+			bench_run(sock, false, &addr, port, dgram_len, duration_ms, &run);
+			bench_report("udp", dgram_len, &run);
+			(void) net_sock_close(sock);
+		}
+		(void) net_sock_destroy(sock);
+	}
+	if (rc != NET_OK) {
+		msg_error("net_dtls_bench: UDP socket to %s:%d failed (%d)\n", host, port, rc);
+		return rc;
+	}
+
+	/* DTLS: full handshake, transfer, then a resumed handshake on the same socket. */
+	rc = net_sock_create(nethnd, &sock, NET_PROTO_DTLS);
+	if (rc != NET_OK) {
+		msg_error("net_dtls_bench: DTLS socket creation failed (%d)\n", rc);
+		return rc;
+	}
+	(void) net_sock_setopt(sock, "sock_noblocking", NULL, 0);
+	rc = bench_dtls_open(nethnd, sock, host, port, ca_certs, &hs_full);
+	if (rc == NET_OK) {
+		bench_run(sock, true, NULL, port, dgram_len, duration_ms, &run);
+		bench_report("dtls", dgram_len, &run);
+		(void) net_sock_close(sock);
+
+		rc = bench_dtls_open(nethnd, sock, host, port, ca_certs, &hs_resumed);
+		if (rc == NET_OK) {
+			(void) net_sock_close(sock);
+		}
+	}
+	(void) net_sock_destroy(sock);
+
+	if (rc != NET_OK) {
+		msg_error("net_dtls_bench: DTLS handshake with %s:%d failed (%d)\n", host, port, rc);
+		return rc;
+	}
+	msg_info("net_dtls_bench: handshake full %lu ms, resumed %lu ms\n",
+			(unsigned long) hs_full, (unsigned long) hs_resumed);
+	return NET_OK;
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+static int bench_dtls_open(net_hnd_t nethnd, net_sockhnd_t sock, const char *host, int port,
+		const char *ca_certs, uint32_t *hs_ms) {
+	uint32_t t0 = HAL_GetTick();
+	int rc;
+
+	(void) nethnd;
+	if (ca_certs != NULL) {
+		(void) net_sock_setopt(sock, "tls_ca_certs", (const uint8_t*) ca_certs, strlen(ca_certs) + 1);
+		(void) net_sock_setopt(sock, "tls_server_verification", NULL, 0);
+	} else {
+		(void) net_sock_setopt(sock, "tls_server_noverification", NULL, 0);
+	}
+	rc = net_sock_open(sock, host, NULL, port, 0);
+	*hs_ms = HAL_GetTick() - t0;
+	return rc;
+}
+
+/** Send back to back, draining the echoes in between without waiting for them. */
+static void bench_run(net_sockhnd_t sock, bool dtls, net_ipaddr_t *addr, int port,
+		size_t dgram_len, uint32_t duration_ms, bench_run_t *run) {
+	uint32_t t0 = HAL_GetTick();
+	net_ipaddr_t from;
+	int from_port = 0;
+	int rc;
+
+	memset(run, 0, sizeof(bench_run_t));
+	do {
+		memcpy(bench_tx, &run->sent, sizeof(run->sent));	/* Sequence number. */
+		rc = dtls ? net_sock_send(sock, bench_tx, dgram_len)
+				: net_sock_sendto(sock, bench_tx, dgram_len, addr, port);
+		if (rc == (int) dgram_len) {
+			run->sent++;
+		} else {
+			run->errors++;
+		}
+		do {
+			rc = dtls ? net_sock_recv(sock, bench_rx, sizeof(bench_rx))
+					: net_sock_recvfrom(sock, bench_rx, sizeof(bench_rx), &from, &from_port);
+			if (rc > 0) {
+				run->echoed++;
+			}
+		} while (rc > 0);
+		run->elapsed_ms = HAL_GetTick() - t0;
+	} while (run->elapsed_ms < duration_ms);
+}
+
+static void bench_report(const char *name, size_t dgram_len, const bench_run_t *run) {
+	uint32_t ms = MAX(run->elapsed_ms, 1);
+
+	msg_info("net_dtls_bench %s: %u B x %lu in %lu ms: %lu dgram/s, %lu kB/s, %lu echoed, %lu errors\n",
+			name, (unsigned) dgram_len, (unsigned long) run->sent, (unsigned long) ms,
+			(unsigned long) (((uint64_t) run->sent * 1000) / ms),
+			(unsigned long) (((uint64_t) run->sent * dgram_len) / ms),
+			(unsigned long) run->echoed, (unsigned long) run->errors);
+}
+
+#endif /* USE_MBED_TLS && MBEDTLS_SSL_PROTO_DTLS */
@@ -0,0 +1,204 @@
+/*
+ * net_host_test.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Daruin Solano
+ *
+ *  Loopback test of the NET_IF_HOST backend, against an echo server run by a thread on the
+ *  same interface through net_srv:
+ *   - TCP echo round trips, and their rate;
+ *   - the read timeout;
+ *   - net_sock_open_start()/net_sock_open_step();
+ *   - UDP sendto/recvfrom between two local ports;
+ *   - a refused connect;
+ *   - optionally, a TLS session with an echo server on tls_port, e.g.
+ *       openssl s_server -accept <tls_port> -cert srv.pem -key srv.key -rev
+ *
+ *    int net_host_loopback_test(net_hnd_t nethnd, int port, int tls_port, const char *ca_certs);
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "net_internal.h"
+
+#ifdef USE_HOST
+#include <pthread.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define TEST_ROUND_TRIPS      20000
+#define TEST_READ_TIMEOUT     "100"   /**< ms */
+#define TEST_REFUSED_PORT     1       /**< Nothing listens there. */
+
+/* Private variables ---------------------------------------------------------*/
+static net_srv_conn_t test_srv;
+
+/* Private function prototypes -----------------------------------------------*/
+static void * test_echo_server(void * arg);
+static int test_echo(net_sockhnd_t sock, const uint8_t * msg, int len);
+static int test_check(const char * name, bool cond);
+
+/* Functions Definition ------------------------------------------------------*/
+
+/**
+ * @brief  Run the test on the loopback of the host interface.
+ * @param  In: port       Local TCP port of the echo server. The UDP ports follow it.
+ * @param  In: tls_port   Port of a local TLS echo server, 0 to skip the TLS session.
+ * @param  In: ca_certs   Root CA of the TLS server, PEM.
+ * @retval 0 if passed, else the number of checks failed.
+ */
+int net_host_loopback_test(net_hnd_t nethnd, int port, int tls_port, const char * ca_certs)
+{
+  net_sockhnd_t sock = NULL;
+  net_sockhnd_t udp_a = NULL;
+  net_sockhnd_t udp_b = NULL;
+  net_ipaddr_t addr;
+  net_ipaddr_t from;
+  pthread_t server;
+  char msg[32];
+  uint8_t buf[32];
+  uint32_t t0;
+  int from_port = 0;
+  int failed = 0;
+  int steps = 0;
+  int rc;
+
+  memset(&test_srv, 0, sizeof(test_srv));
+  test_srv.protocol = NET_PROTO_TCP;
+  test_srv.localport = port;
+  test_srv.name = "net_host_test";
+  if ((net_srv_bind(nethnd, NULL, &test_srv) != NET_OK)
+      || (pthread_create(&server, NULL, test_echo_server, NULL) != 0))
+  {
+    return test_check("echo server", false);
+  }
+
+  /* TCP echo */
+  failed += test_check("create", net_sock_create(nethnd, &sock, NET_PROTO_TCP) == NET_OK);
+  failed += test_check("open", net_sock_open(sock, "localhost", NULL, port, 0) == NET_OK);
+  t0 = HAL_GetTick();
+  for (rc = 0; (rc >= 0) && (steps < TEST_ROUND_TRIPS); steps++)
+  {
+    rc = test_echo(sock, (uint8_t *) msg, snprintf(msg, sizeof(msg), "hello %d", steps));
+  }
+  failed += test_check("echo round trips", rc >= 0);
+  msg_info("net_host_test: %d round trips in %lu ms\n", steps, (unsigned long) (HAL_GetTick() - t0));
+
+  /* Read timeout */
+  (void) net_sock_setopt(sock, "sock_read_timeout", (uint8_t *) TEST_READ_TIMEOUT, sizeof(TEST_READ_TIMEOUT));
+  t0 = HAL_GetTick();
+  rc = net_sock_recv(sock, buf, sizeof(buf));
+  failed += test_check("read timeout", (rc == NET_TIMEOUT) && ((HAL_GetTick() - t0) >= (uint32_t) (atoi(TEST_READ_TIMEOUT) - 1)));
+  (void) net_sock_close(sock);
+
+  /* Non-blocking open: the server takes the next connection. */
+  rc = net_sock_open_start(sock, "127.0.0.1", port, 0);
+  while (rc == NET_IN_PROGRESS)
+  {
+    rc = net_sock_open_step(sock);
+  }
+  failed += test_check("open_start/open_step", rc == NET_OK);
+  failed += test_check("echo after open_step", test_echo(sock, (uint8_t *) "x", 1) == 1);
+  (void) net_sock_close(sock);
+  (void) net_sock_destroy(sock);
+
+  /* UDP */
+  failed += test_check("udp create", (net_sock_create(nethnd, &udp_a, NET_PROTO_UDP) == NET_OK)
+                       && (net_sock_create(nethnd, &udp_b, NET_PROTO_UDP) == NET_OK));
+  failed += test_check("udp open", (net_sock_open(udp_a, NULL, NULL, 0, port + 1) == NET_OK)
+                       && (net_sock_open(udp_b, NULL, NULL, 0, port + 2) == NET_OK));
+  failed += test_check("hostaddress", net_get_hostaddress(nethnd, &addr, "localhost") == NET_OK);
+  failed += test_check("sendto", net_sock_sendto(udp_a, (uint8_t *) "ping", 4, &addr, port + 2) == 4);
+  rc = net_sock_recvfrom(udp_b, buf, sizeof(buf), &from, &from_port);
+  failed += test_check("recvfrom", (rc == 4) && (memcmp(buf, "ping", 4) == 0) && (from_port == (port + 1)));
+  (void) net_sock_close(udp_a);
+  (void) net_sock_close(udp_b);
+  (void) net_sock_destroy(udp_a);
+  (void) net_sock_destroy(udp_b);
+
+  /* Refused */
+  failed += test_check("create", net_sock_create(nethnd, &sock, NET_PROTO_TCP) == NET_OK);
+  failed += test_check("refused open", net_sock_open(sock, "127.0.0.1", NULL, TEST_REFUSED_PORT, 0) != NET_OK);
+  (void) net_sock_destroy(sock);
+
+#ifdef USE_MBED_TLS
+  /* TLS */
+  if (tls_port != 0)
+  {
+    failed += test_check("tls create", net_sock_create(nethnd, &sock, NET_PROTO_TLS) == NET_OK);
+    (void) net_sock_setopt(sock, "tls_ca_certs", (const uint8_t *) ca_certs, strlen(ca_certs) + 1);
+    (void) net_sock_setopt(sock, "tls_server_name", (const uint8_t *) "localhost", sizeof("localhost"));
+    failed += test_check("tls open", net_sock_open(sock, "127.0.0.1", NULL, tls_port, 0) == NET_OK);
+    failed += test_check("tls send", net_sock_send(sock, (uint8_t *) "abc\n", 4) == 4);
+    failed += test_check("tls recv", net_sock_recv(sock, buf, sizeof(buf)) > 0);
+    (void) net_sock_close(sock);
+    (void) net_sock_destroy(sock);
+  }
+#else
+  (void) tls_port;
+  (void) ca_certs;
+#endif
+
+  (void) pthread_join(server, NULL);
+  (void) net_srv_close(&test_srv);
+  msg_info("net_host_test: %s (%d failed)\n", (failed == 0) ? "passed" : "FAILED", failed);
+  return failed;
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/** Echo what each client sends until it goes away. Serves the two TCP connections of the test. */
+static void * test_echo_server(void * arg)
+{
+  uint8_t buf[256];
+  int conn;
+  int n;
+
+  (void) arg;
+  for (conn = 0; conn < 2; conn++)
+  {
+    if (net_srv_listen(&test_srv) != NET_OK)
+    {
+      break;
+    }
+    while ((n = net_sock_recv(test_srv.sock, buf, sizeof(buf))) > 0)
+    {
+      (void) net_sock_send(test_srv.sock, buf, n);
+    }
+    (void) net_srv_next_conn(&test_srv);
+  }
+  return NULL;
+}
+
+/** Send msg and read it back. len, or <0 on error or mismatch. */
+static int test_echo(net_sockhnd_t sock, const uint8_t * msg, int len)
+{
+  uint8_t buf[32];
+  int got = 0;
+  int n;
+
+  if (net_sock_send(sock, msg, len) != len)
+  {
+    return NET_ERR;
+  }
+  while (got < len)
+  {
+    n = net_sock_recv(sock, &buf[got], sizeof(buf) - got);
+    if (n <= 0)
+    {
+      return NET_ERR;
+    }
+    got += n;
+  }
+  return (memcmp(buf, msg, len) == 0) ? len : NET_ERR;
+}
+
+static int test_check(const char * name, bool cond)
+{
+  if (!cond)
+  {
+    msg_error("net_host_test: %s failed\n", name);
+    return 1;
+  }
+  return 0;
+}
+
+#endif /* USE_HOST */
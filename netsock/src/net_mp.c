@@ -0,0 +1,344 @@
+/*
+ * net_mp.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Daruin Solano
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "net_internal.h"
+#include "net_mp.h"
+
+/* Private defines -----------------------------------------------------------*/
+#define NET_MP_RTT_SWITCH_RATIO		2		/**< A same-preference interface must be this much faster to migrate. */
+
+/* Private function prototypes -----------------------------------------------*/
+static int mp_best(net_mp_t *mp, net_mp_class_t cls, uint8_t exclude);
+static void mp_if_failed(net_mp_t *mp, int itf);
+static void mp_if_usable(net_mp_t *mp, int itf, bool usable);
+static int mp_connect(net_mp_sock_t *ms, int itf, net_sockhnd_t *sockhnd);
+static void mp_drop(net_mp_sock_t *ms);
+static int mp_reconnect(net_mp_sock_t *ms);
+
+/* Functions Definition ------------------------------------------------------*/
+
+/**
+ * @brief  Initialize an empty interface group.
+ * @param  In: probe_host, probe_port   TCP endpoint used to probe the interfaces.
+ * @retval NET_OK, or NET_PARAM.
+ */
+int net_mp_init(net_mp_t *mp, const char *probe_host, int probe_port) {
+	if ((mp == NULL) || (probe_host == NULL) || (strlen(probe_host) >= NET_MP_HOST_SIZE)) {
+		return NET_PARAM;
+	}
+	memset(mp, 0, sizeof(net_mp_t));
+	strcpy(mp->probe_host, probe_host);
+	mp->probe_port = probe_port;
+	return NET_OK;
+}
+
+/**
+ * @brief  Add an interface, initialized by net_init(), to the group. It is probed by the next
+ *         net_mp_poll(); until then it is usable if its link is up.
+ * @param  In: prefer   net_mp_class_t mask of the classes to run on this interface when possible.
+ * @retval Index of the interface in the group, or NET_PARAM.
+ */
+int net_mp_add_if(net_mp_t *mp, net_hnd_t nethnd, const char *name, uint8_t prefer) {
+	net_mp_if_t *e = NULL;
+
+	if ((mp == NULL) || (nethnd == NULL) || (mp->count >= NET_MP_MAX_IF)) {
+		return NET_PARAM;
+	}
+	e = &mp->itf[mp->count];
+	memset(e, 0, sizeof(net_mp_if_t));
+	e->nethnd = nethnd;
+	e->name = (name != NULL) ? name : "?";
+	e->prefer = prefer;
+	e->usable = net_is_up(nethnd);
+	e->rtt_ms = NET_MP_RTT_UNKNOWN;
+	e->last_probe = net_clock_ms() - NET_MP_PROBE_INTERVAL;
+	return mp->count++;
+}
+
+/**
+ * @brief  Follow the link state of the interfaces and probe those due. To be called periodically,
+ *         from a single task: a probe blocks for the connection setup.
+ */
+void net_mp_poll(net_mp_t *mp) {
+	for (int i = 0; i < mp->count; i++) {
+		net_mp_if_t *e = &mp->itf[i];
+
+		if (!net_is_up(e->nethnd)) {
+			mp_if_usable(mp, i, false);
+			continue;
+		}
+		if ((net_clock_ms() - e->last_probe) >= NET_MP_PROBE_INTERVAL) {
+			net_mp_probe(mp, i);
+		}
+	}
+}
+
+/**
+ * @brief  Probe an interface now: time a TCP connection to the probe endpoint.
+ *         The RTT is smoothed like the TCP SRTT (1/8 of each new sample).
+ */
+void net_mp_probe(net_mp_t *mp, int itf) {
+	net_mp_if_t *e = &mp->itf[itf];
+	net_sockhnd_t sock = NULL;
+	uint32_t t0 = net_clock_ms();
+	int rc = NET_ERR;
+
+	rc = net_sock_create(e->nethnd, &sock, NET_PROTO_TCP);
+	if (rc == NET_OK) {
+		rc = net_sock_open(sock, mp->probe_host, NULL, mp->probe_port, 0);
+		if (rc == NET_OK) {
+			uint32_t sample = net_clock_ms() - t0;
+
+			e->rtt_ms = (e->rtt_ms == NET_MP_RTT_UNKNOWN) ? sample : ((7 * e->rtt_ms + sample) / 8);
+			e->probe_fails = 0;
+			(void) net_sock_close(sock);
+		}
+		(void) net_sock_destroy(sock);
+	}
+	e->last_probe = net_clock_ms();
+	e->probes++;
+
+	if (rc == NET_OK) {
+		msg_debug("net_mp %s: rtt %lu ms\n", e->name, (unsigned long) e->rtt_ms);
+		mp_if_usable(mp, itf, true);
+	} else {
+		msg_debug("net_mp %s: probe failed (%d)\n", e->name, rc);
+		mp_if_failed(mp, itf);
+	}
+}
+
+/**
+ * @brief  Select the interface for a traffic class: the fastest usable one among those preferred
+ *         by the class, else the fastest usable one.
+ * @retval Index of the interface, or NET_NOT_FOUND if none is usable.
+ */
+int net_mp_best(net_mp_t *mp, net_mp_class_t cls) {
+	return mp_best(mp, cls, 0);
+}
+
+/**
+ * @brief  Open a logical connection on the best interface for its class.
+ * @param  In: setup, setup_arg   Optional. Applied to every socket created for the connection.
+ * @retval NET_OK, NET_PARAM, or the error of the last interface tried.
+ */
+int net_mp_sock_open(net_mp_sock_t *ms, net_mp_t *mp, net_mp_class_t cls, net_proto_t proto,
+		const char *host, int port, net_mp_setup_t *setup, void *setup_arg) {
+	if ((ms == NULL) || (mp == NULL) || (host == NULL) || (strlen(host) >= NET_MP_HOST_SIZE)) {
+		return NET_PARAM;
+	}
+	memset(ms, 0, sizeof(net_mp_sock_t));
+	ms->mp = mp;
+	ms->cls = cls;
+	ms->proto = proto;
+	strcpy(ms->host, host);
+	ms->port = port;
+	ms->setup = setup;
+	ms->setup_arg = setup_arg;
+	ms->itf = -1;
+	return mp_reconnect(ms);
+}
+
+/**
+ * @brief  Send on the current connection. If it fails, the connection is re-established on the
+ *         best interface and the payload is sent once more on the new connection.
+ * @retval Bytes sent, or the error of the last attempt.
+ */
+int net_mp_sock_send(net_mp_sock_t *ms, const uint8_t *buf, size_t len) {
+	int rc = NET_ERR;
+
+	if ((ms->sockhnd == NULL) && (mp_reconnect(ms) != NET_OK)) {
+		return NET_NOT_FOUND;
+	}
+	rc = net_sock_send(ms->sockhnd, buf, len);
+	if ((rc < 0) && (rc != NET_TIMEOUT)) {
+		msg_warning("net_mp %s: send failed (%d), failing over\n", ms->mp->itf[ms->itf].name, rc);
+		mp_if_failed(ms->mp, ms->itf);
+		if (mp_reconnect(ms) == NET_OK) {
+			rc = net_sock_send(ms->sockhnd, buf, len);
+		}
+	}
+	return rc;
+}
+
+/**
+ * @brief  Receive on the current connection. If it was closed or failed, the connection is
+ *         re-established and 0 is returned: what the peer had in flight is lost.
+ * @retval Bytes received, 0, NET_TIMEOUT, or the error of the last attempt.
+ */
+int net_mp_sock_recv(net_mp_sock_t *ms, uint8_t *buf, size_t len) {
+	int rc = NET_ERR;
+
+	if (ms->sockhnd == NULL) {
+		return (mp_reconnect(ms) == NET_OK) ? 0 : NET_NOT_FOUND;
+	}
+	rc = net_sock_recv(ms->sockhnd, buf, len);
+	if ((rc < 0) && (rc != NET_TIMEOUT) && (rc != NET_NO_DATA)) {
+		msg_warning("net_mp %s: recv failed (%d), failing over\n", ms->mp->itf[ms->itf].name, rc);
+		if (rc != NET_EOF) {
+			mp_if_failed(ms->mp, ms->itf);
+		}
+		rc = (mp_reconnect(ms) == NET_OK) ? 0 : rc;
+	}
+	return rc;
+}
+
+/**
+ * @brief  Move the connection to a better interface if there is one: the current one is out of
+ *         service, or a preferred one is back, or a same-preference one is much faster.
+ *         The new connection is opened before the old one is closed. To be called between two
+ *         transactions of the application protocol.
+ * @retval NET_OK if the connection was kept or moved, or the error of the reconnection.
+ */
+int net_mp_sock_check(net_mp_sock_t *ms) {
+	net_mp_t *mp = ms->mp;
+	net_sockhnd_t sock = NULL;
+	int best = NET_NOT_FOUND;
+	bool move = false;
+
+	if (ms->sockhnd == NULL) {
+		return mp_reconnect(ms);
+	}
+	best = mp_best(mp, ms->cls, 0);
+	if ((best < 0) || (best == ms->itf)) {
+		return NET_OK;
+	}
+	if (!mp->itf[ms->itf].usable) {
+		move = true;
+	} else if ((mp->itf[best].prefer & ms->cls) != (mp->itf[ms->itf].prefer & ms->cls)) {
+		move = ((mp->itf[best].prefer & ms->cls) != 0);
+	} else {
+		move = (mp->itf[ms->itf].rtt_ms != NET_MP_RTT_UNKNOWN)
+				&& ((mp->itf[best].rtt_ms * NET_MP_RTT_SWITCH_RATIO) < mp->itf[ms->itf].rtt_ms);
+	}
+	if (!move || (mp_connect(ms, best, &sock) != NET_OK)) {
+		return NET_OK;
+	}
+	msg_info("net_mp %s:%d: moved from %s to %s\n", ms->host, ms->port, mp->itf[ms->itf].name,
+			mp->itf[best].name);
+	mp_drop(ms);
+	ms->sockhnd = sock;
+	ms->itf = best;
+	ms->generation++;
+	return NET_OK;
+}
+
+/** @brief  Number of connections established so far: a change means the peer sees a new connection. */
+uint32_t net_mp_sock_generation(net_mp_sock_t *ms) {
+	return ms->generation;
+}
+
+/** @brief  Close the logical connection. */
+int net_mp_sock_close(net_mp_sock_t *ms) {
+	mp_drop(ms);
+	return NET_OK;
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+static int mp_best(net_mp_t *mp, net_mp_class_t cls, uint8_t exclude) {
+	for (int pass = 0; pass < 2; pass++) {
+		int best = NET_NOT_FOUND;
+
+		for (int i = 0; i < mp->count; i++) {
+			net_mp_if_t *e = &mp->itf[i];
+			bool preferred = ((e->prefer & cls) != 0);
+
+			if (((exclude & (1U << i)) != 0) || !e->usable || (preferred != (pass == 0))) {
+				continue;
+			}
+			/* An unprobed interface (RTT_UNKNOWN) comes last. */
+			if ((best < 0) || (e->rtt_ms < mp->itf[best].rtt_ms)) {
+				best = i;
+			}
+		}
+		if (best >= 0) {
+			return best;
+		}
+	}
+	return NET_NOT_FOUND;
+}
+
+/** A failed connection counts as a failed probe. */
+static void mp_if_failed(net_mp_t *mp, int itf) {
+	net_mp_if_t *e = &mp->itf[itf];
+
+	if (e->probe_fails < UINT8_MAX) {
+		e->probe_fails++;
+	}
+	if (e->probe_fails >= NET_MP_PROBE_FAILS) {
+		mp_if_usable(mp, itf, false);
+	}
+}
+
+static void mp_if_usable(net_mp_t *mp, int itf, bool usable) {
+	net_mp_if_t *e = &mp->itf[itf];
+
+	if (e->usable != usable) {
+		msg_info("net_mp %s: %s\n", e->name, usable ? "in service" : "out of service");
+	}
+	e->usable = usable;
+}
+
+static int mp_connect(net_mp_sock_t *ms, int itf, net_sockhnd_t *sockhnd) {
+	net_sockhnd_t sock = NULL;
+	int rc = net_sock_create(ms->mp->itf[itf].nethnd, &sock, ms->proto);
+
+	if (rc != NET_OK) {
+		return rc;
+	}
+	if (ms->setup != NULL) {
+		rc = ms->setup(sock, ms->setup_arg);
+	}
+	if (rc == NET_OK) {
+		rc = net_sock_open(sock, ms->host, NULL, ms->port, 0);
+	}
+	if (rc != NET_OK) {
+		(void) net_sock_destroy(sock);
+		return rc;
+	}
+	*sockhnd = sock;
+	return NET_OK;
+}
+
+static void mp_drop(net_mp_sock_t *ms) {
+	if (ms->sockhnd != NULL) {
+		(void) net_sock_close(ms->sockhnd);
+		(void) net_sock_destroy(ms->sockhnd);
+		ms->sockhnd = NULL;
+	}
+	ms->itf = -1;
+}
+
+/** Drop the current connection and open a new one, trying each usable interface once, best first. */
+static int mp_reconnect(net_mp_sock_t *ms) {
+	net_mp_t *mp = ms->mp;
+	uint8_t tried = 0;
+	int rc = NET_NOT_FOUND;
+
+	mp_drop(ms);
+	for (int n = 0; n < mp->count; n++) {
+		net_sockhnd_t sock = NULL;
+		int i = mp_best(mp, ms->cls, tried);
+
+		if (i < 0) {
+			break;
+		}
+		tried |= (1U << i);
+		rc = mp_connect(ms, i, &sock);
+		if (rc == NET_OK) {
+			ms->sockhnd = sock;
+			ms->itf = i;
+			ms->generation++;
+			msg_info("net_mp %s:%d: connected on %s\n", ms->host, ms->port, mp->itf[i].name);
+			return NET_OK;
+		}
+		mp_if_failed(mp, i);
+	}
+	msg_error("net_mp %s:%d: no interface could connect (%d)\n", ms->host, ms->port, rc);
+	return rc;
+}
@@ -105,9 +105,61 @@ int network_write(Network *n, unsigned char *buffer, int len, int timeout_ms) {
 
 	return rc;
 }
+
+/** Function to write the segments of a packet to the socket opened, in one go
+ * @param - Address of Network Structure
+ *        - Segments of the data to write to socket
+ *        - Number of segments
+ *        - Timeout in milliseconds
+ * @return - Number of Bytes written on SUCCESS
+ *         - -1 on FAILURE
+ **/
+int network_writev(Network *n, const net_iovec_t *iov, int iovcnt, int timeout_ms) {
+	int rc;
+
+	if (n->sockHandle == NULL) return NET_NOT_FOUND;
+
+	rc = net_sock_sendv((net_sockhnd_t) n->sockHandle, iov, iovcnt);
+	if (rc < 0) {
+		msg_error("net_sock_sendv failed - %d\n", rc);
+	}
+
+	return rc;
+}
+
+/** Function to read from the socket opened without copying, see net_sock_recv_buf()
+ * @param - Address of Network Structure
+ *        - View set on the bytes read, to be released by network_release_buf()
+ *        - Most bytes in the view
+ *        - Timeout in milliseconds
+ * @return - Number of Bytes in the view on SUCCESS
+ *         - -1 on FAILURE
+ **/
+int network_read_buf(Network *n, net_buf_t *view, int maxlen, int timeout_ms) {
+	int bytes;
+
+	if (n->sockHandle == NULL) return NET_NOT_FOUND;
+
+	bytes = net_sock_recv_buf((net_sockhnd_t) n->sockHandle, view, maxlen);
+	if (bytes < 0 && bytes != NET_TIMEOUT) {
+		msg_error("net_sock_recv_buf failed - %d\n", bytes);
+	}
+
+	return (bytes==NET_TIMEOUT)?NET_OK:bytes;	// timeout is normal response, we catch it anyway but returns ok
+}
+
+int network_release_buf(Network *n, net_buf_t *view) {
+	if (n->sockHandle == NULL) return NET_NOT_FOUND;
+
+	return net_sock_release_buf((net_sockhnd_t) n->sockHandle, view);
+}
+
 int network_disconnect(Network *n) {
+	if (n->sockHandle == NULL) return 0;
+
 	net_sock_close(n->sockHandle);
 	net_sock_destroy(n->sockHandle);
+	n->sockHandle = NULL;
 	return 0;
 }
 
@@ -117,6 +169,7 @@ int mqtt_network_init(Network *n, device_config_t* dev) {
 	n->mqttdisconnect = network_disconnect;
 	n->mqttread = network_read;
 	n->mqttwrite = network_write;
+	n->mqttwritev = network_writev;
 
 	if (hnet == NULL){ /* if network is not yet initialized*/
 		rc = net_init(&hnet, NET_IF, net_if_init);
@@ -140,6 +193,21 @@ int mqtt_network_init(Network *n, device_config_t* dev) {
 	msg_info("[RTC]** UTC-date: %s UTC-time: %s ** -5 to actual time **", date, time);
 	//rtc_initialize(&rtc);
 
+	return mqtt_network_open(n, dev);
+}
+
+/** Function to create and open the broker connection, on the network brought up by mqtt_network_init().
+ *  Also used to reconnect, after the previous socket was released by network_disconnect().
+ * @return - NET_OK on SUCCESS
+ *         - NET_ERR on FAILURE
+ **/
+int mqtt_network_open(Network *n, device_config_t* dev) {
+	int rc = NET_ERR;
+
+	if (n->netHandle == NULL) {
+		n->netHandle = hnet;
+	}
+
 	rc = net_sock_create(n->netHandle, &n->sockHandle, (dev->HostPort == 1883)?NET_PROTO_TCP:NET_PROTO_TLS);
 	if (rc != NET_OK) {
 		rc = NET_ERR;
@@ -187,12 +255,25 @@ int mqtt_network_init(Network *n, device_config_t* dev) {
 		/* ASCII timeout strings (include the null terminator or pass strlen) */
 		net_sock_setopt(n->sockHandle, "sock_read_timeout",  (const uint8_t*)"5000", strlen("5000"));
 		net_sock_setopt(n->sockHandle, "sock_write_timeout", (const uint8_t*)"5000", strlen("5000"));
+		(void)net_sock_setopt(n->sockHandle, "sock_keepalive",
+							  (const uint8_t*)MQTT_SOCK_KEEPALIVE, strlen(MQTT_SOCK_KEEPALIVE));
+		/* Telemetry messages are small: no need for full-size TLS records. */
+		(void)net_sock_setopt(n->sockHandle, "tls_max_frag_len",
+							  (const uint8_t*)MQTT_TLS_MAX_FRAG_LEN, strlen(MQTT_TLS_MAX_FRAG_LEN));
+#ifdef MQTT_TLS_PROFILE
+		(void)net_sock_setopt(n->sockHandle, "tls_profile",
+							  (const uint8_t*)MQTT_TLS_PROFILE, strlen(MQTT_TLS_PROFILE) + 1);
+#endif
 		(void)net_sock_setopt(n->sockHandle, "tls_server_name",
 							  (const uint8_t*)dev->HostName, strlen(dev->HostName));
 		rc = net_sock_open(n->sockHandle, dev->HostName, NULL, dev->HostPort, 0);
 	}
 #endif
 
+	/* Zero-copy reads only where the backend has them (lwIP netconn, TCP): elsewhere, each view would
+	 * be allocated for the read. */
+	n->mqttreadbuf = (rc == NET_OK && net_sock_is_zero_copy(n->sockHandle)) ? network_read_buf : NULL;
+	n->mqttreleasebuf = network_release_buf;
 	if (rc != NET_OK) {
 		rc = NET_ERR;
 		msg_error("error creating/opening socket for mqtt client connection...\n");
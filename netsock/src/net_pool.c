@@ -0,0 +1,253 @@
+/*
+ * net_pool.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Daruin Solano
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "net_internal.h"
+#include "net_pool.h"
+
+#if defined(HAS_RTOS) || defined(MQTT_TASK)
+#include "cmsis_os.h"
+#define NET_POOL_LOCKING
+#endif
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct {
+	net_sock_ctxt_t *sock;			/**< NULL: free slot. */
+	int port;
+	uint32_t idle_since;			/**< Tick of the net_pool_put(). */
+	char host[NET_POOL_HOST_SIZE];
+} net_pool_entry_t;
+
+/* Private variables ---------------------------------------------------------*/
+static net_pool_entry_t pool[NET_POOL_SIZE];
+#ifdef NET_POOL_LOCKING
+static osMutexId_t pool_mutex = NULL;
+#endif
+
+/* Private function prototypes -----------------------------------------------*/
+static void pool_lock(void);
+static void pool_unlock(void);
+static bool pool_probe(net_sock_ctxt_t *sock);
+static void pool_discard(net_sock_ctxt_t *sock);
+
+/* Functions Definition ------------------------------------------------------*/
+
+/**
+ * @brief  Create the pool lock. Called by net_init().
+ * @retval NET_OK, or NET_ERR.
+ */
+int net_pool_init(void) {
+#ifdef NET_POOL_LOCKING
+	if (pool_mutex == NULL) {
+		pool_mutex = osMutexNew(NULL);
+		if (pool_mutex == NULL) {
+			msg_error("net_pool_init: failed creating the pool mutex.\n");
+			return NET_ERR;
+		}
+	}
+#endif
+	return NET_OK;
+}
+
+/**
+ * @brief  Take an idle connection to host:port out of the pool. The most recently used one
+ *         is tried first; a connection closed by the server meanwhile is discarded.
+ * @param  Out: sockhnd   Open socket, owned by the caller until net_pool_put() or net_sock_destroy().
+ * @retval NET_OK, NET_NOT_FOUND if there is no live connection to reuse, or NET_PARAM.
+ */
+int net_pool_get(net_hnd_t nethnd, net_proto_t proto, const char *host, int port,
+		net_sockhnd_t *sockhnd) {
+	net_sock_ctxt_t *sock = NULL;
+
+	if ((nethnd == NULL) || (host == NULL) || (sockhnd == NULL)) {
+		return NET_PARAM;
+	}
+	net_pool_expire();
+
+	do {
+		int best = -1;
+
+		pool_lock();
+		for (int i = 0; i < NET_POOL_SIZE; i++) {
+			net_pool_entry_t *e = &pool[i];
+			if ((e->sock != NULL) && (e->sock->net == (net_ctxt_t*) nethnd)
+					&& (e->sock->proto == proto) && (e->port == port)
+					&& (strcmp(e->host, host) == 0)
+					&& ((best < 0) || ((int32_t) (e->idle_since - pool[best].idle_since) > 0))) {
+				best = i;
+			}
+		}
+		sock = NULL;
+		if (best >= 0) {
+			sock = pool[best].sock;
+			pool[best].sock = NULL;
+		}
+		pool_unlock();
+
+		if ((sock != NULL) && !pool_probe(sock)) {
+			msg_debug("net_pool_get: dropping a dead connection to %s:%d\n", host, port);
+			pool_discard(sock);
+			continue;
+		}
+		break;
+	} while (1);
+
+	if (sock == NULL) {
+		return NET_NOT_FOUND;
+	}
+	*sockhnd = (net_sockhnd_t) sock;
+	return NET_OK;
+}
+
+/**
+ * @brief  Hand a connection over to the pool, once the last response was completely read and
+ *         the server did not ask for the connection to be closed.
+ *         The pool takes the socket over in any case: when it is not pooled it is closed and
+ *         destroyed. The least recently used idle connection is evicted if the pool is full.
+ * @note   TLS connections are pooled only if the server certificate was verified.
+ * @retval NET_OK if the connection was pooled, NET_PARAM otherwise.
+ */
+int net_pool_put(net_sockhnd_t sockhnd, const char *host, int port) {
+	net_sock_ctxt_t *sock = (net_sock_ctxt_t*) sockhnd;
+	net_sock_ctxt_t *victim = NULL;
+	int slot = -1;
+
+	if (sock == NULL) {
+		return NET_PARAM;
+	}
+	if ((host == NULL) || (strlen(host) >= NET_POOL_HOST_SIZE) || (sock->open_pending)) {
+		pool_discard(sock);
+		return NET_PARAM;
+	}
+#ifdef USE_MBED_TLS
+	if (((sock->proto == NET_PROTO_TLS) || (sock->proto == NET_PROTO_DTLS))
+			&& ((sock->tlsData == NULL) || !sock->tlsData->tls_srv_verification)) {
+		pool_discard(sock);
+		return NET_PARAM;
+	}
+#endif /* USE_MBED_TLS */
+
+	net_pool_expire();
+
+	pool_lock();
+	for (int i = 0; i < NET_POOL_SIZE; i++) {
+		if (pool[i].sock == NULL) {
+			slot = i;
+			break;
+		}
+		if ((slot < 0) || ((int32_t) (pool[i].idle_since - pool[slot].idle_since) < 0)) {
+			slot = i;
+		}
+	}
+	victim = pool[slot].sock;
+	pool[slot].sock = sock;
+	pool[slot].port = port;
+	pool[slot].idle_since = net_clock_ms();
+	strcpy(pool[slot].host, host);
+	pool_unlock();
+
+	if (victim != NULL) {
+		pool_discard(victim);
+	}
+	return NET_OK;
+}
+
+/**
+ * @brief  Close the connections idle for more than NET_POOL_IDLE_TIMEOUT. Done by net_pool_get()
+ *         and net_pool_put(); may also be called periodically to free the sockets sooner.
+ */
+void net_pool_expire(void) {
+	uint32_t now = net_clock_ms();
+
+	for (int i = 0; i < NET_POOL_SIZE; i++) {
+		net_sock_ctxt_t *sock = NULL;
+
+		pool_lock();
+		if ((pool[i].sock != NULL)
+				&& ((now - pool[i].idle_since) >= NET_POOL_IDLE_TIMEOUT)) {
+			sock = pool[i].sock;
+			pool[i].sock = NULL;
+		}
+		pool_unlock();
+
+		if (sock != NULL) {
+			pool_discard(sock);
+		}
+	}
+}
+
+/**
+ * @brief  Close all the idle connections of an interface, or of all interfaces if nethnd is NULL.
+ *         Called by net_deinit() and net_reinit(): the pooled sockets would otherwise keep them
+ *         from running.
+ */
+void net_pool_flush(net_hnd_t nethnd) {
+	for (int i = 0; i < NET_POOL_SIZE; i++) {
+		net_sock_ctxt_t *sock = NULL;
+
+		pool_lock();
+		if ((pool[i].sock != NULL)
+				&& ((nethnd == NULL) || (pool[i].sock->net == (net_ctxt_t*) nethnd))) {
+			sock = pool[i].sock;
+			pool[i].sock = NULL;
+		}
+		pool_unlock();
+
+		if (sock != NULL) {
+			pool_discard(sock);
+		}
+	}
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/** Cheap liveness check: a short read must time out. EOF or an error means the server closed
+ *  the connection; unsolicited bytes mean the protocol state is unknown. Neither is reusable.
+ *  The backend is called directly, so that the probe does not show in the traffic counters. */
+static bool pool_probe(net_sock_ctxt_t *sock) {
+	uint8_t b;
+	int rc;
+	bool blocking = sock->blocking;
+	uint16_t read_timeout = sock->read_timeout;
+
+	if (sock->methods.recv == NULL) {
+		return false;
+	}
+	sock->blocking = true;
+	sock->read_timeout = NET_POOL_PROBE_TIMEOUT;
+	rc = sock->methods.recv((net_sockhnd_t) sock, &b, 1);
+	sock->blocking = blocking;
+	sock->read_timeout = read_timeout;
+
+	return (rc == 0) || (rc == NET_TIMEOUT) || (rc == NET_NO_DATA);
+}
+
+static void pool_discard(net_sock_ctxt_t *sock) {
+	(void) net_sock_close((net_sockhnd_t) sock);
+	(void) net_sock_destroy((net_sockhnd_t) sock);
+}
+
+static void pool_lock(void) {
+#ifdef NET_POOL_LOCKING
+	/* Before the scheduler runs there is only one context: nothing to serialize. */
+	if ((pool_mutex != NULL) && (osKernelGetState() == osKernelRunning)) {
+		if (osMutexAcquire(pool_mutex, osWaitForever) != osOK) {
+			msg_error("net_pool: mutex acquire not succeeded..\n");
+		}
+	}
+#endif
+}
+
+static void pool_unlock(void) {
+#ifdef NET_POOL_LOCKING
+	if ((pool_mutex != NULL) && (osKernelGetState() == osKernelRunning)) {
+		if (osMutexRelease(pool_mutex) != osOK) {
+			msg_error("net_pool: mutex release not succeeded..\n");
+		}
+	}
+#endif
+}
@@ -0,0 +1,230 @@
+/*
+ * net_rng.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Daruin Solano
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "net_internal.h"
+#include "net_rng.h"
+
+#if !defined(MBEDTLS_CONFIG_FILE)
+#include "mbedtls/config.h"
+#else
+#include MBEDTLS_CONFIG_FILE
+#endif
+#include "mbedtls/entropy.h"
+#include "mbedtls/entropy_poll.h"
+#include "mbedtls/ctr_drbg.h"
+
+#if defined(HAS_RTOS) || defined(MQTT_TASK)
+#include "cmsis_os.h"
+#define NET_RNG_LOCKING
+#endif
+
+/* Private defines -----------------------------------------------------------*/
+#define NET_RNG_PERS	"net_rng"
+
+/* Private variables ---------------------------------------------------------*/
+static mbedtls_entropy_context rng_entropy;
+static mbedtls_ctr_drbg_context rng_drbg;
+static volatile bool rng_seeded = false;
+#ifdef NET_RNG_LOCKING
+static osMutexId_t volatile rng_mutex = NULL;
+#endif
+#if NET_RNG_POOL_SIZE > 0
+static uint8_t rng_pool[NET_RNG_POOL_SIZE];
+static size_t rng_pool_avail = 0;
+#endif
+
+/* Private function prototypes -----------------------------------------------*/
+static void rng_lock(void);
+static void rng_unlock(void);
+static int rng_generate(unsigned char *output, size_t len);
+
+/* Functions Definition ------------------------------------------------------*/
+
+/**
+ * @brief  Seed the shared DRBG from the hardware RNG. Called by net_init(); the
+ *         other entry points call it too, so that it never has to be called by
+ *         the application. Calling it again once seeded does nothing.
+ * @retval NET_OK, or NET_ERR if the entropy source failed.
+ */
+int net_rng_init(void) {
+	int ret = 0;
+
+	if (rng_seeded) {
+		return NET_OK;
+	}
+
+#ifdef NET_RNG_LOCKING
+	if (rng_mutex == NULL) {
+		/* Two tasks may both get here first: the scheduler is locked while the mutex is
+		 * looked at and created, so that only one of them creates it. osKernelLock() fails
+		 * before the scheduler runs, when there is only one context anyway. */
+		int32_t lock = osKernelLock();
+
+		if (rng_mutex == NULL) {
+			rng_mutex = osMutexNew(NULL);
+		}
+		if (lock >= 0) {
+			(void) osKernelRestoreLock(lock);
+		}
+		if (rng_mutex == NULL) {
+			msg_error("net_rng_init: failed creating the DRBG mutex.\n");
+			return NET_ERR;
+		}
+	}
+#endif
+
+	rng_lock();
+	if (!rng_seeded) {
+		mbedtls_entropy_init(&rng_entropy);
+		mbedtls_ctr_drbg_init(&rng_drbg);
+
+		if ((ret = mbedtls_entropy_add_source(&rng_entropy, mbedtls_hardware_poll,
+				(void*) &hrng, 1, MBEDTLS_ENTROPY_SOURCE_STRONG)) != 0) {
+			msg_error("net_rng_init: mbedtls_entropy_add_source returned -0x%x\n", -ret);
+		} else if ((ret = mbedtls_ctr_drbg_seed(&rng_drbg, mbedtls_entropy_func,
+				&rng_entropy, (const unsigned char*) NET_RNG_PERS,
+				strlen(NET_RNG_PERS))) != 0) {
+			msg_error("net_rng_init: mbedtls_ctr_drbg_seed returned -0x%x\n", -ret);
+		}
+
+		if (ret == 0) {
+			mbedtls_ctr_drbg_set_reseed_interval(&rng_drbg, NET_RNG_RESEED_INTERVAL);
+			rng_seeded = true;
+		} else {
+			mbedtls_ctr_drbg_free(&rng_drbg);
+			mbedtls_entropy_free(&rng_entropy);
+		}
+	}
+	rng_unlock();
+
+	return (ret == 0) ? NET_OK : NET_ERR;
+}
+
+/**
+ * @brief  Force a reseed from the hardware RNG, eg. after the device woke up from
+ *         standby. The pooled output is dropped.
+ * @retval NET_OK, or NET_ERR if the entropy source failed.
+ */
+int net_rng_reseed(void) {
+	int ret;
+
+	if (net_rng_init() != NET_OK) {
+		return NET_ERR;
+	}
+
+	rng_lock();
+	ret = mbedtls_ctr_drbg_reseed(&rng_drbg, NULL, 0);
+#if NET_RNG_POOL_SIZE > 0
+	memset(rng_pool, 0, sizeof(rng_pool));
+	rng_pool_avail = 0;
+#endif
+	rng_unlock();
+
+	if (ret != 0) {
+		msg_error("net_rng_reseed: mbedtls_ctr_drbg_reseed returned -0x%x\n", -ret);
+		return NET_ERR;
+	}
+	return NET_OK;
+}
+
+/**
+ * @brief  mbedTLS f_rng callback (see mbedtls_ssl_conf_rng()). p_rng is unused.
+ * @retval 0, or an MBEDTLS_ERR_CTR_DRBG_xxx error code.
+ */
+int net_rng_random(void *p_rng, unsigned char *output, size_t len) {
+	int ret;
+
+	(void) p_rng;
+	if (net_rng_init() != NET_OK) {
+		return MBEDTLS_ERR_CTR_DRBG_ENTROPY_SOURCE_FAILED;
+	}
+
+	rng_lock();
+	ret = rng_generate(output, len);
+	rng_unlock();
+
+	return ret;
+}
+
+/**
+ * @brief  Fill buf with random bytes. Requests up to NET_RNG_POOL_SIZE bytes are
+ *         served from a pool refilled by a single DRBG call.
+ * @retval NET_OK, or NET_ERR.
+ */
+int net_rng_bytes(uint8_t *buf, size_t len) {
+	int ret = 0;
+
+	if ((buf == NULL) && (len > 0)) {
+		return NET_PARAM;
+	}
+	if (net_rng_init() != NET_OK) {
+		return NET_ERR;
+	}
+
+	rng_lock();
+#if NET_RNG_POOL_SIZE > 0
+	if (len <= NET_RNG_POOL_SIZE) {
+		if (rng_pool_avail < len) {
+			ret = rng_generate(rng_pool, NET_RNG_POOL_SIZE);
+			rng_pool_avail = (ret == 0) ? NET_RNG_POOL_SIZE : 0;
+		}
+		if (ret == 0) {
+			uint8_t *p = &rng_pool[NET_RNG_POOL_SIZE - rng_pool_avail];
+			memcpy(buf, p, len);
+			memset(p, 0, len);	/* Never hand out the same bytes twice. */
+			rng_pool_avail -= len;
+		}
+	} else
+#endif /* NET_RNG_POOL_SIZE */
+	{
+		ret = rng_generate(buf, len);
+	}
+	rng_unlock();
+
+	if (ret != 0) {
+		msg_error("net_rng_bytes: mbedtls_ctr_drbg_random returned -0x%x\n", -ret);
+		return NET_ERR;
+	}
+	return NET_OK;
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/** Must be called with the lock held. The DRBG reseeds by itself every NET_RNG_RESEED_INTERVAL calls. */
+static int rng_generate(unsigned char *output, size_t len) {
+	int ret = 0;
+
+	while ((len > 0) && (ret == 0)) {
+		size_t chunk = (len > MBEDTLS_CTR_DRBG_MAX_REQUEST) ? MBEDTLS_CTR_DRBG_MAX_REQUEST : len;
+		ret = mbedtls_ctr_drbg_random(&rng_drbg, output, chunk);
+		output += chunk;
+		len -= chunk;
+	}
+	return ret;
+}
+
+static void rng_lock(void) {
+#ifdef NET_RNG_LOCKING
+	/* Before the scheduler runs there is only one context: nothing to serialize. */
+	if ((rng_mutex != NULL) && (osKernelGetState() == osKernelRunning)) {
+		if (osMutexAcquire(rng_mutex, osWaitForever) != osOK) {
+			msg_error("net_rng: mutex acquire not succeeded..\n");
+		}
+	}
+#endif
+}
+
+static void rng_unlock(void) {
+#ifdef NET_RNG_LOCKING
+	if ((rng_mutex != NULL) && (osKernelGetState() == osKernelRunning)) {
+		if (osMutexRelease(rng_mutex) != osOK) {
+			msg_error("net_rng: mutex release not succeeded..\n");
+		}
+	}
+#endif
+}
@@ -55,12 +55,21 @@
 /* Private typedef -----------------------------------------------------------*/
 /* Private variables ---------------------------------------------------------*/
 /* Private function prototypes -----------------------------------------------*/
+#ifdef USE_HOST
+extern int net_srv_bind_host(net_sockhnd_t sockhnd, net_srv_conn_t * srv);
+extern int net_srv_listen_host(net_srv_conn_t * srv);
+extern int net_srv_next_conn_host(net_srv_conn_t * srv);
+#define NET_SRV_IS_HOST(s)	(((net_sock_ctxt_t *) (s))->net->itf == NET_IF_HOST)
+#endif /* USE_HOST */
+
 /* Functions Definition ------------------------------------------------------*/
 
 int net_srv_bind(net_hnd_t nethnd, net_sockhnd_t sockhnd, net_srv_conn_t* srv)
 {
 	int rc = NET_NOT_FOUND;
+#ifdef USE_WIFI
 	WIFI_Protocol_t proto;
+#endif /* USE_WIFI */
 	if (nethnd != NULL){
 		rc = NET_OK;
 	}
@@ -70,6 +79,19 @@ int net_srv_bind(net_hnd_t nethnd, net_sockhnd_t sockhnd, net_srv_conn_t* srv)
 		{
 			rc = net_sock_create(nethnd, &sockhnd, srv->protocol);
 		}
+#ifdef USE_HOST
+		if ((rc == NET_OK) && NET_SRV_IS_HOST(sockhnd))
+		{
+			rc = net_srv_bind_host(sockhnd, srv);
+			if (rc == NET_OK)
+			{
+				srv->sock = sockhnd;
+				msg_debug("server has started: %s...", srv->name);
+			}
+		}
+		else
+#endif /* USE_HOST */
+#ifdef USE_WIFI
 		if ( rc == NET_OK)
 		{
 			net_sock_ctxt_t *sock = (net_sock_ctxt_t * ) sockhnd;
@@ -81,6 +103,11 @@ int net_srv_bind(net_hnd_t nethnd, net_sockhnd_t sockhnd, net_srv_conn_t* srv)
 				rc = NET_OK;
 			}
 		}
+#else
+		{
+			rc = NET_PARAM;
+		}
+#endif /* USE_WIFI */
 	}
 	if (rc != NET_OK){
 		msg_error("error in network connection...");
@@ -92,6 +119,13 @@ int net_srv_bind(net_hnd_t nethnd, net_sockhnd_t sockhnd, net_srv_conn_t* srv)
 int net_srv_listen(net_srv_conn_t* srv )
 {
 	int rc = NET_ERR;
+#ifdef USE_HOST
+	if (NET_SRV_IS_HOST(srv->sock))
+	{
+		return net_srv_listen_host(srv);
+	}
+#endif /* USE_HOST */
+#ifdef USE_WIFI
 	uint8_t ip[4] = {0};
 	uint16_t port;
 	net_sock_ctxt_t *sock = (net_sock_ctxt_t * ) srv->sock;
@@ -103,17 +137,26 @@ int net_srv_listen(net_srv_conn_t* srv )
 			srv->remoteip.ip[12+i] = ip[i];
 		}
 	}
+#endif /* USE_WIFI */
 	return rc;
 }
 
 int net_srv_next_conn(net_srv_conn_t* srv)
 {
 	int rc = NET_ERR;
+#ifdef USE_HOST
+	if (NET_SRV_IS_HOST(srv->sock))
+	{
+		return net_srv_next_conn_host(srv);
+	}
+#endif /* USE_HOST */
+#ifdef USE_WIFI
 	net_sock_ctxt_t *sock = (net_sock_ctxt_t * ) (srv->sock);
 	if (WIFI_CloseServerConnection((uint32_t)sock->underlying_sock_ctxt) == WIFI_STATUS_OK)
 	{
 		rc = NET_OK;
 	}
+#endif /* USE_WIFI */
 	return rc;
 }
 
@@ -123,6 +166,14 @@ int net_srv_close(net_srv_conn_t* srv)
 
     net_sock_ctxt_t *sock = (net_sock_ctxt_t *)srv->sock;
 
+#ifdef USE_HOST
+    if (NET_SRV_IS_HOST(srv->sock)) {
+        net_sock_destroy(srv->sock);   /* closes the listening and client sockets */
+        memset(srv, 0, sizeof(*srv));
+        return NET_OK;
+    }
+#endif /* USE_HOST */
+
     /* If underlying socket id is invalid, treat as already closed */
     if ((int)sock->underlying_sock_ctxt <= 0 || sock->underlying_sock_ctxt == (net_sockhnd_t)-1) {
         net_sock_destroy(srv->sock);   // your internal destroy
@@ -132,6 +183,7 @@ int net_srv_close(net_srv_conn_t* srv)
 
     int rc = NET_ERR;
 
+#ifdef USE_WIFI
     if (WIFI_StopServer((uint32_t)sock->underlying_sock_ctxt) == WIFI_STATUS_OK) {
         rc = NET_OK;
     } else {
@@ -139,6 +191,7 @@ int net_srv_close(net_srv_conn_t* srv)
         msg_error("net_srv_close: WIFI_StopServer failed, forcing local destroy");
         rc = NET_OK; /* force success so upper layers can restart */
     }
+#endif /* USE_WIFI */
 
     sock->underlying_sock_ctxt = (net_sockhnd_t)-1;
     net_sock_destroy(srv->sock);
@@ -0,0 +1,155 @@
+/*
+ * net_sup.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Daruin Solano
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "net_internal.h"
+#include "net_sup.h"
+
+/* Private defines -----------------------------------------------------------*/
+#define NET_SUP_MAX_SHIFT		16		/**< Bounds min << n before the cap is applied. */
+#define NET_SUP_LINK_POLL_MS	500		/**< net_sup_wait_ms() while the link is down. */
+
+/* Private function prototypes -----------------------------------------------*/
+static uint32_t sup_random(uint32_t range);
+static bool sup_due(uint32_t now, uint32_t tick);
+
+/* Functions Definition ------------------------------------------------------*/
+
+/**
+ * @brief  Initialize a supervisor. The first attempt is allowed immediately.
+ * @param  In: nethnd   Interface to watch, or NULL to leave the link out.
+ * @param  In: conf     Policy, copied. NULL for NET_SUP_CONF_DEFAULT.
+ */
+void net_sup_init(net_sup_t *sup, const char *name, net_hnd_t nethnd,
+		const net_sup_conf_t *conf) {
+	static const net_sup_conf_t conf_default = NET_SUP_CONF_DEFAULT;
+
+	memset(sup, 0, sizeof(net_sup_t));
+	sup->name = (name != NULL) ? name : "?";
+	sup->nethnd = nethnd;
+	sup->conf = (conf != NULL) ? *conf : conf_default;
+	if (sup->conf.backoff_min_ms == 0) {
+		sup->conf.backoff_min_ms = 1;
+	}
+	if (sup->conf.backoff_max_ms < sup->conf.backoff_min_ms) {
+		sup->conf.backoff_max_ms = sup->conf.backoff_min_ms;
+	}
+	sup->breaker = NET_SUP_CLOSED;
+	sup->next_try = net_clock_ms();
+}
+
+/**
+ * @brief  Tell whether a connection attempt may be made now.
+ * @retval true if the caller should try, and report the outcome with net_sup_success()
+ *         or net_sup_failure().
+ */
+bool net_sup_ready(net_sup_t *sup) {
+	uint32_t now = net_clock_ms();
+
+	if (sup->nethnd != NULL) {
+		if (!net_is_up(sup->nethnd)) {
+			sup->link_down = true;
+			return false;
+		}
+		if (sup->link_down) {
+			/* Link back: the past failures say nothing about the endpoint. */
+			sup->link_down = false;
+			sup->failures = 0;
+			if (sup->breaker == NET_SUP_OPEN) {
+				sup->breaker = NET_SUP_HALF_OPEN;
+			}
+			sup->next_try = now + sup_random(sup->conf.linkup_spread_ms);
+			msg_info("net_sup %s: link up, retry in %lu ms\n", sup->name,
+					(unsigned long) (sup->next_try - now));
+		}
+	}
+
+	if (!sup_due(now, sup->next_try)) {
+		return false;
+	}
+	if (sup->breaker == NET_SUP_OPEN) {
+		sup->breaker = NET_SUP_HALF_OPEN;
+		msg_info("net_sup %s: circuit half-open, trial attempt\n", sup->name);
+	}
+	return true;
+}
+
+/**
+ * @brief  Time until net_sup_ready() may return true, for the caller to sleep.
+ * @retval Delay in ms. 0 if an attempt is allowed now.
+ */
+uint32_t net_sup_wait_ms(net_sup_t *sup) {
+	uint32_t now = net_clock_ms();
+
+	if (sup->link_down) {
+		return NET_SUP_LINK_POLL_MS;
+	}
+	return sup_due(now, sup->next_try) ? 0 : (sup->next_try - now);
+}
+
+/** @brief  Report a successful attempt: clears the backoff and closes the breaker. */
+void net_sup_success(net_sup_t *sup) {
+	if (sup->breaker != NET_SUP_CLOSED) {
+		msg_info("net_sup %s: circuit closed\n", sup->name);
+	}
+	sup->breaker = NET_SUP_CLOSED;
+	sup->failures = 0;
+	sup->next_try = net_clock_ms();
+}
+
+/**
+ * @brief  Report a failed attempt. The next one is delayed by a random time between half and
+ *         all of min(backoff_min_ms * 2^(failures - 1), backoff_max_ms), or by breaker_open_ms
+ *         when the breaker opens.
+ */
+void net_sup_failure(net_sup_t *sup) {
+	uint32_t now = net_clock_ms();
+	uint32_t cap = sup->conf.backoff_max_ms;
+	uint16_t shift = 0;
+
+	if (sup->failures < UINT16_MAX) {
+		sup->failures++;
+	}
+
+	if ((sup->breaker == NET_SUP_HALF_OPEN)
+			|| ((sup->conf.breaker_threshold != 0)
+					&& (sup->failures >= sup->conf.breaker_threshold))) {
+		sup->breaker = NET_SUP_OPEN;
+		sup->next_try = now + sup->conf.breaker_open_ms
+				+ sup_random(sup->conf.linkup_spread_ms);
+		msg_warning("net_sup %s: circuit open after %u failures, next trial in %lu ms\n",
+				sup->name, sup->failures, (unsigned long) (sup->next_try - now));
+		return;
+	}
+
+	shift = MIN(sup->failures - 1, NET_SUP_MAX_SHIFT);
+	if (sup->conf.backoff_min_ms <= (cap >> shift)) {
+		cap = sup->conf.backoff_min_ms << shift;
+	}
+	sup->next_try = now + (cap / 2) + sup_random(cap - (cap / 2));
+	msg_debug("net_sup %s: failure %u, retry in %lu ms\n", sup->name, sup->failures,
+			(unsigned long) (sup->next_try - now));
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/** Uniform in [0, range]. The spreading only needs to differ between the clients. */
+static uint32_t sup_random(uint32_t range) {
+	uint32_t r = 0;
+
+	if (range == 0) {
+		return 0;
+	}
+	if (net_rng_bytes((uint8_t*) &r, sizeof(r)) != NET_OK) {
+		r = net_clock_ms() * 2654435761U;
+	}
+	return (range == UINT32_MAX) ? r : (r % (range + 1));
+}
+
+static bool sup_due(uint32_t now, uint32_t tick) {
+	return (int32_t) (now - tick) >= 0;
+}
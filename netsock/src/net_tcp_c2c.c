@@ -60,6 +60,16 @@
 #define NET_DEFAULT_NOBLOCKING_READ_TIMEOUT   500
 
 /* Private typedef -----------------------------------------------------------*/
+/** Send queue of a batching socket (sock_batch_size). */
+typedef struct net_c2c_batch_s {
+  uint8_t * buf;
+  uint32_t size;          /**< sock_batch_size the queue was allocated for. */
+  uint32_t len;           /**< Queued bytes. */
+  uint32_t first_tick;    /**< When the oldest queued payload was queued. */
+  int error;              /**< Error of a failed flush: bytes reported as sent were lost, the stream
+                               is broken. Returned by the next send, recv and flush until closed. */
+} net_c2c_batch_t;
+
 /* Private variables ---------------------------------------------------------*/
 char OperatorsString[C2C_OPERATORS_LIST + 1];
 
@@ -72,6 +82,13 @@ int net_sock_send_tcp_c2c(net_sockhnd_t sockhnd, const uint8_t * buf, size_t len
 int net_sock_sendto_udp_c2c(net_sockhnd_t sockhnd, const uint8_t * buf, size_t len,  net_ipaddr_t * remoteaddress, int remoteport);
 int net_sock_close_tcp_c2c(net_sockhnd_t sockhnd);
 int net_sock_destroy_tcp_c2c(net_sockhnd_t sockhnd);
+int net_sock_flush_tcp_c2c(net_sockhnd_t sockhnd, bool force);
+static int net_c2c_send(net_sock_ctxt_t * sock, const uint8_t * buf, size_t len);
+static int net_c2c_send_all(net_sock_ctxt_t * sock, const uint8_t * buf, size_t len);
+static int net_c2c_batch_queue(net_sock_ctxt_t * sock, const uint8_t * buf, size_t len);
+static int net_c2c_batch_flush(net_sock_ctxt_t * sock);
+static int net_c2c_batch_session(net_sock_ctxt_t * sock);
+static bool net_c2c_batch_due(net_sock_ctxt_t * sock, uint32_t now);
 
 /* Functions Definition ------------------------------------------------------*/
 
@@ -98,6 +115,7 @@ int net_sock_create_c2c(net_hnd_t nethnd, net_sockhnd_t * sockhnd, net_proto_t p
       case NET_PROTO_TCP:
         sock->methods.recv      = (net_sock_recv_tcp_c2c);
         sock->methods.send      = (net_sock_send_tcp_c2c);
+        sock->methods.flush     = (net_sock_flush_tcp_c2c);
         break;
       case NET_PROTO_UDP:
         // temporarily return, until the C2C UDP sockets are implemented.
@@ -115,6 +133,7 @@ int net_sock_create_c2c(net_hnd_t nethnd, net_sockhnd_t * sockhnd, net_proto_t p
     sock->blocking          = NET_DEFAULT_BLOCKING;
     sock->read_timeout      = NET_DEFAULT_BLOCKING_READ_TIMEOUT;
     sock->write_timeout     = NET_DEFAULT_BLOCKING_WRITE_TIMEOUT;
+    sock->batch_deadline    = NET_DEFAULT_BATCH_DEADLINE;
     ctxt->sock_list         = sock; /* Insert at the head of the list */
     *sockhnd = (net_sockhnd_t) sock;
 
@@ -224,20 +243,34 @@ int net_sock_recv_tcp_c2c(net_sockhnd_t sockhnd, uint8_t * buf, size_t len)
   uint16_t read = 0;
   uint16_t tmp_len = MIN(len, C2C_PAYLOAD_SIZE);
   uint8_t * tmp_buf = buf;
-  uint32_t start_time = HAL_GetTick();
+  net_deadline_t deadline = net_sock_deadline(sock, sock->read_timeout);
+
+  if ((sock->c2c_batch != NULL) && (sock->c2c_batch->error < 0))
+  {
+    return sock->c2c_batch->error;
+  }
+  /* A request may be waiting in the send queue for the response being read. */
+  if ((sock->c2c_batch != NULL) && (sock->c2c_batch->len > 0))
+  {
+    rc = net_c2c_batch_session(sock);
+    if (rc < 0)
+    {
+      return rc;
+    }
+  }
 
   /* Read the received payload by chunks of C2C_PAYLOAD_SIZE bytes because of
    * a constraint of C2C_ReceiveData(). */
   do
   {
-    if ( (sock->blocking == true) && (net_timeout_left_ms(start_time, HAL_GetTick(), sock->read_timeout) <= 0) )
+    if ( (sock->blocking == true) && net_deadline_expired(deadline) )
     {
       rc = NET_TIMEOUT;
       break;
     }
 
     status = C2C_ReceiveData((uint8_t) ((uint32_t)sock->underlying_sock_ctxt & 0xFF), tmp_buf, tmp_len, &read,
-                             (sock->blocking == true) ? sock->read_timeout : NET_DEFAULT_NOBLOCKING_READ_TIMEOUT);
+                             (sock->blocking == true) ? net_deadline_left_ms(deadline) : NET_DEFAULT_NOBLOCKING_READ_TIMEOUT);
 
     msg_debug("Read %d/%d.\n", read, tmp_len);
     if (status != C2C_RET_OK)
@@ -274,26 +307,38 @@ int net_sock_recvfrom_udp_c2c(net_sockhnd_t sockhnd, uint8_t * const buf, size_t
 
 
 int net_sock_send_tcp_c2c( net_sockhnd_t sockhnd, const uint8_t * buf, size_t len)
+{
+  net_sock_ctxt_t *sock = (net_sock_ctxt_t * ) sockhnd;
+
+  if (sock->batch_size == 0)
+  {
+    return net_c2c_send(sock, buf, len);
+  }
+  return net_c2c_batch_queue(sock, buf, len);
+}
+
+
+/** One C2C_SendData() call, retried while nothing is sent in blocking mode. May send a part of buf only. */
+static int net_c2c_send(net_sock_ctxt_t * sock, const uint8_t * buf, size_t len)
 {
   int rc = 0;
   C2C_SendStatus_t status = C2C_SEND_OK;
-  net_sock_ctxt_t *sock = (net_sock_ctxt_t * ) sockhnd;
   uint16_t sent = 0;
-  uint32_t start_time = HAL_GetTick();
+  net_deadline_t deadline = net_sock_deadline(sock, sock->write_timeout);
   char ErrorString[C2C_ERROR_STRING];
 
   memset(ErrorString, 0, C2C_ERROR_STRING);
 
   do
   {
-    if ( (sock->blocking == true) && (net_timeout_left_ms(start_time, HAL_GetTick(), sock->write_timeout) <= 0) )
+    if ( (sock->blocking == true) && net_deadline_expired(deadline) )
     {
       rc = NET_TIMEOUT;
       break;
     }
 
     status = C2C_SendData((uint8_t) ((uint32_t)sock->underlying_sock_ctxt & 0xFF), (uint8_t *)buf, len, &sent,
-                          (sock->blocking == true) ? sock->write_timeout : NET_DEFAULT_NOBLOCKING_WRITE_TIMEOUT );
+                          (sock->blocking == true) ? net_deadline_left_ms(deadline) : NET_DEFAULT_NOBLOCKING_WRITE_TIMEOUT );
 
     msg_debug("Sent %d/%d.\n", sent, len);
     if (status !=  C2C_SEND_OK)
@@ -329,6 +374,14 @@ int net_sock_close_tcp_c2c(net_sockhnd_t sockhnd)
 {
   int rc = NET_ERR;
   net_sock_ctxt_t *sock = (net_sock_ctxt_t * ) sockhnd;
+
+  /* Best effort: what is still queued goes out before the connection is stopped. */
+  (void) net_c2c_batch_flush(sock);
+  if (sock->c2c_batch != NULL)
+  {
+    sock->c2c_batch->error = NET_OK;
+  }
+
   C2C_Ret_t status = C2C_StopClientConnection((uint8_t) ((uint32_t)sock->underlying_sock_ctxt && 0xFF));
   if (status == C2C_RET_OK)
   {
@@ -369,11 +422,197 @@ int net_sock_destroy_tcp_c2c(net_sockhnd_t sockhnd)
   }
   if (rc == NET_OK)
   {
+    if (sock->c2c_batch != NULL)
+    {
+      net_free(sock->c2c_batch);
+    }
     net_free(sock);
   }
 
   return rc;
 }
 
+
+/**
+ * @brief  Send the queue of a batching socket, and along with it the queues of the other sockets
+ *         of the interface, in a single radio session.
+ * @param  In: force   false: only if sock_batch_deadline is reached.
+ */
+int net_sock_flush_tcp_c2c(net_sockhnd_t sockhnd, bool force)
+{
+  net_sock_ctxt_t *sock = (net_sock_ctxt_t * ) sockhnd;
+
+  if ((sock->c2c_batch != NULL) && (sock->c2c_batch->error < 0))
+  {
+    return sock->c2c_batch->error;
+  }
+  if ((sock->c2c_batch == NULL) || (sock->c2c_batch->len == 0))
+  {
+    return NET_OK;
+  }
+  if ((force == false) && (net_c2c_batch_due(sock, net_clock_ms()) == false))
+  {
+    return NET_OK;
+  }
+  return net_c2c_batch_session(sock);
+}
+
+
+/* Private functions ---------------------------------------------------------*/
+
+/** Send the whole buffer, within sock->write_timeout. The chunks share its deadline. */
+static int net_c2c_send_all(net_sock_ctxt_t * sock, const uint8_t * buf, size_t len)
+{
+  int rc = 0;
+  size_t done = 0;
+  net_deadline_t saved = sock->deadline;
+
+  sock->deadline = net_sock_deadline(sock, sock->write_timeout);
+  while ( (done < len) && (rc >= 0) )
+  {
+    rc = net_c2c_send(sock, buf + done, len - done);
+    if (rc >= 0)
+    {
+      done += rc;
+      if ( (done < len) && net_deadline_expired(sock->deadline) )
+      {
+        rc = NET_TIMEOUT;
+      }
+    }
+  }
+  sock->deadline = saved;
+  return (rc < 0) ? rc : (int) done;
+}
+
+
+/** Batched send: queue the payload, and send the queue when full or overdue.
+ *  A payload which does not fit in an empty queue is sent at once. */
+static int net_c2c_batch_queue(net_sock_ctxt_t * sock, const uint8_t * buf, size_t len)
+{
+  int rc = NET_OK;
+  net_c2c_batch_t *b = sock->c2c_batch;
+
+  if ((b != NULL) && (b->error < 0))
+  {
+    return b->error;
+  }
+  if (len == 0)
+  {
+    return 0;
+  }
+  /* The queue is empty when sock_batch_size changes: net_sock_setopt() flushes it. */
+  if ( (b != NULL) && (b->size != sock->batch_size) && (b->len == 0) )
+  {
+    net_free(b);
+    b = sock->c2c_batch = NULL;
+  }
+  if (b == NULL)
+  {
+    b = net_malloc(sizeof(net_c2c_batch_t) + sock->batch_size);
+    if (b == NULL)
+    {
+      msg_error("net_c2c: send queue allocation failed, sending unbatched.\n");
+      return net_c2c_send(sock, buf, len);
+    }
+    memset(b, 0, sizeof(net_c2c_batch_t));
+    b->buf = (uint8_t *) (b + 1);
+    b->size = sock->batch_size;
+    sock->c2c_batch = b;
+  }
+
+  if (b->len + len > b->size)
+  {
+    rc = net_c2c_batch_session(sock);
+    if (rc < 0)
+    {
+      return rc;
+    }
+  }
+  if (len >= b->size)
+  {
+    return net_c2c_send_all(sock, buf, len);
+  }
+
+  if (b->len == 0)
+  {
+    b->first_tick = net_clock_ms();
+  }
+  memcpy(b->buf + b->len, buf, len);
+  b->len += len;
+  sock->batch_stats.queued_bytes = b->len;
+  sock->batch_stats.queued_msgs++;
+
+  if ( (b->len == b->size) || net_c2c_batch_due(sock, net_clock_ms()) )
+  {
+    rc = net_c2c_batch_session(sock);
+  }
+  return (rc < 0) ? rc : (int) len;
+}
+
+
+/** Send the queue of one socket. The queue is emptied in any case: on failure, the error sticks
+ *  to the socket, whose caller was told the queued bytes were sent. */
+static int net_c2c_batch_flush(net_sock_ctxt_t * sock)
+{
+  int rc = NET_OK;
+  net_c2c_batch_t *b = sock->c2c_batch;
+  net_batch_stats_t *st = &sock->batch_stats;
+  uint32_t start_time = net_clock_ms();
+  uint32_t elapsed = 0;
+
+  if ((b == NULL) || (b->len == 0) || (b->error < 0))
+  {
+    return (b == NULL) ? NET_OK : b->error;
+  }
+
+  rc = net_c2c_send_all(sock, b->buf, b->len);
+  elapsed = net_clock_ms() - start_time;
+
+  if (rc < 0)
+  {
+    msg_error("net_c2c: flush failed (%d), %lu queued bytes dropped.\n", rc, (unsigned long) b->len);
+    st->flush_errors++;
+    b->error = rc;
+  }
+  else
+  {
+    st->flushes++;
+    st->flushed_msgs += st->queued_msgs;
+    st->flush_lat_last_ms = elapsed;
+    st->flush_lat_max_ms = MAX(st->flush_lat_max_ms, elapsed);
+    st->hold_max_ms = MAX(st->hold_max_ms, start_time - b->first_tick);
+    rc = NET_OK;
+  }
+  b->len = 0;
+  st->queued_bytes = 0;
+  st->queued_msgs = 0;
+  return rc;
+}
+
+
+/** Flush a socket and, since the radio is awake anyway, all the queues of its interface:
+ *  this keeps the number of wake-ups down, and lets the modem go back to PSM sooner. */
+static int net_c2c_batch_session(net_sock_ctxt_t * sock)
+{
+  int rc = net_c2c_batch_flush(sock);
+
+  for (net_sock_ctxt_t *cur = sock->net->sock_list; cur != NULL; cur = cur->next)
+  {
+    if ( (cur != sock) && (cur->c2c_batch != NULL) && (cur->c2c_batch->len > 0) )
+    {
+      (void) net_c2c_batch_flush(cur);
+    }
+  }
+  return rc;
+}
+
+
+static bool net_c2c_batch_due(net_sock_ctxt_t * sock, uint32_t now)
+{
+  net_c2c_batch_t *b = sock->c2c_batch;
+
+  return (b != NULL) && (b->len > 0) && ((now - b->first_tick) >= sock->batch_deadline);
+}
+
 #endif /* USE_C2C */
 /************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,990 @@
+/*
+ * net_tcp_host.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Daruin Solano
+ *
+ *  NET_IF_HOST backend: TCP and UDP sockets over the Linux socket API, for running the protocol code
+ *  (MQTT, HTTP, WebSocket, NTP, REST) on a development host against local brokers and servers.
+ *  Built with -DUSE_HOST and netsock/host first in the include path (board HAL replacement).
+ *
+ *  The file descriptors are non-blocking: the I/O calls are tried first, and only wait when they would block.
+ *  Each socket owns an epoll instance for these waits, with the socket timeouts. The server accept loop waits
+ *  on it as well, and net_sock_open_start()/net_sock_open_step() drive a non-blocking connect() with it.
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#if defined(USE_HOST) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE   /* accept4(): before any header, or <sys/socket.h> leaves it out. */
+#endif
+#include "net_internal.h"
+
+#ifdef USE_HOST
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <ifaddrs.h>
+#include <netdb.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/random.h>
+#include <sys/socket.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define NET_HOST_LISTEN_BACKLOG   4
+#define NET_HOST_ACCEPT_POLL_MS   2000  /**< Same period as the WiFi module server wait. */
+
+/* Private typedef -----------------------------------------------------------*/
+/** Backend socket context, referenced by net_sock_ctxt_t::underlying_sock_ctxt. */
+typedef struct {
+  int fd;               /**< Connected socket. For a server socket, the accepted client. -1 if none. */
+  int lfd;              /**< Listening socket of a server socket, -1 otherwise. */
+  int epfd;             /**< epoll instance. Watches one descriptor at a time, the one being waited for. */
+  int wfd;              /**< Descriptor in the epoll set, -1 if none. */
+  uint32_t wevents;     /**< Events watched on wfd. */
+} net_host_sock_t;
+
+/* Private variables ---------------------------------------------------------*/
+/** Stands for the STM32 RNG handle in the code shared with the target. Unused on the host. */
+RNG_HandleTypeDef hrng;
+
+/* Private function prototypes -----------------------------------------------*/
+int net_sock_create_host(net_hnd_t nethnd, net_sockhnd_t * sockhnd, net_proto_t proto);
+int net_sock_open_host(net_sockhnd_t sockhnd, const char * hostname, int remoteport, int localport);
+int net_sock_open_start_host(net_sockhnd_t sockhnd, const char * hostname, int remoteport, int localport);
+int net_sock_open_step_host(net_sockhnd_t sockhnd);
+int net_sock_recv_tcp_host(net_sockhnd_t sockhnd, uint8_t * buf, size_t len);
+int net_sock_recvfrom_udp_host(net_sockhnd_t sockhnd, uint8_t * const buf, size_t len, net_ipaddr_t * remoteaddress, int * remoteport);
+int net_sock_send_tcp_host(net_sockhnd_t sockhnd, const uint8_t * buf, size_t len);
+int net_sock_sendv_tcp_host(net_sockhnd_t sockhnd, const net_iovec_t * iov, int iovcnt);
+int net_sock_sendto_udp_host(net_sockhnd_t sockhnd, const uint8_t * buf, size_t len, net_ipaddr_t * remoteaddress, int remoteport);
+int net_sock_close_host(net_sockhnd_t sockhnd);
+int net_sock_destroy_host(net_sockhnd_t sockhnd);
+int net_sock_probe_tcp_host(net_sockhnd_t sockhnd, bool arm);
+int net_get_hostaddress_host(net_ipaddr_t * ipAddress, const char * host);
+int net_get_ip_address_host(net_ipaddr_t * ipAddress);
+int net_get_mac_address_host(net_macaddr_t * macAddress);
+int net_srv_bind_host(net_sockhnd_t sockhnd, net_srv_conn_t * srv);
+int net_srv_listen_host(net_srv_conn_t * srv);
+int net_srv_next_conn_host(net_srv_conn_t * srv);
+
+static int host_watch(net_host_sock_t * hs, int fd, uint32_t events);
+static int host_wait(net_host_sock_t * hs, int fd, uint32_t events, net_deadline_t deadline);
+static net_deadline_t host_deadline(net_sock_ctxt_t * sock, uint16_t timeout);
+static int host_errno_to_net(int err);
+static void host_addr_to_net(const struct sockaddr_in * sin, net_ipaddr_t * ipAddress, int * port);
+static void host_close_fd(net_host_sock_t * hs, int * fd);
+
+/* Functions Definition ------------------------------------------------------*/
+
+int net_sock_create_host(net_hnd_t nethnd, net_sockhnd_t * sockhnd, net_proto_t proto)
+{
+  int rc = NET_ERR;
+  net_ctxt_t *ctxt = (net_ctxt_t *) nethnd;
+  net_sock_ctxt_t *sock = NULL;
+  net_host_sock_t *hs = NULL;
+
+  if ((proto != NET_PROTO_TCP) && (proto != NET_PROTO_UDP))
+  {
+    return NET_PARAM;
+  }
+
+  sock = net_malloc(sizeof(net_sock_ctxt_t));
+  hs = net_malloc(sizeof(net_host_sock_t));
+  if ((sock == NULL) || (hs == NULL))
+  {
+    msg_error("net_sock_create allocation failed.\n");
+    net_free(sock);
+    net_free(hs);
+    return NET_ERR;
+  }
+
+  memset(sock, 0, sizeof(net_sock_ctxt_t));
+  hs->fd = -1;
+  hs->lfd = -1;
+  hs->wfd = -1;
+  hs->wevents = 0;
+  hs->epfd = epoll_create1(EPOLL_CLOEXEC);
+  if (hs->epfd < 0)
+  {
+    msg_error("epoll_create1() failed with error: %d\n", errno);
+    net_free(sock);
+    net_free(hs);
+    return NET_ERR;
+  }
+
+  sock->net = ctxt;
+  sock->next = ctxt->sock_list;
+  sock->methods.open            = (net_sock_open_host);
+  switch(proto)
+  {
+    case NET_PROTO_TCP:
+      sock->methods.open_start  = (net_sock_open_start_host);
+      sock->methods.open_step   = (net_sock_open_step_host);
+      sock->methods.recv        = (net_sock_recv_tcp_host);
+      sock->methods.send        = (net_sock_send_tcp_host);
+      sock->methods.sendv       = (net_sock_sendv_tcp_host);
+      sock->methods.probe       = (net_sock_probe_tcp_host);
+      break;
+    default:
+      sock->methods.recvfrom    = (net_sock_recvfrom_udp_host);
+      sock->methods.sendto      = (net_sock_sendto_udp_host);
+  }
+  sock->methods.close           = (net_sock_close_host);
+  sock->methods.destroy         = (net_sock_destroy_host);
+  sock->proto             = proto;
+  sock->blocking          = NET_DEFAULT_BLOCKING;
+  sock->read_timeout      = NET_DEFAULT_BLOCKING_READ_TIMEOUT;
+  sock->write_timeout     = NET_DEFAULT_BLOCKING_WRITE_TIMEOUT;
+  sock->underlying_sock_ctxt = (net_sockhnd_t) hs;
+  ctxt->sock_list         = sock; /* Insert at the head of the list */
+  *sockhnd = (net_sockhnd_t) sock;
+  rc = NET_OK;
+
+  return rc;
+}
+
+
+int net_sock_open_start_host(net_sockhnd_t sockhnd, const char * hostname, int dstport, int localport)
+{
+  int rc = NET_OK;
+  int ret = 0;
+  net_sock_ctxt_t *sock = (net_sock_ctxt_t * ) sockhnd;
+  net_host_sock_t *hs = (net_host_sock_t *) sock->underlying_sock_ctxt;
+  char portBuffer[6];
+  struct addrinfo hints;
+  struct addrinfo *list = NULL;
+  struct addrinfo *current = NULL;
+
+  if ((hs->fd >= 0) || (hs->lfd >= 0) || (localport != 0))
+  { /* TCP local port setting is not implemented */
+    return NET_PARAM;
+  }
+
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family   = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_protocol = IPPROTO_TCP;
+  snprintf(portBuffer, sizeof(portBuffer), "%d", dstport);
+
+  if( ((ret = getaddrinfo(hostname, portBuffer, &hints, &list)) != 0) || (list == NULL) )
+  {
+    msg_info("The address of %s could not be resolved. Error: %d.\n", hostname, ret);
+    return NET_NOT_FOUND;
+  }
+
+  rc = NET_NOT_FOUND;
+  for (current = list; (current != NULL) && (rc == NET_NOT_FOUND); current = current->ai_next)
+  {
+    int fd = socket(current->ai_family, current->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, current->ai_protocol);
+    if (fd < 0)
+    {
+      continue;
+    }
+    if ((connect(fd, current->ai_addr, current->ai_addrlen) == 0) || (errno == EINPROGRESS))
+    {
+      int one = 1;
+      (void) setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+      hs->fd = fd;
+      rc = (host_watch(hs, fd, EPOLLOUT) == 0) ? NET_IN_PROGRESS : NET_ERR;
+    }
+    else
+    {
+      msg_error("connect() failed with error: %d\n", errno);
+      close(fd);
+    }
+  }
+  freeaddrinfo(list);
+
+  if ((rc != NET_IN_PROGRESS) && (hs->fd >= 0))
+  {
+    host_close_fd(hs, &hs->fd);
+  }
+  return rc;
+}
+
+
+int net_sock_open_step_host(net_sockhnd_t sockhnd)
+{
+  int rc = NET_IN_PROGRESS;
+  net_sock_ctxt_t *sock = (net_sock_ctxt_t * ) sockhnd;
+  net_host_sock_t *hs = (net_host_sock_t *) sock->underlying_sock_ctxt;
+  int ret = 0;
+
+  if (hs->fd < 0)
+  {
+    return NET_PARAM;
+  }
+
+  ret = host_wait(hs, hs->fd, EPOLLOUT, net_deadline_in(0));
+  if (ret > 0)
+  {
+    int err = 0;
+    socklen_t errlen = sizeof(err);
+    if ((getsockopt(hs->fd, SOL_SOCKET, SO_ERROR, &err, &errlen) != 0) || (err != 0))
+    {
+      msg_error("connect() failed with error: %d\n", err);
+      host_close_fd(hs, &hs->fd);
+      rc = NET_NOT_FOUND;
+    }
+    else
+    {
+      rc = NET_OK;
+    }
+  }
+  else if (ret < 0)
+  {
+    host_close_fd(hs, &hs->fd);
+    rc = NET_ERR;
+  }
+
+  return rc;
+}
+
+
+int net_sock_open_host(net_sockhnd_t sockhnd, const char * hostname, int dstport, int localport)
+{
+  int rc = NET_OK;
+  net_sock_ctxt_t *sock = (net_sock_ctxt_t * ) sockhnd;
+  net_host_sock_t *hs = (net_host_sock_t *) sock->underlying_sock_ctxt;
+
+  switch (sock->proto)
+  {
+    case NET_PROTO_TCP:
+    {
+      rc = net_sock_open_start_host(sockhnd, hostname, dstport, localport);
+      if (rc == NET_IN_PROGRESS)
+      {
+        /* Blocking open: wait for the connection within the write timeout. */
+        int ret = host_wait(hs, hs->fd, EPOLLOUT, host_deadline(sock, sock->write_timeout));
+        rc = (ret > 0) ? net_sock_open_step_host(sockhnd) : NET_TIMEOUT;
+        if (rc == NET_TIMEOUT)
+        {
+          msg_error("connect() timed out.\n");
+          host_close_fd(hs, &hs->fd);
+        }
+      }
+      break;
+    }
+    case NET_PROTO_UDP:
+    {
+      struct sockaddr_in local;
+
+      if ((dstport != 0) || (hs->fd >= 0))
+      { /* UDP default remote port setting is not implemented */
+        return NET_PARAM;
+      }
+      memset(&local, 0, sizeof(local));
+      local.sin_family = AF_INET;
+      local.sin_addr.s_addr = htonl(INADDR_ANY);
+      local.sin_port = htons(localport);
+
+      hs->fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_UDP);
+      if (hs->fd < 0)
+      {
+        rc = NET_ERR;
+      }
+      else if (bind(hs->fd, (struct sockaddr *) &local, sizeof(local)) != 0)
+      {
+        msg_error("bind() failed with error: %d\n", errno);
+        host_close_fd(hs, &hs->fd);
+        rc = NET_ERR;
+      }
+      else
+      {
+        rc = (host_watch(hs, hs->fd, EPOLLIN) == 0) ? NET_OK : NET_ERR;
+      }
+      break;
+    }
+    default:
+      rc = NET_PARAM;
+  }
+
+  return rc;
+}
+
+
+int net_sock_recv_tcp_host(net_sockhnd_t sockhnd, uint8_t * buf, size_t len)
+{
+  int rc = 0;
+  net_sock_ctxt_t *sock = (net_sock_ctxt_t * ) sockhnd;
+  net_host_sock_t *hs = (net_host_sock_t *) sock->underlying_sock_ctxt;
+
+  net_deadline_t deadline = host_deadline(sock, sock->read_timeout);
+
+  if (hs->fd < 0)
+  {
+    return NET_PARAM;
+  }
+
+  for (;;)
+  {
+    ssize_t ret = recv(hs->fd, buf, len, 0);
+    if (ret > 0)
+    {
+      rc = (int) ret;
+      break;
+    }
+    if (ret == 0)
+    {
+      rc = (len == 0) ? 0 : NET_EOF;
+      break;
+    }
+    if ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR))
+    {
+      rc = host_errno_to_net(errno);
+      break;
+    }
+    if (!sock->blocking)
+    {
+      rc = 0;
+      break;
+    }
+    ret = host_wait(hs, hs->fd, EPOLLIN | EPOLLRDHUP, deadline);
+    if (ret == 0)
+    {
+      rc = NET_TIMEOUT;
+      break;
+    }
+    if (ret < 0)
+    {
+      rc = NET_ERR;
+      break;
+    }
+  }
+
+  return rc;
+}
+
+
+int net_sock_recvfrom_udp_host(net_sockhnd_t sockhnd, uint8_t * const buf, size_t len, net_ipaddr_t * remoteaddress, int * remoteport)
+{
+  int rc = 0;
+  net_sock_ctxt_t *sock = (net_sock_ctxt_t * ) sockhnd;
+  net_host_sock_t *hs = (net_host_sock_t *) sock->underlying_sock_ctxt;
+  struct sockaddr_in from;
+  socklen_t fromlen = sizeof(from);
+
+  net_deadline_t deadline = host_deadline(sock, sock->read_timeout);
+
+  if (hs->fd < 0)
+  {
+    return NET_PARAM;
+  }
+
+  for (;;)
+  {
+    ssize_t ret = recvfrom(hs->fd, buf, len, 0, (struct sockaddr *) &from, &fromlen);
+    if (ret >= 0)
+    {
+      host_addr_to_net(&from, remoteaddress, remoteport);
+      rc = (int) ret;
+      break;
+    }
+    if ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR))
+    {
+      rc = host_errno_to_net(errno);
+      break;
+    }
+    if (!sock->blocking)
+    {
+      rc = 0;
+      break;
+    }
+    ret = host_wait(hs, hs->fd, EPOLLIN, deadline);
+    if (ret <= 0)
+    {
+      rc = (ret == 0) ? NET_TIMEOUT : NET_ERR;
+      break;
+    }
+  }
+
+  return rc;
+}
+
+
+int net_sock_send_tcp_host(net_sockhnd_t sockhnd, const uint8_t * buf, size_t len)
+{
+  int rc = 0;
+  net_sock_ctxt_t *sock = (net_sock_ctxt_t * ) sockhnd;
+  net_host_sock_t *hs = (net_host_sock_t *) sock->underlying_sock_ctxt;
+
+  net_deadline_t deadline = host_deadline(sock, sock->write_timeout);
+
+  if (hs->fd < 0)
+  {
+    return NET_PARAM;
+  }
+
+  for (;;)
+  {
+    ssize_t ret = send(hs->fd, buf, len, MSG_NOSIGNAL);
+    if (ret >= 0)
+    {
+      rc = (int) ret;
+      break;
+    }
+    if ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR))
+    {
+      rc = host_errno_to_net(errno);
+      break;
+    }
+    if (!sock->blocking)
+    {
+      rc = 0;
+      break;
+    }
+    ret = host_wait(hs, hs->fd, EPOLLOUT, deadline);
+    if (ret <= 0)
+    {
+      rc = (ret == 0) ? NET_TIMEOUT : NET_ERR;
+      break;
+    }
+  }
+
+  return rc;
+}
+
+
+/** Gather write: the segments go to the kernel in a single sendmsg(). */
+int net_sock_sendv_tcp_host(net_sockhnd_t sockhnd, const net_iovec_t * iov, int iovcnt)
+{
+  int rc = 0;
+  int i;
+  net_sock_ctxt_t *sock = (net_sock_ctxt_t * ) sockhnd;
+  net_host_sock_t *hs = (net_host_sock_t *) sock->underlying_sock_ctxt;
+  struct iovec vec[NET_IOV_MAX];
+  struct msghdr msg;
+
+  net_deadline_t deadline = host_deadline(sock, sock->write_timeout);
+
+  if (hs->fd < 0)
+  {
+    return NET_PARAM;
+  }
+
+  for (i = 0; i < iovcnt; i++)
+  {
+    vec[i].iov_base = (void *) iov[i].base;
+    vec[i].iov_len = iov[i].len;
+  }
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = vec;
+  msg.msg_iovlen = iovcnt;
+
+  for (;;)
+  {
+    ssize_t ret = sendmsg(hs->fd, &msg, MSG_NOSIGNAL);
+    if (ret >= 0)
+    {
+      rc = (int) ret;
+      break;
+    }
+    if ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR))
+    {
+      rc = host_errno_to_net(errno);
+      break;
+    }
+    if (!sock->blocking)
+    {
+      rc = 0;
+      break;
+    }
+    ret = host_wait(hs, hs->fd, EPOLLOUT, deadline);
+    if (ret <= 0)
+    {
+      rc = (ret == 0) ? NET_TIMEOUT : NET_ERR;
+      break;
+    }
+  }
+
+  return rc;
+}
+
+
+int net_sock_sendto_udp_host(net_sockhnd_t sockhnd, const uint8_t * buf, size_t len, net_ipaddr_t * remoteaddress, int remoteport)
+{
+  int rc = 0;
+  net_sock_ctxt_t *sock = (net_sock_ctxt_t * ) sockhnd;
+  net_host_sock_t *hs = (net_host_sock_t *) sock->underlying_sock_ctxt;
+  struct sockaddr_in to;
+  ssize_t ret = 0;
+
+  if ((hs->fd < 0) || (remoteaddress->ipv != NET_IP_V4))
+  {
+    return NET_PARAM;
+  }
+
+  memset(&to, 0, sizeof(to));
+  to.sin_family = AF_INET;
+  to.sin_port = htons(remoteport);
+  memcpy(&to.sin_addr.s_addr, &remoteaddress->ip[12], 4);
+
+  ret = sendto(hs->fd, buf, len, 0, (struct sockaddr *) &to, sizeof(to));
+  rc = (ret >= 0) ? (int) ret : host_errno_to_net(errno);
+
+  return rc;
+}
+
+
+int net_sock_close_host(net_sockhnd_t sockhnd)
+{
+  net_sock_ctxt_t *sock = (net_sock_ctxt_t * ) sockhnd;
+  net_host_sock_t *hs = (net_host_sock_t *) sock->underlying_sock_ctxt;
+
+  if ((hs->fd < 0) && (hs->lfd < 0))
+  {
+    msg_warning("Underlying socket already closed. Skipping net_sock_close_host().");
+  }
+  if (hs->fd >= 0)
+  {
+    if (sock->proto == NET_PROTO_TCP)
+    {
+      (void) shutdown(hs->fd, SHUT_RDWR);
+    }
+    host_close_fd(hs, &hs->fd);
+  }
+  if (hs->lfd >= 0)
+  {
+    host_close_fd(hs, &hs->lfd);
+  }
+
+  return NET_OK;
+}
+
+
+/** The kernel sends the TCP keepalive probes, with the sock_keepalive timings; the probe reports
+ *  what it found: a pending error, or the FIN of the peer. */
+int net_sock_probe_tcp_host(net_sockhnd_t sockhnd, bool arm)
+{
+  net_sock_ctxt_t *sock = (net_sock_ctxt_t * ) sockhnd;
+  net_host_sock_t *hs = (net_host_sock_t *) sock->underlying_sock_ctxt;
+  int err = 0;
+  socklen_t errlen = sizeof(err);
+  uint8_t b;
+  ssize_t ret;
+
+  if (hs->fd < 0)
+  {
+    return NET_EOF;
+  }
+  if (arm)
+  {
+    int one = 1;
+    int idle = MAX(1, (int) (sock->ka_idle / 1000));
+    int intvl = MAX(1, (int) (sock->ka_intvl / 1000));
+    int cnt = sock->ka_cnt;
+
+    (void) setsockopt(hs->fd, SOL_SOCKET, SO_KEEPALIVE, &one, sizeof(one));
+    (void) setsockopt(hs->fd, IPPROTO_TCP, TCP_KEEPIDLE, &idle, sizeof(idle));
+    (void) setsockopt(hs->fd, IPPROTO_TCP, TCP_KEEPINTVL, &intvl, sizeof(intvl));
+    (void) setsockopt(hs->fd, IPPROTO_TCP, TCP_KEEPCNT, &cnt, sizeof(cnt));
+  }
+
+  if ((getsockopt(hs->fd, SOL_SOCKET, SO_ERROR, &err, &errlen) == 0) && (err != 0))
+  {
+    msg_debug("net_sock_probe_tcp_host: socket error %d\n", err);
+    return NET_EOF;
+  }
+  ret = recv(hs->fd, &b, 1, MSG_PEEK | MSG_DONTWAIT);
+  if (ret == 0)
+  {
+    return NET_EOF;
+  }
+  if ((ret < 0) && (errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR))
+  {
+    return NET_EOF;
+  }
+  return NET_OK;
+}
+
+
+int net_sock_destroy_host(net_sockhnd_t sockhnd)
+{
+  int rc = NET_ERR;
+  net_sock_ctxt_t *sock = (net_sock_ctxt_t * ) sockhnd;
+  net_ctxt_t *ctxt = sock->net;
+
+  /* Find the parent in the linked list.
+   * Unlink and free.
+   */
+  if (sock == ctxt->sock_list)
+  {
+    ctxt->sock_list = sock->next;
+    rc = NET_OK;
+  }
+  else
+  {
+    net_sock_ctxt_t *cur = ctxt->sock_list;
+    while ((cur != NULL) && (cur->next != NULL))
+    {
+      if (cur->next == sock)
+      {
+        cur->next = sock->next;
+        rc = NET_OK;
+        break;
+      }
+      cur = cur->next;
+    }
+  }
+  if (rc == NET_OK)
+  {
+    net_host_sock_t *hs = (net_host_sock_t *) sock->underlying_sock_ctxt;
+    if ((hs->fd >= 0) || (hs->lfd >= 0))
+    {
+      (void) net_sock_close_host(sockhnd);
+    }
+    close(hs->epfd);
+    net_free(hs);
+    net_free(sock);
+  }
+
+  return rc;
+}
+
+
+int net_get_hostaddress_host(net_ipaddr_t * ipAddress, const char * host)
+{
+  int rc = NET_ERR;
+  int ret = 0;
+  struct addrinfo hints;
+  struct addrinfo *servinfo = NULL;
+
+  memset(&hints, 0, sizeof hints);
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_DGRAM;
+
+  ret = getaddrinfo(host, NULL, &hints, &servinfo);
+  if ((ret != 0) || (servinfo == NULL))
+  {
+    msg_error("getaddrinfo error: %d.\n", ret);
+    rc = NET_NOT_FOUND;
+  }
+  else
+  {
+    host_addr_to_net((struct sockaddr_in *) servinfo->ai_addr, ipAddress, NULL);
+    freeaddrinfo(servinfo);
+    rc = NET_OK;
+  }
+
+  return rc;
+}
+
+
+/**
+ * @brief   Address of the first IPv4 interface which is up and not a loopback, or 127.0.0.1.
+ */
+int net_get_ip_address_host(net_ipaddr_t * ipAddress)
+{
+  struct ifaddrs *list = NULL;
+  struct ifaddrs *cur = NULL;
+  struct sockaddr_in lo;
+
+  memset(&lo, 0, sizeof(lo));
+  lo.sin_family = AF_INET;
+  lo.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  host_addr_to_net(&lo, ipAddress, NULL);
+
+  if (getifaddrs(&list) == 0)
+  {
+    for (cur = list; cur != NULL; cur = cur->ifa_next)
+    {
+      if ((cur->ifa_addr != NULL) && (cur->ifa_addr->sa_family == AF_INET)
+          && ((cur->ifa_flags & IFF_UP) != 0) && ((cur->ifa_flags & IFF_LOOPBACK) == 0))
+      {
+        host_addr_to_net((struct sockaddr_in *) cur->ifa_addr, ipAddress, NULL);
+        break;
+      }
+    }
+    freeifaddrs(list);
+  }
+
+  return NET_OK;
+}
+
+
+/**
+ * @brief   Hardware address of the first interface which is up and not a loopback.
+ */
+int net_get_mac_address_host(net_macaddr_t * macAddress)
+{
+  int rc = NET_ERR;
+  struct ifaddrs *list = NULL;
+  struct ifaddrs *cur = NULL;
+  int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+
+  if ((fd >= 0) && (getifaddrs(&list) == 0))
+  {
+    for (cur = list; (cur != NULL) && (rc != NET_OK); cur = cur->ifa_next)
+    {
+      struct ifreq ifr;
+      if ((cur->ifa_addr == NULL) || (cur->ifa_addr->sa_family != AF_INET)
+          || ((cur->ifa_flags & IFF_UP) == 0) || ((cur->ifa_flags & IFF_LOOPBACK) != 0))
+      {
+        continue;
+      }
+      memset(&ifr, 0, sizeof(ifr));
+      strncpy(ifr.ifr_name, cur->ifa_name, sizeof(ifr.ifr_name) - 1);
+      if (ioctl(fd, SIOCGIFHWADDR, &ifr) == 0)
+      {
+        memcpy(macAddress->mac, ifr.ifr_hwaddr.sa_data, sizeof(macAddress->mac));
+        rc = NET_OK;
+      }
+    }
+    freeifaddrs(list);
+  }
+  if (fd >= 0)
+  {
+    close(fd);
+  }
+
+  return rc;
+}
+
+
+/**
+ * @brief   net_srv_bind() for NET_IF_HOST: listening TCP socket, or bound UDP socket.
+ */
+int net_srv_bind_host(net_sockhnd_t sockhnd, net_srv_conn_t * srv)
+{
+  int rc = NET_OK;
+  net_sock_ctxt_t *sock = (net_sock_ctxt_t * ) sockhnd;
+  net_host_sock_t *hs = (net_host_sock_t *) sock->underlying_sock_ctxt;
+  struct sockaddr_in local;
+  int one = 1;
+
+  if (sock->proto == NET_PROTO_UDP)
+  {
+    return net_sock_open_host(sockhnd, NULL, 0, srv->localport);
+  }
+
+  memset(&local, 0, sizeof(local));
+  local.sin_family = AF_INET;
+  local.sin_addr.s_addr = htonl(INADDR_ANY);
+  local.sin_port = htons(srv->localport);
+
+  hs->lfd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
+  if (hs->lfd < 0)
+  {
+    return NET_ERR;
+  }
+  (void) setsockopt(hs->lfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  if ((bind(hs->lfd, (struct sockaddr *) &local, sizeof(local)) != 0)
+      || (listen(hs->lfd, NET_HOST_LISTEN_BACKLOG) != 0))
+  {
+    msg_error("Could not listen on port %u. Error: %d\n", srv->localport, errno);
+    host_close_fd(hs, &hs->lfd);
+    rc = NET_ERR;
+  }
+
+  return rc;
+}
+
+
+/**
+ * @brief   net_srv_listen() for NET_IF_HOST: wait forever for a client, which then becomes the peer
+ *          of the net_sock_recv() and net_sock_send() calls on srv->sock. The previous client, if any, is closed.
+ */
+int net_srv_listen_host(net_srv_conn_t * srv)
+{
+  net_sock_ctxt_t *sock = (net_sock_ctxt_t * ) srv->sock;
+  net_host_sock_t *hs = (net_host_sock_t *) sock->underlying_sock_ctxt;
+
+  if (hs->lfd < 0)
+  {
+    return (hs->fd >= 0) ? NET_OK : NET_PARAM;  /* UDP server: nothing to accept. */
+  }
+  if (hs->fd >= 0)
+  {
+    host_close_fd(hs, &hs->fd);
+  }
+
+  for (;;)
+  {
+    struct sockaddr_in from;
+    socklen_t fromlen = sizeof(from);
+    int fd = accept4(hs->lfd, (struct sockaddr *) &from, &fromlen, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd >= 0)
+    {
+      int one = 1;
+      int port = 0;
+      (void) setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+      hs->fd = fd;
+      host_addr_to_net(&from, &srv->remoteip, &port);
+      srv->remoteport = (uint16_t) port;
+      return NET_OK;
+    }
+    if ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR) && (errno != ECONNABORTED))
+    {
+      msg_error("accept() failed with error: %d\n", errno);
+      return NET_ERR;
+    }
+    if (host_wait(hs, hs->lfd, EPOLLIN, net_deadline_in(NET_HOST_ACCEPT_POLL_MS)) < 0)
+    {
+      return NET_ERR;
+    }
+  }
+}
+
+
+/**
+ * @brief   net_srv_next_conn() for NET_IF_HOST: close the current client connection.
+ */
+int net_srv_next_conn_host(net_srv_conn_t * srv)
+{
+  net_sock_ctxt_t *sock = (net_sock_ctxt_t * ) srv->sock;
+  net_host_sock_t *hs = (net_host_sock_t *) sock->underlying_sock_ctxt;
+
+  if ((hs->lfd >= 0) && (hs->fd >= 0))
+  {
+    (void) shutdown(hs->fd, SHUT_RDWR);
+    host_close_fd(hs, &hs->fd);
+  }
+  return NET_OK;
+}
+
+
+/**
+ * @brief   mbedTLS entropy source of the host build: the kernel CSPRNG.
+ */
+int mbedtls_hardware_poll( void *data, unsigned char *output, size_t len, size_t *olen )
+{
+  ssize_t ret = 0;
+
+  ((void) data);
+  *olen = 0;
+  ret = getrandom(output, len, 0);
+  if (ret > 0)
+  {
+    *olen = (size_t) ret;
+  }
+  return 0;
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/** Make fd, with events, the descriptor watched by the epoll set of the socket. */
+static int host_watch(net_host_sock_t * hs, int fd, uint32_t events)
+{
+  struct epoll_event ev;
+  int op = EPOLL_CTL_MOD;
+
+  if ((fd == hs->wfd) && (events == hs->wevents))
+  {
+    return 0;
+  }
+  if (fd != hs->wfd)
+  {
+    if (hs->wfd >= 0)
+    {
+      (void) epoll_ctl(hs->epfd, EPOLL_CTL_DEL, hs->wfd, NULL);
+    }
+    op = EPOLL_CTL_ADD;
+  }
+
+  memset(&ev, 0, sizeof(ev));
+  ev.events = events;
+  ev.data.fd = fd;
+  if (epoll_ctl(hs->epfd, op, fd, &ev) != 0)
+  {
+    hs->wfd = -1;
+    hs->wevents = 0;
+    return -1;
+  }
+  hs->wfd = fd;
+  hs->wevents = events;
+  return 0;
+}
+
+
+/**
+ * @brief   Wait for events on fd.
+ * @param   In:   deadline  NET_DEADLINE_NONE to wait forever.
+ * @retval  >0 if fd is ready, 0 on timeout, <0 on error.
+ */
+static int host_wait(net_host_sock_t * hs, int fd, uint32_t events, net_deadline_t deadline)
+{
+  if (host_watch(hs, fd, events) != 0)
+  {
+    return -1;
+  }
+
+  for (;;)
+  {
+    struct epoll_event ev;
+    int left = deadline.armed ? (int) MIN(net_deadline_left_ms(deadline), INT32_MAX) : -1;
+    int n = epoll_wait(hs->epfd, &ev, 1, left);
+    if (n >= 0)
+    {
+      return n;
+    }
+    if (errno != EINTR)
+    {
+      return -1;
+    }
+    if (net_deadline_expired(deadline))
+    {
+      return 0;
+    }
+  }
+}
+
+
+/** Deadline of a blocking call. A 0 socket timeout means no timeout: only the inherited deadline applies. */
+static net_deadline_t host_deadline(net_sock_ctxt_t * sock, uint16_t timeout)
+{
+  return (timeout != 0) ? net_sock_deadline(sock, timeout) : sock->deadline;
+}
+
+
+static int host_errno_to_net(int err)
+{
+  int rc = NET_ERR;
+
+  switch(err)
+  {
+    case EPIPE:
+    case ECONNRESET:
+    case ENOTCONN:
+    case ECONNABORTED:
+      rc = NET_EOF;
+      break;
+    case ETIMEDOUT:
+      rc = NET_TIMEOUT;
+      break;
+    default:
+      rc = NET_ERR;
+  }
+
+  return rc;
+}
+
+
+static void host_addr_to_net(const struct sockaddr_in * sin, net_ipaddr_t * ipAddress, int * port)
+{
+  ipAddress->ipv = NET_IP_V4;
+  memset(ipAddress->ip, 0xFF, sizeof(ipAddress->ip));
+  memcpy(&ipAddress->ip[12], &sin->sin_addr, 4);
+  if (port != NULL)
+  {
+    *port = ntohs(sin->sin_port);
+  }
+}
+
+
+/** Close a descriptor; closing also removes it from the epoll set. */
+static void host_close_fd(net_host_sock_t * hs, int * fd)
+{
+  if (*fd == hs->wfd)
+  {
+    hs->wfd = -1;
+    hs->wevents = 0;
+  }
+  close(*fd);
+  *fd = -1;
+}
+
+#endif /* USE_HOST */
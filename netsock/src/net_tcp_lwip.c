@@ -47,7 +47,7 @@
 /* Includes ------------------------------------------------------------------*/
 #include "net_internal.h"
 
-#ifdef USE_LWIP
+#if defined(USE_LWIP) && !defined(USE_LWIP_NETCONN)
 #include "lwip/netdb.h"
 
 /* Private defines -----------------------------------------------------------*/
@@ -589,6 +589,6 @@ int net_get_hostaddress_lwip(net_hnd_t nethnd, net_ipaddr_t * ipAddress, const c
   return rc;
 }
 
-#endif /* USE_LWIP */
+#endif /* USE_LWIP && !USE_LWIP_NETCONN */
 
 /************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
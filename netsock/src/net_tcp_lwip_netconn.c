@@ -0,0 +1,641 @@
+/*
+ * net_tcp_lwip_netconn.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Daruin Solano
+ *
+ *  lwIP backend on the netconn API. Alternative to net_tcp_lwip.c (BSD sockets), selected by USE_LWIP_NETCONN.
+ *  The received pbuf chains are kept by the socket: net_sock_recv() copies out of them, and
+ *  net_sock_recv_buf() hands out views on the pbuf payloads, which hold a pbuf reference until released.
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "net_internal.h"
+
+#if defined(USE_LWIP) && defined(USE_LWIP_NETCONN)
+#include "lwip/api.h"
+#include "lwip/pbuf.h"
+#include "lwip/tcp.h"
+#include "lwip/tcpip.h"
+
+#if !LWIP_SO_RCVTIMEO
+#error  lwipopts.h must define LWIP_SO_RCVTIMEO so that the TCP read timeout is supported.
+#endif /* !LWIP_SO_RCVTIMEO */
+#if !LWIP_SO_SNDTIMEO
+#error  lwipopts.h must define LWIP_SO_SNDTIMEO so that the TCP write timeout is supported.
+#endif /* !LWIP_SO_SNDTIMEO */
+
+/* Private defines -----------------------------------------------------------*/
+/* Private typedef -----------------------------------------------------------*/
+/** Backend socket context, referenced by net_sock_ctxt_t::underlying_sock_ctxt. */
+typedef struct {
+  struct netconn * conn;  /**< NULL when the socket is closed. */
+  struct pbuf * rx;       /**< First pbuf of the received chain not consumed yet. */
+  u16_t rx_off;           /**< Consumed bytes in rx. */
+} net_lwip_nc_t;
+
+/* Private variables ---------------------------------------------------------*/
+/* Private function prototypes -----------------------------------------------*/
+int net_sock_create_lwip(net_hnd_t nethnd, net_sockhnd_t * sockhnd, net_proto_t proto);
+int net_sock_open_lwip(net_sockhnd_t sockhnd, const char * hostname, int remoteport, int localport);
+int net_sock_recv_tcp_lwip(net_sockhnd_t sockhnd, uint8_t * buf, size_t len);
+int net_sock_recv_buf_tcp_lwip(net_sockhnd_t sockhnd, net_buf_t * view, size_t maxlen);
+int net_sock_release_buf_lwip(net_sockhnd_t sockhnd, net_buf_t * view);
+int net_sock_recvfrom_udp_lwip(net_sockhnd_t sockhnd, uint8_t * const buf, size_t len, net_ipaddr_t * remoteaddress, int * remoteport);
+int net_sock_send_tcp_lwip( net_sockhnd_t sockhnd, const uint8_t * buf, size_t len);
+int net_sock_sendto_udp_lwip(net_sockhnd_t sockhnd, const uint8_t * buf, size_t len,  net_ipaddr_t * remoteaddress, int remoteport);
+int net_sock_close_tcp_lwip(net_sockhnd_t sockhnd);
+int net_sock_destroy_tcp_lwip(net_sockhnd_t sockhnd);
+int net_sock_probe_tcp_lwip(net_sockhnd_t sockhnd, bool arm);
+int net_get_hostaddress_lwip(net_hnd_t nethnd, net_ipaddr_t * ipAddress, const char * host);
+
+static int rx_fill(net_sock_ctxt_t * sock, net_lwip_nc_t * nc);
+static void rx_consume(net_lwip_nc_t * nc, size_t len);
+static int err_to_net(net_sock_ctxt_t * sock, err_t err, bool reading);
+static void nc_set_timeout(net_sock_ctxt_t * sock, net_lwip_nc_t * nc, bool reading);
+
+/* Functions Definition ------------------------------------------------------*/
+
+int net_sock_create_lwip(net_hnd_t nethnd, net_sockhnd_t * sockhnd, net_proto_t proto)
+{
+  int rc = NET_ERR;
+  net_ctxt_t *ctxt = (net_ctxt_t *) nethnd;
+  net_sock_ctxt_t *sock = NULL;
+  net_lwip_nc_t *nc = NULL;
+
+  sock = net_malloc(sizeof(net_sock_ctxt_t));
+  nc = net_malloc(sizeof(net_lwip_nc_t));
+  if ((sock == NULL) || (nc == NULL))
+  {
+    msg_error("net_sock_create allocation failed.\n");
+    net_free(sock);
+    net_free(nc);
+    rc = NET_ERR;
+  }
+  else
+  {
+    memset(sock, 0, sizeof(net_sock_ctxt_t));
+    memset(nc, 0, sizeof(net_lwip_nc_t));
+    sock->net = ctxt;
+    sock->next = ctxt->sock_list;
+    sock->methods.open            = (net_sock_open_lwip);
+    switch(proto)
+    {
+      case NET_PROTO_TCP:
+        sock->methods.recv        = (net_sock_recv_tcp_lwip);
+        sock->methods.recv_buf    = (net_sock_recv_buf_tcp_lwip);
+        sock->methods.release_buf = (net_sock_release_buf_lwip);
+        sock->methods.send        = (net_sock_send_tcp_lwip);
+        sock->methods.probe       = (net_sock_probe_tcp_lwip);
+        break;
+      case NET_PROTO_UDP:
+        sock->methods.recvfrom    = (net_sock_recvfrom_udp_lwip);
+        sock->methods.sendto      = (net_sock_sendto_udp_lwip);
+        break;
+      default:
+        net_free(nc);
+        net_free(sock);
+        return NET_PARAM;
+    }
+    sock->methods.close           =  (net_sock_close_tcp_lwip);
+    sock->methods.destroy         =  (net_sock_destroy_tcp_lwip);
+    sock->proto             = proto;
+    sock->blocking          = NET_DEFAULT_BLOCKING;
+    sock->read_timeout      = NET_DEFAULT_BLOCKING_READ_TIMEOUT;
+    sock->write_timeout     = NET_DEFAULT_BLOCKING_WRITE_TIMEOUT;
+    sock->underlying_sock_ctxt = (net_sockhnd_t) nc;
+    ctxt->sock_list         = sock; /* Insert at the head of the list */
+    *sockhnd = (net_sockhnd_t) sock;
+
+    rc = NET_OK;
+  }
+
+  return rc;
+}
+
+
+int net_sock_open_lwip(net_sockhnd_t sockhnd, const char * hostname, int dstport, int localport)
+{
+  int rc = NET_OK;
+  err_t err = ERR_OK;
+  net_sock_ctxt_t *sock = (net_sock_ctxt_t * ) sockhnd;
+  net_lwip_nc_t *nc = (net_lwip_nc_t *) sock->underlying_sock_ctxt;
+  ip_addr_t addr;
+
+  if (nc->conn != NULL)
+  {
+    return NET_PARAM;
+  }
+
+  switch (sock->proto)
+  {
+    case NET_PROTO_TCP:
+      if (localport != 0)
+      { /* TCP local port setting is not implemented */
+        return NET_PARAM;
+      }
+      if ((err = netconn_gethostbyname(hostname, &addr)) != ERR_OK)
+      {
+        msg_info("The address of %s could not be resolved. Error: %d.\n", hostname, err);
+        return NET_NOT_FOUND;
+      }
+      nc->conn = netconn_new(NETCONN_TCP);
+      break;
+    case NET_PROTO_UDP:
+      if (dstport != 0)
+      { /* UDP default remote port setting is not implemented */
+        return NET_PARAM;
+      }
+      nc->conn = netconn_new(NETCONN_UDP);
+      break;
+    default:
+      return NET_PARAM;
+  }
+
+  if (nc->conn == NULL)
+  {
+    msg_error("netconn_new() failed.\n");
+    return NET_ERR;
+  }
+
+  if (sock->blocking)
+  {
+    netconn_set_recvtimeout(nc->conn, sock->read_timeout);
+    netconn_set_sendtimeout(nc->conn, sock->write_timeout);
+  }
+
+  if (sock->proto == NET_PROTO_TCP)
+  {
+    err = netconn_connect(nc->conn, &addr, (u16_t) dstport);
+    if (err != ERR_OK)
+    {
+      msg_error("netconn_connect() failed with error: %d\n", err);
+      rc = NET_NOT_FOUND;
+    }
+  }
+  else
+  {
+    err = netconn_bind(nc->conn, IP_ADDR_ANY, (u16_t) localport);
+    if (err != ERR_OK)
+    {
+      msg_error("netconn_bind() failed with error: %d\n", err);
+      rc = NET_ERR;
+    }
+  }
+
+  if (rc == NET_OK)
+  {
+    /* Set after connect(), which must block. */
+    netconn_set_nonblocking(nc->conn, sock->blocking ? 0 : 1);
+  }
+  else
+  {
+    netconn_delete(nc->conn);
+    nc->conn = NULL;
+  }
+
+  return rc;
+}
+
+
+int net_sock_recv_tcp_lwip(net_sockhnd_t sockhnd, uint8_t * buf, size_t len)
+{
+  int rc = 0;
+  net_sock_ctxt_t *sock = (net_sock_ctxt_t * ) sockhnd;
+  net_lwip_nc_t *nc = (net_lwip_nc_t *) sock->underlying_sock_ctxt;
+
+  if (nc->conn == NULL)
+  {
+    return NET_PARAM;
+  }
+
+  rc = rx_fill(sock, nc);
+  if (rc > 0)
+  {
+    /* Copy whatever is already received, without waiting for more. */
+    u16_t n = (u16_t) MIN(len, (size_t) (nc->rx->tot_len - nc->rx_off));
+    n = pbuf_copy_partial(nc->rx, buf, n, nc->rx_off);
+    rx_consume(nc, n);
+    rc = n;
+  }
+
+  return rc;
+}
+
+
+int net_sock_recv_buf_tcp_lwip(net_sockhnd_t sockhnd, net_buf_t * view, size_t maxlen)
+{
+  int rc = 0;
+  net_sock_ctxt_t *sock = (net_sock_ctxt_t * ) sockhnd;
+  net_lwip_nc_t *nc = (net_lwip_nc_t *) sock->underlying_sock_ctxt;
+
+  if (nc->conn == NULL)
+  {
+    return NET_PARAM;
+  }
+
+  rc = rx_fill(sock, nc);
+  if (rc > 0)
+  {
+    /* One view per pbuf: the payload of a chain is not contiguous. */
+    struct pbuf *p = nc->rx;
+    size_t n = MIN(maxlen, (size_t) (p->len - nc->rx_off));
+
+    pbuf_ref(p);
+    view->data = (const uint8_t *) p->payload + nc->rx_off;
+    view->len = n;
+    view->priv = p;
+    rx_consume(nc, n);
+    rc = (int) n;
+  }
+
+  return rc;
+}
+
+
+int net_sock_release_buf_lwip(net_sockhnd_t sockhnd, net_buf_t * view)
+{
+  (void) sockhnd;
+  pbuf_free((struct pbuf *) view->priv);
+  return NET_OK;
+}
+
+
+int net_sock_recvfrom_udp_lwip(net_sockhnd_t sockhnd, uint8_t * const buf, size_t len, net_ipaddr_t * remoteaddress, int * remoteport)
+{
+  int rc = 0;
+  err_t err = ERR_OK;
+  net_sock_ctxt_t *sock = (net_sock_ctxt_t * ) sockhnd;
+  net_lwip_nc_t *nc = (net_lwip_nc_t *) sock->underlying_sock_ctxt;
+  struct netbuf *nb = NULL;
+
+  if (nc->conn == NULL)
+  {
+    return NET_PARAM;
+  }
+
+  nc_set_timeout(sock, nc, true);
+  err = netconn_recv(nc->conn, &nb);
+  if (err != ERR_OK)
+  {
+    rc = err_to_net(sock, err, true);
+  }
+  else
+  {
+    const ip_addr_t *from = netbuf_fromaddr(nb);
+    if (IP_IS_V4(from))
+    {
+      u32_t ip = ip4_addr_get_u32(ip_2_ip4(from));
+      rc = netbuf_copy(nb, buf, (u16_t) MIN(len, 0xFFFF));
+      remoteaddress->ipv = NET_IP_V4;
+      memset(remoteaddress->ip, 0xFF, sizeof(remoteaddress->ip));
+      memcpy(&remoteaddress->ip[12], &ip, 4);
+      *remoteport = netbuf_fromport(nb);
+    }
+    else
+    {
+      /* IPv6 not implemented. */
+      rc = NET_ERR;
+    }
+    netbuf_delete(nb);
+  }
+
+  return rc;
+}
+
+
+int net_sock_send_tcp_lwip( net_sockhnd_t sockhnd, const uint8_t * buf, size_t len)
+{
+  int rc = 0;
+  err_t err = ERR_OK;
+  size_t written = 0;
+  net_sock_ctxt_t *sock = (net_sock_ctxt_t * ) sockhnd;
+  net_lwip_nc_t *nc = (net_lwip_nc_t *) sock->underlying_sock_ctxt;
+
+  if (nc->conn == NULL)
+  {
+    return NET_PARAM;
+  }
+
+  nc_set_timeout(sock, nc, false);
+  /* NETCONN_COPY: the caller buffer is not kept until the segments are acknowledged. */
+  err = netconn_write_partly(nc->conn, buf, len, NETCONN_COPY, &written);
+  if ((written > 0) || (err == ERR_OK))
+  {
+    rc = (int) written;
+  }
+  else
+  {
+    rc = err_to_net(sock, err, false);
+  }
+
+  return rc;
+}
+
+
+int net_sock_sendto_udp_lwip(net_sockhnd_t sockhnd, const uint8_t * buf, size_t len, net_ipaddr_t * remoteaddress, int remoteport)
+{
+  int rc = 0;
+  err_t err = ERR_OK;
+  net_sock_ctxt_t *sock = (net_sock_ctxt_t * ) sockhnd;
+  net_lwip_nc_t *nc = (net_lwip_nc_t *) sock->underlying_sock_ctxt;
+  struct netbuf *nb = NULL;
+  ip_addr_t to;
+  u32_t ip;
+
+  if ((nc->conn == NULL) || (remoteaddress->ipv != NET_IP_V4) || (len > 0xFFFF))
+  {
+    return NET_PARAM;
+  }
+
+  memcpy(&ip, &remoteaddress->ip[12], 4);
+  ip_addr_set_ip4_u32(&to, ip);
+
+  nb = netbuf_new();
+  if (nb == NULL)
+  {
+    return NET_ERR;
+  }
+  /* The datagram is sent before netconn_sendto() returns: no copy of the payload. */
+  err = netbuf_ref(nb, buf, (u16_t) len);
+  if (err == ERR_OK)
+  {
+    err = netconn_sendto(nc->conn, nb, &to, (u16_t) remoteport);
+  }
+  netbuf_delete(nb);
+
+  rc = (err == ERR_OK) ? (int) len : err_to_net(sock, err, false);
+  return rc;
+}
+
+
+int net_sock_close_tcp_lwip(net_sockhnd_t sockhnd)
+{
+  int rc = NET_OK;
+  net_sock_ctxt_t *sock = (net_sock_ctxt_t * ) sockhnd;
+  net_lwip_nc_t *nc = (net_lwip_nc_t *) sock->underlying_sock_ctxt;
+
+  if (nc->conn != NULL)
+  {
+    if (sock->proto == NET_PROTO_TCP)
+    {
+      (void) netconn_close(nc->conn);
+    }
+    if (ERR_OK != netconn_delete(nc->conn))
+    {
+      msg_error("Could not delete the netconn.\n");
+      rc = NET_ERR;
+    }
+    nc->conn = NULL;
+    /* Views still held by the caller keep their own pbuf reference. */
+    if (nc->rx != NULL)
+    {
+      pbuf_free(nc->rx);
+      nc->rx = NULL;
+      nc->rx_off = 0;
+    }
+  }
+  else
+  {
+    msg_warning("Underlying socket already closed. Skipping net_sock_close_tcp_lwip().");
+  }
+
+  return rc;
+}
+
+
+/**
+ * @brief   sock_keepalive probe.
+ *          On arming, the lwIP TCP keepalive is configured from the socket option when it is
+ *          compiled in (LWIP_TCP_KEEPALIVE): the stack then aborts the connection by itself.
+ *          A connection aborted by the stack has lost its pcb, or reports an error.
+ */
+int net_sock_probe_tcp_lwip(net_sockhnd_t sockhnd, bool arm)
+{
+  int rc = NET_OK;
+  net_sock_ctxt_t *sock = (net_sock_ctxt_t * ) sockhnd;
+  net_lwip_nc_t *nc = (net_lwip_nc_t *) sock->underlying_sock_ctxt;
+
+  if (nc->conn == NULL)
+  {
+    return NET_EOF;
+  }
+
+  LOCK_TCPIP_CORE();
+  if ((nc->conn->pcb.tcp == NULL) || (netconn_err(nc->conn) != ERR_OK))
+  {
+    rc = NET_EOF;
+  }
+#if LWIP_TCP_KEEPALIVE
+  else if (arm)
+  {
+    struct tcp_pcb *pcb = nc->conn->pcb.tcp;
+    ip_set_option(pcb, SOF_KEEPALIVE);
+    pcb->keep_idle = MAX(sock->ka_idle, 1000);
+    pcb->keep_intvl = MAX(sock->ka_intvl, 1000);
+    pcb->keep_cnt = MAX(sock->ka_cnt, 1);
+  }
+#else
+  (void) arm;
+#endif /* LWIP_TCP_KEEPALIVE */
+  UNLOCK_TCPIP_CORE();
+
+  return rc;
+}
+
+
+int net_sock_destroy_tcp_lwip(net_sockhnd_t sockhnd)
+{
+  int rc = NET_ERR;
+  net_sock_ctxt_t *sock = (net_sock_ctxt_t * ) sockhnd;
+  net_ctxt_t *ctxt = sock->net;
+
+  /* Find the parent in the linked list.
+   * Unlink and free.
+   */
+  if (sock == ctxt->sock_list)
+  {
+    ctxt->sock_list = sock->next;
+    rc = NET_OK;
+  }
+  else
+  {
+    net_sock_ctxt_t *cur = ctxt->sock_list;
+    do
+    {
+      if (cur->next == sock)
+      {
+        cur->next = sock->next;
+        rc = NET_OK;
+        break;
+      }
+      cur = cur->next;
+    } while(cur->next != NULL);
+  }
+  if (rc == NET_OK)
+  {
+    net_lwip_nc_t *nc = (net_lwip_nc_t *) sock->underlying_sock_ctxt;
+    if (nc->conn != NULL)
+    {
+      (void) net_sock_close_tcp_lwip(sockhnd);
+    }
+    net_free(nc);
+    net_free(sock);
+  }
+
+  return rc;
+}
+
+
+int net_get_hostaddress_lwip(net_hnd_t nethnd, net_ipaddr_t * ipAddress, const char * host)
+{
+  net_ctxt_t *ctxt = (net_ctxt_t *) nethnd;
+  int rc = NET_ERR;
+
+  if ((ipAddress == NULL) || (host == NULL))
+  {
+    rc = NET_PARAM;
+  }
+  else if (ctxt->lwip_netif.ip_addr.addr == 0)
+  {
+    /* The network interface is not configured. */
+    rc = NET_PARAM;
+  }
+  else
+  {
+    ip_addr_t addr;
+    err_t err = netconn_gethostbyname(host, &addr);
+    if (err != ERR_OK)
+    {
+      msg_error("netconn_gethostbyname error: %d.\n", err);
+      rc = NET_NOT_FOUND;
+    }
+    else
+    {
+      u32_t ip = ip4_addr_get_u32(ip_2_ip4(&addr));
+      ipAddress->ipv = NET_IP_V4;
+      memset(ipAddress->ip, 0xFF, sizeof(ipAddress->ip));
+      memcpy(&ipAddress->ip[12], &ip, 4);
+      rc = NET_OK;
+    }
+  }
+
+  return rc;
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief   Make sure that received bytes are pending in nc->rx, waiting for them in blocking mode.
+ * @retval  >0 if bytes are pending, 0 if none in non-blocking mode, or a NET_xxx error code.
+ */
+static int rx_fill(net_sock_ctxt_t * sock, net_lwip_nc_t * nc)
+{
+  int rc = 0;
+
+  if (nc->rx == NULL)
+  {
+    nc_set_timeout(sock, nc, true);
+  }
+  while ((nc->rx == NULL) && (rc == 0))
+  {
+    struct pbuf *p = NULL;
+    err_t err = netconn_recv_tcp_pbuf(nc->conn, &p);
+    if (err == ERR_OK)
+    {
+      nc->rx = p;
+      nc->rx_off = 0;
+    }
+    else
+    {
+      rc = err_to_net(sock, err, true);
+      if ((rc == 0) && !sock->blocking)
+      {
+        break;
+      }
+    }
+  }
+
+  return (nc->rx != NULL) ? 1 : rc;
+}
+
+
+/**
+ * @brief   Drop len bytes from the head of the received chain, and the pbufs they empty.
+ *          A pbuf still referenced by a view is freed on the release of the view.
+ */
+static void rx_consume(net_lwip_nc_t * nc, size_t len)
+{
+  nc->rx_off += (u16_t) len;
+  while ((nc->rx != NULL) && (nc->rx_off >= nc->rx->len))
+  {
+    struct pbuf *p = nc->rx;
+    nc->rx_off -= p->len;
+    nc->rx = p->next;
+    if (nc->rx != NULL)
+    {
+      /* Keep the tail: pbuf_free() would otherwise walk down the chain. */
+      pbuf_ref(nc->rx);
+    }
+    pbuf_free(p);
+  }
+}
+
+
+static int err_to_net(net_sock_ctxt_t * sock, err_t err, bool reading)
+{
+  int rc = NET_ERR;
+
+  switch(err)
+  {
+    case ERR_WOULDBLOCK:
+    case ERR_INPROGRESS:
+      /* Nothing yet. The caller should try again. */
+      rc = 0;
+      break;
+    case ERR_TIMEOUT:
+      rc = ( (((reading ? sock->read_timeout : sock->write_timeout) != 0) || sock->deadline.armed) && sock->blocking ) ? NET_TIMEOUT : 0;
+      break;
+    case ERR_CLSD:
+    case ERR_RST:
+    case ERR_ABRT:
+    case ERR_CONN:
+      rc = NET_EOF;
+      break;
+    default:
+      rc = NET_ERR;
+  }
+
+  return rc;
+}
+
+
+/**
+ * @brief   Blocking calls: set the netconn timeout to what is left of the socket timeout, or of the
+ *          deadline set by the layer above if it is earlier. netconn counts from its own start.
+ */
+static void nc_set_timeout(net_sock_ctxt_t * sock, net_lwip_nc_t * nc, bool reading)
+{
+  uint16_t timeout = reading ? sock->read_timeout : sock->write_timeout;
+  net_deadline_t deadline = (timeout != 0) ? net_sock_deadline(sock, timeout) : sock->deadline;
+  int ms = 0;   /* netconn: 0 waits forever. */
+
+  if (!sock->blocking)
+  {
+    return;
+  }
+  if (deadline.armed)
+  {
+    ms = (int) MAX(1, MIN(net_deadline_left_ms(deadline), INT32_MAX));
+  }
+  if (reading)
+  {
+    netconn_set_recvtimeout(nc->conn, ms);
+  }
+  else
+  {
+    netconn_set_sendtimeout(nc->conn, ms);
+  }
+}
+
+#endif /* USE_LWIP && USE_LWIP_NETCONN */
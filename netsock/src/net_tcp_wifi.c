@@ -100,6 +100,8 @@ int net_sock_create_wifi(net_hnd_t nethnd, net_sockhnd_t * sockhnd, net_proto_t
       case NET_PROTO_TCP:
         sock->methods.recv      = (net_sock_recv_tcp_wifi);
         sock->methods.send      = (net_sock_send_tcp_wifi);
+        /* No sock_keepalive probe: the ES-WiFi module has no TCP keepalive, and a ping of the
+         * peer tells that the host is up, not that the connection is. */
         break;
       case NET_PROTO_UDP:
         sock->methods.recvfrom  = (net_sock_recvfrom_udp_wifi);
@@ -229,20 +231,20 @@ int net_sock_recv_tcp_wifi(net_sockhnd_t sockhnd, uint8_t * buf, size_t len)
   uint16_t read = 0;
   uint16_t tmp_len = MIN(len, WIFI_PAYLOAD_SIZE);
   uint8_t * tmp_buf = buf;
-  uint32_t start_time = HAL_GetTick();
+  net_deadline_t deadline = net_sock_deadline(sock, sock->read_timeout);
     
   /* Read the received payload by chunks of WIFI_PAYLOAD_SIZE bytes because of
    * a constraint of WIFI_ReceiveData(). */
   do
   {
-    if ( (sock->blocking == true) && (net_timeout_left_ms(start_time, HAL_GetTick(), sock->read_timeout) <= 0) )
+    if ( (sock->blocking == true) && net_deadline_expired(deadline) )
     {
       rc = NET_TIMEOUT;
       break;
     }
 
     status = WIFI_ReceiveData((uint8_t) ((uint32_t)sock->underlying_sock_ctxt & 0xFF), tmp_buf, tmp_len, &read,
-                             (sock->blocking == true) ? sock->read_timeout : NET_DEFAULT_NOBLOCKING_READ_TIMEOUT);
+                             (sock->blocking == true) ? net_deadline_left_ms(deadline) : NET_DEFAULT_NOBLOCKING_READ_TIMEOUT);
     msg_debug("Read %d/%d.\n", read, tmp_len);
     if (status != WIFI_STATUS_OK)
     {
@@ -278,7 +280,7 @@ int net_sock_recvfrom_udp_wifi(net_sockhnd_t sockhnd, uint8_t * const buf, size_
   uint16_t read = 0;
   uint16_t tmp_len = MIN(len, WIFI_PAYLOAD_SIZE);
   uint8_t * tmp_buf = buf;
-  uint32_t start_time = HAL_GetTick();
+  net_deadline_t deadline = net_sock_deadline(sock, sock->read_timeout);
 
   /* Note: The remote address and the remote port are unknown until a packet is received. */
   { /* Read the received payload by chunks of WIFI_PAYLOAD_SIZE bytes because of
@@ -287,14 +289,14 @@ int net_sock_recvfrom_udp_wifi(net_sockhnd_t sockhnd, uint8_t * const buf, size_
     {
       uint16_t port = 0;
       uint8_t ip[4] = { 0, 0, 0, 0 };
-      if ( (sock->blocking == true) && (net_timeout_left_ms(start_time, HAL_GetTick(), sock->read_timeout) <= 0) )
+      if ( (sock->blocking == true) && net_deadline_expired(deadline) )
       {
         rc = NET_TIMEOUT;
         break;
       }
       
       status = WIFI_ReceiveDataFrom((uint8_t) ((uint32_t)sock->underlying_sock_ctxt & 0xFF), tmp_buf, tmp_len, &read,
-                               (sock->blocking == true) ? sock->read_timeout : NET_DEFAULT_NOBLOCKING_READ_TIMEOUT,
+                               (sock->blocking == true) ? net_deadline_left_ms(deadline) : NET_DEFAULT_NOBLOCKING_READ_TIMEOUT,
                             		   ip ,sizeof(ip), &port);
       msg_debug("Read %d/%d.", read, tmp_len);
       if (status != WIFI_STATUS_OK)
@@ -334,18 +336,18 @@ int net_sock_send_tcp_wifi( net_sockhnd_t sockhnd, const uint8_t * buf, size_t l
   WIFI_Status_t status = WIFI_STATUS_OK;
   net_sock_ctxt_t *sock = (net_sock_ctxt_t * ) sockhnd;
   uint16_t sent = 0;
-  uint32_t start_time = HAL_GetTick();
+  net_deadline_t deadline = net_sock_deadline(sock, sock->write_timeout);
   
   do
   {
-    if ( (sock->blocking == true) && (net_timeout_left_ms(start_time, HAL_GetTick(), sock->write_timeout) <= 0) )
+    if ( (sock->blocking == true) && net_deadline_expired(deadline) )
     {
       rc = NET_TIMEOUT;
       break;
     }
     
     status = WIFI_SendData((uint8_t) ((uint32_t)sock->underlying_sock_ctxt & 0xFF), (uint8_t *)buf, len, &sent,
-                          (sock->blocking == true) ? sock->write_timeout : NET_DEFAULT_NOBLOCKING_WRITE_TIMEOUT );
+                          (sock->blocking == true) ? net_deadline_left_ms(deadline) : NET_DEFAULT_NOBLOCKING_WRITE_TIMEOUT );
     if (status !=  WIFI_STATUS_OK)
     {
       rc = NET_ERR;
@@ -365,7 +367,7 @@ int net_sock_sendto_udp_wifi(net_sockhnd_t sockhnd, const uint8_t * buf, size_t
   WIFI_Status_t status = WIFI_STATUS_OK;
   net_sock_ctxt_t *sock = (net_sock_ctxt_t * ) sockhnd;
   uint16_t sent = 0;
-  uint32_t start_time = HAL_GetTick();
+  net_deadline_t deadline = net_sock_deadline(sock, sock->write_timeout);
   uint8_t ip_addr[4] = { 0, 0, 0, 0 };
   int16_t port = remoteport;
   
@@ -380,14 +382,14 @@ int net_sock_sendto_udp_wifi(net_sockhnd_t sockhnd, const uint8_t * buf, size_t
   
   do
   {
-    if ( (sock->blocking == true) && (net_timeout_left_ms(start_time, HAL_GetTick(), sock->write_timeout) <= 0) )
+    if ( (sock->blocking == true) && net_deadline_expired(deadline) )
     {
       rc = NET_TIMEOUT;
       break;
     }
     
     status = WIFI_SendDataTo((uint8_t) ((uint32_t)sock->underlying_sock_ctxt & 0xFF), (uint8_t *)buf, len, &sent,
-                          (sock->blocking == true) ? sock->write_timeout : NET_DEFAULT_NOBLOCKING_WRITE_TIMEOUT, ip_addr, port );
+                          (sock->blocking == true) ? net_deadline_left_ms(deadline) : NET_DEFAULT_NOBLOCKING_WRITE_TIMEOUT, ip_addr, port );
     if (status !=  WIFI_STATUS_OK)
     {
       rc = NET_ERR;
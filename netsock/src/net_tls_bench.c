@@ -0,0 +1,234 @@
+/*
+ * net_tls_bench.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Daruin Solano
+ *
+ *  Benchmark of the lean TLS configuration and of the ROM comb table of secp256r1. Its counts are
+ *  fixed, and it logs first the build options it measures, so that two builds compare line by line:
+ *   - the P-256 fixed-point multiplication (ECDHE key generation) and the ECDSA verification,
+ *     with the comb table of the build: in flash (MBEDTLS_ECP_FIXED_POINT_ROM_TABLES), computed
+ *     at the first multiplication and kept in RAM (MBEDTLS_ECP_FIXED_POINT_OPTIM, its size is
+ *     logged), or computed again at each multiplication;
+ *   - rounds full TLS handshakes to host:port with tls_profile "default", then as many with "lean".
+ *  Run it from a build with the project config, then from one with httpclient_mbedtls_lean_config.h
+ *  and one without MBEDTLS_ECP_FIXED_POINT_ROM_TABLES, against the same server and its P-256
+ *  certificate, e.g.
+ *    openssl s_server -accept <port> -cert srv.pem -key srv.key
+ *
+ *    int net_tls_bench(net_hnd_t nethnd, const char *host, int port, const char *ca_certs, int rounds);
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "net_internal.h"
+
+#if defined(USE_MBED_TLS)
+#include "mbedtls/ecp.h"
+#include "mbedtls/ecdsa.h"
+
+/* Private defines -----------------------------------------------------------*/
+#define BENCH_ECC_OPS			20		/**< Key generations, then verifications, timed. */
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct {
+	uint32_t done;			/**< Handshakes completed. */
+	uint32_t failed;
+	uint32_t min_ms;
+	uint32_t max_ms;
+	uint32_t total_ms;
+} bench_hs_t;
+
+/* Private function prototypes -----------------------------------------------*/
+static void bench_config(void);
+static int bench_ecc(void);
+static void bench_handshakes(net_hnd_t nethnd, const char *host, int port, const char *ca_certs,
+		const char *profile, int rounds, bench_hs_t *hs);
+static void bench_hs_report(const char *profile, const bench_hs_t *hs);
+
+/* Functions Definition ------------------------------------------------------*/
+
+/**
+ * @brief  Time the P-256 operations of the handshake, then rounds handshakes to host:port with
+ *         each TLS profile of the build, and log the results.
+ * @param  In: ca_certs   Root CA of the server, PEM. NULL: the server is not verified.
+ * @param  In: rounds     Handshakes per profile. 0 to time the ECC operations only.
+ * @retval NET_OK, NET_PARAM, or NET_ERR if an ECC operation or every handshake failed.
+ */
+int net_tls_bench(net_hnd_t nethnd, const char *host, int port, const char *ca_certs, int rounds) {
+	bench_hs_t hs;
+	int rc = NET_OK;
+
+	if ((rounds < 0) || ((rounds > 0) && ((nethnd == NULL) || (host == NULL)))) {
+		return NET_PARAM;
+	}
+
+	bench_config();
+	if (bench_ecc() != 0) {
+		rc = NET_ERR;
+	}
+	if (rounds == 0) {
+		return rc;
+	}
+
+	bench_handshakes(nethnd, host, port, ca_certs, "default", rounds, &hs);
+	bench_hs_report("default", &hs);
+	if (hs.done == 0) {
+		rc = NET_ERR;
+	}
+#ifdef NET_TLS_LEAN_PROFILE
+	bench_handshakes(nethnd, host, port, ca_certs, "lean", rounds, &hs);
+	bench_hs_report("lean", &hs);
+	if (hs.done == 0) {
+		rc = NET_ERR;
+	}
+#endif /* NET_TLS_LEAN_PROFILE */
+	return rc;
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/** Log the options which the results depend on. */
+static void bench_config(void) {
+	const int *suite;
+	int suites = 0;
+
+	for (suite = mbedtls_ssl_list_ciphersuites(); *suite != 0; suite++) {
+		suites++;
+	}
+	msg_info("net_tls_bench: %d suites built, lean profile %s, P-256 comb table %s, window %d\n",
+			suites,
+#ifdef NET_TLS_LEAN_PROFILE
+			"yes",
+#else
+			"no",
+#endif
+#if defined(MBEDTLS_ECP_FIXED_POINT_ROM_TABLES)
+			"in ROM", MBEDTLS_ECP_ROM_TABLE_WINDOW
+#elif MBEDTLS_ECP_FIXED_POINT_OPTIM == 1
+			"kept in RAM", MBEDTLS_ECP_WINDOW_SIZE
+#else
+			"computed at each multiplication", MBEDTLS_ECP_WINDOW_SIZE
+#endif
+			);
+}
+
+/** P-256 key generations then ECDSA verifications. 0, or the mbedTLS error. */
+static int bench_ecc(void) {
+#if defined(MBEDTLS_ECDSA_C) && defined(MBEDTLS_ECP_DP_SECP256R1_ENABLED)
+	static const unsigned char hash[32] = { 1 };
+	mbedtls_ecp_group grp;
+	mbedtls_ecp_point Q;
+	mbedtls_mpi d, r, s;
+	uint32_t t0, first_ms, keygen_ms = 0, verify_ms = 0;
+	size_t table_bytes = 0;
+	size_t i;
+	int ret;
+
+	mbedtls_ecp_group_init(&grp);
+	mbedtls_ecp_point_init(&Q);
+	mbedtls_mpi_init(&d);
+	mbedtls_mpi_init(&r);
+	mbedtls_mpi_init(&s);
+
+	ret = mbedtls_ecp_group_load(&grp, MBEDTLS_ECP_DP_SECP256R1);
+
+	/* The first multiplication computes the comb table kept in RAM, if any. */
+	t0 = HAL_GetTick();
+	if (ret == 0) {
+		ret = mbedtls_ecp_gen_keypair(&grp, &d, &Q, net_rng_random, NULL);
+	}
+	first_ms = HAL_GetTick() - t0;
+	for (i = 0; i < grp.T_size; i++) {
+		table_bytes += sizeof(mbedtls_ecp_point)
+				+ ((grp.T[i].X.n + grp.T[i].Y.n + grp.T[i].Z.n) * sizeof(mbedtls_mpi_uint));
+	}
+
+	t0 = HAL_GetTick();
+	for (i = 0; (ret == 0) && (i < BENCH_ECC_OPS); i++) {
+		ret = mbedtls_ecp_gen_keypair(&grp, &d, &Q, net_rng_random, NULL);
+	}
+	keygen_ms = HAL_GetTick() - t0;
+
+	if (ret == 0) {
+		ret = mbedtls_ecdsa_sign(&grp, &r, &s, &d, hash, sizeof(hash), net_rng_random, NULL);
+	}
+	t0 = HAL_GetTick();
+	for (i = 0; (ret == 0) && (i < BENCH_ECC_OPS); i++) {
+		ret = mbedtls_ecdsa_verify(&grp, hash, sizeof(hash), &Q, &r, &s);
+	}
+	verify_ms = HAL_GetTick() - t0;
+
+	if (ret == 0) {
+		msg_info("net_tls_bench: P-256 first keygen %lu ms, %u B of RAM held by the comb table\n",
+				(unsigned long) first_ms, (unsigned) table_bytes);
+		msg_info("net_tls_bench: P-256 keygen %lu ms, ECDSA verify %lu ms, for %d of each\n",
+				(unsigned long) keygen_ms, (unsigned long) verify_ms, BENCH_ECC_OPS);
+	} else {
+		msg_error("net_tls_bench: P-256 operation failed (-0x%x)\n", -ret);
+	}
+
+	mbedtls_mpi_free(&s);
+	mbedtls_mpi_free(&r);
+	mbedtls_mpi_free(&d);
+	mbedtls_ecp_point_free(&Q);
+	mbedtls_ecp_group_free(&grp);
+	return ret;
+#else
+	msg_info("net_tls_bench: no P-256 ECDSA in this build\n");
+	return 0;
+#endif /* MBEDTLS_ECDSA_C && MBEDTLS_ECP_DP_SECP256R1_ENABLED */
+}
+
+/** rounds full handshakes, each on a new socket: no session is resumed. */
+static void bench_handshakes(net_hnd_t nethnd, const char *host, int port, const char *ca_certs,
+		const char *profile, int rounds, bench_hs_t *hs) {
+	net_sockhnd_t sock = NULL;
+	uint32_t t0, ms;
+	int rc;
+	int i;
+
+	memset(hs, 0, sizeof(bench_hs_t));
+	hs->min_ms = UINT32_MAX;
+	for (i = 0; i < rounds; i++) {
+		if (net_sock_create(nethnd, &sock, NET_PROTO_TLS) != NET_OK) {
+			hs->failed++;
+			continue;
+		}
+		if (ca_certs != NULL) {
+			(void) net_sock_setopt(sock, "tls_ca_certs", (const uint8_t*) ca_certs, strlen(ca_certs) + 1);
+			(void) net_sock_setopt(sock, "tls_server_verification", NULL, 0);
+		} else {
+			(void) net_sock_setopt(sock, "tls_server_noverification", NULL, 0);
+		}
+		(void) net_sock_setopt(sock, "tls_server_name", (const uint8_t*) host, strlen(host) + 1);
+		(void) net_sock_setopt(sock, "tls_profile", (const uint8_t*) profile, strlen(profile) + 1);
+
+		t0 = HAL_GetTick();
+		rc = net_sock_open(sock, host, NULL, port, 0);
+		ms = HAL_GetTick() - t0;
+		if (rc == NET_OK) {
+			hs->done++;
+			hs->total_ms += ms;
+			hs->min_ms = MIN(hs->min_ms, ms);
+			hs->max_ms = MAX(hs->max_ms, ms);
+			(void) net_sock_close(sock);
+		} else {
+			hs->failed++;
+		}
+		(void) net_sock_destroy(sock);
+	}
+}
+
+static void bench_hs_report(const char *profile, const bench_hs_t *hs) {
+	if (hs->done == 0) {
+		msg_error("net_tls_bench %s: no handshake completed, %lu failed\n", profile,
+				(unsigned long) hs->failed);
+		return;
+	}
+	msg_info("net_tls_bench %s: %lu handshakes, min %lu ms, avg %lu ms, max %lu ms, %lu failed\n",
+			profile, (unsigned long) hs->done, (unsigned long) hs->min_ms,
+			(unsigned long) (hs->total_ms / hs->done), (unsigned long) hs->max_ms,
+			(unsigned long) hs->failed);
+}
+
+#endif /* USE_MBED_TLS */
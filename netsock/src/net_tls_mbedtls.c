@@ -47,20 +47,46 @@
 #ifdef USE_MBED_TLS
 /* Includes ------------------------------------------------------------------*/
 #include "net_internal.h"
+#if defined(MBEDTLS_SSL_DTLS_HELLO_VERIFY) && defined(MBEDTLS_SSL_SRV_C) && defined(MBEDTLS_SSL_COOKIE_C)
+#include "mbedtls/ssl_cookie.h"
+#endif
 
 /* Private defines -----------------------------------------------------------*/
 /* Private typedef -----------------------------------------------------------*/
 /* Private variables ---------------------------------------------------------*/
+#ifdef NET_TLS_LEAN_PROFILE
+/* "lean" tls_profile: one suite, one curve, one hash; the server chain must be ECDSA P-256. */
+static const int tls_lean_ciphersuites[] = { MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256, 0 };
+static const mbedtls_ecp_group_id tls_lean_curves[] = { MBEDTLS_ECP_DP_SECP256R1, MBEDTLS_ECP_DP_NONE };
+static const int tls_lean_sig_hashes[] = { MBEDTLS_MD_SHA256, MBEDTLS_MD_NONE };
+#endif /* NET_TLS_LEAN_PROFILE */
+#if defined(MBEDTLS_SSL_DTLS_HELLO_VERIFY) && defined(MBEDTLS_SSL_SRV_C) && defined(MBEDTLS_SSL_COOKIE_C)
+static mbedtls_ssl_cookie_ctx dtls_cookie_ctx;  /**< Cookie key, common to the DTLS server configurations. */
+static bool dtls_cookie_ready = false;
+#endif
+
 /* Private function prototypes -----------------------------------------------*/
 int net_sock_create_mbedtls(net_hnd_t nethnd, net_sockhnd_t * sockhnd, net_proto_t proto);
 int net_sock_open_mbedtls(net_sockhnd_t sockhnd, const char * hostname, int dstport, int localport);
+int net_sock_open_start_mbedtls(net_sockhnd_t sockhnd, const char * hostname, int dstport, int localport);
+int net_sock_open_step_mbedtls(net_sockhnd_t sockhnd);
 int net_sock_recv_mbedtls(net_sockhnd_t sockhnd, uint8_t * const buf, size_t len);
 int net_sock_send_mbedtls(net_sockhnd_t sockhnd, const uint8_t * buf, size_t len);
 int net_sock_close_mbedtls(net_sockhnd_t sockhnd);
 int net_sock_destroy_mbedtls(net_sockhnd_t sockhnd);
+int net_sock_probe_mbedtls(net_sockhnd_t sockhnd, bool arm);
 
 static void my_debug( void *ctx, int level, const char *file, int line, const char *str );
 static void internal_close(net_sock_ctxt_t * sock);
+static int tls_open_setup(net_sock_ctxt_t * sock, const char * hostname, int dstport, int localport);
+static void tls_set_bio(net_sock_ctxt_t * sock, bool blocking);
+#if defined(MBEDTLS_SSL_PROTO_DTLS)
+static int dtls_send(void *ctx, const unsigned char *buf, size_t len);
+static int dtls_recv(void *ctx, unsigned char *buf, size_t len);
+static int dtls_recv_timeout(void *ctx, unsigned char *buf, size_t len, uint32_t timeout);
+static void dtls_timer_set(void *ctx, uint32_t int_ms, uint32_t fin_ms);
+static int dtls_timer_get(void *ctx);
+#endif /* MBEDTLS_SSL_PROTO_DTLS */
 
 /* Functions Definition ------------------------------------------------------*/
 
@@ -95,10 +121,16 @@ int net_sock_create_mbedtls(net_hnd_t nethnd, net_sockhnd_t * sockhnd, net_proto
       sock->net = ctxt;
       sock->next = ctxt->sock_list;
       sock->methods.open    = (net_sock_open_mbedtls);
+      sock->methods.open_start = (net_sock_open_start_mbedtls);
+      sock->methods.open_step  = (net_sock_open_step_mbedtls);
       sock->methods.recv    = (net_sock_recv_mbedtls);
       sock->methods.send    = (net_sock_send_mbedtls);
       sock->methods.close   = (net_sock_close_mbedtls);
       sock->methods.destroy = (net_sock_destroy_mbedtls);
+      if (proto == NET_PROTO_TLS)
+      {
+        sock->methods.probe = (net_sock_probe_mbedtls);   /* Nothing to probe under DTLS: UDP is connectionless. */
+      }
       sock->proto           = proto;
       sock->blocking        = NET_DEFAULT_BLOCKING;
       sock->read_timeout    = NET_DEFAULT_BLOCKING_READ_TIMEOUT;
@@ -115,26 +147,25 @@ int net_sock_create_mbedtls(net_hnd_t nethnd, net_sockhnd_t * sockhnd, net_proto
 }
 
 
-int net_sock_open_mbedtls(net_sockhnd_t sockhnd, const char * hostname, int dstport, int localport)
+static int tls_open_setup(net_sock_ctxt_t * sock, const char * hostname, int dstport, int localport)
 {
-  int rc = NET_ERR;
-  net_sock_ctxt_t *sock = (net_sock_ctxt_t * ) sockhnd;
   net_tls_data_t * tlsData = sock->tlsData;
+  bool dtls = (sock->proto == NET_PROTO_DTLS);
 
   /* mbedTLS instance */
   int ret = 0;
-  const unsigned char *pers = (unsigned char *)"net_tls";
 #if 0 // 2k should be large enough! Not needed anyway.
 #ifdef msg_debug
   unsigned char buf[MBEDTLS_SSL_MAX_CONTENT_LEN + 1];
 #endif
 #endif // 0
 
+#ifndef USE_HOST
   mbedtls_platform_set_calloc_free(heap_alloc, heap_free);  /* Common to all sockets. */
+#endif /* USE_HOST */
   mbedtls_ssl_config_init(&tlsData->conf);
   mbedtls_ssl_conf_dbg(&tlsData->conf, my_debug, stdout);
   mbedtls_debug_set_threshold(TLS_DEBUG_LEVEL); // Level 3 for Info-level dmesg logs
-  mbedtls_ctr_drbg_init(&tlsData->ctr_drbg);
   mbedtls_x509_crt_init(&tlsData->cacert);
   if (tlsData->tls_dev_cert != NULL)
   {
@@ -146,17 +177,10 @@ int net_sock_open_mbedtls(net_sockhnd_t sockhnd, const char * hostname, int dstp
   }
   mbedtls_debug_set_threshold(1);
 
-  /* Entropy generator init */
-  mbedtls_entropy_init(&tlsData->entropy);
-  if( (ret = mbedtls_entropy_add_source(&tlsData->entropy, mbedtls_hardware_poll, (void*)&hrng, 1, MBEDTLS_ENTROPY_SOURCE_STRONG)) != 0 )
+  /* Random generator: the DRBG is shared by all the sockets, seeded once. */
+  if (net_rng_init() != NET_OK)
   {
-    msg_error( " failed\n  ! mbedtls_entropy_add_source returned -0x%x\n", -ret );
-    internal_close(sock);
-    return NET_ERR;
-  }
-  if( (ret = mbedtls_ctr_drbg_seed(&tlsData->ctr_drbg, mbedtls_entropy_func, &tlsData->entropy, pers, strlen((char const *)pers))) != 0 )
-  {
-    msg_error(" failed\n  ! mbedtls_ctr_drbg_seed returned -0x%x\n", -ret);
+    msg_error(" failed\n  ! net_rng_init\n");
     internal_close(sock);
     return NET_ERR;
   }
@@ -220,18 +244,26 @@ int net_sock_open_mbedtls(net_sockhnd_t sockhnd, const char * hostname, int dstp
 #endif  /* FIREWALL_MBEDLIB */
   }
   
-  /* TCP Connection */
+  /* TCP Connection, or UDP socket */
   msg_debug("  . Connecting to %s:%d...", hostname, dstport);
-  if( (ret = net_sock_create(hnet, &sock->underlying_sock_ctxt, NET_PROTO_TCP)) != NET_OK )
+  if( (ret = net_sock_create(hnet, &sock->underlying_sock_ctxt, dtls ? NET_PROTO_UDP : NET_PROTO_TCP)) != NET_OK )
   {
-    msg_error(" failed to create a TCP socket  ! net_sock_create returned %d\n", ret);
+    msg_error(" failed to create a %s socket  ! net_sock_create returned %d\n", dtls ? "UDP" : "TCP", ret);
     internal_close(sock);
     return NET_ERR;
   }
+  if (!dtls)
+  {
+    /* The connection can be probed only if the TCP backend can: see net_sock_is_probed(). */
+    sock->methods.probe = (((net_sock_ctxt_t *) sock->underlying_sock_ctxt)->methods.probe != NULL) ?
+                          (net_sock_probe_mbedtls) : NULL;
+  }
   
-  if( (ret = net_sock_setopt(sock->underlying_sock_ctxt, (sock->blocking == true) ? "sock_blocking" : "sock_noblocking", NULL, 0)) != NET_OK )
+  /* The underlying socket does not block during a net_sock_open_step() handshake. */
+  bool blocking = (sock->blocking == true) && (tlsData->hs_noblocking == false);
+  if( (ret = net_sock_setopt(sock->underlying_sock_ctxt, (blocking == true) ? "sock_blocking" : "sock_noblocking", NULL, 0)) != NET_OK )
   {
-    msg_error(" failed setting the %s option.\n", (sock->blocking == true) ? "sock_blocking" : "sock_noblocking");
+    msg_error(" failed setting the %s option.\n", (blocking == true) ? "sock_blocking" : "sock_noblocking");
     if (net_sock_destroy(sock->underlying_sock_ctxt) != NET_OK )
     {
       msg_error("Failed destroying the socket.\n");
@@ -241,17 +273,50 @@ int net_sock_open_mbedtls(net_sockhnd_t sockhnd, const char * hostname, int dstp
   }
  
   /* TLS Connection */
-  if( (ret = mbedtls_ssl_config_defaults(&tlsData->conf, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT)) != 0)
+  if( (ret = mbedtls_ssl_config_defaults(&tlsData->conf, MBEDTLS_SSL_IS_CLIENT,
+         dtls ? MBEDTLS_SSL_TRANSPORT_DATAGRAM : MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT)) != 0)
   {
     msg_error(" failed\n  ! mbedtls_ssl_config_defaults returned -0x%x\n\n", -ret);
+    if (net_sock_destroy(sock->underlying_sock_ctxt) != NET_OK )
+    {
+      msg_error("Failed destroying the socket.\n");
+    }
     internal_close(sock);
     return NET_ERR;
   }
+#if defined(MBEDTLS_SSL_PROTO_DTLS)
+  if (dtls == true)
+  {
+    mbedtls_ssl_conf_handshake_timeout(&tlsData->conf, NET_DTLS_HS_TIMEOUT_MIN, NET_DTLS_HS_TIMEOUT_MAX);
+  }
+#endif /* MBEDTLS_SSL_PROTO_DTLS */
 
-#if 0
-  mbedtls_ssl_conf_cert_profile(&sock->conf, &mbedtls_x509_crt_XXX_suite);
-  // TODO: Allow the user to select a TLS profile?
+#if defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
+  /* Smaller records, and smaller record buffers after the handshake (MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH). */
+  if( (ret = mbedtls_ssl_conf_max_frag_len(&tlsData->conf, tlsData->tls_mfl_code)) != 0)
+  {
+    msg_error(" failed\n  ! mbedtls_ssl_conf_max_frag_len returned -0x%x\n\n", -ret);
+    if (net_sock_destroy(sock->underlying_sock_ctxt) != NET_OK )
+    {
+      msg_error("Failed destroying the socket.\n");
+    }
+    internal_close(sock);
+    return NET_ERR;
+  }
 #endif
+
+#ifdef NET_TLS_LEAN_PROFILE
+  if (tlsData->tls_profile == NET_TLS_PROFILE_LEAN)
+  {
+    mbedtls_ssl_conf_ciphersuites(&tlsData->conf, tls_lean_ciphersuites);
+    mbedtls_ssl_conf_curves(&tlsData->conf, tls_lean_curves);
+    mbedtls_ssl_conf_sig_hashes(&tlsData->conf, tls_lean_sig_hashes);
+  }
+#endif /* NET_TLS_LEAN_PROFILE */
+  if (tlsData->tls_ciphersuites[0] != 0)
+  {
+    mbedtls_ssl_conf_ciphersuites(&tlsData->conf, tlsData->tls_ciphersuites);
+  }
   /* Only for debug
    * mbedtls_ssl_conf_verify(&(tlsDataParams->conf), _iot_tls_verify_cert, NULL); */
   if(tlsData->tls_srv_verification == true)
@@ -263,7 +328,7 @@ int net_sock_open_mbedtls(net_sockhnd_t sockhnd, const char * hostname, int dstp
     mbedtls_ssl_conf_authmode(&tlsData->conf, MBEDTLS_SSL_VERIFY_OPTIONAL);
   }
 
-  mbedtls_ssl_conf_rng(&tlsData->conf, mbedtls_ctr_drbg_random, &tlsData->ctr_drbg);
+  mbedtls_ssl_conf_rng(&tlsData->conf, net_rng_random, NULL);
   mbedtls_ssl_conf_ca_chain(&tlsData->conf, &tlsData->cacert, (tlsData->tls_ca_crl != NULL) ? &tlsData->cacrl : NULL);
 
   if( (tlsData->tls_dev_cert != NULL) && (tlsData->tls_dev_key != NULL) )
@@ -271,6 +336,10 @@ int net_sock_open_mbedtls(net_sockhnd_t sockhnd, const char * hostname, int dstp
     if( (ret = mbedtls_ssl_conf_own_cert(&tlsData->conf, &tlsData->clicert, &tlsData->pkey)) != 0)
     {
       msg_error(" failed\n  ! mbedtls_ssl_conf_own_cert returned -0x%x\n\n", -ret);
+      if (net_sock_destroy(sock->underlying_sock_ctxt) != NET_OK )
+      {
+        msg_error("Failed destroying the socket.\n");
+      }
       internal_close(sock);
       return NET_ERR;
     }
@@ -297,20 +366,40 @@ int net_sock_open_mbedtls(net_sockhnd_t sockhnd, const char * hostname, int dstp
     }
   }
 
+#if defined(MBEDTLS_SSL_PROTO_DTLS)
+  if (dtls == true)
+  {
+    mbedtls_ssl_set_timer_cb(&tlsData->ssl, tlsData, dtls_timer_set, dtls_timer_get);
+    /* Abbreviated handshake if the server still knows the session: no certificate exchange, no ECDHE. */
+    if ( (tlsData->session_saved == true) && ((ret = mbedtls_ssl_set_session(&tlsData->ssl, &tlsData->session)) != 0) )
+    {
+      msg_warning("mbedtls_ssl_set_session returned -0x%x: full handshake.\n", -ret);
+    }
+  }
+#endif /* MBEDTLS_SSL_PROTO_DTLS */
+
   /*set SSL context send and recv functions*/
-  if (sock->blocking == true)
+  tls_set_bio(sock, blocking);
+  
+  msg_debug("\n\nSSL state connect : %d ", sock->tlsData->ssl.state);
+
+#if defined(MBEDTLS_SSL_PROTO_DTLS)
+  if (dtls == true)
   {
-    mbedtls_ssl_conf_read_timeout(&tlsData->conf, sock->read_timeout);
-    mbedtls_ssl_set_bio(&tlsData->ssl, (void *) sock->underlying_sock_ctxt, mbedtls_net_send, NULL, mbedtls_net_recv_blocking);
+    /* The UDP socket only binds the local port: the datagrams are sent to the resolved server address. */
+    tlsData->dtls_port = dstport;
+    ret = net_get_hostaddress(hnet, &tlsData->dtls_peer, hostname);
+    if (ret == NET_OK)
+    {
+      ret = net_sock_open(sock->underlying_sock_ctxt, hostname, NULL, 0, localport);
+    }
   }
   else
+#endif /* MBEDTLS_SSL_PROTO_DTLS */
   {
-    mbedtls_ssl_set_bio(&tlsData->ssl, (void *) sock->underlying_sock_ctxt, mbedtls_net_send, mbedtls_net_recv, NULL);
+    ret = net_sock_open(sock->underlying_sock_ctxt, hostname, NULL, dstport, localport);
   }
-  
-  msg_debug("\n\nSSL state connect : %d ", sock->tlsData->ssl.state);
-
-  if( (ret = net_sock_open(sock->underlying_sock_ctxt, hostname, NULL, dstport, localport)) != NET_OK )
+  if (ret != NET_OK)
   {
     msg_error(" failed to connect to %s:%d  ! net_sock_open returned %d\n", hostname, dstport, ret);
     if (net_sock_destroy(sock->underlying_sock_ctxt) != NET_OK )
@@ -320,44 +409,91 @@ int net_sock_open_mbedtls(net_sockhnd_t sockhnd, const char * hostname, int dstp
     internal_close(sock);
     return NET_ERR;
   }
-  
-  /*SSL HANDSHAKE*/
-  msg_debug("\n\nSSL state connect : %d ", sock->tlsData->ssl.state);
-  msg_debug("  . Performing the SSL/TLS handshake...");
 
-  while( (ret = mbedtls_ssl_handshake(&tlsData->ssl)) != 0 )
+  tlsData->hs_start = net_clock_ms();
+  return NET_OK;
+}
+
+
+/**
+ * @brief   Release the socket after a handshake failure, and report the verification result.
+ * @retval  NET_AUTH if the server certificate could not be verified, NET_ERR otherwise.
+ */
+static int tls_handshake_failed(net_sock_ctxt_t * sock, int ret)
+{
+  net_tls_data_t * tlsData = sock->tlsData;
+
+  if( (tlsData->flags = mbedtls_ssl_get_verify_result(&tlsData->ssl)) != 0 )
   {
-    if( (ret != MBEDTLS_ERR_SSL_WANT_READ) && (ret != MBEDTLS_ERR_SSL_WANT_WRITE) )
+    char vrfy_buf[512];
+    mbedtls_x509_crt_verify_info(vrfy_buf, sizeof(vrfy_buf), "  ! ", tlsData->flags);
+    if (tlsData->tls_srv_verification == true)
     {
-      if( (tlsData->flags = mbedtls_ssl_get_verify_result(&tlsData->ssl)) != 0 )
-      {
-        char vrfy_buf[512];
-        mbedtls_x509_crt_verify_info(vrfy_buf, sizeof(vrfy_buf), "  ! ", tlsData->flags);
-        if (tlsData->tls_srv_verification == true)
-        {
-          msg_error("Server verification:\n%s\n", vrfy_buf);
-        }
-        else
-        {
-          msg_info("Server verification:\n%s\n", vrfy_buf);
-        }
-      }
-      msg_error(" failed\n  ! mbedtls_ssl_handshake returned -0x%x\n", -ret);
+      msg_error("Server verification:\n%s\n", vrfy_buf);
+    }
+    else
+    {
+      msg_info("Server verification:\n%s\n", vrfy_buf);
+    }
+  }
+  msg_error(" failed\n  ! mbedtls_ssl_handshake returned -0x%x\n", -ret);
 
-      if (net_sock_close(sock->underlying_sock_ctxt) != NET_OK )
-      {
-        msg_error("Failed closing the socket.\n");
-      }
-      if (net_sock_destroy(sock->underlying_sock_ctxt) != NET_OK )
-      {
-        msg_error("Failed destroying the socket.\n");
-      }
-      internal_close(sock);
+  if (net_sock_close(sock->underlying_sock_ctxt) != NET_OK )
+  {
+    msg_error("Failed closing the socket.\n");
+  }
+  if (net_sock_destroy(sock->underlying_sock_ctxt) != NET_OK )
+  {
+    msg_error("Failed destroying the socket.\n");
+  }
+  internal_close(sock);
+  tlsData->hs_noblocking = false;
+#if defined(MBEDTLS_SSL_PROTO_DTLS)
+  /* Do not offer the session again: the next attempt starts from scratch. */
+  mbedtls_ssl_session_free(&tlsData->session);
+  tlsData->session_saved = false;
+#endif /* MBEDTLS_SSL_PROTO_DTLS */
+
+  return (ret == MBEDTLS_ERR_X509_CERT_VERIFY_FAILED) ? NET_AUTH : NET_ERR;
+}
 
-      return (ret == MBEDTLS_ERR_X509_CERT_VERIFY_FAILED) ? NET_AUTH : NET_ERR;
+
+/**
+ * @brief   Switch the socket to its configured blocking mode once the handshake is over.
+ */
+static void tls_handshake_done(net_sock_ctxt_t * sock)
+{
+  net_tls_data_t * tlsData = sock->tlsData;
+  int ret = 0;
+
+  if ( (tlsData->hs_noblocking == true) && (sock->blocking == true) )
+  {
+    if (net_sock_setopt(sock->underlying_sock_ctxt, "sock_blocking", NULL, 0) != NET_OK)
+    {
+      msg_error(" failed setting the sock_blocking option.\n");
     }
+    tls_set_bio(sock, true);
   }
+  tlsData->hs_noblocking = false;
 
+#if defined(MBEDTLS_SSL_PROTO_DTLS)
+  if (sock->proto == NET_PROTO_DTLS)
+  {
+    bool resumed = (tlsData->session_saved == true) && (tlsData->ssl.session != NULL)
+      && (tlsData->ssl.session->id_len != 0) && (tlsData->ssl.session->id_len == tlsData->session.id_len)
+      && (memcmp(tlsData->ssl.session->id, tlsData->session.id, tlsData->session.id_len) == 0);
+
+    msg_info("DTLS handshake done in %lu ms (%s): %s.\n", (unsigned long) (net_clock_ms() - tlsData->hs_start),
+       resumed ? "resumed" : "full", mbedtls_ssl_get_ciphersuite(&tlsData->ssl));
+    mbedtls_ssl_session_free(&tlsData->session);
+    tlsData->session_saved = (mbedtls_ssl_get_session(&tlsData->ssl, &tlsData->session) == 0);
+  }
+  else
+#endif /* MBEDTLS_SSL_PROTO_DTLS */
+  {
+    msg_info("TLS handshake done in %lu ms: %s.\n", (unsigned long) (net_clock_ms() - tlsData->hs_start),
+       mbedtls_ssl_get_ciphersuite(&tlsData->ssl));
+  }
   msg_debug(" ok\n    [ Protocol is %s ]\n    [ Ciphersuite is %s ]\n",
      mbedtls_ssl_get_version(&sock->tlsData->ssl),
      mbedtls_ssl_get_ciphersuite(&sock->tlsData->ssl));
@@ -372,22 +508,85 @@ int net_sock_open_mbedtls(net_sockhnd_t sockhnd, const char * hostname, int dstp
   }
 
   msg_debug("  . Verifying peer X.509 certificate...");
+}
 
 
-#if 0
-#ifdef msg_debug
-  if (mbedtls_ssl_get_peer_cert(&sock->ssl) != NULL)
+int net_sock_open_mbedtls(net_sockhnd_t sockhnd, const char * hostname, int dstport, int localport)
+{
+  net_sock_ctxt_t *sock = (net_sock_ctxt_t * ) sockhnd;
+  net_tls_data_t * tlsData = sock->tlsData;
+  int ret = 0;
+
+  tlsData->hs_noblocking = false;
+  if ( (ret = tls_open_setup(sock, hostname, dstport, localport)) != NET_OK)
   {
-    msg_debug("  . Peer certificate information    ...\n");
-    mbedtls_x509_crt_info((char *) buf, sizeof(buf) - 1, "      ", mbedtls_ssl_get_peer_cert(&sock->ssl));
-    msg_debug("%s\n", buf);
+    return ret;
   }
-#endif
-#endif // 0
-   
-  rc = NET_OK;
-    
-  return rc;
+
+  /*SSL HANDSHAKE*/
+  msg_debug("\n\nSSL state connect : %d ", sock->tlsData->ssl.state);
+  msg_debug("  . Performing the SSL/TLS handshake...");
+
+  while( (ret = mbedtls_ssl_handshake(&tlsData->ssl)) != 0 )
+  {
+    if( (ret != MBEDTLS_ERR_SSL_WANT_READ) && (ret != MBEDTLS_ERR_SSL_WANT_WRITE) )
+    {
+      return tls_handshake_failed(sock, ret);
+    }
+  }
+
+  tls_handshake_done(sock);
+
+  return NET_OK;
+}
+
+
+int net_sock_open_start_mbedtls(net_sockhnd_t sockhnd, const char * hostname, int dstport, int localport)
+{
+  net_sock_ctxt_t *sock = (net_sock_ctxt_t * ) sockhnd;
+  net_tls_data_t * tlsData = sock->tlsData;
+  int ret = 0;
+
+  tlsData->hs_noblocking = true;
+  if ( (ret = tls_open_setup(sock, hostname, dstport, localport)) != NET_OK)
+  {
+    tlsData->hs_noblocking = false;
+    return ret;
+  }
+
+  msg_debug("  . Starting the SSL/TLS handshake...");
+  /* First handshake step: it only leaves the HELLO_REQUEST state. The ClientHello goes out
+   * on the next step, i.e. the first net_sock_open_step() of the caller. */
+  return net_sock_open_step_mbedtls(sockhnd);
+}
+
+
+/* Runs at most one handshake state per call.
+ * The bundled mbedTLS has no restartable ECP, so the ECDHE/ECDSA computations of a
+ * state still run to completion; the caller regains control between the states and
+ * whenever the peer has not answered yet. */
+int net_sock_open_step_mbedtls(net_sockhnd_t sockhnd)
+{
+  net_sock_ctxt_t *sock = (net_sock_ctxt_t * ) sockhnd;
+  net_tls_data_t * tlsData = sock->tlsData;
+  int ret = 0;
+
+  if (tlsData->ssl.state != MBEDTLS_SSL_HANDSHAKE_OVER)
+  {
+    ret = mbedtls_ssl_handshake_step(&tlsData->ssl);
+    if( (ret != 0) && (ret != MBEDTLS_ERR_SSL_WANT_READ) && (ret != MBEDTLS_ERR_SSL_WANT_WRITE) )
+    {
+      return tls_handshake_failed(sock, ret);
+    }
+    if (tlsData->ssl.state != MBEDTLS_SSL_HANDSHAKE_OVER)
+    {
+      return NET_IN_PROGRESS;
+    }
+  }
+
+  tls_handshake_done(sock);
+
+  return NET_OK;
 }
 
 
@@ -398,20 +597,28 @@ int net_sock_recv_mbedtls(net_sockhnd_t sockhnd, uint8_t * buf, size_t len)
   net_tls_data_t * tlsData = sock->tlsData;
   int read = 0;
   int ret = 0;
-  uint32_t start_time = HAL_GetTick();
+  net_sock_ctxt_t *underlying = (net_sock_ctxt_t * ) sock->underlying_sock_ctxt;
+  net_deadline_t deadline = net_sock_deadline(sock, sock->read_timeout);
+  net_deadline_t underlying_deadline = underlying->deadline;
+
+  /* The reads of the underlying socket stop at the deadline of this call, however many
+   * of them a record takes. */
+  if (sock->blocking == true)
+  {
+    underlying->deadline = net_deadline_min(underlying_deadline, deadline);
+  }
   
   do
   {
     if (sock->blocking == true)
     {
-      mbedtls_ssl_conf_read_timeout(&tlsData->conf, sock->read_timeout);
-      msg_debug("mbedtls_ssl_conf_read_timeout: %u\n", sock->read_timeout);
-    
-      if (net_timeout_left_ms(start_time, HAL_GetTick(), sock->read_timeout) <= 0)
+      if (net_deadline_expired(deadline))
       {
         rc = NET_TIMEOUT;
         break;
       }
+      mbedtls_ssl_conf_read_timeout(&tlsData->conf, net_deadline_left_ms(deadline));
+      msg_debug("mbedtls_ssl_conf_read_timeout: %lu\n", (unsigned long) net_deadline_left_ms(deadline));
     }
     
     ret = mbedtls_ssl_read(&tlsData->ssl, buf + read, len - read);
@@ -439,6 +646,7 @@ int net_sock_recv_mbedtls(net_sockhnd_t sockhnd, uint8_t * buf, size_t len)
       }
     }
   } while ( ((ret == MBEDTLS_ERR_SSL_WANT_READ) || (ret == MBEDTLS_ERR_SSL_WANT_WRITE)) && (sock->blocking == true) && (rc == 0) );
+  underlying->deadline = underlying_deadline;
     
   return (rc < 0) ? rc : read;
 }
@@ -451,13 +659,30 @@ int net_sock_send_mbedtls( net_sockhnd_t sockhnd, const uint8_t * buf, size_t le
   net_tls_data_t * tlsData = sock->tlsData;
   int sent = 0;
   int ret = 0;
-  uint32_t start_time = HAL_GetTick();
+  net_sock_ctxt_t *underlying = (net_sock_ctxt_t * ) sock->underlying_sock_ctxt;
+  net_deadline_t deadline = net_sock_deadline(sock, sock->write_timeout);
+  net_deadline_t underlying_deadline = underlying->deadline;
+
+#if defined(MBEDTLS_SSL_PROTO_DTLS) && defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
+  /* One datagram per send: the payload is not split over several records. */
+  if ( (sock->proto == NET_PROTO_DTLS) && (len > mbedtls_ssl_get_max_frag_len(&tlsData->ssl)) )
+  {
+    msg_error("DTLS datagram of %u bytes over the %u bytes record limit.\n", (unsigned) len,
+       (unsigned) mbedtls_ssl_get_max_frag_len(&tlsData->ssl));
+    return NET_PARAM;
+  }
+#endif /* MBEDTLS_SSL_PROTO_DTLS && MBEDTLS_SSL_MAX_FRAGMENT_LENGTH */
+
+  if (sock->blocking == true)
+  {
+    underlying->deadline = net_deadline_min(underlying_deadline, deadline);
+  }
   
   do
   {
     if (sock->blocking == true)
     {
-      if (net_timeout_left_ms(start_time, HAL_GetTick(), sock->write_timeout) <= 0)
+      if (net_deadline_expired(deadline))
       {
         rc = NET_TIMEOUT;
         break;
@@ -486,6 +711,7 @@ int net_sock_send_mbedtls( net_sockhnd_t sockhnd, const uint8_t * buf, size_t le
       }
     }
   } while ( ((ret == MBEDTLS_ERR_SSL_WANT_READ) || (ret == MBEDTLS_ERR_SSL_WANT_WRITE)) && (sock->blocking == true) && (rc == 0));
+  underlying->deadline = underlying_deadline;
   
   return (rc < 0) ? rc : sent;
 }
@@ -522,6 +748,34 @@ int net_sock_close_mbedtls(net_sockhnd_t sockhnd)
 }
 
 
+/**
+ * @brief   sock_keepalive probe: done on the underlying TCP connection, with the TLS socket settings.
+ *          A TCP connection which cannot be probed is reported alive.
+ */
+int net_sock_probe_mbedtls(net_sockhnd_t sockhnd, bool arm)
+{
+  net_sock_ctxt_t *sock = (net_sock_ctxt_t * ) sockhnd;
+  net_sock_ctxt_t *tcp = (net_sock_ctxt_t * ) sock->underlying_sock_ctxt;
+
+  if ((tcp == NULL) || (tcp->methods.probe == NULL))
+  {
+    return NET_OK;
+  }
+  if (arm)
+  {
+    int rc;
+    /* Settings for the backend only: net_keepalive_poll() must not probe the TCP socket on its own. */
+    tcp->ka_idle = sock->ka_idle;
+    tcp->ka_intvl = sock->ka_intvl;
+    tcp->ka_cnt = sock->ka_cnt;
+    rc = tcp->methods.probe((net_sockhnd_t) tcp, true);
+    tcp->ka_idle = 0;
+    return rc;
+  }
+  return tcp->methods.probe((net_sockhnd_t) tcp, false);
+}
+
+
 int net_sock_destroy_mbedtls(net_sockhnd_t sockhnd)
 {
   int rc = NET_ERR;
@@ -552,6 +806,9 @@ int net_sock_destroy_mbedtls(net_sockhnd_t sockhnd)
   }
   if (rc == NET_OK)
   {
+#if defined(MBEDTLS_SSL_PROTO_DTLS)
+    mbedtls_ssl_session_free(&sock->tlsData->session);
+#endif /* MBEDTLS_SSL_PROTO_DTLS */
     net_free(sock->tlsData);
     net_free(sock);
   }
@@ -559,6 +816,35 @@ int net_sock_destroy_mbedtls(net_sockhnd_t sockhnd)
   return rc;
 }
 
+#if defined(MBEDTLS_SSL_DTLS_HELLO_VERIFY) && defined(MBEDTLS_SSL_SRV_C) && defined(MBEDTLS_SSL_COOKIE_C)
+/**
+ * @brief   Give a DTLS server configuration its HelloVerifyRequest cookie callbacks: the server does
+ *          no work for a ClientHello, and answers it with no more than a cookie, until the client echoes
+ *          a cookie bound to its address. A spoofed source cannot use the server as an amplifier.
+ *          Each connection must set the client address with mbedtls_ssl_set_client_transport_id().
+ * @note    The cookie key is drawn at the first call, and shared by all the server configurations.
+ * @retval  NET_OK, or NET_ERR if the key could not be drawn.
+ */
+int net_tls_conf_dtls_cookies(mbedtls_ssl_config * conf)
+{
+  int ret = 0;
+
+  if (dtls_cookie_ready == false)
+  {
+    mbedtls_ssl_cookie_init(&dtls_cookie_ctx);
+    if ((ret = mbedtls_ssl_cookie_setup(&dtls_cookie_ctx, net_rng_random, NULL)) != 0)
+    {
+      msg_error("mbedtls_ssl_cookie_setup returned -0x%x\n", -ret);
+      mbedtls_ssl_cookie_free(&dtls_cookie_ctx);
+      return NET_ERR;
+    }
+    dtls_cookie_ready = true;
+  }
+  mbedtls_ssl_conf_dtls_cookies(conf, mbedtls_ssl_cookie_write, mbedtls_ssl_cookie_check, &dtls_cookie_ctx);
+  return NET_OK;
+}
+#endif /* MBEDTLS_SSL_DTLS_HELLO_VERIFY && MBEDTLS_SSL_SRV_C && MBEDTLS_SSL_COOKIE_C */
+
 static void my_debug( void *ctx, int level,
                       const char *file, int line,
                       const char *str )
@@ -573,6 +859,141 @@ static void my_debug( void *ctx, int level,
 }
 
 
+/**
+ * @brief   Plug the TLS record layer on the underlying socket: stream or datagram, blocking or not.
+ */
+static void tls_set_bio(net_sock_ctxt_t * sock, bool blocking)
+{
+  net_tls_data_t * tlsData = sock->tlsData;
+
+  if (blocking == true)
+  {
+    mbedtls_ssl_conf_read_timeout(&tlsData->conf, sock->read_timeout);
+  }
+#if defined(MBEDTLS_SSL_PROTO_DTLS)
+  if (sock->proto == NET_PROTO_DTLS)
+  {
+    mbedtls_ssl_set_bio(&tlsData->ssl, (void *) sock, dtls_send, (blocking == true) ? NULL : dtls_recv,
+                        (blocking == true) ? dtls_recv_timeout : NULL);
+    return;
+  }
+#endif /* MBEDTLS_SSL_PROTO_DTLS */
+  if (blocking == true)
+  {
+    mbedtls_ssl_set_bio(&tlsData->ssl, (void *) sock->underlying_sock_ctxt, mbedtls_net_send, NULL, mbedtls_net_recv_blocking);
+  }
+  else
+  {
+    mbedtls_ssl_set_bio(&tlsData->ssl, (void *) sock->underlying_sock_ctxt, mbedtls_net_send, mbedtls_net_recv, NULL);
+  }
+}
+
+
+#if defined(MBEDTLS_SSL_PROTO_DTLS)
+/* DTLS record layer callbacks. ctx is the DTLS socket: the records go to and come from its
+ * server address only, through the underlying UDP socket. */
+static int dtls_send(void *ctx, const unsigned char *buf, size_t len)
+{
+  net_sock_ctxt_t *sock = (net_sock_ctxt_t * ) ctx;
+  net_tls_data_t * tlsData = sock->tlsData;
+  int ret = net_sock_sendto(sock->underlying_sock_ctxt, buf, len, &tlsData->dtls_peer, tlsData->dtls_port);
+
+  if (ret > 0)
+  {
+    return ret;
+  }
+  if ( (ret == 0) || (ret == NET_TIMEOUT) )
+  {
+    return MBEDTLS_ERR_SSL_WANT_WRITE;
+  }
+  msg_error("dtls_send(): error %d in net_sock_sendto() - requestedLen=%u\n", ret, (unsigned) len);
+  return MBEDTLS_ERR_SSL_INTERNAL_ERROR;
+}
+
+
+/* Non-blocking: the UDP socket is in sock_noblocking mode. */
+static int dtls_recv(void *ctx, unsigned char *buf, size_t len)
+{
+  return dtls_recv_timeout(ctx, buf, len, 0);
+}
+
+
+/* Returns MBEDTLS_ERR_SSL_TIMEOUT when nothing came within timeout ms (0: the sock_read_timeout
+ * of the UDP socket): mbedTLS then retransmits the last handshake flight. */
+static int dtls_recv_timeout(void *ctx, unsigned char *buf, size_t len, uint32_t timeout)
+{
+  net_sock_ctxt_t *sock = (net_sock_ctxt_t * ) ctx;
+  net_tls_data_t * tlsData = sock->tlsData;
+  net_sock_ctxt_t *udp = (net_sock_ctxt_t * ) sock->underlying_sock_ctxt;
+  uint16_t read_timeout = udp->read_timeout;
+  net_deadline_t deadline = net_deadline_in(timeout);
+  net_ipaddr_t from;
+  int from_port = 0;
+  int ret = 0;
+
+  do
+  {
+    if (timeout != 0)
+    {
+      if (net_deadline_expired(deadline))
+      {
+        ret = NET_TIMEOUT;
+        break;
+      }
+      udp->read_timeout = (uint16_t) MIN(net_deadline_left_ms(deadline), UINT16_MAX);
+    }
+    ret = net_sock_recvfrom(sock->underlying_sock_ctxt, buf, len, &from, &from_port);
+    /* Stray datagrams from other sources are not handed to mbedTLS. */
+  } while ( (ret > 0) && ((from_port != tlsData->dtls_port) || (memcmp(from.ip, tlsData->dtls_peer.ip, sizeof(from.ip)) != 0)) );
+  udp->read_timeout = read_timeout;
+
+  if (ret > 0)
+  {
+    return ret;
+  }
+  switch (ret)
+  {
+    case 0:
+    case NET_NO_DATA:
+      return MBEDTLS_ERR_SSL_WANT_READ;
+    case NET_TIMEOUT:
+      return MBEDTLS_ERR_SSL_TIMEOUT;
+    default:
+      msg_error("dtls_recv_timeout(): error %d in net_sock_recvfrom() - requestedLen=%u\n", ret, (unsigned) len);
+      return MBEDTLS_ERR_SSL_INTERNAL_ERROR;
+  }
+}
+
+
+/* Retransmission timer, on the net clock. */
+static void dtls_timer_set(void *ctx, uint32_t int_ms, uint32_t fin_ms)
+{
+  net_tls_data_t * tlsData = (net_tls_data_t *) ctx;
+
+  tlsData->dtls_timer_start = net_clock_ms();
+  tlsData->dtls_timer_int = int_ms;
+  tlsData->dtls_timer_fin = fin_ms;
+}
+
+
+static int dtls_timer_get(void *ctx)
+{
+  net_tls_data_t * tlsData = (net_tls_data_t *) ctx;
+  uint32_t elapsed = net_clock_ms() - tlsData->dtls_timer_start;
+
+  if (tlsData->dtls_timer_fin == 0)
+  {
+    return -1;
+  }
+  if (elapsed >= tlsData->dtls_timer_fin)
+  {
+    return 2;
+  }
+  return (elapsed >= tlsData->dtls_timer_int) ? 1 : 0;
+}
+#endif /* MBEDTLS_SSL_PROTO_DTLS */
+
+
 static void internal_close(net_sock_ctxt_t * sock)
 {
   net_tls_data_t * tlsData = sock->tlsData;
@@ -585,8 +1006,6 @@ static void internal_close(net_sock_ctxt_t * sock)
   mbedtls_x509_crl_free(&tlsData->cacrl);
   mbedtls_ssl_free(&tlsData->ssl);
   mbedtls_ssl_config_free(&tlsData->conf);
-  mbedtls_ctr_drbg_free(&tlsData->ctr_drbg);
-  mbedtls_entropy_free(&tlsData->entropy);
   
   return;
 }
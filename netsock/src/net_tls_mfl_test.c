@@ -0,0 +1,291 @@
+/*
+ * net_tls_mfl_test.c
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Daruin Solano
+ *
+ *  Test of the tls_max_frag_len socket option on the NET_IF_HOST backend, against an mbedTLS
+ *  server run by a thread on the loopback. Two connections ask for 512 byte fragments:
+ *   - the server acknowledges the extension: both record buffers are cut to 512 bytes;
+ *   - the server ignores it (RFC 6066 lets it): the client keeps its full input buffer and sends
+ *     512 byte records anyway.
+ *  Each time the server sends TEST_LEN bytes in as few records as it may, then echoes TEST_LEN
+ *  bytes from the client: both must come whole.
+ *  The build needs MBEDTLS_SSL_SRV_C, which the project config leaves out: build it with
+ *  netsock/host/net_test_mbedtls_config.h as MBEDTLS_CONFIG_FILE.
+ *
+ *    int net_tls_mfl_test(net_hnd_t nethnd, int port, const char *ca_certs,
+ *                         const char *srv_cert, const char *srv_key);
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "net_internal.h"
+
+#if defined(USE_HOST) && defined(USE_MBED_TLS) && defined(MBEDTLS_SSL_SRV_C) && \
+    defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH) && defined(MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH)
+#include <pthread.h>
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/ssl_internal.h"
+
+/* Private defines -----------------------------------------------------------*/
+#define TEST_MFL              "512"
+#define TEST_MFL_LEN          512
+#define TEST_LEN              4000    /**< Several 512 byte records, a single full one. */
+#define TEST_SRV_TIMEOUT      5000    /**< ms */
+#define TEST_BUF_OVERHEAD     (MBEDTLS_SSL_BUFFER_LEN - MBEDTLS_SSL_MAX_CONTENT_LEN)
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  const char * name;
+  bool refuse;                          /**< The server ignores the extension. */
+  uint8_t mfl_code;                     /**< Expected on the client session. */
+  size_t in_buf_len;                    /**< Expected client record buffers. */
+  size_t out_buf_len;
+} test_case_t;
+
+/* Private variables ---------------------------------------------------------*/
+static net_srv_conn_t test_srv;
+static mbedtls_x509_crt test_srv_crt;
+static mbedtls_pk_context test_srv_key;
+static mbedtls_ctr_drbg_context test_srv_drbg;  /**< Seeded from the shared DRBG, which the client thread uses. */
+static const test_case_t test_cases[] =
+{
+  { "acknowledged", false, MBEDTLS_SSL_MAX_FRAG_LEN_512,
+    TEST_MFL_LEN + TEST_BUF_OVERHEAD, TEST_MFL_LEN + TEST_BUF_OVERHEAD },
+  { "ignored",      true,  MBEDTLS_SSL_MAX_FRAG_LEN_NONE,
+    MBEDTLS_SSL_BUFFER_LEN, TEST_MFL_LEN + TEST_BUF_OVERHEAD },
+};
+static uint8_t test_tx[TEST_LEN];
+static uint8_t test_rx[TEST_LEN];
+
+/* Private function prototypes -----------------------------------------------*/
+static void * test_tls_server(void * arg);
+static int test_server_conn(net_sockhnd_t sock, bool refuse);
+static int test_send_all(net_sockhnd_t sock, const uint8_t * buf, int len);
+static int test_recv_all(net_sockhnd_t sock, uint8_t * buf, int len);
+static int test_check(const char * name, bool cond);
+
+/* Functions Definition ------------------------------------------------------*/
+
+/**
+ * @brief  Run the test on the loopback of the host interface.
+ * @param  In: port       Local TCP port of the TLS server.
+ * @param  In: ca_certs   Root CA of srv_cert, PEM.
+ * @param  In: srv_cert   Certificate of the server, PEM, for the name "localhost".
+ * @param  In: srv_key    Private key of the server, PEM.
+ * @retval 0 if passed, else the number of checks failed.
+ */
+int net_tls_mfl_test(net_hnd_t nethnd, int port, const char * ca_certs,
+                     const char * srv_cert, const char * srv_key)
+{
+  net_sockhnd_t sock = NULL;
+  net_tls_data_t * tlsData;
+  pthread_t server;
+  int failed = 0;
+  size_t i;
+  int c;
+
+  for (i = 0; i < sizeof(test_tx); i++)
+  {
+    test_tx[i] = (uint8_t) (i * 7);
+  }
+  mbedtls_x509_crt_init(&test_srv_crt);
+  mbedtls_pk_init(&test_srv_key);
+  mbedtls_ctr_drbg_init(&test_srv_drbg);
+  memset(&test_srv, 0, sizeof(test_srv));
+  test_srv.protocol = NET_PROTO_TCP;
+  test_srv.localport = port;
+  test_srv.name = "net_tls_mfl_test";
+  if ((mbedtls_ctr_drbg_seed(&test_srv_drbg, net_rng_random, NULL, NULL, 0) != 0)
+      || (mbedtls_x509_crt_parse(&test_srv_crt, (const unsigned char *) srv_cert, strlen(srv_cert) + 1) != 0)
+      || (mbedtls_pk_parse_key(&test_srv_key, (const unsigned char *) srv_key, strlen(srv_key) + 1, NULL, 0) != 0)
+      || (net_srv_bind(nethnd, NULL, &test_srv) != NET_OK)
+      || (pthread_create(&server, NULL, test_tls_server, NULL) != 0))
+  {
+    mbedtls_ctr_drbg_free(&test_srv_drbg);
+    mbedtls_pk_free(&test_srv_key);
+    mbedtls_x509_crt_free(&test_srv_crt);
+    return test_check("TLS server", false);
+  }
+
+  for (c = 0; c < (int) (sizeof(test_cases) / sizeof(test_cases[0])); c++)
+  {
+    const test_case_t * tc = &test_cases[c];
+    int rc;
+
+    msg_info("net_tls_mfl_test: server %s the extension\n", tc->name);
+    if (net_sock_create(nethnd, &sock, NET_PROTO_TLS) != NET_OK)
+    {
+      failed += test_check("create", false);
+      break;
+    }
+    (void) net_sock_setopt(sock, "tls_ca_certs", (const uint8_t *) ca_certs, strlen(ca_certs) + 1);
+    (void) net_sock_setopt(sock, "tls_server_name", (const uint8_t *) "localhost", sizeof("localhost"));
+    failed += test_check("tls_max_frag_len",
+                         net_sock_setopt(sock, "tls_max_frag_len", (const uint8_t *) TEST_MFL, sizeof(TEST_MFL)) == NET_OK);
+    rc = net_sock_open(sock, "127.0.0.1", NULL, port, 0);
+    failed += test_check("open", rc == NET_OK);
+    if (rc == NET_OK)
+    {
+      tlsData = ((net_sock_ctxt_t *) sock)->tlsData;
+      failed += test_check("negotiated fragment length", tlsData->ssl.session->mfl_code == tc->mfl_code);
+      failed += test_check("input buffer", tlsData->ssl.in_buf_len == tc->in_buf_len);
+      failed += test_check("output buffer", tlsData->ssl.out_buf_len == tc->out_buf_len);
+      failed += test_check("receive", (test_recv_all(sock, test_rx, TEST_LEN) == TEST_LEN)
+                           && (memcmp(test_rx, test_tx, TEST_LEN) == 0));
+      failed += test_check("send", test_send_all(sock, test_tx, TEST_LEN) == TEST_LEN);
+      failed += test_check("echo", (test_recv_all(sock, test_rx, TEST_LEN) == TEST_LEN)
+                           && (memcmp(test_rx, test_tx, TEST_LEN) == 0));
+      (void) net_sock_close(sock);
+    }
+    (void) net_sock_destroy(sock);
+  }
+
+  (void) pthread_join(server, NULL);
+  (void) net_srv_close(&test_srv);
+  mbedtls_ctr_drbg_free(&test_srv_drbg);
+  mbedtls_pk_free(&test_srv_key);
+  mbedtls_x509_crt_free(&test_srv_crt);
+  msg_info("net_tls_mfl_test: %s (%d failed)\n", (failed == 0) ? "passed" : "FAILED", failed);
+  return failed;
+}
+
+/* Private functions ---------------------------------------------------------*/
+
+/** Serve the connections of the test cases, in order. */
+static void * test_tls_server(void * arg)
+{
+  int c;
+
+  (void) arg;
+  for (c = 0; c < (int) (sizeof(test_cases) / sizeof(test_cases[0])); c++)
+  {
+    if (net_srv_listen(&test_srv) != NET_OK)
+    {
+      break;
+    }
+    if (test_server_conn(test_srv.sock, test_cases[c].refuse) != 0)
+    {
+      msg_error("net_tls_mfl_test: server %s failed\n", test_cases[c].name);
+    }
+    (void) net_srv_next_conn(&test_srv);
+  }
+  return NULL;
+}
+
+/** Handshake, send test_tx, then echo TEST_LEN bytes. 0, or the mbedTLS error. */
+static int test_server_conn(net_sockhnd_t sock, bool refuse)
+{
+  static uint8_t buf[TEST_LEN];
+  mbedtls_ssl_config conf;
+  mbedtls_ssl_context ssl;
+  int got = 0;
+  int sent = 0;
+  int ret;
+
+  mbedtls_ssl_config_init(&conf);
+  mbedtls_ssl_init(&ssl);
+  ret = mbedtls_ssl_config_defaults(&conf, MBEDTLS_SSL_IS_SERVER, MBEDTLS_SSL_TRANSPORT_STREAM,
+                                    MBEDTLS_SSL_PRESET_DEFAULT);
+  if (ret == 0)
+  {
+    mbedtls_ssl_conf_rng(&conf, mbedtls_ctr_drbg_random, &test_srv_drbg);
+    ret = mbedtls_ssl_conf_own_cert(&conf, &test_srv_crt, &test_srv_key);
+  }
+  if (ret == 0)
+  {
+    ret = mbedtls_ssl_setup(&ssl, &conf);
+  }
+  mbedtls_ssl_conf_read_timeout(&conf, TEST_SRV_TIMEOUT);
+  mbedtls_ssl_set_bio(&ssl, sock, mbedtls_net_send, NULL, mbedtls_net_recv_blocking);
+
+  /* Ignoring the extension: forget the length asked for once the ClientHello is parsed, so that
+   * the ServerHello does not acknowledge it. */
+  while ((ret == 0) && (ssl.state != MBEDTLS_SSL_HANDSHAKE_OVER))
+  {
+    ret = mbedtls_ssl_handshake_step(&ssl);
+    if (refuse && (ssl.state == MBEDTLS_SSL_SERVER_HELLO))
+    {
+      ssl.session_negotiate->mfl_code = MBEDTLS_SSL_MAX_FRAG_LEN_NONE;
+    }
+    if ((ret == MBEDTLS_ERR_SSL_WANT_READ) || (ret == MBEDTLS_ERR_SSL_WANT_WRITE))
+    {
+      ret = 0;
+    }
+  }
+
+  while ((ret >= 0) && (sent < TEST_LEN))
+  {
+    ret = mbedtls_ssl_write(&ssl, &test_tx[sent], TEST_LEN - sent);
+    sent += (ret > 0) ? ret : 0;
+  }
+  while ((ret >= 0) && (got < TEST_LEN))
+  {
+    ret = mbedtls_ssl_read(&ssl, &buf[got], TEST_LEN - got);
+    got += (ret > 0) ? ret : 0;
+  }
+  sent = 0;
+  while ((ret >= 0) && (sent < got))
+  {
+    ret = mbedtls_ssl_write(&ssl, &buf[sent], got - sent);
+    sent += (ret > 0) ? ret : 0;
+  }
+  if (ret >= 0)
+  {
+    (void) mbedtls_ssl_close_notify(&ssl);
+    ret = 0;
+  }
+
+  mbedtls_ssl_free(&ssl);
+  mbedtls_ssl_config_free(&conf);
+  return ret;
+}
+
+/** Write len bytes: a TLS send takes one record at most. len, or the error of the socket. */
+static int test_send_all(net_sockhnd_t sock, const uint8_t * buf, int len)
+{
+  int sent = 0;
+  int n;
+
+  while (sent < len)
+  {
+    n = net_sock_send(sock, &buf[sent], len - sent);
+    if (n <= 0)
+    {
+      return (n < 0) ? n : NET_EOF;
+    }
+    sent += n;
+  }
+  return sent;
+}
+
+/** Read len bytes. len, or the error of the socket. */
+static int test_recv_all(net_sockhnd_t sock, uint8_t * buf, int len)
+{
+  int got = 0;
+  int n;
+
+  while (got < len)
+  {
+    n = net_sock_recv(sock, &buf[got], len - got);
+    if (n <= 0)
+    {
+      return (n < 0) ? n : NET_EOF;
+    }
+    got += n;
+  }
+  return got;
+}
+
+static int test_check(const char * name, bool cond)
+{
+  if (!cond)
+  {
+    msg_error("net_tls_mfl_test: %s failed\n", name);
+    return 1;
+  }
+  return 0;
+}
+
+#endif /* USE_HOST && USE_MBED_TLS && MBEDTLS_SSL_SRV_C && ... */
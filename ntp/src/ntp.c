@@ -31,6 +31,13 @@ char* ntp_servers[] = {
 		"time.nist.gov",
 		"time.nist.gov"		//Public access to accurate time.
 };
+#define NTP_SERVER_COUNT	(sizeof(ntp_servers) / sizeof(ntp_servers[0]))
+
+/* One supervisor per server: a server that keeps failing is skipped for a while (see net_sup.h). */
+#define NTP_SUP_CONF	{ 5000, 600000, 3, 1800000, 2000 }
+static net_sup_t ntp_sup[NTP_SERVER_COUNT];
+static bool ntp_sup_inited = false;
+
 uint8_t ntp_packet[NTP_PACKET_SIZE]; // NTP request packet
 uint8_t ntp_rx_packet[NTP_PACKET_SIZE];
 NTP_t ntp;
@@ -44,6 +51,8 @@ net_sockhnd_t udp_sock;
 
 static int  ntp_get_network_time(void);
 static void ntp_init_packet(void);
+static void ntp_sup_init(void);
+static int  ntp_sup_next(void);
 
 
 
@@ -62,6 +71,7 @@ static int ntp_get_network_time(void) {
 	net_ipaddr_t 	stage_ntp_ip;
 	char* 			stage_ntp_server;
 	int 			stage_ntp_port;
+	int 			server = -1;
 
 	// Set up the NTP query packet
 	ntp_init_packet();
@@ -72,12 +82,23 @@ static int ntp_get_network_time(void) {
 		goto end;
 	}
 
-	// Connect to the actual NTP server
-	for (int i = 0; i < sizeof(ntp_servers) / sizeof(ntp_servers[0]); i++) {
+	// Connect to the actual NTP server, skipping those backing off
+	ntp_sup_init();
+	int first = ntp_sup_next();
+	int tried = 0;
+	for (int i = 0; i < NTP_SERVER_COUNT; i++) {
 		ret = NET_ERR;
-		msg_debug("NTP server connect try %d/%d", i+1, sizeof(ntp_servers)/sizeof(ntp_servers[0]));
-		if (net_sock_open(udp_sock, ntp_servers[i], NULL, NTP_PORT, LOCAL_PORT) == NET_OK)
+		/* When all of them are backing off, the one due first is tried anyway. */
+		if (!net_sup_ready(&ntp_sup[i]) && (i != first)) continue;
+		tried++;
+		msg_debug("NTP server connect try %d/%d", i+1, NTP_SERVER_COUNT);
+		if (net_sock_open(udp_sock, ntp_servers[i], NULL, NTP_PORT, LOCAL_PORT) != NET_OK)
+		{
+			net_sup_failure(&ntp_sup[i]);
+		}
+		else
 		{
+			server = i;
 			stage_ntp_server = ntp.ntp_server = ntp_servers[i];
 			ntp.ntp_port = NTP_PORT;
 			net_get_hostaddress(hnet, &stage_ntp_ip, stage_ntp_server);
@@ -95,8 +116,7 @@ static int ntp_get_network_time(void) {
 		}
 	}
 	if (ret != NET_OK) {
-		msg_error("NTP servers not reachable... after %d attemps",
-				sizeof(ntp_servers) / sizeof(ntp_servers[0]));
+		msg_error("NTP servers not reachable... after %d attemps", tried);
 		goto end;
 	}
 
@@ -182,11 +202,36 @@ static int ntp_get_network_time(void) {
 		ret = NET_OK;
 	}
 	end:
+	if (server >= 0) {
+		(ret == NET_OK) ? net_sup_success(&ntp_sup[server]) : net_sup_failure(&ntp_sup[server]);
+	}
 	net_sock_close(udp_sock);
 	net_sock_destroy(udp_sock);
 	return ret;
 }
 
+static void ntp_sup_init(void) {
+	net_sup_conf_t conf = NTP_SUP_CONF;
+
+	if (ntp_sup_inited) return;
+	for (int i = 0; i < NTP_SERVER_COUNT; i++) {
+		net_sup_init(&ntp_sup[i], ntp_servers[i], NULL, &conf);
+	}
+	ntp_sup_inited = true;
+}
+
+/* Index of the server allowed to be tried first. */
+static int ntp_sup_next(void) {
+	int next = 0;
+
+	for (int i = 1; i < NTP_SERVER_COUNT; i++) {
+		if (net_sup_wait_ms(&ntp_sup[i]) < net_sup_wait_ms(&ntp_sup[next])) {
+			next = i;
+		}
+	}
+	return next;
+}
+
 time_t ntp_get_epoch(void){
 	if (ntp_get_network_time() == NET_OK)
 		return ntp.epoch_time;
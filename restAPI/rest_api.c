@@ -341,3 +341,89 @@ int rest_api_dispatch(rest_api_t *api, http_srv_t *hs, const http_srv_request_t
     http_srv_next_conn(hs);
     return (src == HTTP_OK) ? HTTP_OK : HTTP_ERR;
 }
+
+/* ---------- built-in handlers ---------- */
+
+static cJSON *net_stats_dir_json(const net_stats_dir_t *d)
+{
+    cJSON *o = cJSON_CreateObject();
+    if (!o) return NULL;
+
+    cJSON_AddNumberToObject(o, "calls", d->calls);
+    cJSON_AddNumberToObject(o, "bytes", d->bytes);
+    cJSON_AddNumberToObject(o, "timeouts", d->timeouts);
+    cJSON_AddNumberToObject(o, "eofs", d->eofs);
+    cJSON_AddNumberToObject(o, "errors", d->errors);
+    cJSON_AddNumberToObject(o, "lat_max_ms", d->lat_max_ms);
+
+    cJSON *hist = cJSON_AddArrayToObject(o, "lat_hist");
+    for (size_t i = 0; hist && i < NET_STATS_LAT_BUCKETS; ++i) {
+        cJSON_AddItemToArray(hist, cJSON_CreateNumber(d->lat_hist[i]));
+    }
+    return o;
+}
+
+static cJSON *net_stats_json(const net_stats_t *st)
+{
+    cJSON *o = cJSON_CreateObject();
+    if (!o) return NULL;
+
+    cJSON_AddItemToObject(o, "rx", net_stats_dir_json(&st->rx));
+    cJSON_AddItemToObject(o, "tx", net_stats_dir_json(&st->tx));
+    return o;
+}
+
+static void net_stats_sock_json(net_sockhnd_t sockhnd, net_proto_t proto,
+                                const net_stats_t *stats, void *arg)
+{
+    static const char *const proto_names[] = { "none", "tcp", "tls", "udp", "mqtt" };
+    cJSON *arr = (cJSON *)arg;
+    char id[20];
+
+    cJSON *o = net_stats_json(stats);
+    if (!o) return;
+
+    snprintf(id, sizeof(id), "%p", (void *)sockhnd);
+    cJSON_AddStringToObject(o, "id", id);
+    cJSON_AddStringToObject(o, "proto",
+        ((size_t)proto < sizeof(proto_names) / sizeof(proto_names[0])) ? proto_names[proto] : "?");
+    cJSON_AddItemToArray(arr, o);
+}
+
+int rest_net_stats_get(http_srv_t *hs, const http_srv_request_t *req,
+                       cJSON *body_in, cJSON **json_out, uint32_t *http_status)
+{
+    (void)body_in;
+    net_stats_t st;
+    char reset[4];
+
+    if (!hs || !json_out || !http_status) return HTTP_ERR;
+
+    if (net_get_stats(hs->nethnd, &st) != NET_OK) {
+        *http_status = 404;
+        *json_out = cJSON_CreateObject();
+        if (*json_out) cJSON_AddStringToObject(*json_out, "error", "stats_disabled");
+        return HTTP_OK;
+    }
+
+    cJSON *root = cJSON_CreateObject();
+    if (!root) return HTTP_ERR;
+
+    /* Lower bound of each histogram bucket, in ms. */
+    cJSON *bounds = cJSON_AddArrayToObject(root, "lat_buckets_ms");
+    for (size_t i = 0; bounds && i < NET_STATS_LAT_BUCKETS; ++i) {
+        cJSON_AddItemToArray(bounds, cJSON_CreateNumber((i == 0) ? 0 : (double)(1UL << (i - 1))));
+    }
+    cJSON_AddItemToObject(root, "interface", net_stats_json(&st));
+
+    cJSON *socks = cJSON_AddArrayToObject(root, "sockets");
+    if (socks) (void)net_sock_foreach_stats(hs->nethnd, net_stats_sock_json, socks);
+
+    if (rest_query_get(req, "reset", reset, sizeof(reset)) && strcmp(reset, "1") == 0) {
+        (void)net_reset_stats(hs->nethnd);
+    }
+
+    *json_out = root;
+    *http_status = 200;
+    return HTTP_OK;
+}
@@ -56,6 +56,14 @@ int  rest_send_error(http_srv_t *hs, uint32_t status, const char *code, const ch
 const char *rest_query_get(const http_srv_request_t *req, const char *key,
                            char *out, size_t out_len);
 
+/* ---------- built-in handlers ---------- */
+
+/* Network counters of the server interface (see net_get_stats()), route it eg. as
+ *   { "GET", "/api/net/stats", rest_net_stats_get, false }
+ * "?reset=1" clears the counters once they are reported. */
+int  rest_net_stats_get(http_srv_t *hs, const http_srv_request_t *req,
+                        cJSON *body_in, cJSON **json_out, uint32_t *http_status);
+
 #ifdef __cplusplus
 }
 #endif
@@ -35,8 +35,7 @@ static int ws_client_recv_exact(ws_client_ctx_t *ctx, uint8_t *buf, size_t len)
     if (len == 0) return WS_OK;
 
     size_t got = 0;
-    const uint32_t timeout_ms = 5000;
-    const uint32_t start = HAL_GetTick();
+    const net_deadline_t deadline = net_deadline_in(5000);
 
     /* 1) Consume any pending bytes first */
     while (got < len && ctx->pending_off < ctx->pending_len) {
@@ -71,8 +70,7 @@ static int ws_client_recv_exact(ws_client_ctx_t *ctx, uint8_t *buf, size_t len)
 
         /* Treat all transient/no-data conditions the same */
         if (rc == NET_NO_DATA || rc == NET_TIMEOUT) {
-            const uint32_t now = HAL_GetTick();
-            if ((uint32_t)(now - start) > timeout_ms) {
+            if (net_deadline_expired(deadline)) {
                 msg_warning("[WS RX] recv_exact TIMEOUT need=%lu got=%lu last_rc=%d\r\n",
                             (unsigned long)len, (unsigned long)got, rc);
                 return WS_TIMEOUT;
@@ -217,8 +215,10 @@ static void ws_client_send_close_code(ws_client_ctx_t *ctx, uint16_t code)
 static int ws_client_handshake(ws_client_ctx_t *ctx) {
 	/* Build Sec-WebSocket-Key: 16 random bytes base64 */
 	uint8_t key_raw[16];
-	for (int i = 0; i < 16; i++)
-		key_raw[i] = (uint8_t) (rand() & 0xFF);
+	if (net_rng_bytes(key_raw, sizeof(key_raw)) != NET_OK) {
+		msg_error("ws_client: random key failed\n");
+		return WS_ERR;
+	}
 
 	if (ws_base64(key_raw, sizeof(key_raw), ctx->key_b64, sizeof(ctx->key_b64))
 			< 0) {
@@ -586,10 +586,9 @@ int ws_client_close(ws_client_t c)
                         ctx->scratch, ctx->scratch_cap);
 
     /* 2) Wait briefly for peer CLOSE (best effort) */
-    const uint32_t timeout_ms = 2000;
-    const uint32_t start = HAL_GetTick();
+    const net_deadline_t deadline = net_deadline_in(2000);
 
-    while ((uint32_t)(HAL_GetTick() - start) < timeout_ms) {
+    while (!net_deadline_expired(deadline)) {
 
         ws_frame_hdr_t h;
         int hr = ws_client_read_frame_hdr(ctx, &h);
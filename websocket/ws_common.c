@@ -349,12 +349,14 @@ int ws_read_frame_payload(net_sockhnd_t sock, const ws_frame_hdr_t *h,
 	return WS_OK;
 }
 
-static void ws_make_mask_key(uint8_t key[4]) {
-	/* Simple rand-based; seed rand() in main */
-	key[0] = (uint8_t) (rand() & 0xFF);
-	key[1] = (uint8_t) (rand() & 0xFF);
-	key[2] = (uint8_t) (rand() & 0xFF);
-	key[3] = (uint8_t) (rand() & 0xFF);
+static int ws_make_mask_key(uint8_t key[4]) {
+	/* RFC 6455 5.3: masking keys must not be predictable. Without the DRBG
+	 * there is no such key: the frame is not sent. */
+	if (net_rng_bytes(key, 4) != NET_OK) {
+		msg_error("ws_make_mask_key: random generator failed, frame not sent\n");
+		return WS_ERR;
+	}
+	return WS_OK;
 }
 
 int ws_send_frame(net_sockhnd_t sock, ws_opcode_t opcode,
@@ -391,7 +393,8 @@ int ws_send_frame(net_sockhnd_t sock, ws_opcode_t opcode,
 	uint8_t mask_key[4] = { 0 };
 	if (mask_outgoing) {
 		hdr[1] |= 0x80;
-		ws_make_mask_key(mask_key);
+		if (ws_make_mask_key(mask_key) != WS_OK)
+			return WS_ERR;
 		memcpy(&hdr[hdr_len], mask_key, 4);
 		hdr_len += 4;
 	}